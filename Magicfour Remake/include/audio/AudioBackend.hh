@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+
+// Where the mixer writes its output, in interleaved 16-bit stereo at the mixer rate.
+// The device backend lives with the game's sound code; the ones here have no device,
+// so the mixer can be run headless.
+class AudioBackend
+{
+public:
+	virtual ~AudioBackend() = default;
+
+	// Frames the backend takes now without queuing too much. The mixer renders this many on Update.
+	virtual size_t GetWritableFrames() = 0;
+
+	virtual void Write(const int16_t* samples, size_t frame_count) = 0;
+};
+
+// Discards the output. Nothing is rendered on Update; call AudioMixer::Render directly.
+class NullAudioBackend : public AudioBackend
+{
+public:
+	size_t GetWritableFrames() override { return 0; }
+	void Write(const int16_t* /*samples*/, size_t frame_count) override { written_frames_ += frame_count; }
+
+	inline uint64_t GetWrittenFrames() const { return written_frames_; }
+
+private:
+	uint64_t written_frames_ = 0;
+};
+
+// Writes the output to a WAV file, completed when the backend is destroyed.
+// Like the null backend, it is driven by AudioMixer::Render.
+class WaveFileAudioBackend : public AudioBackend
+{
+public:
+	WaveFileAudioBackend(const char* filename, uint32_t sample_rate);
+	~WaveFileAudioBackend() override;
+
+	size_t GetWritableFrames() override { return 0; }
+	void Write(const int16_t* samples, size_t frame_count) override;
+
+private:
+	void WriteHeader();
+
+	std::ofstream file_;
+	uint32_t sample_rate_;
+	uint64_t written_frames_ = 0;
+};
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "util/MemoryReport.hh"
+
+// Samples of a sound at the rate of its file, mono or stereo.
+// The mixer resamples and upmixes while mixing, so a clip is stored as compact as its source allows.
+class AudioClip
+{
+public:
+	// How the samples are kept between plays.
+	enum class Storage
+	{
+		kPcm,       // Decoded to 16-bit PCM
+		kImaAdpcm,  // IMA ADPCM blocks at a quarter of the size, decoded block by block while playing
+		kStream,    // Left in the file, and read ahead in chunks by the stream thread while playing
+	};
+
+	AudioClip(uint32_t sample_rate, uint32_t channel_count, std::vector<int16_t> samples);
+	AudioClip(const AudioClip&) = delete;
+
+	// Parse the bytes of a RIFF WAVE file of 8-bit, 16-bit or 32-bit float PCM, or IMA ADPCM.
+	// PCM is compressed for kImaAdpcm. IMA ADPCM files are kept as they are, even for kStream.
+	// A streamed clip reads the bytes in place and keeps owner, which must keep them alive;
+	// without an owner it keeps a copy of its samples. filename is only used for errors.
+	static std::shared_ptr<AudioClip> LoadWave(std::string_view bytes, const std::string& filename,
+		Storage storage = Storage::kPcm, std::shared_ptr<const void> owner = nullptr);
+
+	inline Storage GetStorage() const { return storage_; }
+	inline uint32_t GetSampleRate() const { return sample_rate_; }
+	inline uint32_t GetChannelCount() const { return channel_count_; }
+	inline size_t GetFrameCount() const { return frame_count_; }
+
+	// kPcm only.
+	inline const int16_t* GetSamples() const { return samples_.data(); }
+
+	// kImaAdpcm only. Decode the block to GetFramesPerBlock frames; the last may run past the clip.
+	inline size_t GetFramesPerBlock() const { return frames_per_block_; }
+	void DecodeBlock(size_t block, int16_t* frames) const;
+
+	// kStream only. Convert frame_count frames from first_frame, all within the clip.
+	void ReadFrames(size_t first_frame, size_t frame_count, int16_t* frames) const;
+
+	// A streamed file is mapped, and only its pages being read are resident.
+	inline MemoryUsage GetMemoryUsage() const
+	{
+		return { sizeof(*this) + samples_.capacity() * sizeof(int16_t) + blocks_.capacity(), 0 };
+	}
+
+private:
+	// Sample formats of PCM files.
+	enum class SampleFormat
+	{
+		kInt16,
+		kUInt8,
+		kFloat32,
+	};
+
+	AudioClip(uint32_t sample_rate, uint32_t channel_count);
+
+	static void ConvertSamples(SampleFormat format, const uint8_t* source, size_t sample_count, int16_t* samples);
+
+	Storage storage_ = Storage::kPcm;
+	uint32_t sample_rate_;
+	uint32_t channel_count_;
+	size_t frame_count_ = 0;
+
+	// kPcm
+	std::vector<int16_t> samples_;
+
+	// kImaAdpcm
+	std::vector<uint8_t> blocks_;
+	size_t block_bytes_ = 0;
+	size_t frames_per_block_ = 0;
+
+	// kStream
+	std::shared_ptr<const void> stream_owner_;
+	const uint8_t* stream_data_ = nullptr;
+	SampleFormat stream_format_ = SampleFormat::kInt16;
+};
@@ -0,0 +1,135 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "util/MemoryReport.hh"
+
+class AudioClip;
+class AudioBackend;
+class AudioStream;
+class AudioStreamThread;
+
+// Mixes clips in software into one stereo stream for the backend.
+// Voices come from a fixed pool. Each sound has an instance limit, and when the pool is full,
+// a voice of lower priority is stolen. Identical sounds triggered close together are coalesced,
+// since more copies of the same sample starting at once only make it louder.
+// Streamed clips get a stream per voice, filled on a background thread unless streams are
+// filled inline, which keeps headless renders deterministic.
+// Not thread-safe; play and update from one thread, or under one lock as SoundClass does.
+class AudioMixer
+{
+public:
+	static constexpr uint32_t kSampleRate = 44100;
+	static constexpr uint32_t kChannelCount = 2;
+
+	using VoiceHandle = uint32_t;
+	static constexpr VoiceHandle kNoVoice = UINT32_MAX;
+
+	// How a sound is played, set per sound id.
+	struct SoundSettings
+	{
+		int priority = 0;              // Higher steals voices from lower
+		uint32_t max_instances = 4;    // Playing at once; the oldest is restarted over this
+		float gain = 1.0f;
+		float coalesce_ms = 15.0f;     // Triggers this close to a playing instance are merged into it
+	};
+
+	struct Stats
+	{
+		size_t plays = 0;
+		size_t coalesced = 0;         // Triggers merged into an instance just started
+		size_t instance_limited = 0;  // Instances restarted by the instance limit
+		size_t stolen = 0;            // Voices taken from sounds of lower priority
+		size_t rejected = 0;          // Triggers dropped as every voice has higher priority
+		size_t peak_voices = 0;
+		size_t stream_underruns = 0;  // Chunks a stream had nothing read ahead for
+	};
+
+	AudioMixer(std::unique_ptr<AudioBackend> backend, size_t voice_count = 32, bool stream_thread = true);
+	AudioMixer(const AudioMixer&) = delete;
+	~AudioMixer();
+
+	void SetSoundSettings(uint64_t sound_id, const SoundSettings& settings);
+
+	// sound_id identifies the sound for its settings, limits and coalescing, e.g. a ResourceId.
+	// Returns kNoVoice if the trigger is rejected; a coalesced trigger returns the voice it joined.
+	VoiceHandle Play(uint64_t sound_id, std::shared_ptr<const AudioClip> clip, bool loop = false);
+	void Stop(VoiceHandle voice);
+	bool IsPlaying(VoiceHandle voice) const;
+
+	inline void SetMasterGain(float gain) { master_gain_ = gain; }
+
+	// Render as many frames as the backend takes now.
+	void Update();
+
+	// Render frame_count frames to the backend, whatever it asks for.
+	void Render(size_t frame_count);
+
+	inline const Stats& GetStats() const { return stats_; }
+	size_t GetActiveVoiceCount() const;
+	inline uint64_t GetRenderedFrames() const { return rendered_frames_; }
+
+	// Decode buffers of the voices and read-ahead of the playing streams.
+	MemoryUsage GetMemoryUsage() const;
+
+private:
+	struct Voice
+	{
+		std::shared_ptr<const AudioClip> clip;
+		uint64_t sound_id = 0;
+		int priority = 0;
+		float gain = 1.0f;
+		bool loop = false;
+
+		// Frame position in 32.32 fixed point, advanced by step per output frame.
+		uint64_t position = 0;
+		uint64_t step = 0;
+
+		uint64_t start_frame = 0;  // rendered_frames_ when it was triggered
+		uint32_t generation = 0;   // Tells a stale handle from the current voice
+
+		// The frame before the position, which it is interpolated from.
+		int16_t history[2] = {};
+
+		// Block of an IMA ADPCM clip decoded last.
+		std::vector<int16_t> decoded;
+		size_t decoded_block = SIZE_MAX;
+
+		// Stream of a streamed clip, and the frames drained from it.
+		std::shared_ptr<AudioStream> stream;
+		uint64_t stream_frame = 0;
+	};
+
+	const SoundSettings& GetSettings(uint64_t sound_id) const;
+	size_t AllocateVoice(const SoundSettings& settings);
+
+	void ReleaseVoice(Voice& voice);
+
+	// Frames from frame on that are at hand without a copy. Returns 0 at the end,
+	// or for a stream, when it has nothing read ahead.
+	size_t FetchFrames(Voice& voice, uint64_t frame, const int16_t** frames);
+
+	// Add the voice to mix_, and return false when it has ended.
+	bool MixVoice(Voice& voice, float* mix, size_t frame_count);
+
+	inline VoiceHandle MakeHandle(size_t index) const
+	{
+		return static_cast<VoiceHandle>((voices_[index].generation << 16) | index);
+	}
+
+	std::unique_ptr<AudioBackend> backend_;
+	std::vector<Voice> voices_;
+	std::unique_ptr<AudioStreamThread> stream_thread_;
+	bool threaded_streams_;
+	std::unordered_map<uint64_t, SoundSettings> settings_;
+
+	float master_gain_ = 1.0f;
+	uint64_t rendered_frames_ = 0;
+	Stats stats_;
+
+	std::vector<float> mix_;
+	std::vector<int16_t> output_;
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fixed ring of interleaved 16-bit frames between one producer thread and one consumer thread.
+// Each side peeks a contiguous span up to the wrap, fills or reads it, then commits or consumes.
+class AudioRingBuffer
+{
+public:
+	AudioRingBuffer(size_t frame_capacity, uint32_t channel_count);
+	AudioRingBuffer(const AudioRingBuffer&) = delete;
+
+	size_t GetReadableFrames() const;
+	size_t GetWritableFrames() const;
+
+	// Consumer side.
+	size_t PeekRead(const int16_t** frames) const;
+	void Consume(size_t frame_count);
+
+	// Producer side.
+	size_t PeekWrite(int16_t** frames);
+	void Commit(size_t frame_count);
+
+	inline size_t GetCapacity() const { return capacity_; }
+	inline size_t GetSizeInBytes() const { return samples_.capacity() * sizeof(int16_t); }
+
+private:
+	std::vector<int16_t> samples_;
+	size_t capacity_;
+	uint32_t channel_count_;
+
+	// Frames read and written since the start; their difference is what is buffered.
+	std::atomic<uint64_t> read_{ 0 };
+	std::atomic<uint64_t> write_{ 0 };
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "audio/AudioRingBuffer.hh"
+
+class AudioClip;
+
+// One playing instance of a streamed clip, read from its file into a ring of two chunks.
+// While the mixer drains one chunk, the other is refilled, so only the ring is resident.
+// Fill runs on the producer thread and the buffer is drained on the mixer thread.
+class AudioStream
+{
+public:
+	static constexpr size_t kChunkFrames = 4096;
+
+	AudioStream(std::shared_ptr<const AudioClip> clip, bool loop);
+	AudioStream(const AudioStream&) = delete;
+
+	// Read the next chunk if a whole one fits. Returns false if nothing was read.
+	bool Fill();
+
+	inline AudioRingBuffer& GetBuffer() { return buffer_; }
+
+	// Every frame of a stream not looping was read and drained.
+	inline bool IsFinished() const
+	{
+		return end_of_clip_.load(std::memory_order_acquire) && buffer_.GetReadableFrames() == 0;
+	}
+
+	// The mixer is done with the stream, and the stream thread drops it.
+	inline void Close() { closed_ = true; }
+	inline bool IsClosed() const { return closed_; }
+
+private:
+	std::shared_ptr<const AudioClip> clip_;
+	bool loop_;
+
+	AudioRingBuffer buffer_;
+	size_t read_frame_ = 0;
+
+	std::atomic<bool> end_of_clip_{ false };
+	std::atomic<bool> closed_{ false };
+};
+
+// Thread filling the open streams, woken by the mixer after it drains them
+// and every few milliseconds otherwise.
+class AudioStreamThread
+{
+public:
+	AudioStreamThread();
+	AudioStreamThread(const AudioStreamThread&) = delete;
+	~AudioStreamThread();
+
+	void Add(std::shared_ptr<AudioStream> stream);
+	void Notify();
+
+private:
+	void ThreadMain();
+
+	std::vector<std::shared_ptr<AudioStream> > streams_;
+
+	std::mutex mutex_;
+	std::condition_variable condition_;
+	bool notified_ = false;
+	bool stopping_ = false;
+
+	std::thread thread_;
+};
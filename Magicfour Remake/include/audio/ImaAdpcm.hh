@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// IMA ADPCM in the block layout of WAVE_FORMAT_IMA_ADPCM files, 4 bits per sample.
+// Each block starts with the first sample and step index of every channel,
+// so any block decodes on its own.
+class ImaAdpcm
+{
+public:
+	// Block size written by the encoder, as most tools use.
+	static constexpr size_t kBlockBytesPerChannel = 256;
+
+	// Frames in a block of block_bytes, or 0 if the size is not a valid block.
+	static size_t GetFramesPerBlock(size_t block_bytes, uint32_t channel_count);
+
+	// Encode interleaved frames to blocks of kBlockBytesPerChannel * channel_count bytes.
+	// The last block is padded with silence.
+	static std::vector<uint8_t> Encode(const int16_t* samples, size_t frame_count, uint32_t channel_count);
+
+	// Decode one block of mono or stereo to GetFramesPerBlock(block_bytes, channel_count) interleaved frames.
+	static void DecodeBlock(const uint8_t* block, size_t block_bytes, uint32_t channel_count, int16_t* frames);
+};
@@ -1,10 +1,13 @@
 #pragma once
+#include <istream>
 #include <vector>
 #include <memory>
 #include <string>
 
 #include <DirectXMath.h>
 
+#include "util/MemoryReport.hh"
+
 enum channel_t
 {
 	ANIMATION_CHANNEL_XPOS,
@@ -17,6 +20,15 @@ enum channel_t
 
 class AnimatedObjectClass
 {
+public:
+	// Local transform of a joint relative to its parent,
+	// already including the link offset of the joint.
+	struct JointPose
+	{
+		DirectX::XMFLOAT4 rotation;		// quaternion
+		DirectX::XMFLOAT3 translation;
+	};
+
 private:
 	using XMMATRIX = DirectX::XMMATRIX;
 
@@ -39,7 +51,7 @@ private:
 		XMMATRIX global_transform;
 
 		AnimationNode(std::string name, AnimationNode* parent)
-			: name(name), parent(parent), channels(nullptr)
+			: name(name), parent(parent), channel_num(0), channels(nullptr)
 		{
 			global_transform = link_matrix = DirectX::XMMatrixIdentity();
 		};
@@ -52,15 +64,39 @@ private:
 	AnimationNode root;
 	vector<AnimationNode* > nodes;
 
+	// Raw channel values, only kept until BuildFramePoses has converted them.
 	float* frame_info;
 
+	// Pre-converted local pose of every node for every frame.
+	// The pose of node j at frame f is frame_poses[f * nodes.size() + j].
+	vector<JointPose> frame_poses;
+
 
 private:
 	AnimationNode* create_hierarchy(
-		AnimationNode* curr_node, std::ifstream& fin);
+		AnimationNode* curr_node, std::istream& fin);
+
+	// Convert channel values of frame_info into quaternion/translation poses.
+	void BuildFramePoses();
 
 public:
-	void UpdateGlobalMatrices(const int frame, XMMATRIX, vector<XMMATRIX>& result);
+	inline int GetFrameCount() const { return frames_num; }
+	inline size_t GetJointCount() const { return nodes.size(); }
+
+	MemoryUsage GetMemoryUsage() const;
+
+	// Sample the local pose at fractional 'frame', interpolating between
+	// two neighboring frames. The frame wraps around the clip length.
+	void SamplePose(float frame, vector<JointPose>& pose) const;
+
+	// Blend 'pose' toward 'target' by 'weight' (0 keeps pose, 1 gives target).
+	// Both poses should be sampled from clips with the same hierarchy; joints of
+	// 'pose' beyond those of 'target' are kept as they are.
+	static void BlendPose(vector<JointPose>& pose,
+		const vector<JointPose>& target, float weight);
+
+	void UpdateGlobalMatrices(const vector<JointPose>& pose, XMMATRIX, vector<XMMATRIX>& result);
+	void UpdateGlobalMatrices(float frame, XMMATRIX, vector<XMMATRIX>& result);
 
 	AnimatedObjectClass(const char* filename);
 	~AnimatedObjectClass();
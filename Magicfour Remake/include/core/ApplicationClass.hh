@@ -12,6 +12,7 @@
 
 #include "shader/ShaderManager.hh"
 #include "util/ResourceMap.hh"
+#include "util/ResourceStreamer.hh"
 #include "core/global.hh"
 
 
@@ -40,19 +41,31 @@ private:
 	void GameFrame(class InputClass* input);
 	void Render();
 
+	// Resident memory of every loaded asset, per ResourceMap and owner.
+	void WriteMemoryReport(const char* filename) const;
+
 private:
 	GameState game_state_;
 	time_t	state_start_time_;
 
 	unique_ptr<class D3DClass>			direct3D_;
 	unique_ptr<class D2DClass>			direct2D_;
+
+	// Outlives the models, which release their buffers on it.
+	unique_ptr<class RenderDevice>		render_device_;
 	unique_ptr<class SoundClass>		sound_;
 
 	unique_ptr<class CameraClass>		camera_;
 
+	unique_ptr<class ResourceManifest>	manifest_;
+
 	ResourceMap<class ModelClass>		models_;
 	ResourceMap<class TextureClass>		textures_;
 
+	unique_ptr<ResourceStreamer<class ModelClass> >		model_streamer_;
+	unique_ptr<ResourceStreamer<class TextureClass> >	texture_streamer_;
+	bool memory_report_written_;
+
 	unique_ptr<class LightClass>		light_;
 	unique_ptr<class ShaderManager>		shader_manager_;
 
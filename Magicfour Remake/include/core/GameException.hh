@@ -4,7 +4,9 @@
 #include <string>
 #include <cstring>
 #include <ostream>
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 #define WIDE2(x) L##x
 #define WIDE(x) WIDE2(x)
@@ -12,7 +14,8 @@
 
 #define GAME_EXCEPTION(ERROR_MESSAGE) GameException(ERROR_MESSAGE, WFILE, __LINE__)
 
-class GameException : public std::exception
+// Carries a wide message for the error dialog. Builds without Windows, for the headless tools and tests.
+class GameException : public std::runtime_error
 {
 	std::wstring error_message;
 	std::wstring source_name;
@@ -21,12 +24,12 @@ class GameException : public std::exception
 public:
 	GameException(const wchar_t* error_message,
 		const wchar_t* source_name = L"", const int line_no = 0)
-		: std::exception("Game Exception"), error_message(error_message),
+		: std::runtime_error("Game Exception"), error_message(error_message),
 		source_name(source_name), line_no(line_no) {}
 
 	GameException(const std::wstring& error_message,
 		const wchar_t* source_name = L"", const int line_no = 0)
-		: std::exception("Game Exception"), error_message(error_message),
+		: std::runtime_error("Game Exception"), error_message(error_message),
 		source_name(source_name), line_no(line_no) {}
 
 	inline std::wstring to_wstring() const
@@ -2,8 +2,10 @@
 
 #include "core/global.hh"
 #include "IGameObject.hh"
+#include "TransformCache.hh"
 
 #include <cmath>
+#include <tuple>
 
 template <typename STATE_TYPE>
 class RigidbodyClass : public IGameObject
@@ -42,7 +44,10 @@ public:
 
 	inline XMMATRIX GetLocalWorldMatrix() const
 	{
-		return DirectX::XMMatrixTranslation(position_.x * kScope, position_.y * kScope, 0);
+		return local_world_matrix_.Get({ position_.x, position_.y }, [this]()
+			{
+				return DirectX::XMMatrixTranslation(position_.x * kScope, position_.y * kScope, 0);
+			});
 	}
 
 	virtual rect_t GetGlobalRange() const override final
@@ -52,7 +57,8 @@ public:
 
 	inline XMMATRIX GetRangeRepresentMatrix() const
 	{
-		return range_.add(position_.x, position_.y).toMatrix();
+		const rect_t range = range_.add(position_.x, position_.y);
+		return range_matrix_.Get({ range.x1, range.y1, range.x2, range.y2 }, [&range]() { return range.toMatrix(); });
 	}
 
 	// Returns position_ field.
@@ -109,4 +115,9 @@ protected:
 
 	STATE_TYPE		state_;
 	time_t			state_start_time_;
+
+private:
+	// Shared by drawing and the UI, and rebuilt when the position or range changes.
+	CachedMatrix<std::tuple<int, int> > local_world_matrix_;
+	CachedMatrix<std::tuple<int, int, int, int> > range_matrix_;
 };
\ No newline at end of file
@@ -1,10 +1,16 @@
 #pragma once
 
-#include "../third-party/Audio.h"
+#include "audio/AudioMixer.hh"
 #include "util/ResourceMap.hh"
 
-#include <vector>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace DirectX { class AudioEngine; }
+class AudioClip;
 
 class SoundClass
 {
@@ -14,16 +20,33 @@ private:
 	using unique_ptr = std::unique_ptr<T>;
 
 public:
-	SoundClass();
+	SoundClass(const class ResourceManifest& manifest);
 	~SoundClass();
 
-	void PlayBackground(const std::string& background_music);
-	void PlayEffect(const std::string& effect);
+	void PlayBackground(ResourceId background_music);
+	void PlayEffect(ResourceId effect);
+
+	// Call once per frame. The mixer is fed to the device on its own thread,
+	// so a long frame does not starve the device queue.
+	void Update();
+
+	AudioMixer::Stats GetMixerStats() const;
+
+	void AddToReport(class MemoryReport& report) const;
 
 private:
+	void MixerThreadMain();
+
 	unique_ptr<DirectX::AudioEngine> aud_engine_;
+	unique_ptr<AudioMixer> mixer_;
+
+	// Guards mixer_, which is played on the game thread and rendered on the mixer thread.
+	mutable std::mutex mixer_mutex_;
+	std::condition_variable mixer_condition_;
+	bool stopping_ = false;
+	std::thread mixer_thread_;
 
-	ResourceMap<DirectX::SoundEffect> sounds_;
+	ResourceMap<AudioClip> sounds_;
 
-	unique_ptr<DirectX::SoundEffectInstance> background_loop_;
-};
\ No newline at end of file
+	AudioMixer::VoiceHandle background_voice_ = AudioMixer::kNoVoice;
+};
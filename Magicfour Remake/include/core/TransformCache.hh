@@ -0,0 +1,61 @@
+#pragma once
+
+#include <directxmath.h>
+
+#include <atomic>
+#include <cstddef>
+
+// Counts of the matrices of game objects reused from a CachedMatrix, and rebuilt, per frame.
+class TransformCache
+{
+public:
+	struct Stats
+	{
+		size_t reused = 0;
+		size_t rebuilt = 0;
+	};
+
+	// Keep the counts so far as those of the last frame, and count again.
+	static void BeginFrame();
+	static inline const Stats& GetLastFrameStats() { return last_frame_; }
+
+	static void AddToReport(class MemoryReport& report);
+
+protected:
+	// Objects are drawn on several threads at once.
+	static std::atomic<size_t> reused_;
+	static std::atomic<size_t> rebuilt_;
+
+private:
+	static Stats last_frame_;
+};
+
+// A matrix of an object, built again only when the values it is built from change.
+// Key holds those values, e.g. a position, and is compared on every get, so nothing has to
+// invalidate the matrix where the values are written. An object is used by one thread at a time.
+template<typename Key>
+class CachedMatrix : private TransformCache
+{
+public:
+	// The matrix for key, from build() if key differs from the one it was built for.
+	template<typename Build>
+	const DirectX::XMMATRIX& Get(const Key& key, Build build) const
+	{
+		if (valid_ && key_ == key)
+		{
+			reused_.fetch_add(1, std::memory_order_relaxed);
+			return matrix_;
+		}
+
+		matrix_ = build();
+		key_ = key;
+		valid_ = true;
+		rebuilt_.fetch_add(1, std::memory_order_relaxed);
+		return matrix_;
+	}
+
+private:
+	mutable DirectX::XMMATRIX matrix_;
+	mutable Key key_{};
+	mutable bool valid_ = false;
+};
@@ -3,11 +3,13 @@
 
 #include <memory>
 #include <vector>
+#include <tuple>
 #include <utility>
 
 #include "core/global.hh"
 #include "core/RigidbodyClass.hh"
 #include "core/Skill.hh"
+#include "core/TransformCache.hh"
 #include "util/ResourceMap.hh"
 
 enum class CharacterState
@@ -46,6 +48,9 @@ public:
 		ResourceMap<class ModelClass>& models, ResourceMap<class TextureClass>& textures) const override final;
 	
 	void GetShapeMatrices(time_t curr_time, vector<XMMATRIX>& shape_matrices) const;
+
+	// Animation clips are owned by the character, not by a ResourceMap.
+	void AddToReport(class MemoryReport& report) const;
 	inline time_t GetTimeInvincibleEnd() const { return time_invincible_end_; }
 
 
@@ -55,6 +60,7 @@ public:
 
 	float GetCooltimeGaugeRatio(time_t curr_time) const;
 	float GetInvincibleGaugeRatio(time_t curr_time) const;
+	// Drawn, and projected by the UI, in the same frame.
 	XMMATRIX GetSkillStonePos(time_t curr_time) const;
 
 	SkillBonus LearnSkill(int skill_id, time_t curr_time);
@@ -118,6 +124,15 @@ private:
 		vector<unique_ptr<class IGameObject> >& skill_objs,
 		class SoundClass* sound);
 
+	// Returns the animation clip to be played on 'state',
+	// with the fractional frame and root rotation for 'state_time' milliseconds.
+	class AnimatedObjectClass* GetStateAnimation(CharacterState state,
+		time_t state_time, float& frame, float& root_angle) const;
+
+	// Should be called whenever state_ might be changed,
+	// to cross-fade animation from the previous state.
+	void OnStateChanged(CharacterState prev_state, time_t prev_state_start_time, time_t curr_time);
+
 private:
 	int jump_cnt;
 	unsigned int score_, combo_;
@@ -134,6 +149,12 @@ private:
 	time_t time_skill_available_;
 	time_t time_skill_ended_;
 
+	// The state from which animation is being blended,
+	// and the time when the blending started.
+	CharacterState blend_from_state_;
+	time_t blend_from_state_start_time_;
+	time_t blend_start_time_;
+
 
 	unique_ptr<class SkillObjectGuardian> guardians_[2];
 
@@ -148,6 +169,9 @@ private:
 	class SoundClass* sound;
 
 	vector<unique_ptr<class IGameObject> >& skill_objs;
+
+	// By time and position.
+	CachedMatrix<std::tuple<time_t, int, int> > skill_stone_pos_;
 };
 
 
@@ -1,8 +1,10 @@
 #pragma once
 #include "core/global.hh"
 #include "core/RigidbodyClass.hh"
+#include "core/TransformCache.hh"
 
 #include <memory>
+#include <tuple>
 #include <vector>
 
 enum class ItemState
@@ -39,4 +41,7 @@ public:
 private:
 	int type_;
 	time_t createTime_;
+
+	// Shape and place, by time and position.
+	CachedMatrix<std::tuple<time_t, int, int> > world_matrix_;
 };
\ No newline at end of file
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "SkillObjectClass.hh"
+#include "core/TransformCache.hh"
 
 #include <string>
+#include <tuple>
 
 class SkillObjectSpear : public SkillObjectClass
 {
@@ -28,9 +30,13 @@ public:
 	static void initialize(const std::string& model_name);
 
 private:
+	// Drawn and collided with, by angle and position.
+	const XMMATRIX& GetShape() const;
+
 	static std::string model_name_;
 
 	float angle_;
+	CachedMatrix<std::tuple<float, int, int> > shape_;
 };
 
 class SkillObjectBead : public SkillObjectClass
@@ -1,6 +1,8 @@
 #include <wrl.h>
 #include <string>
 
+#include "util/MemoryReport.hh"
+
 class BitmapClass
 {
 private:
@@ -10,13 +12,20 @@ private:
 public:
 	BitmapClass(class D2DClass* direct2d, const wchar_t* filename);
 	BitmapClass(class D2DClass* direct2d, const std::string& filename);
+	BitmapClass(class D2DClass* direct2d, struct IWICBitmap* image);
 	~BitmapClass() = default;
 	
+	// Decode an image to 32bpp PBGRA in memory. It does not need the render target,
+	// so it can be done on any thread.
+	static ComPtr<struct IWICBitmap> DecodeImageFile(struct IWICImagingFactory* wic_factory, const wchar_t* filename);
+
 	inline float GetWidth() { return width_; }
 	inline float GetHeight() { return height_; }
 
 	inline struct ID2D1Bitmap* GetBitmap() { return bitmap_.Get(); }
 
+	MemoryUsage GetMemoryUsage() const;
+
 private:
 	float width_, height_;
 	ComPtr<struct ID2D1Bitmap> bitmap_;
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "graphics/RenderDevice.hh"
+
+// Where constants were put in a ConstantRing, for the last upload.
+struct ConstantRange
+{
+	size_t offset = 0;
+	size_t size = 0;
+};
+
+// Per-draw constants, suballocated from one large dynamic constant buffer.
+// The constants of a batch of draws are staged on the CPU and written in one update, after
+// those of the batch before, and each draw binds its range. When the ring is full it starts
+// over, discarding what the GPU still reads.
+class ConstantRing
+{
+public:
+	ConstantRing(RenderDevice* device, size_t size);
+	ConstantRing(const ConstantRing&) = delete;
+	~ConstantRing();
+
+	// Stage constants for the next upload.
+	template<typename T>
+	inline ConstantRange Push(const T& constants) { return Stage(&constants, sizeof(T)); }
+
+	// Write the staged constants into the ring. Ranges pushed before are bound from here on.
+	void Upload();
+
+	void Bind(ShaderStage stage, uint32_t slot, ConstantRange range);
+
+private:
+	ConstantRange Stage(const void* constants, size_t size);
+
+	RenderDevice* device_;
+	BufferHandle buffer_;
+	size_t size_;
+
+	size_t head_ = 0;   // Where the next upload goes
+	size_t base_ = 0;   // Where the last one went
+
+	std::vector<uint8_t> staged_;
+};
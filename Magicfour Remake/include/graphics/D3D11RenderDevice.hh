@@ -0,0 +1,88 @@
+#pragma once
+
+#include "graphics/RenderDevice.hh"
+
+#include <d3d11_1.h>
+#include <wrl.h>
+
+#include <vector>
+
+// Constant buffer ranges are bound with the offsets of D3D11.1 where the driver has them.
+// Elsewhere a range is copied to a buffer of its slot when it is bound.
+class D3D11RenderDevice : public RenderDevice
+{
+private:
+	template<typename T>
+	using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+public:
+	// hwnd is where shader compile errors are shown.
+	D3D11RenderDevice(ID3D11Device* device, ID3D11DeviceContext* device_context, HWND hwnd);
+
+protected:
+	BufferHandle CreateBufferImpl(const BufferDesc& desc, const void* initial_data) override;
+	void ReleaseBufferImpl(BufferHandle buffer) override;
+	ShaderHandle CreateShaderImpl(const ShaderDesc& desc) override;
+	SamplerHandle CreateSamplerImpl(AddressMode mode) override;
+
+	void UpdateBufferImpl(BufferHandle buffer, const void* data, size_t size) override;
+	void WriteBufferImpl(BufferHandle buffer, size_t offset, const void* data, size_t size) override;
+
+	void SetShaderImpl(ShaderHandle shader) override;
+	void SetVertexBufferImpl(BufferHandle buffer, uint32_t stride, uint32_t slot) override;
+	void SetIndexBufferImpl(BufferHandle buffer, IndexFormat format) override;
+	void SetConstantBufferImpl(ShaderStage stage, uint32_t slot, BufferHandle buffer,
+		size_t offset, size_t size) override;
+	void SetTextureImpl(uint32_t slot, TextureView* texture) override;
+	void SetSamplerImpl(uint32_t slot, SamplerHandle sampler) override;
+
+	void DrawIndexedImpl(uint32_t index_count, uint32_t start_index, int32_t base_vertex) override;
+	void DrawIndexedInstancedImpl(uint32_t index_count, uint32_t instance_count,
+		uint32_t start_index, int32_t base_vertex, uint32_t start_instance) override;
+
+	void BeginFrameImpl() override;
+
+private:
+	struct Buffer
+	{
+		ComPtr<ID3D11Buffer> buffer;
+		BufferType type;
+		std::vector<uint8_t> shadow;  // Dynamic constant buffers, without constant buffer offsets
+	};
+
+	struct Shader
+	{
+		ComPtr<ID3D11VertexShader>	vertex_shader;
+		ComPtr<ID3D11PixelShader>	pixel_shader;
+		ComPtr<ID3D11InputLayout>	input_layout;
+	};
+
+	ComPtr<ID3DBlob> CompileShader(const wchar_t* filename, const char* target);
+	void OutputShaderErrorMessage(ID3DBlob* error_message, const wchar_t* shader_filename);
+
+	ID3D11Buffer* GetBuffer(BufferHandle buffer) const;
+
+	void BindConstantBuffer(ShaderStage stage, uint32_t slot, ID3D11Buffer* buffer);
+
+	ComPtr<ID3D11Device>			device_;
+	ComPtr<ID3D11DeviceContext>		device_context_;
+	ComPtr<ID3D11DeviceContext1>	device_context1_;
+	HWND hwnd_;
+
+	bool constant_ranges_ = false;
+
+	// Handle id - 1. Released buffer slots are reused.
+	std::vector<Buffer> buffers_;
+	std::vector<uint32_t> free_buffers_;
+
+	std::vector<Shader> shaders_;
+	std::vector<ComPtr<ID3D11SamplerState> > samplers_;
+
+	// Copies of constant buffer ranges, by stage and slot, when offsets are not there.
+	struct RangeBuffer
+	{
+		ComPtr<ID3D11Buffer> buffer;
+		size_t size = 0;
+	};
+	std::vector<RangeBuffer> range_buffers_;
+};
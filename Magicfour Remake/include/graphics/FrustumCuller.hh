@@ -3,34 +3,94 @@
 #include <directxmath.h>
 #include <DirectXCollision.h>
 
-#include <array>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <variant>
+#include <vector>
 
-struct FrustumCuller
+// Instances of a render queue tested against the frustum.
+struct CullStats
 {
-    FrustumCuller(const DirectX::XMMATRIX& vp_matrix) : frustum(vp_matrix) {};
+    size_t visible = 0;
+    size_t culled = 0;
+};
+
+// Tests bounding volumes against the six planes of a view-projection matrix.
+// Instances are culled in batches: the box of each is moved to world space,
+// and four boxes are tested against a plane at once, one per SIMD lane.
+class FrustumCuller
+{
+public:
+    using BoundingVolume = std::variant<DirectX::BoundingBox, DirectX::BoundingSphere>;
+
+    static constexpr size_t kBatchSize = 4;
+
+    FrustumCuller(const DirectX::XMMATRIX& vp_matrix);
+
+    bool IsInFrustum(const BoundingVolume& bv,
+                     const DirectX::XMMATRIX& world_matrix = DirectX::XMMatrixIdentity()) const;
+
+    // Append the indices of the visible instances to visible, in order.
+    // get_volume(i) and get_world(i) return the model-space bounds and the world matrix of instance i.
+    template<typename VolumeGetter, typename WorldGetter>
+    void CullInstances(size_t count, VolumeGetter get_volume, WorldGetter get_world,
+                       std::vector<uint32_t>& visible, CullStats& stats) const;
+
+    // Center of the volume, in model space.
+    static DirectX::XMVECTOR GetCenter(const BoundingVolume& bv);
+
+    // Axis-aligned box around the volume placed at each of the world matrices, in world space.
+    static DirectX::BoundingBox GetWorldBounds(const BoundingVolume& bv, const std::vector<DirectX::XMMATRIX>& world_matrices);
+
+private:
+    // Spheres are culled by their bounding box, which is conservative.
+    static void GetLocalBox(const BoundingVolume& bv, DirectX::XMVECTOR& center, DirectX::XMVECTOR& extents);
+
+    // Axis-aligned box around the transformed one.
+    static void TransformBox(DirectX::FXMVECTOR center, DirectX::FXMVECTOR extents, const DirectX::XMMATRIX& world_matrix,
+                             DirectX::XMVECTOR& world_center, DirectX::XMVECTOR& world_extents);
+
+    // Bit i is set if box i is at least partly inside.
+    unsigned TestBatch(const DirectX::XMVECTOR centers[kBatchSize], const DirectX::XMVECTOR extents[kBatchSize]) const;
 
-    bool IsInFrustum(const std::variant<DirectX::BoundingBox, DirectX::BoundingSphere> bv,
-                        const DirectX::XMMATRIX& world_matrix = DirectX::XMMatrixIdentity()) const
+    // Plane coefficients, each splatted to every lane. A point is inside when a*x + b*y + c*z + d >= 0.
+    DirectX::XMVECTOR plane_a_[6], plane_b_[6], plane_c_[6], plane_d_[6];
+    DirectX::XMVECTOR abs_a_[6], abs_b_[6], abs_c_[6];
+};
+
+template<typename VolumeGetter, typename WorldGetter>
+inline void FrustumCuller::CullInstances(size_t count, VolumeGetter get_volume, WorldGetter get_world,
+                                         std::vector<uint32_t>& visible, CullStats& stats) const
+{
+    const size_t first_visible = visible.size();
+
+    DirectX::XMVECTOR centers[kBatchSize], extents[kBatchSize];
+    for (size_t first = 0; first < count; first += kBatchSize)
     {
-        switch(bv.index())
+        const size_t batch = (std::min)(kBatchSize, count - first);
+        for (size_t i = 0; i < batch; i++)
         {
-            case 0: // BoundingBox
-            {
-                DirectX::BoundingBox transformed_box;
-                std::get<DirectX::BoundingBox>(bv).Transform(transformed_box, world_matrix);
-                return frustum.Intersects(transformed_box);
-            }
-
-            case 1: // BoundingSphere
-            {
-                DirectX::BoundingSphere transformed_sphere;
-                std::get<DirectX::BoundingSphere>(bv).Transform(transformed_sphere, world_matrix);
-                return frustum.Intersects(transformed_sphere);
-            }
+            DirectX::XMVECTOR local_center, local_extents;
+            GetLocalBox(get_volume(first + i), local_center, local_extents);
+            TransformBox(local_center, local_extents, get_world(first + i), centers[i], extents[i]);
+        }
+
+        // Lanes past the end repeat the last box, and are ignored.
+        for (size_t i = batch; i < kBatchSize; i++)
+        {
+            centers[i] = centers[batch - 1];
+            extents[i] = extents[batch - 1];
+        }
+
+        const unsigned inside = TestBatch(centers, extents);
+        for (size_t i = 0; i < batch; i++)
+        {
+            if (inside & (1u << i)) visible.push_back(static_cast<uint32_t>(first + i));
         }
-        return false;
     }
 
-    DirectX::BoundingFrustum frustum;
-};
+    const size_t visible_count = visible.size() - first_visible;
+    stats.visible += visible_count;
+    stats.culled += count - visible_count;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "graphics/RenderDevice.hh"
+
+class ModelClass;
+
+// Per-instance data of a frame, packed on the CPU and uploaded in one update.
+// Batches draw ranges of it, from their first instance, with DrawIndexedInstanced.
+// The buffer grows to the most instances of a frame, and is kept.
+template<typename Instance>
+class InstanceBuffer
+{
+public:
+	explicit InstanceBuffer(RenderDevice* device) : device_(device) {}
+	InstanceBuffer(const InstanceBuffer&) = delete;
+	~InstanceBuffer() { device_->ReleaseBuffer(buffer_); }
+
+	inline Instance& Push() { return instances_.emplace_back(); }
+	inline uint32_t GetCount() const { return static_cast<uint32_t>(instances_.size()); }
+
+	// Upload the instances pushed, and bind them to the vertex buffer slot.
+	void Upload(uint32_t slot);
+
+	// Bind them again, after another instance buffer was drawn.
+	inline void Bind(uint32_t slot) { device_->SetVertexBuffer(buffer_, sizeof(Instance), slot); }
+
+	inline void Clear() { instances_.clear(); }
+
+private:
+	RenderDevice* device_;
+	BufferHandle buffer_;
+	size_t capacity_ = 0;
+
+	std::vector<Instance> instances_;
+};
+
+template<typename Instance>
+void InstanceBuffer<Instance>::Upload(uint32_t slot)
+{
+	if (instances_.empty()) return;
+
+	if (instances_.size() > capacity_)
+	{
+		device_->ReleaseBuffer(buffer_);
+		capacity_ = (std::max)(instances_.size(), capacity_ * 2);
+
+		BufferDesc desc;
+		desc.type = BufferType::kVertex;
+		desc.size = capacity_ * sizeof(Instance);
+		desc.dynamic = true;
+		buffer_ = device_->CreateBuffer(desc);
+	}
+
+	device_->UpdateBuffer(buffer_, instances_.data(), instances_.size() * sizeof(Instance));
+	Bind(slot);
+}
+
+// Instances of a model that never move, with their instance data uploaded once into a static buffer.
+// The batch is pushed as one command of its model, whose bounds enclose every instance,
+// and drawn with one draw.
+template<typename Instance>
+class StaticInstanceBatch
+{
+public:
+	StaticInstanceBatch(RenderDevice* device, const std::shared_ptr<ModelClass>& model,
+		const std::vector<Instance>& instances);
+	StaticInstanceBatch(const StaticInstanceBatch&) = delete;
+	~StaticInstanceBatch() { device_->ReleaseBuffer(buffer_); }
+
+	inline const std::shared_ptr<ModelClass>& GetModel() const { return model_; }
+	inline uint32_t GetCount() const { return count_; }
+
+	inline void Bind(uint32_t slot) const { device_->SetVertexBuffer(buffer_, sizeof(Instance), slot); }
+
+private:
+	RenderDevice* device_;
+	std::shared_ptr<ModelClass> model_;
+	BufferHandle buffer_;
+	uint32_t count_;
+};
+
+template<typename Instance>
+StaticInstanceBatch<Instance>::StaticInstanceBatch(RenderDevice* device, const std::shared_ptr<ModelClass>& model,
+	const std::vector<Instance>& instances)
+	: device_(device), model_(model), count_(static_cast<uint32_t>(instances.size()))
+{
+	if (instances.empty()) return;
+
+	BufferDesc desc;
+	desc.type = BufferType::kVertex;
+	desc.size = instances.size() * sizeof(Instance);
+	buffer_ = device_->CreateBuffer(desc, instances.data());
+}
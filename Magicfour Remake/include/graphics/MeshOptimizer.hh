@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Index buffer optimizations for the GPU post-transform vertex cache.
+// Everything here works on plain index lists, so it runs without a device.
+class MeshOptimizer
+{
+public:
+	// Weld vertices whose stride bytes are bitwise identical.
+	// indices gets the welded index of each of the vertex_count vertices, and the returned list
+	// has the first of the vertices welded into each, in the order of their welded indices.
+	static std::vector<uint32_t> WeldVertices(const void* vertices, size_t vertex_count, size_t stride, uint32_t* indices);
+
+	// Reorder triangles of indices in place for vertex cache locality,
+	// using Tom Forsyth's linear-speed vertex cache optimization.
+	static void OptimizeVertexCache(uint32_t* indices, size_t index_count, size_t vertex_count);
+
+	// Renumber vertices in the order they are first referenced, for vertex fetch locality.
+	// Returns the table from an old vertex index to the new one; indices are rewritten in place.
+	static std::vector<uint32_t> OptimizeVertexFetch(uint32_t* indices, size_t index_count, size_t vertex_count);
+
+	// Average cache miss ratio: transformed vertices per triangle, simulating a FIFO cache.
+	// 3.0 is the worst case (no reuse at all), and around 0.5 ~ 0.7 is the best for usual meshes.
+	static float CalculateACMR(const uint32_t* indices, size_t index_count, size_t vertex_count,
+		size_t cache_size = 16);
+};
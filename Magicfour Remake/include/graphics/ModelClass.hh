@@ -1,18 +1,22 @@
 #pragma
-#include <d3d11.h>
 #include <directxmath.h>
 #include <fstream>
-#include <wrl.h>
+#include <memory>
 #include <vector>
 #include <directxcollision.h>
 #include <variant>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "graphics/ObjParser.hh"
+#include "graphics/RenderDevice.hh"
+#include "util/FileSystem.hh"
+#include "util/MemoryReport.hh"
 
 class ModelClass
 {
 private:
-	template<typename T>
-	using ComPtr = Microsoft::WRL::ComPtr<T>;
-
 	template<typename T>
 	using unique_ptr = std::unique_ptr<T>;
 
@@ -34,28 +38,8 @@ private:
 		XMFLOAT3 binormal;
 	};
 
-	struct ModelType
-	{
-		float x, y, z;
-		float tu, tv;
-		float nx, ny, nz;
-
-		// For normal mapping.
-		float tx, ty, tz;
-		float bx, by, bz;
-	};
-
-	struct TempVertexType
-	{
-		float x, y, z;
-		float tu, tv;
-		float nx, ny, nz;
-	};
-
-	struct VectorType
-	{
-		float x, y, z;
-	};
+	// Triangle corners, as parsed.
+	using ModelType = ObjParser::Corner;
 
 	struct MaterialType
 	{
@@ -65,32 +49,63 @@ private:
 	};
 
 public:
-	ModelClass(ID3D11Device* device, const char* model_filename,
-		const wchar_t* diffuse_filename,
-		const wchar_t* normal_filename = nullptr,
-		const wchar_t* emissive_filename = nullptr
-	);
+	// Result of welding and reordering a mesh on load.
+	struct MeshStats
+	{
+		uint32_t source_vertex_count = 0; // Triangle corners in the source model.
+		uint32_t vertex_count = 0;        // Vertices left after welding identical ones.
+		uint32_t index_count = 0;
 
-	ModelClass(ID3D11Device* device,
+		// Average cache miss ratio of the welded mesh, before and after reordering triangles.
+		float acmr_before = 0.0f, acmr_after = 0.0f;
+
+		// Triangles given a fallback tangent space, as their texture coordinates are degenerate.
+		uint32_t degenerate_triangle_count = 0;
+
+		inline float GetVertexReduction() const
+		{
+			return source_vertex_count ? 1.0f - float(vertex_count) / source_vertex_count : 0.0f;
+		}
+	};
+
+public:
+	ModelClass(RenderDevice* device,
 		const std::string& model_filename,
-		const std::string& diffuse_filename,
-		const std::string& normal_filename = "",
-		const std::string& emissive_filename = ""
+		const std::shared_ptr<class TextureClass>& diffuse_texture,
+		const std::shared_ptr<class TextureClass>& normal_texture = nullptr,
+		const std::shared_ptr<class TextureClass>& emissive_texture = nullptr
 	);
 
-	ModelClass(ID3D11Device* device,
-		const std::string& model_filename,
+
+	// Load the model data only, without the device.
+	// CreateBuffers must be called before the model is rendered.
+	ModelClass(const std::string& model_filename,
+		const std::shared_ptr<class TextureClass>& diffuse_texture,
+		const std::shared_ptr<class TextureClass>& normal_texture = nullptr,
+		const std::shared_ptr<class TextureClass>& emissive_texture = nullptr
+	);
+
+	// Share the buffers of a loaded model, to draw the same geometry with other textures.
+	// The model is kept alive as long as this one.
+	ModelClass(const std::shared_ptr<const ModelClass>& geometry,
 		const std::shared_ptr<class TextureClass>& diffuse_texture,
 		const std::shared_ptr<class TextureClass>& normal_texture = nullptr,
 		const std::shared_ptr<class TextureClass>& emissive_texture = nullptr
 	);
 
+	// Share the buffers and textures of a loaded model, with other bounds.
+	// For instances baked in place, whose bounds enclose all of them in world space.
+	ModelClass(const std::shared_ptr<const ModelClass>& geometry, const DirectX::BoundingBox& bounds);
 
 	ModelClass(const ModelClass&) = delete;
 	~ModelClass();
 
+	void CreateBuffers(RenderDevice* device);
+	void SetTextures(const std::shared_ptr<class TextureClass>& diffuse_texture,
+		const std::shared_ptr<class TextureClass>& normal_texture = nullptr,
+		const std::shared_ptr<class TextureClass>& emissive_texture = nullptr);
 	void Shutdown();
-	void Render(ID3D11DeviceContext*);
+	void Render(RenderDevice*);
 
 	inline const vector<std::pair<MaterialType, int> >& GetMaterial()
 	{
@@ -98,9 +113,24 @@ public:
 	}
 
 	int GetIndexCount();
-	ID3D11ShaderResourceView* GetDiffuseTexture();
-	ID3D11ShaderResourceView* GetNormalTexture();
-	ID3D11ShaderResourceView* GetEmissiveTexture();
+	inline const MeshStats& GetMeshStats() const { return mesh_stats_; }
+
+	// Once the buffers are created, only the bounds and material ranges stay in system memory.
+	MemoryUsage GetMemoryUsage() const;
+
+	// Hash of the source model and its materials. Models loaded from identical sources
+	// have identical geometry, whatever their paths.
+	inline uint64_t GetContentHash() const { return source_hash_; }
+
+	// Size of the vertex and index buffers.
+	size_t GetGeometrySize() const;
+
+	// Small id to sort draws by, in creation order. Models sharing buffers share it.
+	inline uint32_t GetSortId() const { return sort_id_; }
+
+	TextureView* GetDiffuseTexture();
+	TextureView* GetNormalTexture();
+	TextureView* GetEmissiveTexture();
 
 	const std::variant<DirectX::BoundingBox, DirectX::BoundingSphere>& GetBoundingVolume() const
 	{
@@ -109,32 +139,53 @@ public:
 
 
 private:
-	void InitializeBuffers(ID3D11Device*);
-	void RenderBuffers(ID3D11DeviceContext*);
+	void LoadGeometry(const char* model_filename);
+
+	void BuildVertexStream(vector<VertexType>& vertices, vector<uint32_t>& indices);
+	void InitializeBuffers(RenderDevice*, const VertexType* vertices, const void* indices);
+	void RenderBuffers(RenderDevice*);
 
-	void LoadTextures(ID3D11Device* device,
-		const wchar_t* diffuse_filename,
-		const wchar_t* normal_filename,
-		const wchar_t* emissive_filename);
+	// Cooked mesh is a binary copy of the upload buffers, kept next to the source model.
+	static uint64_t HashModelSource(const char* model_filename);
+	bool LoadCookedModel(const char* cooked_filename, uint64_t source_hash);
+	void SaveCookedModel(const char* cooked_filename, uint64_t source_hash,
+		const vector<VertexType>& vertices, const void* indices) const;
 
 	void LoadModel(const char*);
 	void ReleaseModel();
 
 
 	void CalculateModelVectors();
-	void CalculateTangentBinormal(TempVertexType, TempVertexType, TempVertexType, VectorType&, VectorType&);
 
 
 private:
-	ComPtr<ID3D11Buffer> vertexBuffer_, indexBuffer_;
+	// The device the buffers are created on, to release them.
+	RenderDevice* device_ = nullptr;
+	BufferHandle vertex_buffer_, index_buffer_;
 	int vertexCount_, indexCount_;
+	IndexFormat index_format_;
+	MeshStats mesh_stats_;
+	uint64_t source_hash_;
+	uint32_t sort_id_;
+
+	// The model whose buffers are shared, if any.
+	std::shared_ptr<const ModelClass> geometry_source_;
 
 	std::shared_ptr<class TextureClass> diffuse_texture_;
 	std::shared_ptr<class TextureClass> normal_texture_;
 	std::shared_ptr<class TextureClass> emissive_texture_;
 
+	// Triangle corners of the source model, released as soon as the vertex stream is built.
 	vector<ModelType> model_;
 
+	// Upload-ready streams, kept from LoadGeometry until CreateBuffers.
+	// They point either into vertex_stream_/index_stream_ or into the cooked file.
+	const VertexType* staged_vertices_ = nullptr;
+	const void* staged_indices_ = nullptr;
+	vector<VertexType> vertex_stream_;
+	vector<char> index_stream_;
+	FileView cooked_file_;
+
 	vector<std::pair<MaterialType, int> > material_list_;
 	
 	std::variant<DirectX::BoundingBox, DirectX::BoundingSphere> bounding_volume_;
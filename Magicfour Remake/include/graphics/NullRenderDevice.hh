@@ -0,0 +1,101 @@
+#pragma once
+
+#include "graphics/RenderDevice.hh"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Device without a GPU, recording every call in order.
+// Buffers keep their last content, so what was uploaded can be inspected too.
+class NullRenderDevice : public RenderDevice
+{
+public:
+	// copies_constant_ranges acts as a D3D11 device without constant buffer offsets.
+	explicit NullRenderDevice(bool copies_constant_ranges = false);
+
+	enum class CallType
+	{
+		kCreateBuffer,
+		kReleaseBuffer,
+		kCreateShader,
+		kCreateSampler,
+		kUpdateBuffer,
+		kWriteBuffer,
+		kSetShader,
+		kSetVertexBuffer,
+		kSetIndexBuffer,
+		kSetConstantBuffer,
+		kSetTexture,
+		kSetSampler,
+		kDrawIndexed,
+		kDrawIndexedInstanced,
+		kBeginFrame,
+	};
+
+	// Arguments of a call. Fields a call has no use for stay 0.
+	struct Call
+	{
+		CallType type;
+		uint32_t handle = 0;    // Buffer, shader or sampler
+		uint32_t slot = 0;
+		uint64_t value = 0;     // Size, stride, format, stage, or the texture pointer
+		uint64_t offset = 0;    // Of a buffer write or constant buffer range
+		uint64_t size = 0;      // Of a constant buffer range; 0 is the whole buffer
+		uint32_t index_count = 0;
+		uint32_t start_index = 0;
+		int32_t base_vertex = 0;
+		uint32_t instance_count = 0;
+		uint32_t start_instance = 0;
+	};
+
+	inline const std::vector<Call>& GetCalls() const { return calls_; }
+	inline void ClearCalls() { calls_.clear(); }
+	size_t CountCalls(CallType type) const;
+
+	// Content of a buffer, as created or last updated.
+	const std::vector<uint8_t>& GetBufferData(BufferHandle buffer) const;
+	inline size_t GetLiveBufferCount() const { return live_buffer_count_; }
+
+	// One line per call, for comparing logs in tests.
+	std::string DumpCalls() const;
+
+protected:
+	BufferHandle CreateBufferImpl(const BufferDesc& desc, const void* initial_data) override;
+	void ReleaseBufferImpl(BufferHandle buffer) override;
+	ShaderHandle CreateShaderImpl(const ShaderDesc& desc) override;
+	SamplerHandle CreateSamplerImpl(AddressMode mode) override;
+
+	void UpdateBufferImpl(BufferHandle buffer, const void* data, size_t size) override;
+	void WriteBufferImpl(BufferHandle buffer, size_t offset, const void* data, size_t size) override;
+
+	void SetShaderImpl(ShaderHandle shader) override;
+	void SetVertexBufferImpl(BufferHandle buffer, uint32_t stride, uint32_t slot) override;
+	void SetIndexBufferImpl(BufferHandle buffer, IndexFormat format) override;
+	void SetConstantBufferImpl(ShaderStage stage, uint32_t slot, BufferHandle buffer,
+		size_t offset, size_t size) override;
+	void SetTextureImpl(uint32_t slot, TextureView* texture) override;
+	void SetSamplerImpl(uint32_t slot, SamplerHandle sampler) override;
+
+	void DrawIndexedImpl(uint32_t index_count, uint32_t start_index, int32_t base_vertex) override;
+	void DrawIndexedInstancedImpl(uint32_t index_count, uint32_t instance_count,
+		uint32_t start_index, int32_t base_vertex, uint32_t start_instance) override;
+
+	void BeginFrameImpl() override;
+
+private:
+	struct Buffer
+	{
+		BufferDesc desc;
+		std::vector<uint8_t> data;
+		bool live = false;
+	};
+
+	Buffer& GetBuffer(BufferHandle buffer);
+
+	std::vector<Call> calls_;
+	std::vector<Buffer> buffers_;  // Handle id - 1
+	size_t live_buffer_count_ = 0;
+	uint32_t shader_count_ = 0;
+	uint32_t sampler_count_ = 0;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Wavefront OBJ and MTL text parsed in place, without copying lines or going through streams.
+// Only the text is parsed here; the caller opens the files, so this builds on any platform.
+class ObjParser
+{
+public:
+	// Triangle corner. The tangent frame is left zero for TangentGenerator.
+	struct Corner
+	{
+		float x, y, z;
+		float tu, tv;
+		float nx, ny, nz;
+
+		// For normal mapping.
+		float tx, ty, tz;
+		float bx, by, bz;
+	};
+
+	struct Color
+	{
+		float r, g, b;
+	};
+
+	struct Material
+	{
+		Color ambient;
+		Color diffuse;
+		Color specular;
+	};
+
+	using MaterialMap = std::unordered_map<std::string, Material>;
+
+	struct Mesh
+	{
+		// Faces triangulated as fans, three corners per triangle.
+		std::vector<Corner> corners;
+
+		// Materials by usemtl, with the first corner drawn with each.
+		std::vector<std::pair<Material, int> > material_ranges;
+
+		// Bounds of the positions; min is over max if there are none.
+		float min[3], max[3];
+	};
+
+	// Called for each mtllib line with the library name, to add its materials.
+	using MaterialLoader = std::function<void(std::string_view library_name, MaterialMap& materials)>;
+
+	static const Material kDefaultMaterial;
+
+	// Returns false if a face refers to a position that does not exist.
+	static bool ParseModel(std::string_view text, const MaterialLoader& load_materials, Mesh& mesh);
+
+	static void ParseMaterials(std::string_view text, MaterialMap& materials);
+
+	// Library names of the mtllib lines, in order.
+	static std::vector<std::string_view> FindMaterialLibraries(std::string_view text);
+};
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Handle of a resource created by a RenderDevice. 0 is no resource.
+template <typename Tag>
+struct RenderHandle
+{
+	uint32_t id = 0;
+
+	explicit operator bool() const { return id != 0; }
+	bool operator==(RenderHandle other) const { return id == other.id; }
+	bool operator!=(RenderHandle other) const { return id != other.id; }
+};
+
+using BufferHandle = RenderHandle<struct BufferTag>;
+using ShaderHandle = RenderHandle<struct ShaderTag>;
+using SamplerHandle = RenderHandle<struct SamplerTag>;
+
+// Textures are created by TextureClass and bound as they are; an ID3D11ShaderResourceView on D3D11.
+class TextureView;
+
+enum class BufferType
+{
+	kVertex,
+	kIndex,
+	kConstant,
+};
+
+enum class IndexFormat
+{
+	kUInt16,
+	kUInt32,
+};
+
+enum class ShaderStage
+{
+	kVertex,
+	kPixel,
+};
+
+enum class AddressMode
+{
+	kWrap,
+	kClamp,
+};
+
+enum class VertexFormat
+{
+	kFloat2,
+	kFloat3,
+	kFloat4,
+};
+
+struct BufferDesc
+{
+	BufferType type;
+	size_t size;
+	bool dynamic = false;  // Rewritten by UpdateBuffer. Others keep their initial data.
+};
+
+// One vertex attribute. Attributes of a slot are packed in order.
+struct VertexElement
+{
+	const char* semantic;
+	uint32_t semantic_index;
+	VertexFormat format;
+	uint32_t slot = 0;
+	bool per_instance = false;
+};
+
+struct ShaderDesc
+{
+	const wchar_t* vs_filename;
+	const wchar_t* ps_filename;
+	const VertexElement* layout;
+	size_t layout_count;
+};
+
+// Device calls of a frame.
+struct RenderStats
+{
+	size_t draws = 0;
+	size_t instances = 0;
+	size_t indices = 0;
+
+	size_t shader_binds = 0;
+	size_t buffer_binds = 0;           // Vertex and index buffers
+	size_t constant_buffer_binds = 0;
+	size_t texture_binds = 0;
+	size_t sampler_binds = 0;
+	size_t redundant_binds = 0;        // Dropped, as the same was bound already
+
+	size_t buffer_updates = 0;         // Maps
+	size_t bytes_uploaded = 0;
+
+	inline size_t GetStateChanges() const
+	{
+		return shader_binds + buffer_binds + constant_buffer_binds + texture_binds + sampler_binds;
+	}
+};
+
+// What the renderer needs of a graphics API: buffers, constant updates, binds and draws.
+// Every call is counted here, whatever the backend, so the numbers of a frame are comparable
+// between the D3D11 device and the recording one used without a GPU.
+// Binds of what is bound already are dropped here too, before they reach the backend.
+class RenderDevice
+{
+public:
+	// Offsets and sizes of constant buffer ranges are multiples of this.
+	static constexpr size_t kConstantAlignment = 256;
+
+	RenderDevice() = default;
+	RenderDevice(const RenderDevice&) = delete;
+	virtual ~RenderDevice() = default;
+
+	// initial_data is size bytes, or null for a dynamic buffer.
+	BufferHandle CreateBuffer(const BufferDesc& desc, const void* initial_data = nullptr);
+	void ReleaseBuffer(BufferHandle buffer);
+
+	ShaderHandle CreateShader(const ShaderDesc& desc);
+	SamplerHandle CreateSampler(AddressMode mode);
+
+	// Replace the content of a dynamic buffer.
+	void UpdateBuffer(BufferHandle buffer, const void* data, size_t size);
+
+	// Write into a dynamic buffer without discarding the rest of it.
+	// The range must not be in use by draws already issued; for buffers filled front to back.
+	void WriteBuffer(BufferHandle buffer, size_t offset, const void* data, size_t size);
+
+	void SetShader(ShaderHandle shader);
+	void SetVertexBuffer(BufferHandle buffer, uint32_t stride, uint32_t slot = 0);
+	void SetIndexBuffer(BufferHandle buffer, IndexFormat format);
+	void SetConstantBuffer(ShaderStage stage, uint32_t slot, BufferHandle buffer);
+
+	// Bind size bytes of a constant buffer from offset, both multiples of kConstantAlignment.
+	void SetConstantBufferRange(ShaderStage stage, uint32_t slot, BufferHandle buffer, size_t offset, size_t size);
+
+	// Textures and samplers are bound to the pixel shader.
+	void SetTexture(uint32_t slot, TextureView* texture);
+	void SetSampler(uint32_t slot, SamplerHandle sampler);
+
+	void DrawIndexed(uint32_t index_count, uint32_t start_index = 0, int32_t base_vertex = 0);
+
+	// Draw instance_count instances, from start_instance of the per-instance vertex buffers.
+	void DrawIndexedInstanced(uint32_t index_count, uint32_t instance_count,
+		uint32_t start_index = 0, int32_t base_vertex = 0, uint32_t start_instance = 0);
+
+	// Restart the counters, and put the device in the state drawing expects.
+	// What was bound is forgotten, as others may use the device between frames.
+	void BeginFrame();
+	inline const RenderStats& GetFrameStats() const { return stats_; }
+
+protected:
+	// For backends that copy a constant buffer range where it is bound, rather than bind it in place.
+	// The copy is then of the content at the bind, so binds of a buffer are not cached across its updates.
+	inline void SetCopiesConstantRanges(bool copies) { copies_constant_ranges_ = copies; }
+
+	virtual BufferHandle CreateBufferImpl(const BufferDesc& desc, const void* initial_data) = 0;
+	virtual void ReleaseBufferImpl(BufferHandle buffer) = 0;
+	virtual ShaderHandle CreateShaderImpl(const ShaderDesc& desc) = 0;
+	virtual SamplerHandle CreateSamplerImpl(AddressMode mode) = 0;
+
+	virtual void UpdateBufferImpl(BufferHandle buffer, const void* data, size_t size) = 0;
+	virtual void WriteBufferImpl(BufferHandle buffer, size_t offset, const void* data, size_t size) = 0;
+
+	virtual void SetShaderImpl(ShaderHandle shader) = 0;
+	virtual void SetVertexBufferImpl(BufferHandle buffer, uint32_t stride, uint32_t slot) = 0;
+	virtual void SetIndexBufferImpl(BufferHandle buffer, IndexFormat format) = 0;
+	// A size of 0 binds the whole buffer.
+	virtual void SetConstantBufferImpl(ShaderStage stage, uint32_t slot, BufferHandle buffer,
+		size_t offset, size_t size) = 0;
+	virtual void SetTextureImpl(uint32_t slot, TextureView* texture) = 0;
+	virtual void SetSamplerImpl(uint32_t slot, SamplerHandle sampler) = 0;
+
+	virtual void DrawIndexedImpl(uint32_t index_count, uint32_t start_index, int32_t base_vertex) = 0;
+	virtual void DrawIndexedInstancedImpl(uint32_t index_count, uint32_t instance_count,
+		uint32_t start_index, int32_t base_vertex, uint32_t start_instance) = 0;
+
+	virtual void BeginFrameImpl() = 0;
+
+private:
+	// Bindings of the slots below this are cached.
+	static constexpr uint32_t kCachedSlots = 8;
+
+	// A binding and whether it is known. Set returns false if it was bound already.
+	template<typename T>
+	struct Cached
+	{
+		T value{};
+		bool known = false;
+
+		inline bool Set(const T& bound)
+		{
+			if (known && value == bound) return false;
+			value = bound;
+			known = true;
+			return true;
+		}
+	};
+
+	struct BufferBinding
+	{
+		BufferHandle buffer;
+		size_t offset = 0, size = 0;  // Constant buffer range, or the vertex stride
+		inline bool operator==(const BufferBinding& other) const
+		{
+			return buffer == other.buffer && offset == other.offset && size == other.size;
+		}
+	};
+
+	struct BoundState
+	{
+		Cached<ShaderHandle> shader;
+		Cached<BufferBinding> vertex_buffers[kCachedSlots];
+		Cached<BufferBinding> index_buffer;
+		Cached<BufferBinding> constant_buffers[2][kCachedSlots];  // By ShaderStage
+		Cached<TextureView*> textures[kCachedSlots];
+		Cached<SamplerHandle> samplers[kCachedSlots];
+	};
+
+	// Count the bind, or the drop of one already bound. Slots beyond the cache are always bound.
+	template<typename T>
+	bool Bind(Cached<T>* slots, uint32_t slot, const T& bound, size_t& counter);
+
+	// Forget where a buffer is bound, as its handle may be reused.
+	void ForgetBuffer(BufferHandle buffer);
+	void ForgetConstantBuffer(BufferHandle buffer);
+
+	RenderStats stats_;
+	BoundState bound_;
+	bool copies_constant_ranges_ = false;
+};
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <directxmath.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "graphics/FrustumCuller.hh"
+#include "util/RadixSort.hh"
+#include "util/ThreadPool.hh"
+
+enum class RenderPass : uint8_t
+{
+	kOpaque,
+	kTransparent,
+};
+
+enum class ShaderId : uint8_t
+{
+	kLight,
+	kNormalMap,
+	kStone,
+	kFire,
+};
+
+// Sort key of a render command. Opaque commands are drawn in ascending order of
+//   bits 63-60 pass, 59-56 shader, 55-40 material, 39-24 model and 23-0 depth,
+// so state changes least often, and within a pass, shader, material and model
+// the nearest is drawn first. Transparent ones must blend farthest first whatever their state,
+// so WithDepth moves their depth right below the pass:
+//   bits 63-60 pass, 59-36 depth from the far end, 35-32 shader, 31-16 material and 15-0 model.
+// Neighbours of the same state can still be drawn as one.
+struct RenderKey
+{
+	static constexpr uint64_t Make(RenderPass pass, ShaderId shader, uint32_t material, uint32_t model)
+	{
+		return (uint64_t(pass) << 60) | (uint64_t(shader) << 56)
+			| (uint64_t(material & 0xFFFF) << 40) | (uint64_t(model & 0xFFFF) << 24);
+	}
+
+	// 16 bits of the textures bound and the material range drawn.
+	// Textures are told apart by address; the same texture always gets the same bits.
+	static uint32_t HashMaterial(const void* texture, uint32_t material_index = 0)
+	{
+		const uint64_t hash = ((reinterpret_cast<uintptr_t>(texture) >> 4) ^ material_index) * 0x9E3779B97F4A7C15ull;
+		return static_cast<uint32_t>(hash >> 48);
+	}
+
+	static uint64_t WithDepth(uint64_t key, float view_depth)
+	{
+		// Bits of a positive float order like the float itself. The top 24 are kept.
+		uint32_t depth = 0;
+		if (view_depth > 0.0f)
+		{
+			memcpy(&depth, &view_depth, sizeof(depth));
+			depth >>= 8;
+		}
+
+		if (RenderPass(key >> 60) == RenderPass::kTransparent)
+		{
+			const uint64_t state = (key >> 24) & 0xFFFFFFFFFull;  // Shader, material and model
+			return (key & (uint64_t(0xF) << 60)) | (uint64_t(0xFFFFFF - depth) << 36) | state;
+		}
+		return (key & ~uint64_t(0xFFFFFF)) | depth;
+	}
+};
+
+// Cost of sorting a render queue: building the keys of the visible commands and sorting them.
+struct SortStats
+{
+	size_t sorted = 0;
+	float microseconds = 0.0f;
+};
+
+// Which command buffer of the render queues the calling thread pushes to.
+// Draw code run in parallel chunks pushes to the buffer of its chunk, and the buffers are
+// merged in chunk order, so the queue is the same whichever threads ran the chunks.
+// Everything else pushes to the first buffer.
+class RenderLane
+{
+public:
+	static constexpr uint32_t kCount = 16;
+
+	static inline uint32_t GetCurrent() { return current_; }
+
+	// Run draw(begin, end) over [0, count) on the pool, in at most kCount chunks of at least
+	// min_grain items, and wait for all of them. Chunk i pushes to lane i.
+	template<typename Draw>
+	static void ParallelFor(size_t count, size_t min_grain, Draw&& draw);
+
+private:
+	static inline thread_local uint32_t current_ = 0;
+};
+
+template<typename Draw>
+void RenderLane::ParallelFor(size_t count, size_t min_grain, Draw&& draw)
+{
+	const size_t grain = (std::max)(min_grain, (count + kCount - 1) / kCount);
+	ThreadPool::GetInstance().ParallelFor(count, grain, [&draw, grain](size_t begin, size_t end)
+		{
+			struct Scope
+			{
+				uint32_t previous = current_;
+				~Scope() { current_ = previous; }
+			} scope;
+
+			current_ = static_cast<uint32_t>(begin / grain);
+			draw(begin, end);
+		});
+}
+
+// Render commands of a frame, in arrays kept allocated from frame to frame.
+// Commands are pushed to the buffer of the current RenderLane, and merged when sorted.
+// Command needs a ModelClass* model, an XMMATRIX world_matrix, and a uint64_t key made with RenderKey::Make.
+// Commands point to their models, which the resource maps keep alive for the frame.
+template<typename Command>
+class RenderQueue
+{
+public:
+	inline Command& Push()
+	{
+		const uint32_t lane = RenderLane::GetCurrent();
+		return (lane ? lanes_[lane - 1].commands : commands_).emplace_back();
+	}
+
+	inline const Command& operator[](size_t index) const { return commands_[index]; }
+	inline size_t GetSize() const { return commands_.size(); }
+
+	// Merge the lanes, cull the commands, and sort the visible ones by key and depth.
+	// Returns them in draw order, as indices into the queue.
+	const std::vector<SortEntry>& Sort(const DirectX::XMMATRIX& vp_matrix, CullStats& cull_stats, SortStats& sort_stats);
+
+	// Call draw(first, count) for each run of sorted commands that can be drawn as one,
+	// as same_batch(a, b) tells of each command and the one before it.
+	// first is the position in order of the run's first command.
+	template<typename SameBatch, typename Draw>
+	void ForEachBatch(const std::vector<SortEntry>& order, SameBatch same_batch, Draw draw) const;
+
+	// Drop the commands once they are drawn.
+	inline void Clear() { commands_.clear(); }
+
+private:
+	// The first lane, and the others once merged.
+	std::vector<Command> commands_;
+
+	// The other lanes, padded apart, as they are pushed to at once.
+	struct alignas(64) Lane
+	{
+		std::vector<Command> commands;
+	};
+	Lane lanes_[RenderLane::kCount - 1];
+
+	std::vector<uint32_t> visible_;
+	std::vector<SortEntry> order_;
+	std::vector<SortEntry> scratch_;
+};
+
+template<typename Command>
+const std::vector<SortEntry>& RenderQueue<Command>::Sort(const DirectX::XMMATRIX& vp_matrix,
+	CullStats& cull_stats, SortStats& sort_stats)
+{
+	using namespace DirectX;
+
+	// In lane order, after the first.
+	for (Lane& lane : lanes_)
+	{
+		commands_.insert(commands_.end(), lane.commands.begin(), lane.commands.end());
+		lane.commands.clear();
+	}
+
+	cull_stats = CullStats();
+	visible_.clear();
+
+	FrustumCuller culler(vp_matrix);
+	culler.CullInstances(commands_.size(),
+		[this](size_t i) -> const auto& { return commands_[i].model->GetBoundingVolume(); },
+		[this](size_t i) -> const XMMATRIX& { return commands_[i].world_matrix; },
+		visible_, cull_stats);
+
+	const auto sort_start = std::chrono::steady_clock::now();
+
+	// The view depth of the center of the bounds is the w of its clip position.
+	// Not the model origin, as static batches are placed at the world origin.
+	const XMVECTOR depth_column = XMMatrixTranspose(vp_matrix).r[3];
+
+	order_.resize(visible_.size());
+	for (size_t i = 0; i < visible_.size(); i++)
+	{
+		const Command& command = commands_[visible_[i]];
+		const XMVECTOR center = XMVector3Transform(
+			FrustumCuller::GetCenter(command.model->GetBoundingVolume()), command.world_matrix);
+		const float view_depth = XMVectorGetX(XMVector4Dot(center, depth_column));
+
+		order_[i].key = RenderKey::WithDepth(command.key, view_depth);
+		order_[i].index = visible_[i];
+	}
+
+	RadixSort(order_, scratch_);
+
+	sort_stats.sorted = order_.size();
+	sort_stats.microseconds = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - sort_start).count();
+	return order_;
+}
+
+template<typename Command>
+template<typename SameBatch, typename Draw>
+void RenderQueue<Command>::ForEachBatch(const std::vector<SortEntry>& order, SameBatch same_batch, Draw draw) const
+{
+	size_t first = 0;
+	for (size_t i = 1; i <= order.size(); i++)
+	{
+		if (i < order.size() && same_batch(commands_[order[i - 1].index], commands_[order[i].index])) continue;
+
+		draw(static_cast<uint32_t>(first), static_cast<uint32_t>(i - first));
+		first = i;
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+
+// Per-vertex tangent frames for normal mapping, built in the manner of MikkTSpace.
+// Face tangents are weighted by the angle of each corner and summed over the corners
+// sharing position, texture coordinate, normal and handedness, then orthonormalized
+// against the normal. Corners that weld into one vertex thus get the same frame.
+class TangentGenerator
+{
+public:
+	// Attributes of triangle corners; every three consecutive corners form a triangle.
+	// Each attribute is read or written as floats, stride bytes apart per corner.
+	struct Corners
+	{
+		size_t count;
+		size_t stride;
+
+		const float* position; // x, y, z
+		const float* texture;  // u, v
+		const float* normal;   // x, y, z
+
+		float* tangent;        // x, y, z
+		float* binormal;       // x, y, z
+	};
+
+	struct Stats
+	{
+		size_t triangle_count;
+
+		// Triangles with zero area or collapsed texture coordinates, which add nothing to the frames.
+		size_t degenerate_triangle_count;
+
+		// Distinct frames, i.e. vertices after welding.
+		size_t frame_count;
+	};
+
+	// Triangles and frames are processed in parallel chunks on the worker pool.
+	static Stats Generate(const Corners& corners);
+};
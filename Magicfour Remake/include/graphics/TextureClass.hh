@@ -3,7 +3,14 @@
 #include <d3d11.h>
 #include <stdio.h>
 #include <wrl.h>
+#include <cstdint>
 #include <string>
+#include <memory>
+
+#include "graphics/RenderDevice.hh"
+#include "util/MemoryReport.hh"
+
+namespace DirectX { class ScratchImage; }
 
 template<typename T>
 using ComPtr = Microsoft::WRL::ComPtr<T>;
@@ -13,6 +20,7 @@ enum IMAGE_FILE_EXTENSION
     FILE_EXTENSION_JPEG,
     FILE_EXTENSION_PNG,
     FILE_EXTENSION_TGA,
+    FILE_EXTENSION_DDS,
     FILE_EXTENSION_UNKNOWN
 };
 
@@ -22,16 +30,30 @@ class TextureClass
 public:
     TextureClass(ID3D11Device* device, const wchar_t* filename);
     TextureClass(ID3D11Device* device, const std::string& filename);
+    TextureClass(ID3D11Device* device, const DirectX::ScratchImage& image, const std::wstring& filename);
     TextureClass(const TextureClass& other) = delete;
     ~TextureClass();
 
-    ID3D11ShaderResourceView* GetTexture();
+    // Decoding an image does not need the device, so it can be done on any thread.
+    // If prefer_cooked is set, the cooked DDS of the file is loaded instead when it is up to date.
+    static std::shared_ptr<DirectX::ScratchImage> LoadImageFile(const std::wstring& filename, bool prefer_cooked = true);
+
+    // Hash of the format, dimensions and pixels. Identical images get the same hash
+    // whatever file they are loaded from.
+    static uint64_t HashImage(const DirectX::ScratchImage& image);
+
+    // The view to bind with RenderDevice::SetTexture.
+    TextureView* GetTexture();
 
     int GetWidth();
     int GetHeight();
 
+    // The image is not kept once the view is created, so there is only device memory.
+    inline MemoryUsage GetMemoryUsage() const { return { sizeof(*this), gpu_bytes_ }; }
+
 private:
     ComPtr<ID3D11ShaderResourceView> textureView_; // texture ���ٿ�
     int width_, height_;
+    size_t gpu_bytes_;
 };
 
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <dxgiformat.h>
+
+#include <string>
+#include <vector>
+
+namespace DirectX { class ScratchImage; }
+
+// Offline conversion of source images to block-compressed, mipmapped DDS files.
+// TextureClass loads the cooked file instead of the source when it is up to date.
+class TextureCooker
+{
+public:
+	enum class TextureUsage
+	{
+		kColor,
+		kNormal  // Only X and Y are kept; shaders rebuild Z.
+	};
+
+	struct CookResult
+	{
+		std::wstring source_filename;
+		DXGI_FORMAT format;
+		size_t width, height, mip_levels;
+
+		// Peak signal-to-noise ratio of the top level against the source, in dB.
+		float psnr;
+
+		// False if psnr is below the threshold of the format, and nothing was written.
+		bool accepted;
+	};
+
+	static std::wstring GetCookedFilename(const std::wstring& source_filename);
+
+	// Whether the cooked file exists and is not older than the source.
+	static bool IsCookedUpToDate(const std::wstring& source_filename);
+
+	// BC5 for normal maps, BC3 (BC7 if high_quality) for images with alpha, BC1 (BC7) otherwise.
+	static DXGI_FORMAT ChooseFormat(const DirectX::ScratchImage& image, TextureUsage usage, bool high_quality);
+
+	// Minimum PSNR accepted for the format. These catch broken encodes, not small quality losses.
+	static float GetErrorThreshold(DXGI_FORMAT format);
+
+	static CookResult Cook(const std::wstring& source_filename, TextureUsage usage, bool high_quality = false);
+
+	// Cook every <Texture> of the manifest, on the worker pool.
+	static std::vector<CookResult> CookFromManifest(const class ResourceManifest& manifest, bool high_quality = false);
+};
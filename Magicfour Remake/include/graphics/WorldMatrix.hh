@@ -0,0 +1,27 @@
+#pragma once
+
+#include <directxmath.h>
+
+// Per-draw matrices from world matrices, with fast paths for the common kinds.
+// Most objects are placed by scaling and translation alone, or with a rotation added;
+// their products and inverses need only a few vector operations instead of full 4x4 ones.
+// Classify once per world matrix, and pass the kind to the others.
+class WorldMatrix
+{
+public:
+	enum class Kind
+	{
+		kScaleTranslate, // Diagonal 3x3, translation in the last row.
+		kAffine,         // Any 3x3, translation in the last row.
+		kGeneral,
+	};
+
+	static Kind Classify(DirectX::FXMMATRIX world);
+
+	// world * vp.
+	static DirectX::XMMATRIX Concatenate(DirectX::FXMMATRIX world, Kind kind, DirectX::CXMMATRIX vp);
+
+	// The inverse transpose of the 3x3 of world, which transforms normals.
+	// Its translation is zero, as normals take none.
+	static DirectX::XMMATRIX NormalMatrix(DirectX::FXMMATRIX world, Kind kind);
+};
@@ -1,8 +1,13 @@
 #pragma once
 
+#include <memory>
 #include <vector>
 
+#include <DirectXMath.h>
+
 #include "../core/interface/IDrawable.hh"
+#include "shader/FireShaderClass.hh"
+#include "shader/LightShaderClass.hh"
 
 #include "GroundClass.hh"
 
@@ -12,6 +17,8 @@ public:
 	FieldClass(const char* filename);
 	~FieldClass() = default;
 
+	// The grounds and their grass never move, so they are drawn as two static batches,
+	// whatever the number of grounds.
 	virtual void Draw(time_t curr_time, time_t time_delta, class ShaderManager* shader_manager,
 		ResourceMap<class ModelClass>& models, ResourceMap<class TextureClass>& textures) const;
 
@@ -22,4 +29,14 @@ public:
 
 private:
 	std::vector<GroundClass> grounds_;
-};
\ No newline at end of file
+
+	// Placements of the ground sections and grass strips, baked from the grounds on load.
+	std::vector<DirectX::XMMATRIX> ground_matrices_;
+	std::vector<DirectX::XMMATRIX> grass_matrices_;
+
+	// Made on the first draw, when the models are loaded, and again if a model is reloaded.
+	mutable std::unique_ptr<LightShaderClass::StaticBatch> ground_batch_;
+	mutable std::unique_ptr<FireShaderClass::StaticBatch> grass_batch_;
+	mutable const ModelClass* ground_source_ = nullptr;
+	mutable const ModelClass* grass_source_ = nullptr;
+};
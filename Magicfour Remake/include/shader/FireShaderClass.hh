@@ -1,14 +1,11 @@
 #pragma once
 
 #include "ShaderClass.hh"
+#include "graphics/InstanceBuffer.hh"
 
-#include <d3d11.h>
-#include <d3dcompiler.h>
 #include <DirectXMath.h>
-#include <wrl.h>
 
-#include <fstream>
-#include <unordered_map>
+#include <memory>
 #include <vector>
 
 
@@ -18,29 +15,25 @@ class ModelClass;
 class FireShaderClass : public ShaderClass
 {
 private:
-	template<typename T>
-	using ComPtr = Microsoft::WRL::ComPtr<T>;
-
 	using XMMATRIX = DirectX::XMMATRIX;
 	using XMFLOAT3 = DirectX::XMFLOAT3;
 	using XMFLOAT4 = DirectX::XMFLOAT4;
 	using XMFLOAT2 = DirectX::XMFLOAT2;
 
-	struct MatrixBufferType
+	// Per-instance vertex data, in slot 1. Rows as they are, unlike constant buffers.
+	struct InstanceType
 	{
-		XMMATRIX mvp;
+		XMMATRIX world;
 	};
 
-	struct NoiseBufferType
+	// Constants of a draw, shared by its instances, from the constant ring, in both stages.
+	struct DrawBufferType
 	{
-		float frame_time;
 		XMFLOAT3 scroll_speeds;
+		float padding1;
 		XMFLOAT3 scales;
-		float padding;
-	};
+		float padding2;
 
-	struct DistortionBuffer
-	{
 		XMFLOAT2 distortion1;
 		XMFLOAT2 distortion2;
 		XMFLOAT2 distortion3;
@@ -49,15 +42,17 @@ private:
 	};
 
 public:
-	FireShaderClass(ID3D11Device* device, ID3D11DeviceContext* device_context, HWND hwnd);
+	using StaticBatch = StaticInstanceBatch<InstanceType>;
+
+	FireShaderClass(RenderDevice* device, ConstantRing* constants);
 	FireShaderClass(const FireShaderClass&) = delete;
 	~FireShaderClass();
 
-	void PushRenderQueue(std::shared_ptr<ModelClass> model,
-		XMMATRIX mvp_matrix,
-		ID3D11ShaderResourceView* fire_texture,
-		ID3D11ShaderResourceView* noise_texture,
-		ID3D11ShaderResourceView* alpha_texture,
+	void PushRenderQueue(const std::shared_ptr<ModelClass>& model,
+		XMMATRIX world_matrix,
+		TextureView* fire_texture,
+		TextureView* noise_texture,
+		TextureView* alpha_texture,
 		XMFLOAT3 scroll_speeds,
 		XMFLOAT3 scales,
 		XMFLOAT2 distortion1,
@@ -66,8 +61,8 @@ public:
 		float distortion_scale,
 		float distortion_bias);
 
-	void PushRenderQueue(std::shared_ptr<ModelClass> model,
-		XMMATRIX mvp_matrix,
+	void PushRenderQueue(const std::shared_ptr<ModelClass>& model,
+		XMMATRIX world_matrix,
 		XMFLOAT3 scroll_speeds,
 		XMFLOAT3 scales,
 		XMFLOAT2 distortion1,
@@ -76,43 +71,32 @@ public:
 		float distortion_scale,
 		float distortion_bias);
 
-	void ProcessRenderQueue(ID3D11DeviceContext* device_context,
-		XMMATRIX vp_matrix, float frame_time);
+	// Bake instances of a model that never move, such as the grass of a field.
+	std::unique_ptr<StaticBatch> CreateStaticBatch(const std::shared_ptr<ModelClass>& model,
+		const std::vector<XMMATRIX>& world_matrices);
+	void PushRenderQueue(const StaticBatch& batch,
+		XMFLOAT3 scroll_speeds,
+		XMFLOAT3 scales,
+		XMFLOAT2 distortion1,
+		XMFLOAT2 distortion2,
+		XMFLOAT2 distortion3,
+		float distortion_scale,
+		float distortion_bias);
+
+	// The frame time is a frame constant.
+	void ProcessRenderQueue(const XMMATRIX& vp_matrix);
 
 private:
-	void InitializeShader(ID3D11Device* device, ID3D11DeviceContext* device_context, HWND hwnd,
-		const WCHAR* vs_filename, const WCHAR* ps_filename);
-
-	void SetShaderParameters(
-		ID3D11DeviceContext* device_context,
-		const MatrixBufferType& matrix_buffer,
-		const NoiseBufferType& noise_buffer,
-		const DistortionBuffer& distortion_buffer,
-		ID3D11ShaderResourceView* fire_texture,
-		ID3D11ShaderResourceView* noise_texture,
-		ID3D11ShaderResourceView* alpha_texture
-	);
-	
-	void RenderShader(ID3D11DeviceContext* device_context, int index_count);
+	void InitializeShader(const wchar_t* vs_filename, const wchar_t* ps_filename);
 
 
 private:
-	ComPtr<ID3D11SamplerState>	sample_state_wrap_;
-	ComPtr<ID3D11SamplerState>	sample_state_clamp_;
+	SamplerHandle	sample_state_wrap_;
+	SamplerHandle	sample_state_clamp_;
 
-	ComPtr<ID3D11Buffer>		matrix_buffer_;
-	ComPtr<ID3D11Buffer>		noise_buffer_;
-	ComPtr<ID3D11Buffer>		distortion_buffer_;
-
-	struct RenderCommand
+	// Floats only, so that equal effects compare equal bytewise.
+	struct Effect
 	{
-		std::shared_ptr<ModelClass> model;
-		
-		XMMATRIX	world_matrix;
-		ID3D11ShaderResourceView* fire_texture;
-		ID3D11ShaderResourceView* noise_texture;
-		ID3D11ShaderResourceView* alpha_texture;
-
 		XMFLOAT3	scroll_speeds;
 		XMFLOAT3	scales;
 
@@ -124,5 +108,32 @@ private:
 		float		distortion_bias;
 	};
 
-	std::unordered_map<std::shared_ptr<ModelClass>, std::vector<RenderCommand> > render_queue_;
+	struct RenderCommand
+	{
+		ModelClass* model;
+		
+		XMMATRIX	world_matrix;
+		TextureView* fire_texture;
+		TextureView* noise_texture;
+		TextureView* alpha_texture;
+
+		Effect		effect;
+
+		const StaticBatch* batch;  // Or nullptr, for an instance of its own.
+		uint64_t	key;
+	};
+
+	RenderCommand& PushCommand(ModelClass* model, const XMMATRIX& world_matrix,
+		TextureView* fire_texture, TextureView* noise_texture, TextureView* alpha_texture,
+		const Effect& effect);
+
+	RenderQueue<RenderCommand> render_queue_;
+	InstanceBuffer<InstanceType> instances_;
+
+	struct Batch
+	{
+		uint32_t first, count;
+		ConstantRange draw;
+	};
+	std::vector<Batch> batches_;
 };
\ No newline at end of file
@@ -1,14 +1,11 @@
 #pragma once
 
 #include "ShaderClass.hh"
+#include "graphics/InstanceBuffer.hh"
 
-#include <d3d11.h>
-#include <d3dcompiler.h>
 #include <DirectXMath.h>
-#include <wrl.h>
 
-#include <fstream>
-#include <unordered_map>
+#include <memory>
 #include <vector>
 
 class D3DClass;
@@ -17,58 +14,51 @@ class ModelClass;
 class LightShaderClass : public ShaderClass
 {
 private:
-	template<typename T>
-	using ComPtr = Microsoft::WRL::ComPtr<T>;
-
 	using XMMATRIX = DirectX::XMMATRIX;
 	using XMFLOAT3 = DirectX::XMFLOAT3;
 	using XMFLOAT4 = DirectX::XMFLOAT4;
 
-	struct MatrixBufferType
+	// Per-instance vertex data, in slot 1. Rows as they are, unlike constant buffers.
+	struct InstanceType
 	{
-		XMMATRIX mvp; // world * view * projection matrix
+		XMMATRIX world;
 		XMMATRIX world_tr_inv;
 	};
 
-	struct LightBufferType
-	{
-		XMFLOAT4 diffuse_color;
-		XMFLOAT3 light_direction;
-		float padding;  // Added extra padding so structure is a multiple of 16 for CreateBuffer function requirements.
-	};
-
 public:
-	LightShaderClass(ID3D11Device* device, ID3D11DeviceContext* device_context, HWND hwnd);
+	using StaticBatch = StaticInstanceBatch<InstanceType>;
+
+	LightShaderClass(RenderDevice* device, ConstantRing* constants);
 	LightShaderClass(const LightShaderClass&) = delete;
 	~LightShaderClass();
 
-	void PushRenderQueue(std::shared_ptr<ModelClass> model, XMMATRIX world_matrix);
-	void PushRenderQueue(std::shared_ptr<ModelClass> model, XMMATRIX world_matrix,
-		ID3D11ShaderResourceView* texture);
-
-	void ProcessRenderQueue(ID3D11DeviceContext* device_context, const XMMATRIX& vp_matrix,
-		XMFLOAT3 light_direction, XMFLOAT4 diffuse_color);
+	void PushRenderQueue(const std::shared_ptr<ModelClass>& model, XMMATRIX world_matrix);
+	void PushRenderQueue(const std::shared_ptr<ModelClass>& model, XMMATRIX world_matrix,
+		TextureView* texture);
 
-private:
-	void InitializeShader(ID3D11Device* device, ID3D11DeviceContext* device_context, HWND hwnd,
-		const WCHAR* vs_filename, const WCHAR* ps_filename);
+	// Bake instances of a model that never move, such as the grounds of a field.
+	std::unique_ptr<StaticBatch> CreateStaticBatch(const std::shared_ptr<ModelClass>& model,
+		const std::vector<XMMATRIX>& world_matrices);
+	void PushRenderQueue(const StaticBatch& batch);
 
-	void SetShaderParameters(ID3D11DeviceContext* device_context,
-		XMMATRIX, XMMATRIX, ID3D11ShaderResourceView*, XMFLOAT3, XMFLOAT4);
+	// The view-projection matrix and the light are the frame constants.
+	void ProcessRenderQueue(const XMMATRIX& vp_matrix);
 
-	void RenderShader(ID3D11DeviceContext* device_context, int);
+private:
+	void InitializeShader(const wchar_t* vs_filename, const wchar_t* ps_filename);
 
 private:
-	ComPtr<ID3D11SamplerState>	sample_state_;
-	ComPtr<ID3D11Buffer>		matrix_buffer_;
-	ComPtr<ID3D11Buffer>		light_buffer_;
+	SamplerHandle	sample_state_;
 	
 	struct RenderCommand
 	{
-		std::shared_ptr<ModelClass>	model;
-		XMMATRIX						world_matrix;
-		ID3D11ShaderResourceView*		texture;
+		ModelClass*		model;
+		XMMATRIX		world_matrix;
+		TextureView*	texture;
+		const StaticBatch* batch;  // Or nullptr, for an instance of its own.
+		uint64_t		key;
 	};
 
-	std::unordered_map<std::shared_ptr<ModelClass>, std::vector<RenderCommand> > render_queue_;
+	RenderQueue<RenderCommand> render_queue_;
+	InstanceBuffer<InstanceType> instances_;
 };
\ No newline at end of file
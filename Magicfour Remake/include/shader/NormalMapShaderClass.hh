@@ -1,12 +1,8 @@
 #pragma once
 
-#include <d3d11.h>
-#include <d3dcompiler.h>
 #include <directxmath.h>
-#include <fstream>
-#include <wrl.h>
 
-#include <unordered_map>
+#include <memory>
 #include <vector>
 
 #include "ShaderClass.hh"
@@ -17,87 +13,60 @@ class ModelClass;
 class NormalMapShaderClass : public ShaderClass
 {
 private:
-	template<typename T>
-	using ComPtr = Microsoft::WRL::ComPtr<T>;
-
 	using XMMATRIX = DirectX::XMMATRIX;
 	using XMFLOAT3 = DirectX::XMFLOAT3;
 	using XMFLOAT4 = DirectX::XMFLOAT4;
 
-	struct MatrixBufferType
+	// Constants of a draw, from the constant ring, in both stages.
+	struct DrawBufferType
 	{
 		XMMATRIX mvp;
 		XMMATRIX world;
 		XMMATRIX world_tr_inv;
-	};
 
-	struct LightBufferType
-	{
-		XMFLOAT4 diffuse_color;
-		XMFLOAT3 light_direction;
-		float padding;  // Added extra padding so structure is a multiple of 16 for CreateBuffer function requirements.
-		
 		XMFLOAT4 ambient_weight;
 		XMFLOAT4 diffuse_weight;
 		XMFLOAT4 specular_weight;
 	};
 
-	struct CameraBufferType
-	{
-		XMFLOAT3 camera_pos;
-		float padding;
-	};
-
 public:
-	NormalMapShaderClass(ID3D11Device* device, ID3D11DeviceContext* device_context, HWND hwnd);
+	NormalMapShaderClass(RenderDevice* device, ConstantRing* constants);
 	NormalMapShaderClass(const NormalMapShaderClass&) = delete;
 	~NormalMapShaderClass() = default;
 
-	void PushRenderQueue(std::shared_ptr<ModelClass> model, XMMATRIX world_matrix);
-	void PushRenderQueue(std::shared_ptr<ModelClass> model, XMMATRIX world_matrix,
-		ID3D11ShaderResourceView* diffuse_texture,
-		ID3D11ShaderResourceView* normal_texture,
-		ID3D11ShaderResourceView* emissive_texture);
+	void PushRenderQueue(const std::shared_ptr<ModelClass>& model, XMMATRIX world_matrix);
+	void PushRenderQueue(const std::shared_ptr<ModelClass>& model, XMMATRIX world_matrix,
+		TextureView* diffuse_texture,
+		TextureView* normal_texture,
+		TextureView* emissive_texture);
 
-	void ProcessRenderQueue(ID3D11DeviceContext* device_context, const XMMATRIX& vp_matrix,
-		XMFLOAT3 light_direction, XMFLOAT4 diffuse_color, XMFLOAT3 camera_pos);
+	// The light and the camera are the frame constants.
+	void ProcessRenderQueue(const XMMATRIX& vp_matrix);
 
 private:
-	void InitializeShader(ID3D11Device* device, ID3D11DeviceContext* device_context, HWND hwnd,
-		const WCHAR* vs_filename, const WCHAR* ps_filename);
-
-	void SetShaderParameters(ID3D11DeviceContext* device_context,
-		XMMATRIX, XMMATRIX,
-		ID3D11ShaderResourceView* diffuse_texture,
-		ID3D11ShaderResourceView* normal_texture,
-		ID3D11ShaderResourceView* emissive_texture,
-		XMFLOAT3, XMFLOAT4,
-		XMFLOAT3, XMFLOAT3, XMFLOAT3, XMFLOAT3);
-
-	void RenderShader(ID3D11DeviceContext* device_context, int index_count, int index_start = 0);
+	void InitializeShader(const wchar_t* vs_filename, const wchar_t* ps_filename);
 
 private:
-	ComPtr<ID3D11SamplerState>	sample_state_;
-
-	ComPtr<ID3D11Buffer>		matrix_buffer_;
-	ComPtr<ID3D11Buffer>		light_buffer_;
-	ComPtr<ID3D11Buffer>		camera_buffer_;
+	SamplerHandle	sample_state_;
 
 	struct RenderCommand
 	{
-		std::shared_ptr<ModelClass>	model;
+		ModelClass*	model;
 		XMMATRIX					world_matrix;
 
-		ID3D11ShaderResourceView*	diffuse_texture;
-		ID3D11ShaderResourceView*	normal_texture;
-		ID3D11ShaderResourceView*	emissive_texture;
+		TextureView*				diffuse_texture;
+		TextureView*				normal_texture;
+		TextureView*				emissive_texture;
 
 		XMFLOAT3					ambient_weight;
 		XMFLOAT3					diffuse_weight;
 		XMFLOAT3					specular_weight;
 
 		int index_count, index_start;
+
+		uint64_t key;
 	};
 
-	std::unordered_map<std::shared_ptr<ModelClass>, std::vector<RenderCommand> > render_queue_;
+	RenderQueue<RenderCommand> render_queue_;
+	std::vector<ConstantRange> draw_constants_;  // In draw order
 };
\ No newline at end of file
@@ -1,54 +1,33 @@
 #pragma once
 
-#include <d3d11.h>
-#include <d3dcompiler.h>
 #include <directxmath.h>
-#include <wrl.h>
+
+#include "graphics/ConstantRing.hh"
+#include "graphics/RenderDevice.hh"
+#include "graphics/RenderQueue.hh"
 
 class ShaderClass
 {
 public:
-	template<typename T>
-	using ComPtr = Microsoft::WRL::ComPtr<T>;
+	// Slot of the frame constants in both stages, set once a frame by the ShaderManager.
+	static constexpr uint32_t kFrameSlot = 4;
 
-public:
-	ShaderClass();
+	ShaderClass(RenderDevice* device, ConstantRing* constants);
 	~ShaderClass() = default;
 
-	template<typename T>
-	ID3D11Buffer* CreateBasicConstantBuffer(ID3D11Device* device);
+	// Instances of the queue processed last, and the cost of sorting them.
+	inline const CullStats& GetCullStats() const { return cull_stats_; }
+	inline const SortStats& GetSortStats() const { return sort_stats_; }
 
 protected:
-	void CreateShaderObject(ID3D11Device* device, ID3D11DeviceContext* device_context, HWND hwnd,
-		const WCHAR* vs_filename, const WCHAR* ps_filename,
-		D3D11_INPUT_ELEMENT_DESC polygon_layout[], int kNumOfElements);
-
-	ID3D11SamplerState* CreateSamplerState(ID3D11Device* device,
-		D3D11_TEXTURE_ADDRESS_MODE mode = D3D11_TEXTURE_ADDRESS_WRAP);
-
-	void OutputShaderErrorMessage(ID3D10Blob* error_message,
-		HWND hwnd, const WCHAR* shader_filename);
+	void CreateShaderObject(const wchar_t* vs_filename, const wchar_t* ps_filename,
+		const VertexElement layout[], size_t element_count);
 
 protected:
-	ComPtr<ID3D11VertexShader>	vertex_shader_;
-	ComPtr<ID3D11PixelShader>	pixel_shader_;
-	ComPtr<ID3D11InputLayout>	input_layout_;
-};
+	RenderDevice* device_;
+	ConstantRing* constants_;  // Per-draw constants, shared by the shaders
+	ShaderHandle shader_;
 
-template<typename T>
-inline ID3D11Buffer* ShaderClass::CreateBasicConstantBuffer(ID3D11Device* device)
-{
-	ID3D11Buffer* buffer;
-
-	D3D11_BUFFER_DESC constantBufferDesc;
-	constantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-	constantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	constantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	constantBufferDesc.MiscFlags = 0;
-	constantBufferDesc.StructureByteStride = 0;
-	constantBufferDesc.ByteWidth = sizeof(T);
-
-	HRESULT result = device->CreateBuffer(&constantBufferDesc, NULL, &buffer);
-	if (FAILED(result)) return nullptr;
-	else return buffer;
-}
+	CullStats cull_stats_;
+	SortStats sort_stats_;
+};
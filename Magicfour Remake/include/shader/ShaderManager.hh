@@ -1,7 +1,10 @@
 #pragma once
 
+#include <directxmath.h>
+
 #include <memory>
-#include <Windows.h>
+
+#include "graphics/RenderDevice.hh"
 
 class ShaderManager
 {
@@ -11,5 +14,20 @@ public:
 	std::unique_ptr<class NormalMapShaderClass>	normalMap_shader_;
 	std::unique_ptr<class FireShaderClass>		fire_shader_;
 
-	ShaderManager(class ID3D11Device* device, class ID3D11DeviceContext* device_context, HWND hwnd);
-};
\ No newline at end of file
+	ShaderManager(RenderDevice* device);
+	~ShaderManager();
+
+	// Upload the constants every shader reads, and bind them for the frame.
+	// Call after RenderDevice::BeginFrame, before the queues are processed.
+	void SetFrameConstants(const DirectX::XMMATRIX& vp_matrix, DirectX::XMFLOAT3 light_direction,
+		DirectX::XMFLOAT4 diffuse_color, DirectX::XMFLOAT3 camera_pos, float frame_time);
+
+	// Visible and culled instances of each queue, the cost of sorting them, and the device calls, in the last frame.
+	void AddToReport(class MemoryReport& report) const;
+
+private:
+	RenderDevice* device_;
+
+	std::unique_ptr<class ConstantRing> constants_;  // Per-draw constants of all the shaders
+	BufferHandle frame_buffer_;
+};
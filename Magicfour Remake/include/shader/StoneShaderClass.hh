@@ -1,14 +1,11 @@
 #pragma once
 
 #include "shader/ShaderClass.hh"
+#include "graphics/InstanceBuffer.hh"
 
-#include <d3d11.h>
-#include <d3dcompiler.h>
 #include <DirectXMath.h>
-#include <wrl.h>
 
-#include <fstream>
-#include <unordered_map>
+#include <memory>
 #include <vector>
 
 class D3DClass;
@@ -17,73 +14,45 @@ class ModelClass;
 class StoneShaderClass : public ShaderClass
 {
 private:
-	template<typename T>
-	using ComPtr = Microsoft::WRL::ComPtr<T>;
-
 	using XMMATRIX = DirectX::XMMATRIX;
 	using XMFLOAT3 = DirectX::XMFLOAT3;
 	using XMFLOAT4 = DirectX::XMFLOAT4;
 
-	struct MatrixBufferType
+	// Per-instance vertex data, in slot 1. Rows as they are, unlike constant buffers.
+	struct InstanceType
 	{
-		XMMATRIX mvp;
 		XMMATRIX world;
 		XMMATRIX world_tr_inv;
+		XMFLOAT4 diffuse_color;
 	};
 
-	struct LightBufferType
+	// Constants of a batch, from the constant ring.
+	struct MaterialBufferType
 	{
-		XMFLOAT4 diffuse_color;
-		XMFLOAT3 light_direction;
-		float padding;  // Added extra padding so structure is a multiple of 16 for CreateBuffer function requirements.
-
 		XMFLOAT4 ambient_weight;
 		XMFLOAT4 diffuse_weight;
 		XMFLOAT4 specular_weight;
 	};
 
-	struct CameraBufferType
-	{
-		XMFLOAT3 camera_pos;
-		float padding;
-	};
-
 public:
-	StoneShaderClass(ID3D11Device* device, ID3D11DeviceContext* device_context, HWND hwnd);
+	StoneShaderClass(RenderDevice* device, ConstantRing* constants);
 	StoneShaderClass(const StoneShaderClass&) = delete;
 	~StoneShaderClass() = default;
 
-	void PushRenderQueue(std::shared_ptr<ModelClass> model, XMMATRIX world_matrix, XMFLOAT4 diffuse_color);
-
-	void ProcessRenderQueue(ID3D11DeviceContext* device_context, const XMMATRIX& vp_matrix,
-		XMFLOAT3 light_direction, XMFLOAT3 camera_pos);
+	void PushRenderQueue(const std::shared_ptr<ModelClass>& model, XMMATRIX world_matrix, XMFLOAT4 diffuse_color);
 
-	void Render(
-		ID3D11DeviceContext* device_context,
-		class ModelClass* model, XMMATRIX world_matrix, XMMATRIX vp_matrix,
-		XMFLOAT3 light_direction, XMFLOAT4 diffuse_color, XMFLOAT3 camera_pos);
+	// The view-projection matrix, the light and the camera are the frame constants.
+	void ProcessRenderQueue(const XMMATRIX& vp_matrix);
 
 private:
-	void InitializeShader(ID3D11Device* device, ID3D11DeviceContext* device_context, HWND hwnd,
-		const WCHAR* vs_filename, const WCHAR* ps_filename);
-
-	void SetShaderParameters(ID3D11DeviceContext* device_context,
-		XMMATRIX, XMMATRIX,
-		XMFLOAT3, XMFLOAT4,
-		XMFLOAT3 camera_pos, XMFLOAT3, XMFLOAT3, XMFLOAT3);
-
-	void RenderShader(ID3D11DeviceContext* device_context, int index_count, int index_start = 0);
+	void InitializeShader(const wchar_t* vs_filename, const wchar_t* ps_filename);
 
 private:
-	ComPtr<ID3D11SamplerState>	sample_state_;
-
-	ComPtr<ID3D11Buffer>		matrix_buffer_;
-	ComPtr<ID3D11Buffer>		light_buffer_;
-	ComPtr<ID3D11Buffer>		camera_buffer_;
+	SamplerHandle	sample_state_;
 
 	struct RenderCommand
 	{
-		std::shared_ptr<ModelClass>	model;
+		ModelClass*	model;
 		XMMATRIX					world_matrix;
 		XMFLOAT4 					diffuse_color;
 
@@ -92,7 +61,17 @@ private:
 		XMFLOAT3					specular_weight;
 		
 		int index_count, index_start;
+
+		uint64_t key;
 	};
 
-	std::unordered_map<std::shared_ptr<ModelClass>, std::vector<RenderCommand> > render_queue_;
+	RenderQueue<RenderCommand> render_queue_;
+	InstanceBuffer<InstanceType> instances_;
+
+	struct Batch
+	{
+		uint32_t first, count;
+		ConstantRange material;
+	};
+	std::vector<Batch> batches_;
 };
\ No newline at end of file
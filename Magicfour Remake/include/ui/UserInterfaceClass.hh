@@ -26,8 +26,8 @@ private:
 	using XMMATRIX = DirectX::XMMATRIX;
 
 public:
-	UserInterfaceClass(class D2DClass* direct2D,
-		ID3D11Device* device, int screen_width, int screen_height);
+	UserInterfaceClass(class D2DClass* direct2D, ID3D11Device* device,
+		const class ResourceManifest& manifest, int screen_width, int screen_height);
 	~UserInterfaceClass();
 
 	void CalculateScreenPos(const XMMATRIX& mvp_matrix,
@@ -44,6 +44,8 @@ public:
 
 	inline const UIContext& GetContext() { return context; }
 
+	void AddToReport(class MemoryReport& report) const;
+
 
 private:
 	UIContext context;
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "util/MappedFile.hh"
+
+// Read-only pack of asset files, memory-mapped as a whole.
+//
+// Layout: Header, Entry table sorted by (path_hash, path), path string table,
+// then the payloads, each aligned to kPayloadAlignment from the start of the file.
+class AssetArchive
+{
+public:
+	// Cache line, so payloads read with aligned SIMD loads can be used in place.
+	static constexpr uint64_t kPayloadAlignment = 64;
+
+	explicit AssetArchive(const char* archive_filename);
+	AssetArchive(const AssetArchive&) = delete;
+
+	// Path must be normalized (see FileSystem::NormalizePath).
+	// On success, content points into the mapping and stays valid as long as this archive.
+	bool Find(std::string_view path, std::string_view& content) const;
+
+	inline size_t GetEntryCount() const { return entry_count_; }
+	std::string_view GetPath(size_t index) const;
+
+	// Write an archive of the given files, stored under their normalized paths.
+	static void Build(const char* archive_filename, const std::vector<std::string>& file_paths);
+
+	// Every file referenced by the resource XML file, with up-to-date cooked
+	// companions, material libraries of models, and the XML file itself
+	// (with its compiled manifest, if up to date).
+	static std::vector<std::string> CollectResourceFiles(const char* xml_file_path);
+
+private:
+	struct Header
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t entry_count;
+		uint32_t path_table_size;
+		uint64_t file_size;
+	};
+
+	struct Entry
+	{
+		uint64_t path_hash;
+		uint64_t offset;
+		uint64_t size;
+		uint32_t path_offset;
+		uint32_t path_length;
+	};
+
+	MappedFile file_;
+	const Entry* entries_;
+	const char* path_table_;
+	size_t entry_count_;
+};
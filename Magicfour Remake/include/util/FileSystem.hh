@@ -0,0 +1,76 @@
+#pragma once
+
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+#include "util/AssetArchive.hh"
+#include "util/MappedFile.hh"
+
+// Content of a file opened through FileSystem.
+// Points into the mounted archive, or owns the mapping of a loose file.
+class FileView
+{
+public:
+	FileView() : data_(nullptr), size_(0) {}
+	FileView(std::string_view content) : data_(content.data()), size_(content.size()) {}
+	explicit FileView(std::unique_ptr<MappedFile> file)
+		: file_(std::move(file)), data_(file_->GetData()), size_(file_->GetSize()) {}
+
+	FileView(FileView&&) = default;
+	FileView& operator=(FileView&&) = default;
+
+	inline const char* GetData() const { return data_; }
+	inline size_t GetSize() const { return size_; }
+
+	inline std::string_view GetView() const
+	{
+		return std::string_view(data_, size_);
+	}
+
+private:
+	std::unique_ptr<MappedFile> file_;
+	const char* data_;
+	size_t size_;
+};
+
+// std::istream over a FileView, for parsers written with stream operators.
+// Reads the content in place, without copying it.
+class FileStream : private std::streambuf, public std::istream
+{
+public:
+	explicit FileStream(FileView view)
+		: std::istream(static_cast<std::streambuf*>(this)), view_(std::move(view))
+	{
+		char* begin = const_cast<char*>(view_.GetData());
+		setg(begin, begin, begin + view_.GetSize());
+	}
+
+private:
+	FileView view_;
+};
+
+// Files of the game, looked up in the mounted archive first and on disk otherwise.
+// Mount before any loading starts; lookups may then run on any thread.
+class FileSystem
+{
+public:
+	static void Mount(const char* archive_filename);
+	static void Unmount();
+
+	static inline bool IsMounted() { return archive_ != nullptr; }
+
+	// Throws filenotfound_error if the file is neither in the archive nor on disk.
+	static FileView Open(const std::string& path);
+
+	static bool Exists(const std::string& path);
+	static bool IsInArchive(const std::string& path);
+
+	// Forward slashes, no leading "./", as stored in the archive.
+	static std::string NormalizePath(std::string_view path);
+
+private:
+	static std::unique_ptr<AssetArchive> archive_;
+};
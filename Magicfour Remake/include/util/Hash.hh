@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// 64-bit FNV-1a hash.
+// It is not a cryptographic hash, only used to detect changes of file contents
+// and to look up paths in the asset archive.
+constexpr uint64_t kHashSeed = 14695981039346656037ull;
+
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t hash = kHashSeed)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+inline uint64_t HashBytes(std::string_view view, uint64_t hash = kHashSeed)
+{
+	return HashBytes(view.data(), view.size(), hash);
+}
+
+// Same as HashBytes, but usable in constant expressions.
+constexpr uint64_t HashString(std::string_view view, uint64_t hash = kHashSeed)
+{
+	for (char c : view)
+	{
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <windows.h>
+
+#include <string_view>
+
+// Read-only memory mapping of a whole file.
+// The content is accessible until this instance is destroyed.
+class MappedFile
+{
+public:
+	MappedFile(const char* filename);
+	MappedFile(const MappedFile&) = delete;
+	~MappedFile();
+
+	inline const char* GetData() const { return data_; }
+	inline size_t GetSize() const { return size_; }
+
+	inline std::string_view GetView() const
+	{
+		return std::string_view(data_, size_);
+	}
+
+private:
+	HANDLE file_;
+	HANDLE mapping_;
+
+	const char* data_;
+	size_t size_;
+};
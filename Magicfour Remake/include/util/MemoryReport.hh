@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Memory an asset keeps resident after it is loaded.
+struct MemoryUsage
+{
+	size_t cpu_bytes = 0;  // System memory owned by the asset
+	size_t gpu_bytes = 0;  // Estimated size of its device objects
+
+	MemoryUsage& operator+=(const MemoryUsage& other)
+	{
+		cpu_bytes += other.cpu_bytes;
+		gpu_bytes += other.gpu_bytes;
+		return *this;
+	}
+};
+
+// Resident memory broken down per asset, grouped by the map or owner it belongs to.
+// Fill it with ResourceMap::addToReport and Add, then Write it.
+class MemoryReport
+{
+public:
+	void Add(const std::string& group_name, const std::string& asset_name, const MemoryUsage& usage);
+
+	// A line written under the group total, e.g. cache statistics.
+	void AddNote(const std::string& group_name, const std::string& note);
+
+	MemoryUsage GetTotal() const;
+
+	// Groups in the order they were added, assets by size within each group.
+	void Write(std::ostream& out) const;
+	void Write(const char* filename) const;
+
+private:
+	struct Entry
+	{
+		std::string group_name;
+		std::string asset_name;
+		MemoryUsage usage;
+	};
+
+	std::vector<Entry> entries_;
+	std::vector<std::pair<std::string, std::string> > notes_;
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// An item to sort: its key and where it came from.
+struct SortEntry
+{
+	uint64_t key;
+	uint32_t index;
+};
+
+// Stable LSD radix sort of entries by key, a byte per pass.
+// Passes over a byte every key has in common are skipped, so short ranges of keys sort in few passes.
+// scratch is resized as needed and can be kept between calls.
+void RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch);
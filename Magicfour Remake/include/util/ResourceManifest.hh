@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ResourceManifest;
+
+// A node of the manifest, i.e. an element of the resource XML file.
+// Valid as long as the manifest it belongs to.
+struct resource_node
+{
+	static constexpr uint32_t kNone = UINT32_MAX;
+
+	const ResourceManifest* manifest;
+	uint32_t index;
+
+	resource_node(const ResourceManifest* m = nullptr, uint32_t i = kNone) : manifest(m), index(i) {}
+
+	const char* type() const;
+
+	// Returns nullptr if there is no such attribute.
+	const char* find_attr(const char* attr_name) const;
+
+	std::string get_required_attr(const char* attr_name) const;
+	std::string get_attr(const char* attr_name, const char* default_value = "") const;
+
+	resource_node first_node(const char* type_name) const;
+	resource_node next_sibling(const char* type_name) const;
+
+	bool operator!() const { return index == kNone; }
+	operator bool() const { return index != kNone; }
+};
+
+// The resource XML file, parsed once and shared by every ResourceMap.
+// Nodes are indexed by type, in document order wherever they are nested, and by name.
+//
+// It can be compiled to a binary file next to the XML file, which is loaded
+// instead when it is up to date, so the XML is not parsed at runtime.
+class ResourceManifest
+{
+public:
+	explicit ResourceManifest(const char* xml_file_path);
+	ResourceManifest(const ResourceManifest&) = delete;
+
+	// Every node of given type. Empty if there is none.
+	const std::vector<resource_node>& GetNodes(const char* type_name) const;
+
+	// The node of given type and "name" attribute, or an empty node.
+	resource_node Find(const char* type_name, const std::string& name) const;
+
+	static std::string GetCompiledFilename(const std::string& xml_file_path);
+	static bool IsCompiledUpToDate(const std::string& xml_file_path);
+
+	// Parse the XML file and write the compiled manifest.
+	static void Compile(const char* xml_file_path);
+
+private:
+	friend struct resource_node;
+
+	struct Node
+	{
+		uint32_t type;  // Offset into strings_
+		uint32_t first_child;
+		uint32_t next_sibling;
+		uint32_t first_attribute;
+		uint32_t attribute_count;
+	};
+
+	struct Attribute
+	{
+		uint32_t name;  // Offsets into strings_
+		uint32_t value;
+	};
+
+	ResourceManifest() = default;
+
+	void ParseXML(const char* xml_file_path);
+	bool LoadCompiled(const std::string& compiled_filename);
+	void SaveCompiled(const std::string& compiled_filename) const;
+	void BuildIndex();
+
+	inline const char* GetString(uint32_t offset) const { return strings_.data() + offset; }
+
+	// Nodes in document order; the first one is the <Resources> root.
+	std::vector<Node> nodes_;
+	std::vector<Attribute> attributes_;
+
+	// Null-terminated strings, each stored once.
+	std::string strings_;
+
+	std::unordered_map<std::string, std::vector<resource_node> > nodes_by_type_;
+	std::unordered_map<std::string, std::unordered_map<std::string, resource_node> > nodes_by_name_;
+};
@@ -1,49 +1,35 @@
 #pragma once
+#include <cstdio>
+#include <cwchar>
+#include <atomic>
+#include <deque>
 #include <unordered_map>
 #include <string>
+#include <string_view>
 #include <fstream>
 #include <functional>
 #include <memory>
+#include <future>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
 
 #include "core/GameException.hh"
-#include "../third-party/rapidxml-1.13/rapidxml.hpp"
+#include "util/Hash.hh"
+#include "util/MemoryReport.hh"
+#include "util/ResourceManifest.hh"
+#include "util/ThreadPool.hh"
 
-struct xml_node_wrapper
+// Resource name hashed at compile time, for lookups in draw and update code.
+// Declare it constexpr, e.g. constexpr ResourceId kCubeModel("cube");
+struct ResourceId
 {
-	rapidxml::xml_node<>* node;
-	xml_node_wrapper(rapidxml::xml_node<>* n) : node(n) {}
+	uint64_t value;
 
-	std::string get_required_attr(const char* attr_name) const
-	{
-		auto attr = node->first_attribute(attr_name);
-		if (!attr) throw GAME_EXCEPTION(L"Missing required attribute: " + std::wstring(attr_name, attr_name + strlen(attr_name)));
-		return std::string(attr->value());
-	}
-
-	std::string get_attr(const char* attr_name, const char* default_value = "") const
-	{
-		auto attr = node->first_attribute(attr_name);
-		if (!attr) return std::string(default_value);
-		return std::string(attr->value());
-	}
-
-	xml_node_wrapper first_node(const char* name) const
-	{
-		auto child = node->first_node(name);
-		if (!child) return xml_node_wrapper(nullptr);
-		return xml_node_wrapper(child);
-	}
+	constexpr explicit ResourceId(std::string_view name) : value(HashString(name)) {}
 
-
-	xml_node_wrapper next_sibling(const char* name) const
-	{
-		auto sibling = node->next_sibling(name);
-		if (!sibling) return xml_node_wrapper(nullptr);
-		return xml_node_wrapper(sibling);
-	}
-
-	bool operator!() const { return node == nullptr; }
-	operator bool() const { return node != nullptr; }
+	constexpr bool operator==(ResourceId other) const { return value == other.value; }
+	constexpr bool operator!=(ResourceId other) const { return value != other.value; }
 };
 
 template <typename T>
@@ -56,6 +42,21 @@ public:
 	// Key: resource file path, Value: resource
 	std::unordered_map<std::string, std::shared_ptr<T> > path_resources;
 
+	// Key: hash of the content a resource was made from, Value: resource
+	// Weak, so that it does not keep evicted resources alive.
+	std::unordered_map<uint64_t, std::weak_ptr<T> > content_resources;
+
+	struct Stats
+	{
+		size_t content_hits = 0;   // Loads answered by a resource made from identical content
+		size_t bytes_saved = 0;    // Payloads not loaded again thanks to those
+		size_t evictions = 0;
+		size_t bytes_evicted = 0;
+		size_t reloads = 0;        // Evicted resources used, and so loaded again
+	};
+
+	Stats stats;
+
 	inline std::shared_ptr<T> get(const char* resource_name) const
 	{
 		auto item = resources.find(resource_name);
@@ -65,7 +66,11 @@ public:
 			err_msg += std::wstring(resource_name, resource_name + strlen(resource_name));
 			throw GAME_EXCEPTION(err_msg);
 		}
-		else return item->second;
+		else
+		{
+			last_used_[findSlot(ResourceId(resource_name))].store(use_clock_, std::memory_order_relaxed);
+			return item->second;
+		}
 	}
 
 	inline std::shared_ptr<T> get(const std::string& resource_name) const
@@ -77,7 +82,25 @@ public:
 			err_msg += std::wstring(resource_name.begin(), resource_name.end());
 			throw GAME_EXCEPTION(err_msg);
 		}
-		else return item->second;
+		else
+		{
+			last_used_[findSlot(ResourceId(resource_name))].store(use_clock_, std::memory_order_relaxed);
+			return item->second;
+		}
+	}
+
+	// No string is built or hashed; the id is probed in a flat table and the resource read from an array.
+	inline const std::shared_ptr<T>& get(ResourceId resource_id) const
+	{
+		const uint32_t slot = findSlot(resource_id);
+		if (slot == kNoSlot)
+		{
+			wchar_t err_msg[64];
+			swprintf_s(err_msg, L"Resource not found by id: %016llx", resource_id.value);
+			throw GAME_EXCEPTION(err_msg);
+		}
+		last_used_[slot].store(use_clock_, std::memory_order_relaxed);
+		return slots_[slot];
 	}
 
 	inline std::shared_ptr<T> get_by_path(const char* resource_path) const
@@ -114,11 +137,37 @@ public:
 		}
 		else
 		{
+			const ResourceId resource_id(resource_name);
+			if (findSlot(resource_id) != kNoSlot)
+			{
+				std::wstring err_msg = L"Resource id collides with another name: ";
+				err_msg += std::wstring(resource_name.begin(), resource_name.end());
+				throw GAME_EXCEPTION(err_msg);
+			}
+
 			resources[resource_name] = resource;
+			insertSlot(resource_id, resource);
 		}
 		
 	}
 
+	// Rebind an existing name to another resource, e.g. a placeholder to the loaded one.
+	inline void replace(const std::string& resource_name, std::shared_ptr<T> resource)
+	{
+		auto item = resources.find(resource_name);
+		if (item == resources.end())
+		{
+			std::wstring err_msg = L"Resource not found: ";
+			err_msg += std::wstring(resource_name.begin(), resource_name.end());
+			throw GAME_EXCEPTION(err_msg);
+		}
+		else
+		{
+			item->second = resource;
+			slots_[findSlot(ResourceId(resource_name))] = resource;
+		}
+	}
+
 	inline void insert_by_path(std::string resource_path, std::shared_ptr<T> resource)
 	{
 		if (path_resources.find(resource_path) != path_resources.end())
@@ -133,48 +182,59 @@ public:
 		}
 	}
 
-	void findAllNodes(rapidxml::xml_node<>* parent, const char* name, std::vector<rapidxml::xml_node<>*>& out_nodes)
+	inline void erase_by_path(const std::string& resource_path)
 	{
-		for (auto node = parent->first_node(); node; node = node->next_sibling())
-		{
-			if (strcmp(node->name(), name) == 0)
-			{
-				out_nodes.push_back(node);
-			}
-			findAllNodes(node, name, out_nodes);
-		}
+		path_resources.erase(resource_path);
 	}
 
-
-	void loadFromXML(const char* xml_file_path, const char* resource_type, std::function<std::shared_ptr<T> (xml_node_wrapper)> loader)
+	// The resource made from content of given hash, e.g. an identical file under another path,
+	// or nullptr. A hit counts content_bytes as saved.
+	inline std::shared_ptr<T> find_by_content(uint64_t content_hash, size_t content_bytes)
 	{
-		std::ifstream file(xml_file_path);
-		if (!file) throw GAME_EXCEPTION(L"Failed to open resource map XML file.");
-
-		std::string xml_content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-		file.close();
+		auto item = content_resources.find(content_hash);
+		if (item == content_resources.end()) return nullptr;
 
-		static rapidxml::xml_document<> doc;
-		doc.clear();
-		try
-		{
-			doc.parse<0>(&xml_content[0]);
-		}
-		catch (const rapidxml::parse_error& e)
+		std::shared_ptr<T> resource = item->second.lock();
+		if (resource)
 		{
-			throw GAME_EXCEPTION(L"Failed to parse resource map XML file.");
+			stats.content_hits++;
+			stats.bytes_saved += content_bytes;
 		}
+		return resource;
+	}
 
-		auto root = doc.first_node("Resources");
-		if (!root) throw GAME_EXCEPTION(L"Invalid resource map XML format: Missing <Resources> root element.");
+	inline void insert_by_content(uint64_t content_hash, const std::shared_ptr<T>& resource)
+	{
+		content_resources[content_hash] = resource;
+	}
 
-		// Get all resources of given type although they may be children of different nodes
-		std::vector<rapidxml::xml_node<>*> resource_nodes;
-		findAllNodes(root, resource_type, resource_nodes);
+	// Any get by name or id marks the name used at the current clock. Whoever evicts resources
+	// advances the clock once per frame, so a resource not used since is not used in the last frame.
+	inline void advanceUseClock() { use_clock_++; }
+	inline uint32_t getUseClock() const { return use_clock_; }
+
+	// 0 if the name has not been used yet.
+	inline uint32_t getLastUse(const std::string& resource_name) const
+	{
+		const uint32_t slot = findSlot(ResourceId(resource_name));
+		return (slot != kNoSlot) ? last_used_[slot].load(std::memory_order_relaxed) : 0;
+	}
+
+	// References to the resource held by this map. If the use count of the resource is only
+	// these and the caller's, nothing else refers to it.
+	long countReferences(const std::shared_ptr<T>& resource) const
+	{
+		long references = 0;
+		for (const auto& item : resources) if (item.second == resource) references++;
+		for (const auto& item : path_resources) if (item.second == resource) references++;
+		for (const auto& slot : slots_) if (slot == resource) references++;
+		return references;
+	}
 
-		for (auto node : resource_nodes)
+	void loadFromManifest(const ResourceManifest& manifest, const char* resource_type, std::function<std::shared_ptr<T> (resource_node)> loader)
+	{
+		for (auto nodew : manifest.GetNodes(resource_type))
 		{
-			auto nodew = xml_node_wrapper(node);
 			std::string resource_name = nodew.get_attr("name");
 			std::string resource_path = nodew.get_attr("src");
 			
@@ -191,7 +251,7 @@ public:
 			{
 				try
 				{
-					resource = loader(node);
+					resource = loader(nodew);
 				}
 				catch (const std::exception& e)
 				{
@@ -210,6 +270,158 @@ public:
 		}
 		
 	}
+
+	// Same as above, but the loader is split in two.
+	// prepare does the CPU work (file read, decode, parse) and runs on the worker pool,
+	// create makes the device objects from its result and runs on the calling thread.
+	template <typename Prepare, typename Create>
+	void loadFromManifest(const ResourceManifest& manifest, const char* resource_type, Prepare prepare, Create create)
+	{
+		using Prepared = std::invoke_result_t<Prepare&, resource_node>;
+
+		const auto& resource_nodes = manifest.GetNodes(resource_type);
+
+		// Schedule only the first node of each path, so that every path is still loaded once.
+		std::vector<std::future<Prepared> > prepared(resource_nodes.size());
+		std::unordered_set<std::string> scheduled_paths;
+		for (size_t i = 0; i < resource_nodes.size(); i++)
+		{
+			std::string resource_path = resource_nodes[i].get_attr("src");
+
+			if (!resource_path.empty())
+			{
+				if (path_resources.find(resource_path) != path_resources.end()) continue;
+				if (!scheduled_paths.insert(resource_path).second) continue;
+			}
+
+			auto node = resource_nodes[i];
+			prepared[i] = ThreadPool::GetInstance().Submit([&prepare, node]() { return prepare(node); });
+		}
+
+		// Create in document order, which gives the same result as loading one by one.
+		try
+		{
+			for (size_t i = 0; i < resource_nodes.size(); i++)
+			{
+				const auto& nodew = resource_nodes[i];
+				std::string resource_name = nodew.get_attr("name");
+				std::string resource_path = nodew.get_attr("src");
+
+				std::shared_ptr<T> resource;
+
+				// Resource with same path already loaded, reuse it
+				if (!prepared[i].valid())
+				{
+					resource = path_resources[resource_path];
+				}
+				else
+				{
+					try
+					{
+						Prepared data = prepared[i].get();
+						resource = create(nodew, data);
+					}
+					catch (const std::exception& e)
+					{
+						throw GAME_EXCEPTION(L"Failed to load resource: " + std::wstring(resource_name.begin(), resource_name.end()));
+					}
+
+					if (!resource)
+						throw GAME_EXCEPTION(L"Loader function returned null for resource: " + std::wstring(resource_name.begin(), resource_name.end()));
+
+					if (!resource_path.empty()) insert_by_path(resource_path, resource);
+				}
+
+				// if resource_name is duplicate, exception will be thrown
+				if (!resource_name.empty()) insert(resource_name, resource);
+			}
+		}
+		catch (...)
+		{
+			// Tasks still running refer to prepare.
+			for (auto& task : prepared) if (task.valid()) task.wait();
+			throw;
+		}
+	}
 	
+	// Add each distinct resource to the report once, labelled with every name bound to it,
+	// or its path if it has no name. usage_of returns the MemoryUsage of a resource.
+	template <typename UsageOf>
+	void addToReport(MemoryReport& report, const std::string& map_name, UsageOf usage_of) const
+	{
+		std::unordered_map<const T*, std::string> labels;
+		for (const auto& item : resources)
+		{
+			std::string& label = labels[item.second.get()];
+			label += label.empty() ? item.first : ", " + item.first;
+		}
+		for (const auto& item : path_resources)
+		{
+			std::string& label = labels[item.second.get()];
+			if (label.empty()) label = item.first;
+		}
+
+		for (const auto& item : labels)
+		{
+			if (item.first) report.Add(map_name, item.second, usage_of(*item.first));
+		}
+
+		char note[256];
+		snprintf(note, sizeof(note), "%zu content hits (%.1f KB saved), %zu evictions (%.1f KB), %zu reloads",
+			stats.content_hits, stats.bytes_saved / 1024.0, stats.evictions, stats.bytes_evicted / 1024.0, stats.reloads);
+		report.AddNote(map_name, note);
+	}
+
 	ResourceMap() = default;
+
+private:
+	static constexpr uint32_t kNoSlot = UINT32_MAX;
+
+	// Open addressing with linear probing, kept at most half full.
+	uint32_t findSlot(ResourceId resource_id) const
+	{
+		if (id_table_.empty()) return kNoSlot;
+
+		const size_t mask = id_table_.size() - 1;
+		for (size_t i = resource_id.value & mask; ; i = (i + 1) & mask)
+		{
+			if (id_table_[i].second == kNoSlot) return kNoSlot;
+			if (id_table_[i].first == resource_id.value) return id_table_[i].second;
+		}
+	}
+
+	void insertSlot(ResourceId resource_id, std::shared_ptr<T> resource)
+	{
+		slots_.push_back(std::move(resource));
+		last_used_.emplace_back(0);
+
+		if (slots_.size() * 2 > id_table_.size())
+		{
+			auto old_table = std::move(id_table_);
+			id_table_.assign((std::max)(size_t(16), old_table.size() * 2), std::make_pair(uint64_t(0), kNoSlot));
+
+			for (const auto& entry : old_table)
+			{
+				if (entry.second != kNoSlot) placeId(entry.first, entry.second);
+			}
+		}
+
+		placeId(resource_id.value, static_cast<uint32_t>(slots_.size() - 1));
+	}
+
+	void placeId(uint64_t id, uint32_t slot)
+	{
+		const size_t mask = id_table_.size() - 1;
+		size_t i = id & mask;
+		while (id_table_[i].second != kNoSlot) i = (i + 1) & mask;
+		id_table_[i] = std::make_pair(id, slot);
+	}
+
+	// Resources by insertion order, and the slot of each name id.
+	std::vector<std::shared_ptr<T> > slots_;
+	std::vector<std::pair<uint64_t, uint32_t> > id_table_;
+
+	// Use clock of the last get of each slot. Gets may run on several threads at once, while drawing.
+	mutable std::deque<std::atomic<uint32_t> > last_used_;
+	uint32_t use_clock_ = 1;
 };
\ No newline at end of file
@@ -0,0 +1,353 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "util/ResourceMap.hh"
+#include "util/ThreadPool.hh"
+
+// Loads resources of a ResourceMap in background.
+// A requested name is bound to the placeholder at once, and rebound to the resource
+// when it is finalized by Update, so users of the ResourceMap need not know about streaming.
+template <typename T>
+class ResourceStreamer
+{
+public:
+	using Handle = size_t;
+
+	// Creates the resource from the prepared data. Runs on the owning thread.
+	using Creator = std::function<std::shared_ptr<T>()>;
+
+	struct Job
+	{
+		// Runs on a worker thread (file read, decode, parse), and returns the creator.
+		std::function<Creator()> prepare;
+
+		// Optional. The job is not finalized while it returns false, e.g. for dependencies.
+		std::function<bool()> can_create;
+	};
+
+	ResourceStreamer(ResourceMap<T>& resource_map, std::shared_ptr<T> placeholder)
+		: resource_map_(resource_map),
+		  placeholder_(placeholder),
+		  max_in_flight_((std::max)(size_t(1), ThreadPool::GetInstance().GetThreadCount()))
+	{
+	}
+
+	ResourceStreamer(const ResourceStreamer&) = delete;
+
+	~ResourceStreamer()
+	{
+		// Jobs in flight may refer to the owner of this streamer.
+		for (Handle handle : preparing_)
+		{
+			if (requests_[handle]->prepared.valid()) requests_[handle]->prepared.wait();
+		}
+	}
+
+	// Returns immediately. The name refers to the placeholder until the resource is ready.
+	Handle Request(const std::string& name, const std::string& path, int priority, Job job)
+	{
+		// Resource with same path already loaded or requested, share it
+		if (!path.empty())
+		{
+			auto requested = path_requests_.find(path);
+			if (requested != path_requests_.end())
+			{
+				RequestState& request = *requests_[requested->second];
+				if (!name.empty())
+				{
+					resource_map_.insert(name, request.resource ? request.resource : placeholder_);
+					if (!request.resource) request.names.push_back(name);
+				}
+				request.priority = (std::max)(request.priority, priority);
+				return requested->second;
+			}
+		}
+
+		auto request = std::make_shared<RequestState>();
+		request->path = path;
+		request->priority = priority;
+		request->job = std::move(job);
+		if (!name.empty()) request->names.push_back(name);
+
+		if (!path.empty())
+		{
+			auto loaded = resource_map_.path_resources.find(path);
+			if (loaded != resource_map_.path_resources.end()) request->resource = loaded->second;
+		}
+
+		if (!name.empty()) resource_map_.insert(name, request->resource ? request->resource : placeholder_);
+
+		const Handle handle = requests_.size();
+		requests_.push_back(request);
+		if (!path.empty()) path_requests_[path] = handle;
+		if (!request->resource) queued_.push_back(handle);
+
+		return handle;
+	}
+
+	// Request every node of given type in the manifest, with its "priority" attribute (default 0).
+	// describe runs on this thread; the job may keep the node as long as the manifest lives.
+	void RequestFromManifest(const ResourceManifest& manifest, const char* resource_type,
+		std::function<Job (resource_node)> describe)
+	{
+		for (const auto& node : manifest.GetNodes(resource_type))
+		{
+			Request(node.get_attr("name"), node.get_attr("src"),
+				std::stoi(node.get_attr("priority", "0")), describe(node));
+		}
+	}
+
+	inline bool IsReady(Handle handle) const { return requests_[handle]->resource != nullptr; }
+
+	inline std::shared_ptr<T> Get(Handle handle) const
+	{
+		return IsReady(handle) ? requests_[handle]->resource : placeholder_;
+	}
+
+	inline size_t GetPendingCount() const { return queued_.size() + preparing_.size(); }
+
+	// Names or paths of the requests which failed to load, and are left to the placeholder.
+	inline const std::vector<std::string>& GetFailures() const { return failures_; }
+
+	// Keep the resident resources within budget_bytes, as measured by size_of, by evicting
+	// the least recently used ones. Only resources not used in the last frame and referred to
+	// by nothing but the resource map are evicted; their names are bound to the placeholder
+	// and they are requested again when used. 0 for no budget.
+	// Call before the first request, as the jobs are kept for reloading only with a budget.
+	void SetBudget(size_t budget_bytes, std::function<size_t (const T&)> size_of)
+	{
+		budget_bytes_ = budget_bytes;
+		size_of_ = std::move(size_of);
+	}
+
+	// For the dependencies of other jobs: true if the resource of the path is loaded,
+	// or failed and so stands for the placeholder. If it has been evicted, it is requested again.
+	// A job waiting on it is ready otherwise, so it goes before the requests nothing waits on.
+	bool Require(const std::string& path)
+	{
+		auto requested = path_requests_.find(path);
+		if (requested == path_requests_.end())
+		{
+			return resource_map_.path_resources.find(path) != resource_map_.path_resources.end();
+		}
+
+		RequestState& request = *requests_[requested->second];
+		if (request.evicted) Reload(requested->second);
+		if (!request.resource && !request.failed) Bump(requested->second, kInUsePriority);
+		return request.resource != nullptr || request.failed;
+	}
+
+	// Call once per frame. Finalizes prepared resources by priority until budget is spent,
+	// but at least one per call so that loading always progresses.
+	void Update(std::chrono::microseconds budget)
+	{
+		const auto deadline = std::chrono::steady_clock::now() + budget;
+
+		Dispatch();
+
+		std::stable_sort(preparing_.begin(), preparing_.end(), [this](Handle a, Handle b) {
+			return requests_[a]->priority > requests_[b]->priority;
+		});
+
+		bool finalized = false;
+		for (size_t i = 0; i < preparing_.size(); )
+		{
+			if (finalized && std::chrono::steady_clock::now() >= deadline) break;
+
+			RequestState& request = *requests_[preparing_[i]];
+			const bool is_prepared = request.prepared.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+			if (!is_prepared || (request.job.can_create && !request.job.can_create()))
+			{
+				i++;
+				continue;
+			}
+
+			Finalize(request);
+			preparing_.erase(preparing_.begin() + i);
+			finalized = true;
+		}
+
+		// Fill the slots freed above.
+		Dispatch();
+
+		if (budget_bytes_) Evict();
+
+		// Uses from here on, i.e. in this frame, are newer than the evictions above.
+		resource_map_.advanceUseClock();
+	}
+
+private:
+	// Above any priority given in the manifest.
+	static constexpr int kInUsePriority = 1 << 24;
+
+	struct RequestState
+	{
+		std::vector<std::string> names;
+		std::string path;
+		int priority = 0;
+
+		Job job;
+		std::future<Creator> prepared;
+		std::shared_ptr<T> resource;
+
+		bool evicted = false;
+		uint32_t evicted_at = 0;  // Use clock of the resource map
+		bool failed = false;
+	};
+
+	inline void Bump(Handle handle, int priority)
+	{
+		requests_[handle]->priority = (std::max)(requests_[handle]->priority, priority);
+	}
+
+	// Start preparing queued requests by priority, keeping every worker busy but no more,
+	// so that a bumped request does not wait behind the whole queue.
+	void Dispatch()
+	{
+		// Evicted resources used since are loaded again.
+		for (size_t i = 0; i < evicted_.size(); )
+		{
+			if (GetLastUse(*requests_[evicted_[i]]) > requests_[evicted_[i]]->evicted_at) Reload(evicted_[i]);
+			else i++;
+		}
+
+		// Requests whose placeholder was drawn in the last frame are what the player is looking at.
+		const uint32_t use_clock = resource_map_.getUseClock();
+		for (Handle handle : queued_)
+		{
+			if (GetLastUse(*requests_[handle]) >= use_clock) Bump(handle, kInUsePriority);
+		}
+
+		while (preparing_.size() < max_in_flight_ && !queued_.empty())
+		{
+			auto next = std::max_element(queued_.begin(), queued_.end(), [this](Handle a, Handle b) {
+				return requests_[a]->priority < requests_[b]->priority;
+			});
+
+			const Handle handle = *next;
+			queued_.erase(next);
+
+			auto request = requests_[handle];
+			request->prepared = ThreadPool::GetInstance().Submit([request]() { return request->job.prepare(); });
+			preparing_.push_back(handle);
+		}
+	}
+
+	void Finalize(RequestState& request)
+	{
+		const std::string& resource_name = request.names.empty() ? request.path : request.names.front();
+
+		std::shared_ptr<T> resource;
+		try
+		{
+			Creator create = request.prepared.get();
+			resource = create();
+		}
+		catch (const std::exception&)
+		{
+			resource.reset();
+		}
+
+		// A missing or broken file leaves the placeholder bound, rather than stopping the game.
+		// Its path refers to the placeholder as well, for the jobs which depend on it.
+		if (!resource)
+		{
+			if (!request.path.empty()) resource_map_.insert_by_path(request.path, placeholder_);
+			request.failed = true;
+			request.job = Job();
+			failures_.push_back(resource_name);
+			return;
+		}
+
+		for (const auto& name : request.names) resource_map_.replace(name, resource);
+		if (!request.path.empty()) resource_map_.insert_by_path(request.path, resource);
+
+		// The job may hold the prepared data, which is not needed anymore
+		// unless the resource can be evicted and loaded again.
+		request.resource = resource;
+		if (!budget_bytes_) request.job = Job();
+	}
+
+	uint32_t GetLastUse(const RequestState& request) const
+	{
+		uint32_t last_use = 0;
+		for (const auto& name : request.names) last_use = (std::max)(last_use, resource_map_.getLastUse(name));
+		return last_use;
+	}
+
+	void Evict()
+	{
+		const uint32_t use_clock = resource_map_.getUseClock();
+
+		// A resource shared by several requests is counted once, and never evicted,
+		// as the other requests refer to it.
+		std::unordered_set<const T*> counted;
+		size_t resident_bytes = 0;
+		std::vector<std::pair<uint32_t, Handle> > candidates;
+		for (Handle handle = 0; handle < requests_.size(); handle++)
+		{
+			const RequestState& request = *requests_[handle];
+			if (!request.resource) continue;
+
+			if (counted.insert(request.resource.get()).second) resident_bytes += size_of_(*request.resource);
+
+			const uint32_t last_use = GetLastUse(request);
+			const bool is_referred_elsewhere =
+				request.resource.use_count() != resource_map_.countReferences(request.resource) + 1;
+			if (last_use < use_clock && !is_referred_elsewhere) candidates.emplace_back(last_use, handle);
+		}
+
+		if (resident_bytes <= budget_bytes_) return;
+
+		std::sort(candidates.begin(), candidates.end());
+		for (const auto& candidate : candidates)
+		{
+			if (resident_bytes <= budget_bytes_) break;
+
+			RequestState& request = *requests_[candidate.second];
+			const size_t resource_bytes = size_of_(*request.resource);
+
+			for (const auto& name : request.names) resource_map_.replace(name, placeholder_);
+			if (!request.path.empty()) resource_map_.erase_by_path(request.path);
+			request.resource.reset();
+			request.evicted = true;
+			request.evicted_at = use_clock;
+			evicted_.push_back(candidate.second);
+
+			resident_bytes -= resource_bytes;
+			resource_map_.stats.evictions++;
+			resource_map_.stats.bytes_evicted += resource_bytes;
+		}
+	}
+
+	void Reload(Handle handle)
+	{
+		requests_[handle]->evicted = false;
+		evicted_.erase(std::find(evicted_.begin(), evicted_.end(), handle));
+		queued_.push_back(handle);
+		resource_map_.stats.reloads++;
+	}
+
+	ResourceMap<T>& resource_map_;
+	std::shared_ptr<T> placeholder_;
+	const size_t max_in_flight_;
+
+	std::vector<std::shared_ptr<RequestState> > requests_;
+	std::unordered_map<std::string, Handle> path_requests_;
+
+	std::vector<Handle> queued_;
+	std::vector<Handle> preparing_;
+	std::vector<Handle> evicted_;
+	std::vector<std::string> failures_;
+
+	size_t budget_bytes_ = 0;
+	std::function<size_t (const T&)> size_of_;
+};
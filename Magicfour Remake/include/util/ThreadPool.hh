@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed number of worker threads running submitted tasks in FIFO order.
+// Workers initialize COM, so tasks may use WIC and other COM based APIs.
+class ThreadPool
+{
+public:
+	// Use every core but the one of the calling thread by default.
+	explicit ThreadPool(size_t thread_count = 0);
+	ThreadPool(const ThreadPool&) = delete;
+	~ThreadPool();
+
+	// The pool shared by resource loading.
+	static ThreadPool& GetInstance();
+
+	template <typename F>
+	auto Submit(F&& task) -> std::future<std::invoke_result_t<F> >
+	{
+		using R = std::invoke_result_t<F>;
+
+		// packaged_task is move-only, but the queue holds copyable functions.
+		auto packaged = std::make_shared<std::packaged_task<R()> >(std::forward<F>(task));
+		std::future<R> result = packaged->get_future();
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			tasks_.emplace([packaged]() { (*packaged)(); });
+		}
+		condition_.notify_one();
+
+		return result;
+	}
+
+	// Run body(begin, end) over [0, count) in chunks of grain items, and wait for all of them.
+	// The calling thread takes chunks as well, so this may be called from a task of the pool
+	// without waiting on workers that are busy. The first exception thrown by body is rethrown.
+	template <typename F>
+	void ParallelFor(size_t count, size_t grain, F&& body)
+	{
+		const size_t chunk_count = (count + grain - 1) / grain;
+		if (chunk_count <= 1)
+		{
+			if (count) body(size_t(0), count);
+			return;
+		}
+
+		struct State
+		{
+			std::atomic<size_t> next_chunk{ 0 };
+			std::atomic<size_t> done_chunks{ 0 };
+			std::mutex mutex;
+			std::condition_variable finished;
+			std::exception_ptr error;
+		};
+
+		// Helpers queued behind other tasks may start after this returns, and only find no chunk left.
+		auto state = std::make_shared<State>();
+		auto* body_ptr = &body;
+		auto run = [state, body_ptr, count, grain, chunk_count]()
+		{
+			for (size_t chunk = state->next_chunk++; chunk < chunk_count; chunk = state->next_chunk++)
+			{
+				try
+				{
+					(*body_ptr)(chunk * grain, (std::min)(count, (chunk + 1) * grain));
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(state->mutex);
+					if (!state->error) state->error = std::current_exception();
+				}
+
+				if (++state->done_chunks == chunk_count)
+				{
+					std::lock_guard<std::mutex> lock(state->mutex);
+					state->finished.notify_all();
+				}
+			}
+		};
+
+		const size_t helper_count = (std::min)(workers_.size(), chunk_count - 1);
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			for (size_t i = 0; i < helper_count; i++) tasks_.emplace(run);
+		}
+		condition_.notify_all();
+
+		run();
+
+		std::unique_lock<std::mutex> lock(state->mutex);
+		state->finished.wait(lock, [&state, chunk_count]() { return state->done_chunks == chunk_count; });
+		if (state->error) std::rethrow_exception(state->error);
+	}
+
+	inline size_t GetThreadCount() const { return workers_.size(); }
+
+private:
+	void WorkerMain();
+
+	std::vector<std::thread> workers_;
+	std::queue<std::function<void()> > tasks_;
+
+	std::mutex mutex_;
+	std::condition_variable condition_;
+	bool stopping_;
+};
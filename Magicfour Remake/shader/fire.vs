@@ -6,17 +6,28 @@
 /////////////
 // GLOBALS //
 /////////////
-cbuffer MatrixBuffer
+cbuffer DrawBuffer : register(b0)
 {
-    matrix mvp;
+    float3 scrollSpeeds;
+    float padding1;
+    float3 scales;
+    float padding2;
+
+    float2 distortion1; // for noise1
+    float2 distortion2; // for noise2
+    float2 distortion3; // for noise3
+    float distortionScale;
+    float distortionBias;
 };
 
-cbuffer NoiseBuffer
+cbuffer FrameBuffer : register(b4)
 {
+    matrix vpMatrix;
+    float4 diffuseColor;
+    float3 lightDirection;
     float frameTime;
-    float3 scrollSpeeds;
-    float3 scales; // 3 scale
-    float padding;
+    float3 cameraPosition;
+    float framePadding;
 };
 
 
@@ -27,6 +38,12 @@ struct VertexInputType
 {
     float4 position : POSITION;
     float2 tex : TEXCOORD0;
+
+    // Per instance
+    float4 world0 : WORLD0;
+    float4 world1 : WORLD1;
+    float4 world2 : WORLD2;
+    float4 world3 : WORLD3;
 };
 
 struct PixelInputType
@@ -49,7 +66,8 @@ PixelInputType vsMain(VertexInputType input)
 	// Change the position vector to be 4 units for proper matrix calculations.
     input.position.w = 1.0f;
 
-    output.position = mul(input.position, mvp);
+    float4x4 worldMatrix = float4x4(input.world0, input.world1, input.world2, input.world3);
+    output.position = mul(mul(input.position, worldMatrix), vpMatrix);
     output.tex = input.tex;
 
     // ù°  ؽ ǥ ù° ũ   ũ ӵ  ̿Ͽ մϴ.
@@ -6,10 +6,14 @@
 /////////////
 // GLOBALS //
 /////////////
-cbuffer MatrixBuffer
+cbuffer FrameBuffer : register(b4)
 {
-	matrix mvpMatrix;
-	matrix worldTrInvMatrix;
+	matrix vpMatrix;
+	float4 diffuseColor;
+	float3 lightDirection;
+	float frameTime;
+	float3 cameraPosition;
+	float framePadding;
 };
 
 
@@ -21,6 +25,16 @@ struct VertexInputType
     float4 position : POSITION;
     float2 tex : TEXCOORD0;
 	float3 normal : NORMAL;
+
+	// Per instance
+	float4 world0 : WORLD0;
+	float4 world1 : WORLD1;
+	float4 world2 : WORLD2;
+	float4 world3 : WORLD3;
+	float4 worldTrInv0 : WORLDTRINV0;
+	float4 worldTrInv1 : WORLDTRINV1;
+	float4 worldTrInv2 : WORLDTRINV2;
+	float4 worldTrInv3 : WORLDTRINV3;
 };
 
 struct PixelInputType
@@ -38,18 +52,20 @@ PixelInputType vsMain(VertexInputType input)
 {
     PixelInputType output;
     
+	float4x4 worldMatrix = float4x4(input.world0, input.world1, input.world2, input.world3);
+	float4x4 worldTrInvMatrix = float4x4(input.worldTrInv0, input.worldTrInv1, input.worldTrInv2, input.worldTrInv3);
 
 	// Change the position vector to be 4 units for proper matrix calculations.
     input.position.w = 1.0f;
 
 	// Calculate the position of the vertex against the world, view, and projection matrices.
-    output.position = mul(input.position, mvpMatrix);
+    output.position = mul(mul(input.position, worldMatrix), vpMatrix);
     
 	// Store the texture coordinates for the pixel shader.
 	output.tex = input.tex;
     
 	// Calculate the normal vector against the world matrix only.
-    output.normal = mul(input.normal, worldTrInvMatrix);
+    output.normal = mul(input.normal, (float3x3)worldTrInvMatrix);
 	
     // Normalize the normal vector.
     output.normal = normalize(output.normal);
@@ -1,8 +1,12 @@
-cbuffer MatrixBuffer
+cbuffer DrawBuffer : register(b0)
 {
 	matrix mvpMatrix;
-    matrix worldMatrix;
+	matrix worldMatrix;
 	matrix worldTrInvMatrix;
+
+	float4 ambientWeight;
+	float4 diffuseWeight;
+	float4 specularWeight;
 };
 
 struct VertexInputType
@@ -6,11 +6,14 @@
 /////////////
 // GLOBALS //
 /////////////
-cbuffer MatrixBuffer
+cbuffer FrameBuffer : register(b4)
 {
-    matrix mvpMatrix;
-    matrix worldMatrix;
-    matrix worldTrInvMatrix;
+	matrix vpMatrix;
+	float4 diffuseColor;
+	float3 lightDirection;
+	float frameTime;
+	float3 cameraPosition;
+	float framePadding;
 };
 
 //////////////
@@ -21,6 +24,17 @@ struct VertexInputType
     float4 position : POSITION;
     float2 tex : TEXCOORD0;
 	float3 normal : NORMAL;
+
+	// Per instance
+	float4 world0 : WORLD0;
+	float4 world1 : WORLD1;
+	float4 world2 : WORLD2;
+	float4 world3 : WORLD3;
+	float4 worldTrInv0 : WORLDTRINV0;
+	float4 worldTrInv1 : WORLDTRINV1;
+	float4 worldTrInv2 : WORLDTRINV2;
+	float4 worldTrInv3 : WORLDTRINV3;
+	float4 color : COLOR;
 };
 
 struct PixelInputType
@@ -29,6 +43,7 @@ struct PixelInputType
     float4 surfacePos: POSITION;
     float2 tex : TEXCOORD0;
 	float3 normal : NORMAL;
+	float4 color : COLOR;
 };
 
 
@@ -39,12 +54,15 @@ PixelInputType vsMain(VertexInputType input)
 {
     PixelInputType output;
     
+	float4x4 worldMatrix = float4x4(input.world0, input.world1, input.world2, input.world3);
+	float4x4 worldTrInvMatrix = float4x4(input.worldTrInv0, input.worldTrInv1, input.worldTrInv2, input.worldTrInv3);
+
 	// Change the position vector to be 4 units for proper matrix calculations.
     input.position.w = 1.0f;
 
 	// Calculate the position of the vertex against the world, view, and projection matrices.
-    output.position = mul(input.position, mvpMatrix);
     output.surfacePos = mul(input.position, worldMatrix);
+    output.position = mul(output.surfacePos, vpMatrix);
 
 	// Calculate the normal vector against the world matrix only.
     output.normal = mul(input.normal, (float3x3)worldTrInvMatrix);
@@ -52,5 +70,7 @@ PixelInputType vsMain(VertexInputType input)
     // Normalize the normal vector.
     output.normal = normalize(output.normal);
 
+	output.color = input.color;
+
     return output;
 }
\ No newline at end of file
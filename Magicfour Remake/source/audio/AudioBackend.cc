@@ -0,0 +1,58 @@
+#include "audio/AudioBackend.hh"
+
+#include "core/GameException.hh"
+
+using namespace std;
+
+namespace
+{
+	constexpr uint16_t kChannelCount = 2;
+	constexpr uint16_t kBitsPerSample = 16;
+	constexpr uint32_t kHeaderSize = 44;
+
+	template <typename T>
+	void WriteValue(ofstream& fout, T value)
+	{
+		fout.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+}
+
+WaveFileAudioBackend::WaveFileAudioBackend(const char* filename, uint32_t sample_rate)
+	: file_(filename, ios::binary | ios::trunc), sample_rate_(sample_rate)
+{
+	if (!file_) throw GAME_EXCEPTION(L"Failed to create wave file.");
+
+	// Sizes are written again when the file is completed.
+	WriteHeader();
+}
+
+WaveFileAudioBackend::~WaveFileAudioBackend()
+{
+	file_.seekp(0);
+	WriteHeader();
+}
+
+void WaveFileAudioBackend::Write(const int16_t* samples, size_t frame_count)
+{
+	file_.write(reinterpret_cast<const char*>(samples), frame_count * kChannelCount * sizeof(int16_t));
+	written_frames_ += frame_count;
+}
+
+void WaveFileAudioBackend::WriteHeader()
+{
+	const uint32_t block_align = kChannelCount * kBitsPerSample / 8;
+	const uint32_t data_size = static_cast<uint32_t>(written_frames_ * block_align);
+
+	file_.write("RIFF", 4);
+	WriteValue<uint32_t>(file_, kHeaderSize - 8 + data_size);
+	file_.write("WAVEfmt ", 8);
+	WriteValue<uint32_t>(file_, 16);
+	WriteValue<uint16_t>(file_, 1);  // PCM
+	WriteValue<uint16_t>(file_, kChannelCount);
+	WriteValue<uint32_t>(file_, sample_rate_);
+	WriteValue<uint32_t>(file_, sample_rate_ * block_align);
+	WriteValue<uint16_t>(file_, static_cast<uint16_t>(block_align));
+	WriteValue<uint16_t>(file_, kBitsPerSample);
+	file_.write("data", 4);
+	WriteValue<uint32_t>(file_, data_size);
+}
@@ -0,0 +1,182 @@
+#include "audio/AudioClip.hh"
+
+#include "audio/ImaAdpcm.hh"
+#include "core/GameException.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+namespace
+{
+	constexpr uint16_t kWaveFormatPcm = 1;
+	constexpr uint16_t kWaveFormatFloat = 3;
+	constexpr uint16_t kWaveFormatImaAdpcm = 0x11;
+	constexpr uint16_t kWaveFormatExtensible = 0xFFFE;
+
+	template <typename T>
+	T Read(const uint8_t* data)
+	{
+		T value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+}
+
+AudioClip::AudioClip(uint32_t sample_rate, uint32_t channel_count)
+	: sample_rate_(sample_rate), channel_count_(channel_count)
+{
+	if (sample_rate_ == 0 || (channel_count_ != 1 && channel_count_ != 2))
+		throw GAME_EXCEPTION(L"Audio clips must be mono or stereo.");
+}
+
+AudioClip::AudioClip(uint32_t sample_rate, uint32_t channel_count, vector<int16_t> samples)
+	: AudioClip(sample_rate, channel_count)
+{
+	samples_ = move(samples);
+	frame_count_ = samples_.size() / channel_count_;
+}
+
+shared_ptr<AudioClip> AudioClip::LoadWave(string_view bytes, const string& filename, Storage storage, shared_ptr<const void> owner)
+{
+	const uint8_t* data = reinterpret_cast<const uint8_t*>(bytes.data());
+	const size_t size = bytes.size();
+	if (size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0)
+		throw fileformat_error(filename.c_str(), WFILE, __LINE__);
+
+	uint16_t format_tag = 0, channel_count = 0, block_align = 0, bits_per_sample = 0;
+	uint32_t sample_rate = 0, fact_frames = 0;
+	const uint8_t* audio = nullptr;
+	size_t audio_bytes = 0;
+
+	// Walk the chunks for "fmt ", "fact" and "data". Chunks are padded to even sizes.
+	size_t offset = 12;
+	while (offset + 8 <= size)
+	{
+		const uint32_t chunk_size = Read<uint32_t>(data + offset + 4);
+		const uint8_t* chunk = data + offset + 8;
+		if (chunk_size > size - offset - 8) break;
+
+		if (memcmp(data + offset, "fmt ", 4) == 0 && chunk_size >= 16)
+		{
+			format_tag = Read<uint16_t>(chunk);
+			channel_count = Read<uint16_t>(chunk + 2);
+			sample_rate = Read<uint32_t>(chunk + 4);
+			block_align = Read<uint16_t>(chunk + 12);
+			bits_per_sample = Read<uint16_t>(chunk + 14);
+
+			// The actual format of an extensible one is the first two bytes of its sub-format GUID.
+			if (format_tag == kWaveFormatExtensible && chunk_size >= 26) format_tag = Read<uint16_t>(chunk + 24);
+		}
+		else if (memcmp(data + offset, "fact", 4) == 0 && chunk_size >= 4)
+		{
+			fact_frames = Read<uint32_t>(chunk);
+		}
+		else if (memcmp(data + offset, "data", 4) == 0)
+		{
+			audio = chunk;
+			audio_bytes = chunk_size;
+		}
+
+		offset += 8 + chunk_size + (chunk_size & 1);
+	}
+
+	if (!audio || channel_count == 0) throw fileformat_error(filename.c_str(), WFILE, __LINE__);
+
+	shared_ptr<AudioClip> clip(new AudioClip(sample_rate, channel_count));
+
+	if (format_tag == kWaveFormatImaAdpcm && bits_per_sample == 4)
+	{
+		// Whole blocks only. Without a fact chunk, every frame of them counts.
+		clip->frames_per_block_ = ImaAdpcm::GetFramesPerBlock(block_align, channel_count);
+		if (clip->frames_per_block_ == 0) throw fileformat_error(filename.c_str(), WFILE, __LINE__);
+
+		const size_t block_count = audio_bytes / block_align;
+		clip->storage_ = Storage::kImaAdpcm;
+		clip->block_bytes_ = block_align;
+		clip->blocks_.assign(audio, audio + block_count * block_align);
+		clip->frame_count_ = block_count * clip->frames_per_block_;
+		if (fact_frames) clip->frame_count_ = (std::min)(clip->frame_count_, size_t(fact_frames));
+		return clip;
+	}
+
+	SampleFormat format;
+	if (format_tag == kWaveFormatPcm && bits_per_sample == 16) format = SampleFormat::kInt16;
+	else if (format_tag == kWaveFormatPcm && bits_per_sample == 8) format = SampleFormat::kUInt8;
+	else if (format_tag == kWaveFormatFloat && bits_per_sample == 32) format = SampleFormat::kFloat32;
+	else throw fileformat_error(filename.c_str(), WFILE, __LINE__);
+
+	// A trailing partial frame is dropped.
+	const size_t bytes_per_frame = bits_per_sample / 8 * channel_count;
+	clip->frame_count_ = audio_bytes / bytes_per_frame;
+
+	if (storage == Storage::kStream)
+	{
+		if (!owner)
+		{
+			auto copy = make_shared<vector<uint8_t> >(audio, audio + clip->frame_count_ * bytes_per_frame);
+			audio = copy->data();
+			owner = move(copy);
+		}
+
+		clip->storage_ = Storage::kStream;
+		clip->stream_data_ = audio;
+		clip->stream_format_ = format;
+		clip->stream_owner_ = move(owner);
+		return clip;
+	}
+
+	vector<int16_t> samples(clip->frame_count_ * channel_count);
+	ConvertSamples(format, audio, samples.size(), samples.data());
+
+	if (storage == Storage::kImaAdpcm)
+	{
+		clip->storage_ = Storage::kImaAdpcm;
+		clip->block_bytes_ = ImaAdpcm::kBlockBytesPerChannel * channel_count;
+		clip->frames_per_block_ = ImaAdpcm::GetFramesPerBlock(clip->block_bytes_, channel_count);
+		clip->blocks_ = ImaAdpcm::Encode(samples.data(), clip->frame_count_, channel_count);
+		return clip;
+	}
+
+	clip->samples_ = move(samples);
+	return clip;
+}
+
+void AudioClip::ConvertSamples(SampleFormat format, const uint8_t* source, size_t sample_count, int16_t* samples)
+{
+	switch (format)
+	{
+	case SampleFormat::kInt16:
+		memcpy(samples, source, sample_count * sizeof(int16_t));
+		break;
+
+	case SampleFormat::kUInt8:
+		for (size_t i = 0; i < sample_count; i++) samples[i] = static_cast<int16_t>((source[i] - 128) << 8);
+		break;
+
+	case SampleFormat::kFloat32:
+		for (size_t i = 0; i < sample_count; i++)
+		{
+			const float value = Read<float>(source + i * sizeof(float));
+			samples[i] = static_cast<int16_t>(lrintf((std::min)((std::max)(value, -1.0f), 1.0f) * 32767.0f));
+		}
+		break;
+	}
+}
+
+void AudioClip::DecodeBlock(size_t block, int16_t* frames) const
+{
+	ImaAdpcm::DecodeBlock(blocks_.data() + block * block_bytes_, block_bytes_, channel_count_, frames);
+}
+
+void AudioClip::ReadFrames(size_t first_frame, size_t frame_count, int16_t* frames) const
+{
+	size_t bytes_per_sample = sizeof(int16_t);
+	if (stream_format_ == SampleFormat::kUInt8) bytes_per_sample = 1;
+	else if (stream_format_ == SampleFormat::kFloat32) bytes_per_sample = sizeof(float);
+
+	const uint8_t* source = stream_data_ + first_frame * channel_count_ * bytes_per_sample;
+	ConvertSamples(stream_format_, source, frame_count * channel_count_, frames);
+}
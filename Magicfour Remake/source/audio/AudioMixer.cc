@@ -0,0 +1,405 @@
+#include "audio/AudioMixer.hh"
+
+#include "audio/AudioBackend.hh"
+#include "audio/AudioClip.hh"
+#include "audio/AudioStream.hh"
+
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define AUDIO_MIXER_SSE2
+#endif
+
+using namespace std;
+
+namespace
+{
+	// Rendered at most this many frames at once, which bounds the mix buffers.
+	constexpr size_t kRenderChunkFrames = 1024;
+
+	constexpr uint64_t kUnitStep = uint64_t(1) << 32;
+	constexpr uint32_t kMaxVoiceCount = 0xFFFF;
+
+	// dst[i] += src[i] * gain over count samples.
+	void AccumulateSamples(const int16_t* src, float gain, float* dst, size_t count)
+	{
+		size_t i = 0;
+#ifdef AUDIO_MIXER_SSE2
+		const __m128 gains = _mm_set1_ps(gain);
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			const __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+			const __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+			_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(lo, gains)));
+			_mm_storeu_ps(dst + i + 4, _mm_add_ps(_mm_loadu_ps(dst + i + 4), _mm_mul_ps(hi, gains)));
+		}
+#endif
+		for (; i < count; i++) dst[i] += src[i] * gain;
+	}
+
+	// dst[2i] += src[i] * gain, dst[2i + 1] += src[i] * gain over count frames.
+	void AccumulateMonoToStereo(const int16_t* src, float gain, float* dst, size_t count)
+	{
+		size_t i = 0;
+#ifdef AUDIO_MIXER_SSE2
+		const __m128 gains = _mm_set1_ps(gain);
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i));
+			const __m128i pairs = _mm_unpacklo_epi16(x, x);
+			const __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(pairs, pairs), 16));
+			const __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(pairs, pairs), 16));
+			_mm_storeu_ps(dst + i * 2, _mm_add_ps(_mm_loadu_ps(dst + i * 2), _mm_mul_ps(lo, gains)));
+			_mm_storeu_ps(dst + i * 2 + 4, _mm_add_ps(_mm_loadu_ps(dst + i * 2 + 4), _mm_mul_ps(hi, gains)));
+		}
+#endif
+		for (; i < count; i++)
+		{
+			dst[i * 2] += src[i] * gain;
+			dst[i * 2 + 1] += src[i] * gain;
+		}
+	}
+
+	// Scale, clamp and round to 16-bit.
+	void ConvertToPcm(const float* src, float gain, int16_t* dst, size_t count)
+	{
+		size_t i = 0;
+#ifdef AUDIO_MIXER_SSE2
+		const __m128 gains = _mm_set1_ps(gain);
+		const __m128 max_value = _mm_set1_ps(32767.0f), min_value = _mm_set1_ps(-32768.0f);
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i), gains), min_value), max_value);
+			const __m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 4), gains), min_value), max_value);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+		}
+#endif
+		for (; i < count; i++)
+		{
+			const float value = (std::min)((std::max)(src[i] * gain, -32768.0f), 32767.0f);
+			dst[i] = static_cast<int16_t>(value < 0.0f ? value - 0.5f : value + 0.5f);
+		}
+	}
+}
+
+AudioMixer::AudioMixer(unique_ptr<AudioBackend> backend, size_t voice_count, bool stream_thread)
+	: backend_(move(backend)), voices_((std::min)(voice_count, size_t(kMaxVoiceCount))), threaded_streams_(stream_thread)
+{
+	mix_.resize(kRenderChunkFrames * kChannelCount);
+	output_.resize(kRenderChunkFrames * kChannelCount);
+}
+
+AudioMixer::~AudioMixer()
+{
+	for (auto& voice : voices_) ReleaseVoice(voice);
+}
+
+void AudioMixer::SetSoundSettings(uint64_t sound_id, const SoundSettings& settings)
+{
+	settings_[sound_id] = settings;
+}
+
+const AudioMixer::SoundSettings& AudioMixer::GetSettings(uint64_t sound_id) const
+{
+	static const SoundSettings kDefaultSettings;
+
+	auto settings = settings_.find(sound_id);
+	return (settings != settings_.end()) ? settings->second : kDefaultSettings;
+}
+
+AudioMixer::VoiceHandle AudioMixer::Play(uint64_t sound_id, shared_ptr<const AudioClip> clip, bool loop)
+{
+	if (!clip) return kNoVoice;
+
+	stats_.plays++;
+	const SoundSettings& settings = GetSettings(sound_id);
+	const uint64_t coalesce_frames = static_cast<uint64_t>(settings.coalesce_ms * kSampleRate / 1000.0f);
+
+	// Count the instances of the sound, and join one just started.
+	size_t instance_count = 0, oldest_instance = voices_.size();
+	for (size_t i = 0; i < voices_.size(); i++)
+	{
+		const Voice& voice = voices_[i];
+		if (!voice.clip || voice.sound_id != sound_id) continue;
+
+		if (!loop && !voice.loop && voice.clip == clip && rendered_frames_ - voice.start_frame <= coalesce_frames)
+		{
+			stats_.coalesced++;
+			return MakeHandle(i);
+		}
+
+		instance_count++;
+		if (oldest_instance == voices_.size() || voice.start_frame < voices_[oldest_instance].start_frame) oldest_instance = i;
+	}
+
+	size_t index;
+	if (instance_count >= settings.max_instances && oldest_instance != voices_.size())
+	{
+		index = oldest_instance;
+		stats_.instance_limited++;
+	}
+	else index = AllocateVoice(settings);
+
+	if (index == voices_.size())
+	{
+		stats_.rejected++;
+		return kNoVoice;
+	}
+
+	Voice& voice = voices_[index];
+	ReleaseVoice(voice);
+
+	if (clip->GetStorage() == AudioClip::Storage::kStream)
+	{
+		// The first chunk is read here, so the stream does not start with an underrun.
+		voice.stream = make_shared<AudioStream>(clip, loop);
+		voice.stream->Fill();
+
+		if (threaded_streams_)
+		{
+			if (!stream_thread_) stream_thread_ = make_unique<AudioStreamThread>();
+			stream_thread_->Add(voice.stream);
+		}
+	}
+
+	voice.step = (static_cast<uint64_t>(clip->GetSampleRate()) << 32) / kSampleRate;
+	voice.clip = move(clip);
+	voice.sound_id = sound_id;
+	voice.priority = settings.priority;
+	voice.gain = settings.gain;
+	voice.loop = loop;
+	voice.position = 0;
+	voice.start_frame = rendered_frames_;
+	voice.history[0] = voice.history[1] = 0;
+	voice.stream_frame = 0;
+	voice.generation = (voice.generation + 1) & 0xFFFF;
+
+	stats_.peak_voices = (std::max)(stats_.peak_voices, GetActiveVoiceCount());
+
+	return MakeHandle(index);
+}
+
+size_t AudioMixer::AllocateVoice(const SoundSettings& settings)
+{
+	// A free voice, or else the oldest of the lowest priority, if it is not above the new one.
+	size_t victim = voices_.size();
+	for (size_t i = 0; i < voices_.size(); i++)
+	{
+		const Voice& voice = voices_[i];
+		if (!voice.clip) return i;
+
+		if (voice.priority > settings.priority) continue;
+		if (victim == voices_.size() || voice.priority < voices_[victim].priority ||
+			(voice.priority == voices_[victim].priority && voice.start_frame < voices_[victim].start_frame))
+		{
+			victim = i;
+		}
+	}
+
+	if (victim != voices_.size()) stats_.stolen++;
+	return victim;
+}
+
+void AudioMixer::Stop(VoiceHandle handle)
+{
+	const size_t index = handle & 0xFFFF;
+	if (handle == kNoVoice || index >= voices_.size() || MakeHandle(index) != handle) return;
+
+	ReleaseVoice(voices_[index]);
+}
+
+void AudioMixer::ReleaseVoice(Voice& voice)
+{
+	voice.clip.reset();
+	voice.decoded_block = SIZE_MAX;
+
+	if (voice.stream)
+	{
+		voice.stream->Close();
+		voice.stream.reset();
+	}
+}
+
+bool AudioMixer::IsPlaying(VoiceHandle handle) const
+{
+	const size_t index = handle & 0xFFFF;
+	if (handle == kNoVoice || index >= voices_.size() || MakeHandle(index) != handle) return false;
+
+	return voices_[index].clip != nullptr;
+}
+
+size_t AudioMixer::GetActiveVoiceCount() const
+{
+	return count_if(voices_.begin(), voices_.end(), [](const Voice& voice) { return voice.clip != nullptr; });
+}
+
+MemoryUsage AudioMixer::GetMemoryUsage() const
+{
+	MemoryUsage usage{ sizeof(*this) + voices_.capacity() * sizeof(Voice), 0 };
+	usage.cpu_bytes += mix_.capacity() * sizeof(float) + output_.capacity() * sizeof(int16_t);
+	for (const auto& voice : voices_)
+	{
+		usage.cpu_bytes += voice.decoded.capacity() * sizeof(int16_t);
+		if (voice.stream) usage.cpu_bytes += sizeof(AudioStream) + voice.stream->GetBuffer().GetSizeInBytes();
+	}
+
+	return usage;
+}
+
+void AudioMixer::Update()
+{
+	Render(backend_->GetWritableFrames());
+}
+
+void AudioMixer::Render(size_t frame_count)
+{
+	bool streaming = false;
+	while (frame_count > 0)
+	{
+		const size_t chunk_frames = (std::min)(frame_count, kRenderChunkFrames);
+		const size_t sample_count = chunk_frames * kChannelCount;
+
+		fill(mix_.begin(), mix_.begin() + sample_count, 0.0f);
+		for (auto& voice : voices_)
+		{
+			if (!voice.clip) continue;
+
+			if (voice.stream)
+			{
+				if (!threaded_streams_) while (voice.stream->Fill()) {}
+				streaming = true;
+			}
+
+			if (!MixVoice(voice, mix_.data(), chunk_frames)) ReleaseVoice(voice);
+		}
+
+		ConvertToPcm(mix_.data(), master_gain_, output_.data(), sample_count);
+		backend_->Write(output_.data(), chunk_frames);
+
+		rendered_frames_ += chunk_frames;
+		frame_count -= chunk_frames;
+	}
+
+	if (streaming && stream_thread_) stream_thread_->Notify();
+}
+
+size_t AudioMixer::FetchFrames(Voice& voice, uint64_t frame, const int16_t** frames)
+{
+	const AudioClip& clip = *voice.clip;
+	const uint32_t channels = clip.GetChannelCount();
+
+	switch (clip.GetStorage())
+	{
+	case AudioClip::Storage::kPcm:
+		if (frame >= clip.GetFrameCount()) return 0;
+		*frames = clip.GetSamples() + frame * channels;
+		return static_cast<size_t>(clip.GetFrameCount() - frame);
+
+	case AudioClip::Storage::kImaAdpcm:
+	{
+		if (frame >= clip.GetFrameCount()) return 0;
+
+		const size_t frames_per_block = clip.GetFramesPerBlock();
+		const size_t block = static_cast<size_t>(frame / frames_per_block);
+		if (voice.decoded_block != block)
+		{
+			voice.decoded.resize(frames_per_block * channels);
+			clip.DecodeBlock(block, voice.decoded.data());
+			voice.decoded_block = block;
+		}
+
+		const size_t offset = static_cast<size_t>(frame % frames_per_block);
+		const size_t block_frames = (std::min)(frames_per_block, clip.GetFrameCount() - block * frames_per_block);
+		*frames = voice.decoded.data() + offset * channels;
+		return block_frames - offset;
+	}
+
+	case AudioClip::Storage::kStream:
+	{
+		// Frames mixed since the last fetch are drained from the ring only now,
+		// so the span handed out before stays valid while it is mixed.
+		AudioRingBuffer& buffer = voice.stream->GetBuffer();
+		while (voice.stream_frame < frame)
+		{
+			const size_t drained = static_cast<size_t>((std::min)(frame - voice.stream_frame, uint64_t(buffer.GetReadableFrames())));
+			if (drained == 0) return 0;
+
+			buffer.Consume(drained);
+			voice.stream_frame += drained;
+		}
+
+		return buffer.PeekRead(frames);
+	}
+	}
+
+	return 0;
+}
+
+bool AudioMixer::MixVoice(Voice& voice, float* mix, size_t frame_count)
+{
+	const AudioClip& clip = *voice.clip;
+	const uint32_t channels = clip.GetChannelCount();
+	if (clip.GetFrameCount() == 0) return false;
+
+	size_t out = 0;
+	while (out < frame_count)
+	{
+		const uint64_t frame = voice.position >> 32;
+		const int16_t* frames = nullptr;
+		const size_t available = FetchFrames(voice, frame, &frames);
+		if (available == 0)
+		{
+			if (voice.stream)
+			{
+				if (voice.stream->IsFinished()) return false;
+
+				// The rest of the chunk is left silent, and the stream resumes where it was.
+				stats_.stream_underruns++;
+				return true;
+			}
+
+			// A stream loops as it is read, and clips loop here.
+			if (!voice.loop) return false;
+			voice.position -= uint64_t(clip.GetFrameCount()) << 32;
+			continue;
+		}
+
+		if (voice.step == kUnitStep)
+		{
+			// Same rate: a contiguous run up to the end of what is at hand.
+			const size_t run = (std::min)(frame_count - out, available);
+			if (channels == 2) AccumulateSamples(frames, voice.gain, mix + out * 2, run * 2);
+			else AccumulateMonoToStereo(frames, voice.gain, mix + out * 2, run);
+
+			out += run;
+			voice.position += uint64_t(run) << 32;
+		}
+		else
+		{
+			// Other rates are resampled by linear interpolation from the frame before,
+			// so no frame past the position is ever needed, and every source is read in order.
+			const size_t right_channel = channels - 1;
+			for (; out < frame_count; out++)
+			{
+				const uint64_t index = (voice.position >> 32) - frame;
+				if (index >= available) break;
+
+				const int16_t* current = frames + index * channels;
+				const int16_t* previous = index ? current - channels : voice.history;
+				const float t = static_cast<uint32_t>(voice.position) * (1.0f / 4294967296.0f);
+
+				mix[out * 2] += (previous[0] + (current[0] - previous[0]) * t) * voice.gain;
+				mix[out * 2 + 1] += (previous[right_channel] + (current[right_channel] - previous[right_channel]) * t) * voice.gain;
+				voice.position += voice.step;
+			}
+		}
+
+		// Keep the last frame passed for the next span.
+		const uint64_t passed = (std::min)((voice.position >> 32) - frame, uint64_t(available));
+		if (passed > 0) copy_n(frames + (passed - 1) * channels, channels, voice.history);
+	}
+
+	return voice.stream || voice.loop || (voice.position >> 32) < clip.GetFrameCount();
+}
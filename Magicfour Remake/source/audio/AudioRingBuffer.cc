@@ -0,0 +1,48 @@
+#include "audio/AudioRingBuffer.hh"
+
+#include <algorithm>
+
+using namespace std;
+
+AudioRingBuffer::AudioRingBuffer(size_t frame_capacity, uint32_t channel_count)
+	: samples_(frame_capacity * channel_count), capacity_(frame_capacity), channel_count_(channel_count)
+{
+}
+
+size_t AudioRingBuffer::GetReadableFrames() const
+{
+	return static_cast<size_t>(write_.load(memory_order_acquire) - read_.load(memory_order_acquire));
+}
+
+size_t AudioRingBuffer::GetWritableFrames() const
+{
+	return capacity_ - GetReadableFrames();
+}
+
+size_t AudioRingBuffer::PeekRead(const int16_t** frames) const
+{
+	const uint64_t read = read_.load(memory_order_relaxed);
+	const size_t offset = static_cast<size_t>(read % capacity_);
+
+	*frames = samples_.data() + offset * channel_count_;
+	return (std::min)(GetReadableFrames(), capacity_ - offset);
+}
+
+void AudioRingBuffer::Consume(size_t frame_count)
+{
+	read_.fetch_add(frame_count, memory_order_release);
+}
+
+size_t AudioRingBuffer::PeekWrite(int16_t** frames)
+{
+	const uint64_t write = write_.load(memory_order_relaxed);
+	const size_t offset = static_cast<size_t>(write % capacity_);
+
+	*frames = samples_.data() + offset * channel_count_;
+	return (std::min)(GetWritableFrames(), capacity_ - offset);
+}
+
+void AudioRingBuffer::Commit(size_t frame_count)
+{
+	write_.fetch_add(frame_count, memory_order_release);
+}
@@ -0,0 +1,109 @@
+#include "audio/AudioStream.hh"
+
+#include "audio/AudioClip.hh"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+
+namespace
+{
+	// Well within the play time of a chunk, in case a notification is missed.
+	constexpr chrono::milliseconds kPollInterval(20);
+}
+
+AudioStream::AudioStream(shared_ptr<const AudioClip> clip, bool loop)
+	: clip_(move(clip)), loop_(loop), buffer_(kChunkFrames * 2, clip_->GetChannelCount())
+{
+	if (clip_->GetFrameCount() == 0) end_of_clip_ = true;
+}
+
+bool AudioStream::Fill()
+{
+	if (closed_ || end_of_clip_ || buffer_.GetWritableFrames() < kChunkFrames) return false;
+
+	const size_t frame_count = clip_->GetFrameCount();
+	size_t remaining = kChunkFrames;
+	while (remaining > 0)
+	{
+		int16_t* frames;
+		const size_t count = (std::min)({ buffer_.PeekWrite(&frames), remaining, frame_count - read_frame_ });
+
+		clip_->ReadFrames(read_frame_, count, frames);
+		buffer_.Commit(count);
+		read_frame_ += count;
+		remaining -= count;
+
+		if (read_frame_ == frame_count)
+		{
+			if (!loop_)
+			{
+				end_of_clip_.store(true, memory_order_release);
+				break;
+			}
+			read_frame_ = 0;
+		}
+	}
+
+	return true;
+}
+
+AudioStreamThread::AudioStreamThread()
+{
+	thread_ = thread(&AudioStreamThread::ThreadMain, this);
+}
+
+AudioStreamThread::~AudioStreamThread()
+{
+	{
+		lock_guard<mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	condition_.notify_one();
+	thread_.join();
+}
+
+void AudioStreamThread::Add(shared_ptr<AudioStream> stream)
+{
+	{
+		lock_guard<mutex> lock(mutex_);
+		streams_.push_back(move(stream));
+		notified_ = true;
+	}
+	condition_.notify_one();
+}
+
+void AudioStreamThread::Notify()
+{
+	{
+		lock_guard<mutex> lock(mutex_);
+		notified_ = true;
+	}
+	condition_.notify_one();
+}
+
+void AudioStreamThread::ThreadMain()
+{
+	vector<shared_ptr<AudioStream> > streams;
+
+	unique_lock<mutex> lock(mutex_);
+	while (!stopping_)
+	{
+		streams_.erase(remove_if(streams_.begin(), streams_.end(),
+			[](const shared_ptr<AudioStream>& stream) { return stream->IsClosed(); }), streams_.end());
+		streams = streams_;
+		notified_ = false;
+
+		// Files are read without the lock, so the mixer is never held up by the disk.
+		lock.unlock();
+		for (auto& stream : streams)
+		{
+			while (stream->Fill()) {}
+		}
+		streams.clear();
+		lock.lock();
+
+		condition_.wait_for(lock, kPollInterval, [this]() { return stopping_ || notified_; });
+	}
+}
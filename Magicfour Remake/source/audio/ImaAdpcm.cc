@@ -0,0 +1,162 @@
+#include "audio/ImaAdpcm.hh"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace
+{
+	constexpr int kStepTable[89] =
+	{
+		7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+		50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+		337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+		2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+		15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+	};
+
+	constexpr int kIndexTable[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+	// Each channel header is the first sample as int16, the step index and a reserved byte.
+	constexpr size_t kHeaderBytes = 4;
+
+	// After the headers, channels take turns with 4 bytes of 8 samples each.
+	constexpr size_t kGroupBytes = 4;
+	constexpr size_t kGroupFrames = 8;
+
+	struct ChannelState
+	{
+		int predictor = 0;
+		int index = 0;
+	};
+
+	// Apply a code to the state, the same way on both sides.
+	inline void Step(ChannelState& state, int code)
+	{
+		const int step = kStepTable[state.index];
+		int diff = step >> 3;
+		if (code & 4) diff += step;
+		if (code & 2) diff += step >> 1;
+		if (code & 1) diff += step >> 2;
+
+		state.predictor = (std::min)((std::max)(state.predictor + ((code & 8) ? -diff : diff), -32768), 32767);
+		state.index = (std::min)((std::max)(state.index + kIndexTable[code & 7], 0), 88);
+	}
+
+	inline int EncodeSample(ChannelState& state, int sample)
+	{
+		int delta = sample - state.predictor;
+		int code = 0;
+		if (delta < 0)
+		{
+			code = 8;
+			delta = -delta;
+		}
+
+		// Greedy bits of delta / step, with the same rounding as Step.
+		int step = kStepTable[state.index];
+		for (int bit = 4; bit > 0; bit >>= 1)
+		{
+			if (delta >= step)
+			{
+				code |= bit;
+				delta -= step;
+			}
+			step >>= 1;
+		}
+
+		Step(state, code);
+		return code;
+	}
+}
+
+size_t ImaAdpcm::GetFramesPerBlock(size_t block_bytes, uint32_t channel_count)
+{
+	if (channel_count == 0 || block_bytes % (kGroupBytes * channel_count) != 0) return 0;
+
+	const size_t bytes_per_channel = block_bytes / channel_count;
+	if (bytes_per_channel <= kHeaderBytes) return 0;
+
+	return (bytes_per_channel - kHeaderBytes) * 2 + 1;
+}
+
+vector<uint8_t> ImaAdpcm::Encode(const int16_t* samples, size_t frame_count, uint32_t channel_count)
+{
+	const size_t block_bytes = kBlockBytesPerChannel * channel_count;
+	const size_t frames_per_block = GetFramesPerBlock(block_bytes, channel_count);
+	const size_t block_count = (frame_count + frames_per_block - 1) / frames_per_block;
+
+	vector<uint8_t> blocks(block_count * block_bytes, 0);
+	vector<ChannelState> states(channel_count);
+
+	for (size_t b = 0; b < block_count; b++)
+	{
+		const size_t first = b * frames_per_block;
+		uint8_t* block = blocks.data() + b * block_bytes;
+		auto sample_at = [&](size_t frame, uint32_t channel) -> int
+		{
+			return (first + frame < frame_count) ? samples[(first + frame) * channel_count + channel] : 0;
+		};
+
+		// The first frame is stored as it is. The step index carries over from the last block.
+		for (uint32_t c = 0; c < channel_count; c++)
+		{
+			states[c].predictor = sample_at(0, c);
+			const int16_t predictor = static_cast<int16_t>(states[c].predictor);
+			memcpy(block + c * kHeaderBytes, &predictor, sizeof(predictor));
+			block[c * kHeaderBytes + 2] = static_cast<uint8_t>(states[c].index);
+		}
+
+		uint8_t* data = block + channel_count * kHeaderBytes;
+		for (size_t group = 0; group * kGroupFrames + 1 < frames_per_block; group++)
+		{
+			for (uint32_t c = 0; c < channel_count; c++)
+			{
+				for (size_t i = 0; i < kGroupFrames; i += 2)
+				{
+					const size_t frame = 1 + group * kGroupFrames + i;
+					const int low = EncodeSample(states[c], sample_at(frame, c));
+					const int high = EncodeSample(states[c], sample_at(frame + 1, c));
+					*data++ = static_cast<uint8_t>(low | (high << 4));
+				}
+			}
+		}
+	}
+
+	return blocks;
+}
+
+void ImaAdpcm::DecodeBlock(const uint8_t* block, size_t block_bytes, uint32_t channel_count, int16_t* frames)
+{
+	const size_t frames_per_block = GetFramesPerBlock(block_bytes, channel_count);
+
+	ChannelState states[2];
+	for (uint32_t c = 0; c < channel_count; c++)
+	{
+		int16_t predictor;
+		memcpy(&predictor, block + c * kHeaderBytes, sizeof(predictor));
+		states[c].predictor = predictor;
+		states[c].index = (std::min)(int(block[c * kHeaderBytes + 2]), 88);
+		frames[c] = predictor;
+	}
+
+	const uint8_t* data = block + channel_count * kHeaderBytes;
+	for (size_t group = 0; group * kGroupFrames + 1 < frames_per_block; group++)
+	{
+		for (uint32_t c = 0; c < channel_count; c++)
+		{
+			int16_t* out = frames + (1 + group * kGroupFrames) * channel_count + c;
+			for (size_t i = 0; i < kGroupBytes; i++)
+			{
+				Step(states[c], *data & 0x0F);
+				*out = static_cast<int16_t>(states[c].predictor);
+				out += channel_count;
+
+				Step(states[c], *data++ >> 4);
+				*out = static_cast<int16_t>(states[c].predictor);
+				out += channel_count;
+			}
+		}
+	}
+}
@@ -1,8 +1,10 @@
 #include "core/AnimatedObjectClass.hh"
 
-#include <fstream>
+#include <algorithm>
+#include <cmath>
 
 #include "core/GameException.hh"
+#include "util/FileSystem.hh"
 
 #define WIDE2(x) L##x
 #define WIDE(x) WIDE2(x)
@@ -13,7 +15,7 @@ using namespace DirectX;
 
 AnimatedObjectClass::AnimationNode*
 	AnimatedObjectClass::create_hierarchy(
-		AnimationNode* curr_node, ifstream& fin)
+		AnimationNode* curr_node, istream& fin)
 {
 	string buffer;
 	fin >> buffer; // {
@@ -102,37 +104,113 @@ AnimatedObjectClass::~AnimatedObjectClass()
 	delete[] frame_info;
 }
 
-void AnimatedObjectClass::UpdateGlobalMatrices(const int frame, XMMATRIX transform_of_root, vector<XMMATRIX>& result)
+void AnimatedObjectClass::BuildFramePoses()
 {
-	float* frame_info_it = frame_info + (frame % frames_num) * channels_num;
+	constexpr float kDegreeToRadian = 0.0174532925f;
 
-	root.global_transform = transform_of_root;
+	frame_poses.resize(static_cast<size_t>(frames_num) * nodes.size());
+
+	const float* frame_info_it = frame_info;
+	JointPose* pose_it = frame_poses.data();
 
-	for (auto& node : nodes)
+	for (int frame = 0; frame < frames_num; frame++)
 	{
-		XMMATRIX joint_transform = XMMatrixIdentity();
-		for (int i = 0; i < node->channel_num; i++)
+		for (auto& node : nodes)
 		{
-			switch (node->channels[i])
+			// Channels are applied in the reversed order of declaration
+			// (joint = channel[n-1] * ... * channel[0] in row-vector convention),
+			// so each channel is prepended to the accumulated rotation/translation.
+			XMVECTOR rotation = XMQuaternionIdentity();
+			XMVECTOR translation = XMVectorZero();
+
+			for (int i = 0; i < node->channel_num; i++)
 			{
-			case ANIMATION_CHANNEL_XPOS:
-				joint_transform = XMMatrixTranslation(*frame_info_it++, 0, 0) * joint_transform; break;
-			case ANIMATION_CHANNEL_YPOS:
-				joint_transform = XMMatrixTranslation(0, *frame_info_it++, 0) * joint_transform; break;
-			case ANIMATION_CHANNEL_ZPOS:
-				joint_transform = XMMatrixTranslation(0, 0, *frame_info_it++ ) * joint_transform; break;
-				break;
-			case ANIMATION_CHANNEL_XROT:
-				joint_transform = XMMatrixRotationX(*frame_info_it++ * 0.0174532925f) * joint_transform; break;
-			case ANIMATION_CHANNEL_YROT:
-				joint_transform = XMMatrixRotationY(*frame_info_it++ * 0.0174532925f) * joint_transform; break;
-			case ANIMATION_CHANNEL_ZROT:
-				joint_transform = XMMatrixRotationZ(*frame_info_it++ * 0.0174532925f) * joint_transform; break;
-				break;
-				
+				const float value = *frame_info_it++;
+				switch (node->channels[i])
+				{
+				case ANIMATION_CHANNEL_XPOS:
+					translation += XMVector3Rotate(XMVectorSet(value, 0, 0, 0), rotation); break;
+				case ANIMATION_CHANNEL_YPOS:
+					translation += XMVector3Rotate(XMVectorSet(0, value, 0, 0), rotation); break;
+				case ANIMATION_CHANNEL_ZPOS:
+					translation += XMVector3Rotate(XMVectorSet(0, 0, value, 0), rotation); break;
+				case ANIMATION_CHANNEL_XROT:
+					rotation = XMQuaternionMultiply(
+						XMQuaternionRotationAxis(g_XMIdentityR0, value * kDegreeToRadian), rotation); break;
+				case ANIMATION_CHANNEL_YROT:
+					rotation = XMQuaternionMultiply(
+						XMQuaternionRotationAxis(g_XMIdentityR1, value * kDegreeToRadian), rotation); break;
+				case ANIMATION_CHANNEL_ZROT:
+					rotation = XMQuaternionMultiply(
+						XMQuaternionRotationAxis(g_XMIdentityR2, value * kDegreeToRadian), rotation); break;
+				}
 			}
+
+			// Append the link offset of this joint.
+			translation += XMVectorSet(node->offset_x, node->offset_y, node->offset_z, 0);
+
+			XMStoreFloat4(&pose_it->rotation, rotation);
+			XMStoreFloat3(&pose_it->translation, translation);
+			pose_it++;
 		}
-		node->global_transform = joint_transform * node->link_matrix * node->parent->global_transform;
+	}
+}
+
+void AnimatedObjectClass::SamplePose(float frame, vector<JointPose>& pose) const
+{
+	const size_t joint_num = nodes.size();
+	pose.resize(joint_num);
+
+	frame = fmodf(max(frame, 0.0f), static_cast<float>(frames_num));
+
+	const int frame0 = min(static_cast<int>(frame), frames_num - 1);
+	const int frame1 = (frame0 + 1) % frames_num;
+	const float t = frame - frame0;
+
+	const JointPose* pose0 = frame_poses.data() + frame0 * joint_num;
+	const JointPose* pose1 = frame_poses.data() + frame1 * joint_num;
+
+	for (size_t j = 0; j < joint_num; j++)
+	{
+		const XMVECTOR rotation = XMQuaternionSlerp(
+			XMLoadFloat4(&pose0[j].rotation), XMLoadFloat4(&pose1[j].rotation), t);
+		const XMVECTOR translation = XMVectorLerp(
+			XMLoadFloat3(&pose0[j].translation), XMLoadFloat3(&pose1[j].translation), t);
+
+		XMStoreFloat4(&pose[j].rotation, rotation);
+		XMStoreFloat3(&pose[j].translation, translation);
+	}
+}
+
+void AnimatedObjectClass::BlendPose(vector<JointPose>& pose,
+	const vector<JointPose>& target, float weight)
+{
+	const size_t joint_num = min(pose.size(), target.size());
+	for (size_t j = 0; j < joint_num; j++)
+	{
+		const XMVECTOR rotation = XMQuaternionSlerp(
+			XMLoadFloat4(&pose[j].rotation), XMLoadFloat4(&target[j].rotation), weight);
+		const XMVECTOR translation = XMVectorLerp(
+			XMLoadFloat3(&pose[j].translation), XMLoadFloat3(&target[j].translation), weight);
+
+		XMStoreFloat4(&pose[j].rotation, rotation);
+		XMStoreFloat3(&pose[j].translation, translation);
+	}
+}
+
+void AnimatedObjectClass::UpdateGlobalMatrices(const vector<JointPose>& pose,
+	XMMATRIX transform_of_root, vector<XMMATRIX>& result)
+{
+	root.global_transform = transform_of_root;
+
+	for (size_t j = 0; j < nodes.size(); j++)
+	{
+		auto& node = nodes[j];
+
+		XMMATRIX local_transform = XMMatrixRotationQuaternion(XMLoadFloat4(&pose[j].rotation));
+		local_transform.r[3] = XMVectorSetW(XMLoadFloat3(&pose[j].translation), 1.0f);
+
+		node->global_transform = local_transform * node->parent->global_transform;
 		if (!node->children.empty())
 		{
 			result.push_back(node->shape_transform * node->global_transform);
@@ -140,11 +218,17 @@ void AnimatedObjectClass::UpdateGlobalMatrices(const int frame, XMMATRIX transfo
 	}
 }
 
+void AnimatedObjectClass::UpdateGlobalMatrices(float frame, XMMATRIX transform_of_root, vector<XMMATRIX>& result)
+{
+	vector<JointPose> pose;
+	SamplePose(frame, pose);
+	UpdateGlobalMatrices(pose, transform_of_root, result);
+}
+
 AnimatedObjectClass::AnimatedObjectClass(const char* filename)
 	: channels_num(0), frame_info(nullptr), root("", nullptr)
 {
-	ifstream fin(filename);
-	if (fin.fail()) throw filenotfound_error(filename, WFILE, __LINE__);
+	FileStream fin(FileSystem::Open(filename));
 
 	string buffer;
 	fin >> buffer; // HIERARCHY
@@ -169,4 +253,21 @@ AnimatedObjectClass::AnimatedObjectClass(const char* filename)
 	for (int i = 0; i < info_sz; i++) fin >> frame_info[i];
 
 	fin.close();
+
+	BuildFramePoses();
+
+	// Sampling reads frame_poses only.
+	delete[] frame_info;
+	frame_info = nullptr;
+}
+
+MemoryUsage AnimatedObjectClass::GetMemoryUsage() const
+{
+	MemoryUsage usage;
+	usage.cpu_bytes = sizeof(*this) + frame_poses.capacity() * sizeof(JointPose);
+	for (const AnimationNode* node : nodes)
+	{
+		usage.cpu_bytes += sizeof(AnimationNode) + node->channel_num * sizeof(channel_t);
+	}
+	return usage;
 }
\ No newline at end of file
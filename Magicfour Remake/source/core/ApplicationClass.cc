@@ -1,10 +1,15 @@
 #include "core/ApplicationClass.hh"
 
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <unordered_set>
 
 #include "core/D3DClass.hh"
 #include "core/D2DClass.hh"
 #include "graphics/ModelClass.hh"
+#include "graphics/D3D11RenderDevice.hh"
 #include "core/InputClass.hh"
 #include "shader/LightShaderClass.hh"
 #include "shader/NormalMapShaderClass.hh"
@@ -28,17 +33,39 @@
 #include "core/GameException.hh"
 #include "core/SoundClass.hh"
 #include "util/CollisionProcessor.hh"
+#include "util/ResourceStreamer.hh"
 #include "map/FieldClass.hh"
+#include "core/TransformCache.hh"
 
 #include "ui/UserInterfaceClass.hh"
 #include "ui/MonsterUI.hh"
 
+#include "../third-party/DirectXTex.h"
+
 //#define DEBUG_RANGE
 
 using namespace std;
 using namespace DirectX;
 
+constexpr ResourceId kBackgroundSound("background");
+constexpr ResourceId kCharacterDamageSound("character_damage");
+constexpr ResourceId kCharacterDeathSound("character_death");
+constexpr ResourceId kGameoverSound("gameover");
+constexpr ResourceId kHeartbeatSound("heartbeat");
+constexpr ResourceId kPlaneModel("plane");
+constexpr ResourceId kSkillLearnSound("skill_learn");
+
 constexpr float kCameraZPosition = -20.0f;
+constexpr const char* kResourceManifest = "data/resources.xml";
+constexpr const char* kPlaceholderTexture = "data/texture/black.png";
+constexpr const char* kPlaceholderModel = "data/model/abox.obj";
+constexpr const char* kMemoryReport = "memory_report.log";
+constexpr auto kStreamingBudget = std::chrono::microseconds(2000);
+
+// Resident bytes of streamed resources, 0 for no budget.
+// Over budget, least recently used resources are evicted and loaded again when used.
+constexpr size_t kModelMemoryBudget = 0;
+constexpr size_t kTextureMemoryBudget = 0;
 constexpr int	kCameraXLimit = 1'500'000;
 constexpr int	kItemDropProbability = 50;
 constexpr XMFLOAT4 kSkillColor[5] =
@@ -55,19 +82,59 @@ ApplicationClass::ApplicationClass(int screenWidth, int screenHeight, HWND hwnd,
 	direct3D_ = make_unique<D3DClass>(screenWidth, screenHeight,
 		VSYNC_ENABLED, hwnd, FULL_SCREEN, SCREEN_DEPTH, SCREEN_NEAR);
 	direct2D_ = make_unique<D2DClass>(direct3D_->GetSwapChain(), hwnd);
-	sound_ = make_unique<SoundClass>();
+	render_device_ = make_unique<D3D11RenderDevice>(direct3D_->GetDevice(), direct3D_->GetDeviceContext(), hwnd);
+	// resources.xml is parsed once here, or its compiled manifest loaded, for every loader.
+	manifest_ = make_unique<ResourceManifest>(kResourceManifest);
+
+	sound_ = make_unique<SoundClass>(*manifest_);
 
 	camera_ = make_unique<CameraClass>();
 	camera_->SetPosition(0.0f, 0.0f, kCameraZPosition);
 
 
-	auto texture_loader = [this](xml_node_wrapper node) -> std::shared_ptr<TextureClass>
+	// Placeholders are drawn until the resources are streamed in.
+	auto placeholder_texture = make_shared<TextureClass>(direct3D_->GetDevice(), std::string(kPlaceholderTexture));
+	auto placeholder_model = make_shared<ModelClass>(render_device_.get(), std::string(kPlaceholderModel), placeholder_texture);
+
+	texture_streamer_ = make_unique<ResourceStreamer<TextureClass> >(textures_, placeholder_texture);
+	model_streamer_ = make_unique<ResourceStreamer<ModelClass> >(models_, placeholder_model);
+	memory_report_written_ = false;
+
+	texture_streamer_->SetBudget(kTextureMemoryBudget, [](const TextureClass& texture) {
+		return texture.GetMemoryUsage().gpu_bytes;
+	});
+	model_streamer_->SetBudget(kModelMemoryBudget, [](const ModelClass& model) {
+		const MemoryUsage usage = model.GetMemoryUsage();
+		return usage.cpu_bytes + usage.gpu_bytes;
+	});
+
+	// Image decoding and model parsing run on the worker pool.
+	// Only the device objects are created on this thread, in Frame.
+	texture_streamer_->RequestFromManifest(*manifest_, "Texture",
+		[this](resource_node node)
 		{
-			return make_shared<TextureClass>(this->direct3D_->GetDevice(),
-				node.get_required_attr("src"));
-		};
+			const std::string src_path = node.get_required_attr("src");
+			const std::wstring src(src_path.begin(), src_path.end());
 
-	auto model_loader = [this](xml_node_wrapper node) -> std::shared_ptr<ModelClass>
+			ResourceStreamer<TextureClass>::Job job;
+			job.prepare = [this, src]() -> ResourceStreamer<TextureClass>::Creator
+				{
+					auto image = TextureClass::LoadImageFile(src);
+					const uint64_t content_hash = TextureClass::HashImage(*image);
+					return [this, src, image, content_hash]() -> shared_ptr<TextureClass> {
+						// An identical image loaded from another path is shared.
+						if (auto texture = textures_.find_by_content(content_hash, image->GetPixelsSize())) return texture;
+
+						auto texture = make_shared<TextureClass>(this->direct3D_->GetDevice(), *image, src);
+						textures_.insert_by_content(content_hash, texture);
+						return texture;
+					};
+				};
+			return job;
+		});
+
+	model_streamer_->RequestFromManifest(*manifest_, "Model",
+		[this](resource_node node)
 		{
 			std::unordered_map<std::string, std::string> textures;
 			
@@ -78,41 +145,53 @@ ApplicationClass::ApplicationClass(int screenWidth, int screenHeight, HWND hwnd,
 				textures[type] = src;
 			}
 
-			std::shared_ptr<TextureClass> diffuse_texture = nullptr;
-			std::shared_ptr<TextureClass> normal_texture = nullptr;
-			std::shared_ptr<TextureClass> emissive_texture = nullptr;
-
-			if (textures.find("diffuse") != textures.end())
-				diffuse_texture = textures_.get_by_path(textures["diffuse"]);
-			else
+			if (textures.find("diffuse") == textures.end())
 				throw GAME_EXCEPTION(L"Diffuse texture is required for model: " + std::wstring(node.get_required_attr("name").begin(), node.get_required_attr("name").end()));
 
-			if (textures.find("normal") != textures.end())
-				normal_texture = textures_.get_by_path(textures["normal"]);
+			const std::string model_path = node.get_required_attr("model_path");
 
-			if (textures.find("emissive") != textures.end())
-				emissive_texture = textures_.get_by_path(textures["emissive"]);
-			
-			return make_shared<ModelClass>(this->direct3D_->GetDevice(),
-				node.get_required_attr("model_path").c_str(),
-				diffuse_texture,
-				normal_texture,
-				emissive_texture
-			);
-		};
-
-
-
-	textures_.loadFromXML("data/resources.xml", "Texture", texture_loader);
-	models_.loadFromXML("data/resources.xml", "Model", model_loader);
+			ResourceStreamer<ModelClass>::Job job;
+			job.prepare = [this, model_path, textures]() -> ResourceStreamer<ModelClass>::Creator
+				{
+					auto model = make_shared<ModelClass>(model_path, nullptr);
+					return [this, model, textures]() -> shared_ptr<ModelClass> {
+						auto find_texture = [this, &textures](const char* type) -> std::shared_ptr<TextureClass> {
+							auto texture = textures.find(type);
+							return (texture != textures.end()) ? textures_.get_by_path(texture->second) : nullptr;
+						};
+
+						// The same geometry with other textures, e.g. PlaneObject.obj, shares the buffers
+						// of the model loaded first. The geometry loaded here is dropped without an upload.
+						if (auto geometry = models_.find_by_content(model->GetContentHash(), model->GetGeometrySize()))
+						{
+							return make_shared<ModelClass>(shared_ptr<const ModelClass>(geometry),
+								find_texture("diffuse"), find_texture("normal"), find_texture("emissive"));
+						}
+
+						model->SetTextures(find_texture("diffuse"), find_texture("normal"), find_texture("emissive"));
+						model->CreateBuffers(this->render_device_.get());
+						models_.insert_by_content(model->GetContentHash(), model);
+						return model;
+					};
+				};
+
+			// Textures are bound when the model is created, so wait until they are all loaded.
+			// Evicted ones are loaded again.
+			job.can_create = [this, textures]()
+				{
+					bool is_ready = true;
+					for (const auto& texture : textures)
+					{
+						if (!texture_streamer_->Require(texture.second)) is_ready = false;
+					}
+					return is_ready;
+				};
+			return job;
+		});
 
 
 	// Create and initialize the light shader object.
-	shader_manager_ = make_unique<ShaderManager>(
-		direct3D_->GetDevice(),
-		direct3D_->GetDeviceContext(),
-		hwnd
-	);
+	shader_manager_ = make_unique<ShaderManager>(render_device_.get());
 	
 	// Create and initialize the light object.
 	light_ = make_unique<LightClass>();
@@ -153,9 +232,9 @@ ApplicationClass::ApplicationClass(int screenWidth, int screenHeight, HWND hwnd,
 	items_.Insert(new ItemClass(timer_->GetTime(), -1231230, 242320, 2));
 
 	user_interface_ = make_unique<UserInterfaceClass>(direct2D_.get(),
-		direct3D_->GetDevice(), screenWidth, screenHeight);
+		direct3D_->GetDevice(), *manifest_, screenWidth, screenHeight);
 
-	sound_->PlayBackground("background");
+	sound_->PlayBackground(kBackgroundSound);
 	
 	game_state_ = GameState::kGameRun;
 	state_start_time_ = timer_->GetTime();
@@ -185,6 +264,23 @@ bool ApplicationClass::Frame(InputClass* input)
 
 	timer_->Frame();
 
+	// Create the resources loaded in background, within the budget of this frame.
+	texture_streamer_->Update(kStreamingBudget / 2);
+	model_streamer_->Update(kStreamingBudget / 2);
+
+	sound_->Update();
+
+	// Report on demand. Debug builds also report once everything is streamed in.
+#ifdef _DEBUG
+	const bool streaming_done = texture_streamer_->GetPendingCount() == 0 && model_streamer_->GetPendingCount() == 0;
+	if (streaming_done && !memory_report_written_)
+	{
+		WriteMemoryReport(kMemoryReport);
+		memory_report_written_ = true;
+	}
+#endif
+	if (input->IsKeyDown(DIK_M)) WriteMemoryReport(kMemoryReport);
+
 	const time_t curr_time = timer_->GetTime();
 	switch (game_state_)
 	{
@@ -218,7 +314,7 @@ void ApplicationClass::GameFrame(InputClass* input)
 	{
 		if (curr_time - delta_time < state_start_time_ + 1000 && state_start_time_ + 1000 <= curr_time)
 		{
-			sound_->PlayEffect("gameover");
+			sound_->PlayEffect(kGameoverSound);
 		}
 	}
 	else monster_spawner_->Frame(curr_time, delta_time, monsters_.elements);
@@ -267,15 +363,15 @@ void ApplicationClass::GameFrame(InputClass* input)
 			{
 				game_state_ = GameState::kGameOver;
 				state_start_time_ = curr_time;
-				sound_->PlayEffect("character_death");
+				sound_->PlayEffect(kCharacterDeathSound);
 				timer_->SetGameSpeed(250);
 			}
 			else
 			{
-				sound_->PlayEffect("character_damage");
+				sound_->PlayEffect(kCharacterDamageSound);
 				if (character_->GetSkill(0).skill_type == 0)
 				{
-					sound_->PlayEffect("heartbeat");
+					sound_->PlayEffect(kHeartbeatSound);
 				}
 			}
 		});
@@ -287,7 +383,7 @@ void ApplicationClass::GameFrame(InputClass* input)
 			character->LearnSkill(item->GetType(), curr_time);
 			item->SetState(ItemState::kDie, curr_time);
 
-			sound_->PlayEffect("skill_learn");
+			sound_->PlayEffect(kSkillLearnSound);
 		});
 
 
@@ -309,6 +405,9 @@ void ApplicationClass::GameFrame(InputClass* input)
 
 void ApplicationClass::Render()
 {
+	// Count the matrices reused by the objects in this frame.
+	TransformCache::BeginFrame();
+
 	const float camera_x = SATURATE(-kCameraXLimit, character_->GetPosition().x, kCameraXLimit) * kScope;
 	const float camera_y = max(0, character_->GetPosition().y + 200'000) * kScope;
 	camera_->SetPosition(camera_x, camera_y, kCameraZPosition);
@@ -340,34 +439,37 @@ void ApplicationClass::Render()
 #ifdef DEBUG_RANGE
 
 	shader_manager_->light_shader_->PushRenderQueue(
-		models_.get("plane"), character_->GetRangeRepresentMatrix());
+		models_.get(kPlaneModel), character_->GetRangeRepresentMatrix());
 
 	for (auto& obj : skillObjectList_.elements)
 	{
 		auto skill_obj = static_cast<SkillObjectClass*>(obj.get());
 		shader_manager_->light_shader_->PushRenderQueue(
-			models_.get("plane"), skill_obj->GetRangeRepresentMatrix());
+			models_.get(kPlaneModel), skill_obj->GetRangeRepresentMatrix());
 	}
 
 	for (auto& obj : monsters_.elements)
 	{
 		auto skill_obj = static_cast<MonsterClass*>(obj.get());
 		shader_manager_->light_shader_->PushRenderQueue(
-			models_.get("plane"), skill_obj->GetRangeRepresentMatrix());
+			models_.get(kPlaneModel), skill_obj->GetRangeRepresentMatrix());
 	}
 
 #endif
 	// Clear the buffers to begin the scene.
 	direct3D_->BeginScene(0.0f, 0.0f, 0.5f, 1.0f);
+	render_device_->BeginFrame();
+	shader_manager_->SetFrameConstants(vp_matrix, light_->GetDirection(), light_->GetDiffuseColor(),
+		camera_->GetPosition(), curr_time * 0.0004f);
 
 	direct3D_->SetDepthStencilState(D3DClass::DepthStencilMode::Default3D); 
-	shader_manager_->light_shader_	  ->ProcessRenderQueue(direct3D_->GetDeviceContext(), vp_matrix, light_->GetDirection(), light_->GetDiffuseColor());
-	shader_manager_->normalMap_shader_->ProcessRenderQueue(direct3D_->GetDeviceContext(), vp_matrix, light_->GetDirection(), light_->GetDiffuseColor(), camera_->GetPosition());
-	shader_manager_->stone_shader_	  ->ProcessRenderQueue(direct3D_->GetDeviceContext(), vp_matrix, light_->GetDirection(), camera_->GetPosition());
+	shader_manager_->light_shader_	  ->ProcessRenderQueue(vp_matrix);
+	shader_manager_->normalMap_shader_->ProcessRenderQueue(vp_matrix);
+	shader_manager_->stone_shader_	  ->ProcessRenderQueue(vp_matrix);
 	
 	direct3D_->SetDepthStencilState(D3DClass::DepthStencilMode::Transparent3D);
 	direct3D_->EnableAlphaBlending(); // Turn on alpha blending for the fire transparency.
-	shader_manager_->fire_shader_	  ->ProcessRenderQueue(direct3D_->GetDeviceContext(), vp_matrix, curr_time * 0.0004f);
+	shader_manager_->fire_shader_	  ->ProcessRenderQueue(vp_matrix);
 	direct3D_->DisableAlphaBlending();
 
 	direct3D_->SetDepthStencilState(D3DClass::DepthStencilMode::Disabled2D);
@@ -385,3 +487,51 @@ void ApplicationClass::Render()
 	// Present the rendered scene to the screen.
 	direct3D_->EndScene();
 }
+
+void ApplicationClass::WriteMemoryReport(const char* filename) const
+{
+	MemoryReport report;
+
+	models_.addToReport(report, "Models", [](const ModelClass& model) { return model.GetMemoryUsage(); });
+
+	// Welding and vertex cache results by name, once per mesh, as models with other textures share them.
+	std::map<std::string, const ModelClass*> named_models;
+	for (const auto& model : models_.resources)
+	{
+		if (model.second) named_models.emplace(model.first, model.second.get());
+	}
+
+	std::unordered_set<uint32_t> reported_meshes;
+	for (const auto& model : named_models)
+	{
+		if (!reported_meshes.insert(model.second->GetSortId()).second) continue;
+
+		const ModelClass::MeshStats& stats = model.second->GetMeshStats();
+		char note[256];
+		snprintf(note, sizeof(note), "%s: %u -> %u vertices (%.1f%% welded), ACMR %.3f -> %.3f",
+			model.first.c_str(), stats.source_vertex_count, stats.vertex_count,
+			stats.GetVertexReduction() * 100.0f, stats.acmr_before, stats.acmr_after);
+		report.AddNote("Models", note);
+
+		if (stats.degenerate_triangle_count)
+		{
+			snprintf(note, sizeof(note), "%s: %u of %u triangles have degenerate tangent space",
+				model.first.c_str(), stats.degenerate_triangle_count, stats.source_vertex_count / 3);
+			report.AddNote("Models", note);
+		}
+	}
+
+	textures_.addToReport(report, "Textures", [](const TextureClass& texture) { return texture.GetMemoryUsage(); });
+
+	// Resources which failed to load are drawn with the placeholders.
+	for (const auto& name : model_streamer_->GetFailures()) report.AddNote("Models", "Failed to load " + name);
+	for (const auto& name : texture_streamer_->GetFailures()) report.AddNote("Textures", "Failed to load " + name);
+
+	sound_->AddToReport(report);
+	user_interface_->AddToReport(report);
+	character_->AddToReport(report);
+	shader_manager_->AddToReport(report);
+	TransformCache::AddToReport(report);
+
+	report.Write(filename);
+}
@@ -1,9 +1,16 @@
 #include "core/GameObjectList.hh"
 
 #include "core/IGameObject.hh"
+#include "graphics/RenderQueue.hh"
 #include "shader/ShaderManager.hh"
 #include "util/ResourceMap.hh"
 
+namespace
+{
+	// Fewer objects than this are not worth handing to another thread.
+	constexpr size_t kDrawGrain = 64;
+}
+
 GameObjectList::~GameObjectList()
 {
 };
@@ -42,8 +49,12 @@ void GameObjectList::Frame(time_t curr_time, time_t delta_time, std::function<vo
 void GameObjectList::Draw(time_t curr_time, time_t time_delta, class ShaderManager* shader_manager,
 	ResourceMap<class ModelClass>& models, ResourceMap<class TextureClass>& textures) const
 {
-	for (auto& element : elements)
-	{
-		element->Draw(curr_time, time_delta, shader_manager, models, textures);
-	}
+	// Objects push render commands only, so they are drawn in parallel chunks, each to its own lane.
+	RenderLane::ParallelFor(elements.size(), kDrawGrain, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				elements[i]->Draw(curr_time, time_delta, shader_manager, models, textures);
+			}
+		});
 }
\ No newline at end of file
@@ -1,13 +1,90 @@
 #include "core/SoundClass.hh"
 
+#include "audio/AudioBackend.hh"
+#include "audio/AudioClip.hh"
+#include "util/FileSystem.hh"
+#include "util/MemoryReport.hh"
+#include "util/Hash.hh"
 #include "../third-party/Audio.h"
 
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
 using namespace DirectX;
 using namespace std;
 
 #pragma comment(lib, "third-party/DirectXTK.lib")
 
-SoundClass::SoundClass()
+namespace
+{
+	// Mixer output goes to XAudio2 through one dynamic voice, fed a few short buffers ahead.
+	// Few and short, since the queue is the latency of every effect. It is topped up every
+	// kMixerInterval by the mixer thread, well within the ~35 ms queued.
+	class DeviceAudioBackend : public AudioBackend
+	{
+	public:
+		static constexpr size_t kBufferFrames = 512;
+		static constexpr size_t kQueuedBuffers = 3;
+
+		DeviceAudioBackend(AudioEngine* engine)
+			: instance_(engine, [](DynamicSoundEffectInstance*) {},
+				AudioMixer::kSampleRate, AudioMixer::kChannelCount, 16)
+		{
+			// One more buffer than queued, so the one being refilled is never the one playing.
+			for (auto& buffer : buffers_) buffer.resize(kBufferFrames * AudioMixer::kChannelCount * sizeof(int16_t));
+			instance_.Play();
+		}
+
+		size_t GetWritableFrames() override
+		{
+			const size_t pending = instance_.GetPendingBufferCount();
+			return (pending < kQueuedBuffers) ? (kQueuedBuffers - pending) * kBufferFrames : 0;
+		}
+
+		void Write(const int16_t* samples, size_t frame_count) override
+		{
+			while (frame_count > 0)
+			{
+				const size_t frames = (std::min)(frame_count, kBufferFrames);
+				const size_t bytes = frames * AudioMixer::kChannelCount * sizeof(int16_t);
+
+				auto& buffer = buffers_[next_buffer_];
+				next_buffer_ = (next_buffer_ + 1) % buffers_.size();
+
+				memcpy(buffer.data(), samples, bytes);
+				instance_.SubmitBuffer(buffer.data(), bytes);
+
+				samples += frames * AudioMixer::kChannelCount;
+				frame_count -= frames;
+			}
+		}
+
+	private:
+		DynamicSoundEffectInstance instance_;
+		array<vector<uint8_t>, kQueuedBuffers + 1> buffers_;
+		size_t next_buffer_ = 0;
+	};
+
+	const unordered_map<string, AudioClip::Storage> kStorageMap =
+	{
+		{ "pcm", AudioClip::Storage::kPcm },
+		{ "adpcm", AudioClip::Storage::kImaAdpcm },
+		{ "stream", AudioClip::Storage::kStream },
+	};
+
+	constexpr auto kMixerInterval = chrono::milliseconds(5);
+
+	struct LoadedClip
+	{
+		shared_ptr<AudioClip> clip;
+		uint64_t content_hash = 0;
+	};
+}
+
+SoundClass::SoundClass(const ResourceManifest& manifest)
 {
 	AUDIO_ENGINE_FLAGS eflags = AudioEngine_Default;
 #ifdef _DEBUG
@@ -15,30 +92,123 @@ SoundClass::SoundClass()
 #endif
 
 	aud_engine_ = std::make_unique<AudioEngine>(eflags);
+	mixer_ = std::make_unique<AudioMixer>(std::make_unique<DeviceAudioBackend>(aud_engine_.get()));
 
-	sounds_.loadFromXML("data/resources.xml", "Sound",
-		[this](xml_node_wrapper node) -> unique_ptr<SoundEffect>
+	// Files are read and decoded or compressed on the worker pool.
+	// Long sounds are streamed, and keep only their mapped file.
+	sounds_.loadFromManifest(manifest, "Sound",
+		[](resource_node node) -> LoadedClip
 		{
-			std::string src = node.get_required_attr("src");
-			return std::make_unique<SoundEffect>(this->aud_engine_.get(),
-				std::wstring(src.begin(), src.end()).c_str());
+			const string filename = node.get_required_attr("src");
+			const string storage_name = node.get_attr("storage", "pcm");
+
+			auto storage = kStorageMap.find(storage_name);
+			if (storage == kStorageMap.end()) throw fileformat_error(filename.c_str(), WFILE, __LINE__);
+
+			// The same file kept another way is another clip. A streamed clip keeps the file mapped.
+			auto file = make_shared<FileView>(FileSystem::Open(filename));
+
+			LoadedClip loaded;
+			loaded.content_hash = HashBytes(file->GetView(), HashString(storage_name));
+			loaded.clip = AudioClip::LoadWave(file->GetView(), filename, storage->second, file);
+			return loaded;
+		},
+		[this](resource_node node, LoadedClip& loaded) -> shared_ptr<AudioClip>
+		{
+			// An identical file under another path is shared.
+			if (auto clip = sounds_.find_by_content(loaded.content_hash, loaded.clip->GetMemoryUsage().cpu_bytes)) return clip;
+
+			sounds_.insert_by_content(loaded.content_hash, loaded.clip);
+			return loaded.clip;
 		});
+
+	// Settings are per name, even for names sharing a file.
+	for (const auto& node : manifest.GetNodes("Sound"))
+	{
+		AudioMixer::SoundSettings settings;
+		settings.priority = stoi(node.get_attr("voice_priority", "0"));
+		settings.max_instances = stoul(node.get_attr("max_instances", "4"));
+		settings.gain = stof(node.get_attr("gain", "1"));
+		settings.coalesce_ms = stof(node.get_attr("coalesce_ms", "15"));
+
+		mixer_->SetSoundSettings(ResourceId(node.get_required_attr("name")).value, settings);
+	}
+
+	mixer_thread_ = thread(&SoundClass::MixerThreadMain, this);
+}
+
+void SoundClass::PlayBackground(ResourceId background_music)
+{
+	auto clip = sounds_.get(background_music);
+
+	lock_guard<mutex> lock(mixer_mutex_);
+	mixer_->Stop(background_voice_);
+	background_voice_ = mixer_->Play(background_music.value, move(clip), true);
 }
 
-void SoundClass::PlayBackground(const std::string& background_music)
+void SoundClass::PlayEffect(ResourceId sound_name)
 {
-	background_loop_ = sounds_.get(background_music)->CreateInstance();
-	background_loop_->Play();
+	auto clip = sounds_.get(sound_name);
+
+	lock_guard<mutex> lock(mixer_mutex_);
+	mixer_->Play(sound_name.value, move(clip));
 }
 
-void SoundClass::PlayEffect(const std::string& sound_name)
+void SoundClass::Update()
 {
-	sounds_.get(sound_name)->Play();
+	aud_engine_->Update();
+}
+
+void SoundClass::MixerThreadMain()
+{
+	unique_lock<mutex> lock(mixer_mutex_);
+	while (!stopping_)
+	{
+		mixer_->Update();
+		mixer_condition_.wait_for(lock, kMixerInterval);
+	}
+}
+
+AudioMixer::Stats SoundClass::GetMixerStats() const
+{
+	lock_guard<mutex> lock(mixer_mutex_);
+	return mixer_->GetStats();
+}
+
+void SoundClass::AddToReport(MemoryReport& report) const
+{
+	sounds_.addToReport(report, "Sounds", [](const AudioClip& clip) { return clip.GetMemoryUsage(); });
+
+	MemoryUsage mixer_usage;
+	AudioMixer::Stats stats;
+	{
+		lock_guard<mutex> lock(mixer_mutex_);
+		mixer_usage = mixer_->GetMemoryUsage();
+		stats = mixer_->GetStats();
+	}
+	report.Add("Sounds", "(mixer voices and streams)", mixer_usage);
+
+	char note[128];
+	snprintf(note, sizeof(note), "mixer: %zu plays, %zu coalesced, %zu limited, %zu stolen, %zu rejected, peak %zu voices, %zu underruns",
+		stats.plays, stats.coalesced, stats.instance_limited, stats.stolen, stats.rejected, stats.peak_voices, stats.stream_underruns);
+	report.AddNote("Sounds", note);
 }
 
 
 SoundClass::~SoundClass()
 {
+	if (mixer_thread_.joinable())
+	{
+		{
+			lock_guard<mutex> lock(mixer_mutex_);
+			stopping_ = true;
+		}
+		mixer_condition_.notify_one();
+		mixer_thread_.join();
+	}
+
+	// The device voice goes before the engine it belongs to.
+	mixer_.reset();
 	if (aud_engine_)
 	{
 		aud_engine_->Suspend();
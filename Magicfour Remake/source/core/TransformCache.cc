@@ -0,0 +1,23 @@
+#include "core/TransformCache.hh"
+
+#include <cstdio>
+
+#include "util/MemoryReport.hh"
+
+std::atomic<size_t> TransformCache::reused_(0);
+std::atomic<size_t> TransformCache::rebuilt_(0);
+TransformCache::Stats TransformCache::last_frame_;
+
+void TransformCache::BeginFrame()
+{
+	last_frame_.reused = reused_.exchange(0, std::memory_order_relaxed);
+	last_frame_.rebuilt = rebuilt_.exchange(0, std::memory_order_relaxed);
+}
+
+void TransformCache::AddToReport(MemoryReport& report)
+{
+	char note[128];
+	snprintf(note, sizeof(note), "object transforms: %zu reused, %zu rebuilt in the last frame",
+		last_frame_.reused, last_frame_.rebuilt);
+	report.AddNote("Render", note);
+}
@@ -21,10 +21,18 @@
 using namespace DirectX;
 using namespace std;
 
+constexpr ResourceId kCubeModel("cube");
+constexpr ResourceId kDiamondModel("diamond");
+constexpr ResourceId kRainbowTexture("rainbow");
+constexpr ResourceId kSpell1Sound("spell1");
+constexpr ResourceId kSpell2Sound("spell2");
+constexpr ResourceId kSpell3Sound("spell3");
+
 constexpr int kSkillCooltime = 800;
 constexpr int kComboDuration = 5'000;
 constexpr int kInvincibleDuration = 5'000;
 constexpr int kWalkSpd = 700, kRunSpd = 1300;
+constexpr time_t kAnimationBlendDuration = 120;
 
 CharacterClass::CharacterClass(int pos_x, int pos_y,
 	class InputClass* input, class SoundClass* sound,
@@ -42,6 +50,10 @@ CharacterClass::CharacterClass(int pos_x, int pos_y,
 
 	SetState(CharacterState::kNormal, 0);
 
+	blend_from_state_ = CharacterState::kNormal;
+	blend_from_state_start_time_ = 0;
+	blend_start_time_ = -kAnimationBlendDuration;
+
 	skill_[0] = { 1, 1 };
 	skill_[1] = { 2, 1 };
 	skill_[2] = { 3, 1 };
@@ -58,6 +70,9 @@ CharacterClass::CharacterClass(int pos_x, int pos_y,
 
 void CharacterClass::FrameMove(time_t curr_time, time_t time_delta, const vector<class GroundClass>& ground)
 {
+	const CharacterState prev_state = state_;
+	const time_t prev_state_start_time = state_start_time_;
+
 	bool is_walk = false;
 
 	if (state_ != CharacterState::kHit && state_ != CharacterState::kSlip && state_ != CharacterState::kDie)
@@ -262,6 +277,8 @@ void CharacterClass::FrameMove(time_t curr_time, time_t time_delta, const vector
 			guardians_[1]->SetPosition(position_.x - offset_x, position_.y + 200000 - offset_y);
 		}
 	}
+
+	OnStateChanged(prev_state, prev_state_start_time, curr_time);
 }
 
 bool CharacterClass::Frame(time_t time_delta, time_t curr_time)
@@ -275,11 +292,12 @@ void CharacterClass::Draw(time_t curr_time, time_t time_delta, ShaderManager* sh
 	vector<XMMATRIX> char_model_matrices;
 	GetShapeMatrices(curr_time, char_model_matrices);
 
-	ID3D11ShaderResourceView* char_texture = models.get("cube")->GetDiffuseTexture();
-	if (curr_time <= GetTimeInvincibleEnd()) char_texture = textures.get("rainbow")->GetTexture();
+	const auto& cube_model = models.get(kCubeModel);
+	TextureView* char_texture = cube_model->GetDiffuseTexture();
+	if (curr_time <= GetTimeInvincibleEnd()) char_texture = textures.get(kRainbowTexture)->GetTexture();
 
 	for (auto& box : char_model_matrices) {
-		shader_manager->light_shader_->PushRenderQueue(models.get("cube"),
+		shader_manager->light_shader_->PushRenderQueue(cube_model,
 			box * GetLocalWorldMatrix(), char_texture);
 	}
 
@@ -323,7 +341,7 @@ void CharacterClass::Draw(time_t curr_time, time_t time_delta, ShaderManager* sh
 			skill_color.w += (1 - skill_color.w) * brightness * 0.6;
 		}
 
-		shader_manager->stone_shader_->PushRenderQueue(models.get("diamond"), 
+		shader_manager->stone_shader_->PushRenderQueue(models.get(kDiamondModel), 
 			XMMatrixScaling(scale, scale, scale) * skill_stone_pos * XMMatrixTranslation(0, -0.6f * i, 0),
 			skill_color);
 	}
@@ -338,62 +356,112 @@ void CharacterClass::Draw(time_t curr_time, time_t time_delta, ShaderManager* sh
 
 void CharacterClass::GetShapeMatrices(time_t curr_time, std::vector<XMMATRIX>& shape_matrices) const
 {
-	XMMATRIX root_transform = XMMatrixRotationY(DIR_WEIGHT(direction_, XM_PI * 0.65f));
-	//XMMATRIX root_transform = XMMatrixIdentity();
+	float frame, root_angle;
+	AnimatedObjectClass* animation = GetStateAnimation(state_, GetStateTime(curr_time), frame, root_angle);
 
-	float state_elapsed_seconds = (GetStateTime(curr_time)) / 1000.0f;
+	vector<AnimatedObjectClass::JointPose> pose;
+	animation->SamplePose(frame, pose);
 
-	switch (state_)
+	// Cross-fade from the animation of previous state.
+	const time_t blend_elapsed_time = curr_time - blend_start_time_;
+	if (blend_elapsed_time < kAnimationBlendDuration)
 	{
-	case CharacterState::kNormal:
-	case CharacterState::kStop:
-		run_animation_data_->UpdateGlobalMatrices(0, root_transform, shape_matrices);
-		break;
+		const float weight = blend_elapsed_time / (float)kAnimationBlendDuration;
+
+		float prev_frame, prev_root_angle;
+		AnimatedObjectClass* prev_animation = GetStateAnimation(blend_from_state_,
+			curr_time - blend_from_state_start_time_, prev_frame, prev_root_angle);
+
+		vector<AnimatedObjectClass::JointPose> prev_pose;
+		prev_animation->SamplePose(prev_frame, prev_pose);
+
+		// Into the pose of the current animation, which its matrices are updated with.
+		AnimatedObjectClass::BlendPose(pose, prev_pose, 1.0f - weight);
+
+		root_angle = prev_root_angle + (root_angle - prev_root_angle) * weight;
+	}
+
+	animation->UpdateGlobalMatrices(pose, XMMatrixRotationY(root_angle), shape_matrices);
+}
+
+void CharacterClass::AddToReport(MemoryReport& report) const
+{
+	const pair<const char*, const AnimatedObjectClass*> animations[] = {
+		{ "jump_motion", jump_animation_data_.get() },
+		{ "fall_motion", fall_animation_data_.get() },
+		{ "walk_motion", walk_animation_data_.get() },
+		{ "run_motion", run_animation_data_.get() },
+		{ "skill_motion", skill_animation_data_.get() },
+	};
+
+	for (const auto& animation : animations)
+	{
+		report.Add("Animations", animation.first, animation.second->GetMemoryUsage());
+	}
+}
+
+AnimatedObjectClass* CharacterClass::GetStateAnimation(CharacterState state,
+	time_t state_time, float& frame, float& root_angle) const
+{
+	const float state_elapsed_seconds = state_time / 1000.0f;
 
+	root_angle = DIR_WEIGHT(direction_, XM_PI * 0.65f);
+
+	switch (state)
+	{
 	case CharacterState::kWalk:
-		walk_animation_data_->UpdateGlobalMatrices(
-			state_elapsed_seconds / 0.00333333, root_transform, shape_matrices);
-		break;
+		frame = state_elapsed_seconds / 0.00333333f;
+		return walk_animation_data_.get();
 
 	case CharacterState::kRun:
-		run_animation_data_->UpdateGlobalMatrices(
-			state_elapsed_seconds / 0.00333333, root_transform, shape_matrices);
-		break;
+		frame = state_elapsed_seconds / 0.00333333f;
+		return run_animation_data_.get();
 
 	case CharacterState::kJump:
 	case CharacterState::kRunJump:
-		if(GetStateTime(curr_time) > 90)
-			jump_animation_data_->UpdateGlobalMatrices(
-				20 + state_elapsed_seconds / 0.00333333, root_transform, shape_matrices);
-		else
-			jump_animation_data_->UpdateGlobalMatrices(
-				43 + state_elapsed_seconds / 0.00833333, root_transform, shape_matrices);
-		break;
-		
+		if (state_time > 90) frame = 20 + state_elapsed_seconds / 0.00333333f;
+		else frame = 43 + state_elapsed_seconds / 0.00833333f;
+		return jump_animation_data_.get();
+
 	case CharacterState::kSpell:
-		root_transform *= XMMatrixRotationY(XM_PI * 0.5f);
-		skill_animation_data_->UpdateGlobalMatrices(
-			state_elapsed_seconds / 0.00133333, root_transform, shape_matrices);
-		break;
+		root_angle += XM_PI * 0.5f;
+		frame = state_elapsed_seconds / 0.00133333f;
+		return skill_animation_data_.get();
 
 	case CharacterState::kHit:
 	case CharacterState::kSlip:
-		fall_animation_data_->UpdateGlobalMatrices(
-			50 + state_elapsed_seconds / 0.00433333, root_transform, shape_matrices);
-		break;
+		frame = 50 + state_elapsed_seconds / 0.00433333f;
+		return fall_animation_data_.get();
 
 	case CharacterState::kDie:
-		fall_animation_data_->UpdateGlobalMatrices(
-			min(394, 50 + state_elapsed_seconds / 0.01433333), root_transform, shape_matrices);
-		break;
+		frame = min(394.0f, 50 + state_elapsed_seconds / 0.01433333f);
+		return fall_animation_data_.get();
 
+	case CharacterState::kNormal:
+	case CharacterState::kStop:
+	default:
+		frame = 0;
+		return run_animation_data_.get();
 	}
 }
 
+void CharacterClass::OnStateChanged(CharacterState prev_state,
+	time_t prev_state_start_time, time_t curr_time)
+{
+	if (state_ == prev_state && state_start_time_ == prev_state_start_time) return;
+
+	blend_from_state_ = prev_state;
+	blend_from_state_start_time_ = prev_state_start_time;
+	blend_start_time_ = curr_time;
+}
+
 bool CharacterClass::OnCollided(time_t curr_time, int vx)
 {
 	if (time_invincible_end_ < curr_time && time_skill_ended_ < curr_time)
 	{
+		const CharacterState prev_state = state_;
+		const time_t prev_state_start_time = state_start_time_;
+
 		combo_ = 0;
 
 		SetState(CharacterState::kHit, curr_time);
@@ -423,6 +491,8 @@ bool CharacterClass::OnCollided(time_t curr_time, int vx)
 			velocity_.y = 1500;
 			time_invincible_end_ = state_start_time_ + kInvincibleDuration;
 		}
+
+		OnStateChanged(prev_state, prev_state_start_time, curr_time);
 		return true;
 	}
 	return false;
@@ -440,13 +510,13 @@ float CharacterClass::GetInvincibleGaugeRatio(time_t curr_time) const
 
 XMMATRIX CharacterClass::GetSkillStonePos(time_t curr_time) const
 {
-	constexpr float kBoxSize = 0.32f;
-	XMMATRIX skill_stone_pos =
-		XMMatrixRotationX(XM_PI / 18) * XMMatrixRotationY(curr_time * 0.001f) * XMMatrixRotationX(-XM_PI / 10) *
-		XMMatrixScaling(kBoxSize, kBoxSize * 1.2f, kBoxSize) * XMMatrixTranslation(-1.3f, 4.0f, 0.f) *
-		GetLocalWorldMatrix();
-
-	return skill_stone_pos;
+	return skill_stone_pos_.Get({ curr_time, position_.x, position_.y }, [this, curr_time]()
+		{
+			constexpr float kBoxSize = 0.32f;
+			return XMMatrixRotationX(XM_PI / 18) * XMMatrixRotationY(curr_time * 0.001f) * XMMatrixRotationX(-XM_PI / 10) *
+				XMMatrixScaling(kBoxSize, kBoxSize * 1.2f, kBoxSize) * XMMatrixTranslation(-1.3f, 4.0f, 0.f) *
+				GetLocalWorldMatrix();
+		});
 }
 
 
@@ -636,29 +706,29 @@ bool CharacterClass::UseSkill(time_t curr_time,
 		{
 		case 0:
 			time_skill_ended_ = state_start_time_ + 300;
-			sound->PlayEffect("spell3");
+			sound->PlayEffect(kSpell3Sound);
 			break;
 
 		case 1:
 			velocity_.y = 3'600;
 
 			time_skill_ended_ = state_start_time_ + 300;
-			sound->PlayEffect("spell1");
+			sound->PlayEffect(kSpell1Sound);
 			break;
 
 		case 2:
 			time_skill_ended_ = state_start_time_ + 300;
-			sound->PlayEffect("spell2");
+			sound->PlayEffect(kSpell2Sound);
 			break;
 
 		case 3:
 			time_skill_ended_ = state_start_time_ + 300;
-			sound->PlayEffect("spell2");
+			sound->PlayEffect(kSpell2Sound);
 			break;
 
 		case 4:
 			time_skill_ended_ = state_start_time_ + 300;
-			sound->PlayEffect("spell2");
+			sound->PlayEffect(kSpell2Sound);
 
 
 			skill_objs.emplace_back(new SkillObjectShield(
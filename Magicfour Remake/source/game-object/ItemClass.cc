@@ -12,6 +12,8 @@
 using namespace std;
 using namespace DirectX;
 
+constexpr ResourceId kDiamondModel("diamond");
+
 constexpr rect_t kItemRange = { -30000, -10000, 30000, 60000 };
 constexpr time_t kItemLifetime = 10'000;
 
@@ -104,8 +106,9 @@ void ItemClass::Draw(time_t curr_time, time_t time_delta, ShaderManager* shader_
 	};
 
 	shader_manager->stone_shader_->PushRenderQueue(
-		models.get("diamond"),
-		GetShapeMatrix(curr_time) * GetLocalWorldMatrix(),
+		models.get(kDiamondModel),
+		world_matrix_.Get({ curr_time, position_.x, position_.y },
+			[this, curr_time]() { return GetShapeMatrix(curr_time) * GetLocalWorldMatrix(); }),
 		kSkillColor[type_]);
 }
 
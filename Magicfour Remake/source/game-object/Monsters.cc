@@ -13,6 +13,9 @@
 using namespace std;
 using namespace DirectX;
 
+constexpr ResourceId kCubeModel("cube");
+constexpr ResourceId kStopModel("stop");
+
 MonsterDuck::MonsterDuck(direction_t direction, time_t created_time)
 	: MonsterClass(
 		Point2d(DIR_WEIGHT(direction_, kSpawnRightX), kGroundY),
@@ -179,7 +182,7 @@ bool MonsterDuck::Frame(time_t curr_time, time_t time_delta)
 void MonsterDuck::Draw(time_t curr_time, time_t time_delta, ShaderManager* shader_manager,
 	ResourceMap<class ModelClass>& models, ResourceMap<class TextureClass>& textures) const
 {
-	shader_manager->light_shader_->PushRenderQueue(models.get("cube"),
+	shader_manager->light_shader_->PushRenderQueue(models.get(kCubeModel),
 		GetRangeRepresentMatrix());
 }
 
@@ -269,7 +272,7 @@ bool MonsterOctopus::Frame(time_t curr_time, time_t time_delta)
 void MonsterOctopus::Draw(time_t curr_time, time_t time_delta, ShaderManager* shader_manager,
 	ResourceMap<class ModelClass>& models, ResourceMap<class TextureClass>& textures) const
 {
-	shader_manager->light_shader_->PushRenderQueue(models.get("cube"),
+	shader_manager->light_shader_->PushRenderQueue(models.get(kCubeModel),
 		GetRangeRepresentMatrix());
 }
 
@@ -412,7 +415,7 @@ bool MonsterBird::Frame(time_t curr_time, time_t time_delta)
 void MonsterBird::Draw(time_t curr_time, time_t time_delta, ShaderManager* shader_manager,
 	ResourceMap<class ModelClass>& models, ResourceMap<class TextureClass>& textures) const
 {
-	shader_manager->light_shader_->PushRenderQueue(models.get("cube"),
+	shader_manager->light_shader_->PushRenderQueue(models.get(kCubeModel),
 		GetRangeRepresentMatrix());
 }
 
@@ -516,7 +519,7 @@ void MonsterStop::Draw(time_t curr_time, time_t time_delta, ShaderManager* shade
 	const XMMATRIX shape = XMMatrixRotationY((curr_time - state_start_time_) * 0.001f)
 		* XMMatrixTranslation(kScope * position_.x, kScope * position_.y + 0.5f, 0);
 
-	shader_manager->light_shader_->PushRenderQueue(models.get("stop"), shape);
+	shader_manager->light_shader_->PushRenderQueue(models.get(kStopModel), shape);
 }
 
 int MonsterStop::GetVx()
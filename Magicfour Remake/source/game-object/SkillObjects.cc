@@ -12,6 +12,13 @@
 using namespace std;
 using namespace DirectX;
 
+constexpr ResourceId kBasicModel("basic");
+constexpr ResourceId kFireModel("fire");
+constexpr ResourceId kLegModel("leg");
+constexpr ResourceId kOrbModel("orb");
+constexpr ResourceId kShieldModel("shield");
+constexpr ResourceId kSpearModel("spear");
+
 std::string SkillObjectSpear::model_name_;
 std::string SkillObjectBead::model_name_;
 std::string SkillObjectBead::effect_model_name_;
@@ -113,15 +120,21 @@ bool SkillObjectSpear::Frame(time_t curr_time, time_t time_delta)
 void SkillObjectSpear::Draw(time_t curr_time, time_t time_delta, class ShaderManager* shader_manager,
 	ResourceMap<class ModelClass>& models, ResourceMap<class TextureClass>& textures) const
 {
-	const XMMATRIX shape = XMMatrixRotationY(XM_PI / 2) * XMMatrixRotationZ(XM_PI - angle_)
-		* XMMatrixScaling(0.3f, 0.3f, 0.3f) * XMMatrixTranslation(position_.x * kScope, position_.y * kScope, 0.0f);
-	shader_manager->normalMap_shader_->PushRenderQueue(models.get("spear"), shape);
+	shader_manager->normalMap_shader_->PushRenderQueue(models.get(kSpearModel), GetShape());
 }
 
 XMMATRIX SkillObjectSpear::GetGlobalShapeTransform(time_t curr_time)
 {
-	return XMMatrixRotationY(XM_PI / 2) * XMMatrixRotationZ(XM_PI - angle_)
-		* XMMatrixScaling(0.3f, 0.3f, 0.3f) * XMMatrixTranslation(position_.x * kScope, position_.y * kScope, 0.0f);
+	return GetShape();
+}
+
+const XMMATRIX& SkillObjectSpear::GetShape() const
+{
+	return shape_.Get({ angle_, position_.x, position_.y }, [this]()
+		{
+			return XMMatrixRotationY(XM_PI / 2) * XMMatrixRotationZ(XM_PI - angle_)
+				* XMMatrixScaling(0.3f, 0.3f, 0.3f) * XMMatrixTranslation(position_.x * kScope, position_.y * kScope, 0.0f);
+		});
 }
 
 void SkillObjectSpear::initialize(const std::string& model_name)
@@ -211,8 +224,8 @@ void SkillObjectBead::Draw(time_t curr_time, time_t time_delta, class ShaderMana
 		* XMMatrixRotationZ(XM_PI / 2 + atan2(velocity_.y, velocity_.x))
 		* XMMatrixTranslation(position_.x * kScope, position_.y * kScope, (velocity_.y / 1'200'000.0f));
 	
-	//shader_manager->normalMap_shader_->PushRenderQueue(models.get("orb"), orb_shape);
-	shader_manager->fire_shader_->PushRenderQueue(models.get("fire"),
+	//shader_manager->normalMap_shader_->PushRenderQueue(models.get(kOrbModel), orb_shape);
+	shader_manager->fire_shader_->PushRenderQueue(models.get(kFireModel),
 		fire_shape,
 		{ 1.3f, 2.1f, 2.3f },
 		{ 1.0f, 2.0f, 3.0f },
@@ -297,7 +310,7 @@ void SkillObjectLeg::Draw(time_t curr_time, time_t time_delta, class ShaderManag
 	ResourceMap<class ModelClass>& models, ResourceMap<class TextureClass>& textures) const
 {
 	const XMMATRIX shape = XMMatrixTranslation(position_.x * kScope, position_.y * kScope, 0.0f);
-	shader_manager->normalMap_shader_->PushRenderQueue(models.get("leg"), shape);
+	shader_manager->normalMap_shader_->PushRenderQueue(models.get(kLegModel), shape);
 }
 
 XMMATRIX SkillObjectLeg::GetGlobalShapeTransform(time_t curr_time)
@@ -354,7 +367,7 @@ void SkillObjectBasic::Draw(time_t curr_time, time_t time_delta, class ShaderMan
 	ResourceMap<class ModelClass>& models, ResourceMap<class TextureClass>& textures) const
 {
 	const XMMATRIX shape = XMMatrixTranslation(position_.x * kScope, position_.y * kScope, 0.0f);
-	shader_manager->normalMap_shader_->PushRenderQueue(models.get("basic"), shape);
+	shader_manager->normalMap_shader_->PushRenderQueue(models.get(kBasicModel), shape);
 }
 
 XMMATRIX SkillObjectBasic::GetGlobalShapeTransform(time_t curr_time)
@@ -431,7 +444,7 @@ void SkillObjectShield::Draw(time_t curr_time, time_t time_delta, class ShaderMa
 			* XMMatrixTranslation(position_.x * kScope, position_.y * kScope, 0.0f);
 	}
 
-	shader_manager->normalMap_shader_->PushRenderQueue(models.get("shield"), shape);
+	shader_manager->normalMap_shader_->PushRenderQueue(models.get(kShieldModel), shape);
 }
 
 XMMATRIX SkillObjectShield::GetGlobalShapeTransform(time_t curr_time)
@@ -468,7 +481,7 @@ void SkillObjectGuardian::Draw(time_t curr_time, time_t time_delta, class Shader
 	ResourceMap<class ModelClass>& models, ResourceMap<class TextureClass>& textures) const
 {
 	const XMMATRIX shape = XMMatrixTranslation(position_.x * kScope, position_.y * kScope, 0.0f);
-	shader_manager->normalMap_shader_->PushRenderQueue(models.get("orb"), shape);
+	shader_manager->normalMap_shader_->PushRenderQueue(models.get(kOrbModel), shape);
 }
 
 bool SkillObjectGuardian::OnCollided(MonsterClass* monster, time_t collided_time)
@@ -7,26 +7,40 @@
 
 #include "core/D2DClass.hh"
 #include "core/GameException.hh"
+#include "util/FileSystem.hh"
 
-BitmapClass::BitmapClass(D2DClass* direct2d, const wchar_t* filename)
+Microsoft::WRL::ComPtr<IWICBitmap> BitmapClass::DecodeImageFile(IWICImagingFactory* wic_factory, const wchar_t* filename)
 {
+	ComPtr<IWICStream> stream;
 	ComPtr<IWICBitmapDecoder> decoder;
 	ComPtr<IWICBitmapFrameDecode> frame;
 	ComPtr<IWICFormatConverter> converter;
+	ComPtr<IWICBitmap> image;
+
+	// The file must outlive the decoder, which reads it until CreateBitmapFromSource below.
+	const std::wstring wide_filename(filename);
+	FileView file = FileSystem::Open(std::string(wide_filename.begin(), wide_filename.end()));
+
+	HRESULT hr = wic_factory->CreateStream(stream.GetAddressOf());
+	if (FAILED(hr)) throw GAME_EXCEPTION(L"Failed to create WIC stream");
 
-	HRESULT hr = direct2d->GetWicFactory()->CreateDecoderFromFilename(
-		filename,                        // Image to be decoded
+	hr = stream->InitializeFromMemory(
+		reinterpret_cast<BYTE*>(const_cast<char*>(file.GetData())),
+		static_cast<DWORD>(file.GetSize()));
+	if (FAILED(hr)) throw GAME_EXCEPTION(L"Failed to init WIC stream");
+
+	hr = wic_factory->CreateDecoderFromStream(
+		stream.Get(),                    // Image to be decoded
 		NULL,                            // Do not prefer a particular vendor
-		GENERIC_READ,                    // Desired read access to the file
 		WICDecodeMetadataCacheOnDemand,  // Cache metadata when needed
 		decoder.GetAddressOf()           // Pointer to the decoder
 	);
-	if (FAILED(hr)) throw filenotfound_error(filename, WFILE, __LINE__);
+	if (FAILED(hr)) throw fileformat_error(filename, WFILE, __LINE__);
 
 	hr = decoder->GetFrame(0, frame.GetAddressOf());
 	if (FAILED(hr)) throw GAME_EXCEPTION(L"Failed to get frame of decoder");
 
-	hr = direct2d->GetWicFactory()->CreateFormatConverter(converter.GetAddressOf());
+	hr = wic_factory->CreateFormatConverter(converter.GetAddressOf());
 	if (FAILED(hr)) throw GAME_EXCEPTION(L"Failed to create converter");
 
 	hr = converter->Initialize(
@@ -36,7 +50,22 @@ BitmapClass::BitmapClass(D2DClass* direct2d, const wchar_t* filename)
 	);
 	if (FAILED(hr)) throw GAME_EXCEPTION(L"Failed to init converter");
 
-	hr = direct2d->GetRenderTarget()->CreateBitmapFromWicBitmap(converter.Get(), bitmap_.GetAddressOf());
+	// Decode the whole image now, instead of on demand when the bitmap is created.
+	hr = wic_factory->CreateBitmapFromSource(converter.Get(), WICBitmapCacheOnLoad, image.GetAddressOf());
+	if (FAILED(hr)) throw GAME_EXCEPTION(L"Failed to decode image");
+
+	return image;
+}
+
+BitmapClass::BitmapClass(D2DClass* direct2d, const wchar_t* filename)
+	: BitmapClass(direct2d, DecodeImageFile(direct2d->GetWicFactory(), filename).Get())
+{
+
+}
+
+BitmapClass::BitmapClass(D2DClass* direct2d, IWICBitmap* image)
+{
+	HRESULT hr = direct2d->GetRenderTarget()->CreateBitmapFromWicBitmap(image, bitmap_.GetAddressOf());
 	if (FAILED(hr)) throw GAME_EXCEPTION(L"Failed to create bitmap");
 
 	width_ = bitmap_->GetSize().width;
@@ -47,4 +76,11 @@ BitmapClass::BitmapClass(D2DClass* direct2d, const std::string& filename)
 	: BitmapClass(direct2d, std::wstring(filename.begin(), filename.end()).c_str())
 {
 
-}
\ No newline at end of file
+}
+
+MemoryUsage BitmapClass::GetMemoryUsage() const
+{
+	// Decoded to 32bpp, and the decoded image is not kept.
+	const D2D1_SIZE_U size = bitmap_->GetPixelSize();
+	return { sizeof(*this), size_t(size.width) * size.height * 4 };
+}
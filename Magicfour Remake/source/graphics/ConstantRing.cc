@@ -0,0 +1,66 @@
+#include "graphics/ConstantRing.hh"
+
+using namespace std;
+
+namespace
+{
+	BufferHandle CreateRingBuffer(RenderDevice* device, size_t size)
+	{
+		BufferDesc desc;
+		desc.type = BufferType::kConstant;
+		desc.size = size;
+		desc.dynamic = true;
+		return device->CreateBuffer(desc);
+	}
+}
+
+ConstantRing::ConstantRing(RenderDevice* device, size_t size)
+	: device_(device), size_(size)
+{
+	buffer_ = CreateRingBuffer(device_, size_);
+}
+
+ConstantRing::~ConstantRing()
+{
+	device_->ReleaseBuffer(buffer_);
+}
+
+ConstantRange ConstantRing::Stage(const void* constants, size_t size)
+{
+	ConstantRange range;
+	range.offset = staged_.size();
+	range.size = (size + RenderDevice::kConstantAlignment - 1) & ~(RenderDevice::kConstantAlignment - 1);
+
+	staged_.resize(range.offset + range.size);
+	memcpy(staged_.data() + range.offset, constants, size);
+	return range;
+}
+
+void ConstantRing::Upload()
+{
+	if (staged_.empty()) return;
+
+	// More than the ring holds at once; it grows and starts over.
+	if (staged_.size() > size_)
+	{
+		device_->ReleaseBuffer(buffer_);
+		while (size_ < staged_.size()) size_ *= 2;
+		buffer_ = CreateRingBuffer(device_, size_);
+		head_ = 0;
+	}
+
+	if (head_ + staged_.size() > size_) head_ = 0;
+
+	// Starting over discards the buffer; otherwise the GPU still reads what is before the head.
+	if (head_ == 0) device_->UpdateBuffer(buffer_, staged_.data(), staged_.size());
+	else device_->WriteBuffer(buffer_, head_, staged_.data(), staged_.size());
+
+	base_ = head_;
+	head_ += staged_.size();
+	staged_.clear();
+}
+
+void ConstantRing::Bind(ShaderStage stage, uint32_t slot, ConstantRange range)
+{
+	device_->SetConstantBufferRange(stage, slot, buffer_, base_ + range.offset, range.size);
+}
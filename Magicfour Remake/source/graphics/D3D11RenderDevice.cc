@@ -0,0 +1,338 @@
+#include "graphics/D3D11RenderDevice.hh"
+
+#include <d3dcompiler.h>
+
+#include <cstring>
+#include <fstream>
+
+#include "core/GameException.hh"
+
+using namespace std;
+
+namespace
+{
+	DXGI_FORMAT ToDxgiFormat(VertexFormat format)
+	{
+		switch (format)
+		{
+		case VertexFormat::kFloat2: return DXGI_FORMAT_R32G32_FLOAT;
+		case VertexFormat::kFloat3: return DXGI_FORMAT_R32G32B32_FLOAT;
+		case VertexFormat::kFloat4: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+		}
+		return DXGI_FORMAT_UNKNOWN;
+	}
+
+	UINT ToBindFlags(BufferType type)
+	{
+		switch (type)
+		{
+		case BufferType::kVertex: return D3D11_BIND_VERTEX_BUFFER;
+		case BufferType::kIndex: return D3D11_BIND_INDEX_BUFFER;
+		case BufferType::kConstant: return D3D11_BIND_CONSTANT_BUFFER;
+		}
+		return 0;
+	}
+}
+
+D3D11RenderDevice::D3D11RenderDevice(ID3D11Device* device, ID3D11DeviceContext* device_context, HWND hwnd)
+	: device_(device), device_context_(device_context), hwnd_(hwnd),
+	range_buffers_(2 * D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT)
+{
+	// Ranges need offsets at bind, and writes into a constant buffer the GPU may still read.
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	if (SUCCEEDED(device_context_.As(&device_context1_)) &&
+		SUCCEEDED(device_->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))))
+	{
+		constant_ranges_ = options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer;
+	}
+	SetCopiesConstantRanges(!constant_ranges_);
+}
+
+BufferHandle D3D11RenderDevice::CreateBufferImpl(const BufferDesc& desc, const void* initial_data)
+{
+	D3D11_BUFFER_DESC buffer_desc;
+	buffer_desc.Usage = desc.dynamic ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_DEFAULT;
+	buffer_desc.ByteWidth = static_cast<UINT>(desc.size);
+	buffer_desc.BindFlags = ToBindFlags(desc.type);
+	buffer_desc.CPUAccessFlags = desc.dynamic ? D3D11_CPU_ACCESS_WRITE : 0;
+	buffer_desc.MiscFlags = 0;
+	buffer_desc.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA data;
+	data.pSysMem = initial_data;
+	data.SysMemPitch = 0;
+	data.SysMemSlicePitch = 0;
+
+	ComPtr<ID3D11Buffer> buffer;
+	HRESULT result = device_->CreateBuffer(&buffer_desc, initial_data ? &data : nullptr, buffer.GetAddressOf());
+	if (FAILED(result)) throw GAME_EXCEPTION(L"Failed to create buffer.");
+
+	Buffer created;
+	created.buffer = buffer;
+	created.type = desc.type;
+	if (desc.type == BufferType::kConstant && desc.dynamic && !constant_ranges_) created.shadow.resize(desc.size);
+
+	BufferHandle handle;
+	if (!free_buffers_.empty())
+	{
+		handle.id = free_buffers_.back();
+		free_buffers_.pop_back();
+		buffers_[handle.id - 1] = move(created);
+	}
+	else
+	{
+		buffers_.push_back(move(created));
+		handle.id = static_cast<uint32_t>(buffers_.size());
+	}
+
+	return handle;
+}
+
+void D3D11RenderDevice::ReleaseBufferImpl(BufferHandle buffer)
+{
+	buffers_[buffer.id - 1] = Buffer();
+	free_buffers_.push_back(buffer.id);
+}
+
+ComPtr<ID3DBlob> D3D11RenderDevice::CompileShader(const wchar_t* filename, const char* target)
+{
+	ComPtr<ID3DBlob> code;
+	ComPtr<ID3DBlob> error_message;
+
+	const char* entry_point = (target[0] == 'v') ? "vsMain" : "psMain";
+	HRESULT result = D3DCompileFromFile(filename, NULL, NULL, entry_point, target, D3D10_SHADER_ENABLE_STRICTNESS, 0,
+		code.GetAddressOf(), error_message.GetAddressOf());
+
+	if (FAILED(result))
+	{
+		// If the shader failed to compile it should have writen something to the error message.
+		if (error_message) OutputShaderErrorMessage(error_message.Get(), filename);
+		// If there was nothing in the error message then it simply could not find the shader file itself.
+		else MessageBox(hwnd_, filename, L"Missing Shader File", MB_OK);
+
+		throw GAME_EXCEPTION(L"Could not initialize the shader object.");
+	}
+
+	return code;
+}
+
+ShaderHandle D3D11RenderDevice::CreateShaderImpl(const ShaderDesc& desc)
+{
+	ComPtr<ID3DBlob> vs_buffer = CompileShader(desc.vs_filename, "vs_5_0");
+	ComPtr<ID3DBlob> ps_buffer = CompileShader(desc.ps_filename, "ps_5_0");
+
+	Shader shader;
+
+	HRESULT result = device_->CreateVertexShader(vs_buffer->GetBufferPointer(),
+		vs_buffer->GetBufferSize(), NULL, shader.vertex_shader.GetAddressOf());
+	if (FAILED(result)) throw GAME_EXCEPTION(L"Could not initialize the shader object.");
+
+	result = device_->CreatePixelShader(ps_buffer->GetBufferPointer(),
+		ps_buffer->GetBufferSize(), NULL, shader.pixel_shader.GetAddressOf());
+	if (FAILED(result)) throw GAME_EXCEPTION(L"Could not initialize the shader object.");
+
+	// Attributes of a slot follow each other, as in the vertex structures.
+	vector<D3D11_INPUT_ELEMENT_DESC> layout(desc.layout_count);
+	for (size_t i = 0; i < desc.layout_count; i++)
+	{
+		const VertexElement& element = desc.layout[i];
+		layout[i].SemanticName = element.semantic;
+		layout[i].SemanticIndex = element.semantic_index;
+		layout[i].Format = ToDxgiFormat(element.format);
+		layout[i].InputSlot = element.slot;
+		layout[i].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+		layout[i].InputSlotClass = element.per_instance ? D3D11_INPUT_PER_INSTANCE_DATA : D3D11_INPUT_PER_VERTEX_DATA;
+		layout[i].InstanceDataStepRate = element.per_instance ? 1 : 0;
+	}
+
+	result = device_->CreateInputLayout(layout.data(), static_cast<UINT>(layout.size()),
+		vs_buffer->GetBufferPointer(), vs_buffer->GetBufferSize(), shader.input_layout.GetAddressOf());
+	if (FAILED(result)) throw GAME_EXCEPTION(L"Could not initialize the shader object.");
+
+	shaders_.push_back(shader);
+
+	ShaderHandle handle;
+	handle.id = static_cast<uint32_t>(shaders_.size());
+	return handle;
+}
+
+SamplerHandle D3D11RenderDevice::CreateSamplerImpl(AddressMode mode)
+{
+	const D3D11_TEXTURE_ADDRESS_MODE address = (mode == AddressMode::kClamp) ? D3D11_TEXTURE_ADDRESS_CLAMP : D3D11_TEXTURE_ADDRESS_WRAP;
+
+	D3D11_SAMPLER_DESC sampler_desc;
+	sampler_desc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	sampler_desc.AddressU = address;
+	sampler_desc.AddressV = address;
+	sampler_desc.AddressW = address;
+	sampler_desc.MipLODBias = 0.0f;
+	sampler_desc.MaxAnisotropy = 1;
+	sampler_desc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
+	sampler_desc.BorderColor[0] = 0;
+	sampler_desc.BorderColor[1] = 0;
+	sampler_desc.BorderColor[2] = 0;
+	sampler_desc.BorderColor[3] = 0;
+	sampler_desc.MinLOD = 0;
+	sampler_desc.MaxLOD = D3D11_FLOAT32_MAX;
+
+	ComPtr<ID3D11SamplerState> sampler;
+	HRESULT result = device_->CreateSamplerState(&sampler_desc, sampler.GetAddressOf());
+	if (FAILED(result)) throw GAME_EXCEPTION(L"Failed to create sampler state.");
+
+	samplers_.push_back(sampler);
+
+	SamplerHandle handle;
+	handle.id = static_cast<uint32_t>(samplers_.size());
+	return handle;
+}
+
+void D3D11RenderDevice::UpdateBufferImpl(BufferHandle buffer, const void* data, size_t size)
+{
+	vector<uint8_t>& shadow = buffers_[buffer.id - 1].shadow;
+	if (!shadow.empty()) memcpy(shadow.data(), data, size);
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	HRESULT result = device_context_->Map(GetBuffer(buffer), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	if (FAILED(result)) throw GAME_EXCEPTION(L"Failed to lock buffer to update it.");
+
+	memcpy(mapped.pData, data, size);
+
+	device_context_->Unmap(GetBuffer(buffer), 0);
+}
+
+void D3D11RenderDevice::WriteBufferImpl(BufferHandle buffer, size_t offset, const void* data, size_t size)
+{
+	// Ranges of it are copied out when they are bound.
+	vector<uint8_t>& shadow = buffers_[buffer.id - 1].shadow;
+	if (!shadow.empty())
+	{
+		memcpy(shadow.data() + offset, data, size);
+		return;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	HRESULT result = device_context_->Map(GetBuffer(buffer), 0, D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mapped);
+	if (FAILED(result)) throw GAME_EXCEPTION(L"Failed to lock buffer to update it.");
+
+	memcpy(static_cast<uint8_t*>(mapped.pData) + offset, data, size);
+
+	device_context_->Unmap(GetBuffer(buffer), 0);
+}
+
+void D3D11RenderDevice::SetShaderImpl(ShaderHandle shader)
+{
+	const Shader& bound = shaders_[shader.id - 1];
+	device_context_->IASetInputLayout(bound.input_layout.Get());
+	device_context_->VSSetShader(bound.vertex_shader.Get(), NULL, 0);
+	device_context_->PSSetShader(bound.pixel_shader.Get(), NULL, 0);
+}
+
+void D3D11RenderDevice::SetVertexBufferImpl(BufferHandle buffer, uint32_t stride, uint32_t slot)
+{
+	ID3D11Buffer* vertex_buffer = GetBuffer(buffer);
+	const UINT offset = 0;
+	device_context_->IASetVertexBuffers(slot, 1, &vertex_buffer, &stride, &offset);
+}
+
+void D3D11RenderDevice::SetIndexBufferImpl(BufferHandle buffer, IndexFormat format)
+{
+	device_context_->IASetIndexBuffer(GetBuffer(buffer),
+		(format == IndexFormat::kUInt16) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0);
+}
+
+void D3D11RenderDevice::SetConstantBufferImpl(ShaderStage stage, uint32_t slot, BufferHandle buffer,
+	size_t offset, size_t size)
+{
+	ID3D11Buffer* constant_buffer = GetBuffer(buffer);
+	if (size == 0)
+	{
+		BindConstantBuffer(stage, slot, constant_buffer);
+	}
+	else if (constant_ranges_)
+	{
+		// In shader constants of 16 bytes.
+		const UINT first_constant = static_cast<UINT>(offset / 16);
+		const UINT constant_count = static_cast<UINT>(size / 16);
+		if (stage == ShaderStage::kVertex)
+			device_context1_->VSSetConstantBuffers1(slot, 1, &constant_buffer, &first_constant, &constant_count);
+		else device_context1_->PSSetConstantBuffers1(slot, 1, &constant_buffer, &first_constant, &constant_count);
+	}
+	else
+	{
+		RangeBuffer& range = range_buffers_[static_cast<int>(stage) * D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT + slot];
+		if (range.size < size)
+		{
+			range.buffer.Reset();
+			range.size = size;
+
+			D3D11_BUFFER_DESC buffer_desc = {};
+			buffer_desc.Usage = D3D11_USAGE_DYNAMIC;
+			buffer_desc.ByteWidth = static_cast<UINT>(size);
+			buffer_desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+			buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+			HRESULT result = device_->CreateBuffer(&buffer_desc, nullptr, range.buffer.GetAddressOf());
+			if (FAILED(result)) throw GAME_EXCEPTION(L"Failed to create buffer.");
+		}
+
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		HRESULT result = device_context_->Map(range.buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+		if (FAILED(result)) throw GAME_EXCEPTION(L"Failed to lock buffer to update it.");
+
+		memcpy(mapped.pData, buffers_[buffer.id - 1].shadow.data() + offset, size);
+
+		device_context_->Unmap(range.buffer.Get(), 0);
+		BindConstantBuffer(stage, slot, range.buffer.Get());
+	}
+}
+
+void D3D11RenderDevice::BindConstantBuffer(ShaderStage stage, uint32_t slot, ID3D11Buffer* buffer)
+{
+	if (stage == ShaderStage::kVertex) device_context_->VSSetConstantBuffers(slot, 1, &buffer);
+	else device_context_->PSSetConstantBuffers(slot, 1, &buffer);
+}
+
+void D3D11RenderDevice::SetTextureImpl(uint32_t slot, TextureView* texture)
+{
+	ID3D11ShaderResourceView* view = reinterpret_cast<ID3D11ShaderResourceView*>(texture);
+	device_context_->PSSetShaderResources(slot, 1, &view);
+}
+
+void D3D11RenderDevice::SetSamplerImpl(uint32_t slot, SamplerHandle sampler)
+{
+	device_context_->PSSetSamplers(slot, 1, samplers_[sampler.id - 1].GetAddressOf());
+}
+
+void D3D11RenderDevice::DrawIndexedImpl(uint32_t index_count, uint32_t start_index, int32_t base_vertex)
+{
+	device_context_->DrawIndexed(index_count, start_index, base_vertex);
+}
+
+void D3D11RenderDevice::DrawIndexedInstancedImpl(uint32_t index_count, uint32_t instance_count,
+	uint32_t start_index, int32_t base_vertex, uint32_t start_instance)
+{
+	device_context_->DrawIndexedInstanced(index_count, instance_count, start_index, base_vertex, start_instance);
+}
+
+void D3D11RenderDevice::BeginFrameImpl()
+{
+	// Only triangle lists are drawn, while Direct2D may change the topology between frames.
+	device_context_->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+ID3D11Buffer* D3D11RenderDevice::GetBuffer(BufferHandle buffer) const
+{
+	return buffer ? buffers_[buffer.id - 1].buffer.Get() : nullptr;
+}
+
+void D3D11RenderDevice::OutputShaderErrorMessage(ID3DBlob* error_message, const wchar_t* shader_filename)
+{
+	std::ofstream fout("shader-error.txt");
+
+	// Write out the error message.
+	const char* compile_errors = static_cast<const char*>(error_message->GetBufferPointer());
+	fout.write(compile_errors, error_message->GetBufferSize());
+
+	// Pop a message up on the screen to notify the user to check the text file for compile errors.
+	MessageBox(hwnd_, L"Error compiling shader. Check shader-error.txt for message.", shader_filename, MB_OK);
+}
@@ -0,0 +1,136 @@
+#include "graphics/FrustumCuller.hh"
+
+#include <cfloat>
+
+using namespace DirectX;
+
+FrustumCuller::FrustumCuller(const XMMATRIX& vp_matrix)
+{
+    // Planes of the clip volume -w <= x, y <= w and 0 <= z <= w, from the columns of the matrix.
+    const XMMATRIX columns = XMMatrixTranspose(vp_matrix);
+    const XMVECTOR planes[6] =
+    {
+        XMVectorAdd(columns.r[3], columns.r[0]),       // Left
+        XMVectorSubtract(columns.r[3], columns.r[0]),  // Right
+        XMVectorAdd(columns.r[3], columns.r[1]),       // Bottom
+        XMVectorSubtract(columns.r[3], columns.r[1]),  // Top
+        columns.r[2],                                  // Near
+        XMVectorSubtract(columns.r[3], columns.r[2]),  // Far
+    };
+
+    for (int i = 0; i < 6; i++)
+    {
+        const XMVECTOR plane = XMPlaneNormalize(planes[i]);
+        plane_a_[i] = XMVectorSplatX(plane);
+        plane_b_[i] = XMVectorSplatY(plane);
+        plane_c_[i] = XMVectorSplatZ(plane);
+        plane_d_[i] = XMVectorSplatW(plane);
+        abs_a_[i] = XMVectorAbs(plane_a_[i]);
+        abs_b_[i] = XMVectorAbs(plane_b_[i]);
+        abs_c_[i] = XMVectorAbs(plane_c_[i]);
+    }
+}
+
+bool FrustumCuller::IsInFrustum(const BoundingVolume& bv, const XMMATRIX& world_matrix) const
+{
+    XMVECTOR local_center, local_extents;
+    GetLocalBox(bv, local_center, local_extents);
+
+    XMVECTOR centers[kBatchSize], extents[kBatchSize];
+    TransformBox(local_center, local_extents, world_matrix, centers[0], extents[0]);
+    for (size_t i = 1; i < kBatchSize; i++)
+    {
+        centers[i] = centers[0];
+        extents[i] = extents[0];
+    }
+
+    return (TestBatch(centers, extents) & 1u) != 0;
+}
+
+XMVECTOR FrustumCuller::GetCenter(const BoundingVolume& bv)
+{
+    if (const BoundingBox* box = std::get_if<BoundingBox>(&bv)) return XMLoadFloat3(&box->Center);
+    return XMLoadFloat3(&std::get<BoundingSphere>(bv).Center);
+}
+
+BoundingBox FrustumCuller::GetWorldBounds(const BoundingVolume& bv, const std::vector<XMMATRIX>& world_matrices)
+{
+    if (world_matrices.empty()) return BoundingBox(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 0));
+
+    XMVECTOR local_center, local_extents;
+    GetLocalBox(bv, local_center, local_extents);
+
+    XMVECTOR min_corner = XMVectorReplicate(FLT_MAX);
+    XMVECTOR max_corner = XMVectorReplicate(-FLT_MAX);
+    for (const XMMATRIX& world_matrix : world_matrices)
+    {
+        XMVECTOR center, extents;
+        TransformBox(local_center, local_extents, world_matrix, center, extents);
+        min_corner = XMVectorMin(min_corner, XMVectorSubtract(center, extents));
+        max_corner = XMVectorMax(max_corner, XMVectorAdd(center, extents));
+    }
+
+    const XMVECTOR half = XMVectorReplicate(0.5f);
+    BoundingBox bounds;
+    XMStoreFloat3(&bounds.Center, XMVectorMultiply(XMVectorAdd(min_corner, max_corner), half));
+    XMStoreFloat3(&bounds.Extents, XMVectorMultiply(XMVectorSubtract(max_corner, min_corner), half));
+    return bounds;
+}
+
+void FrustumCuller::GetLocalBox(const BoundingVolume& bv, XMVECTOR& center, XMVECTOR& extents)
+{
+    if (const BoundingBox* box = std::get_if<BoundingBox>(&bv))
+    {
+        center = XMLoadFloat3(&box->Center);
+        extents = XMLoadFloat3(&box->Extents);
+    }
+    else
+    {
+        const BoundingSphere& sphere = std::get<BoundingSphere>(bv);
+        center = XMLoadFloat3(&sphere.Center);
+        extents = XMVectorReplicate(sphere.Radius);
+    }
+}
+
+void FrustumCuller::TransformBox(FXMVECTOR center, FXMVECTOR extents, const XMMATRIX& world_matrix,
+                                 XMVECTOR& world_center, XMVECTOR& world_extents)
+{
+    world_center = XMVector3Transform(center, world_matrix);
+
+    // Each local axis adds its extent times the absolute of its transformed direction.
+    world_extents = XMVectorMultiply(XMVectorSplatX(extents), XMVectorAbs(world_matrix.r[0]));
+    world_extents = XMVectorMultiplyAdd(XMVectorSplatY(extents), XMVectorAbs(world_matrix.r[1]), world_extents);
+    world_extents = XMVectorMultiplyAdd(XMVectorSplatZ(extents), XMVectorAbs(world_matrix.r[2]), world_extents);
+}
+
+unsigned FrustumCuller::TestBatch(const XMVECTOR centers[kBatchSize], const XMVECTOR extents[kBatchSize]) const
+{
+    // One box per lane: rows x, y and z of the transposed vectors.
+    const XMMATRIX c = XMMatrixTranspose(XMMATRIX(centers[0], centers[1], centers[2], centers[3]));
+    const XMMATRIX e = XMMatrixTranspose(XMMATRIX(extents[0], extents[1], extents[2], extents[3]));
+
+    // A box is outside when it is entirely behind any plane: distance + projected radius < 0.
+    XMVECTOR outside = XMVectorFalseInt();
+    for (int i = 0; i < 6; i++)
+    {
+        XMVECTOR distance = XMVectorMultiplyAdd(plane_a_[i], c.r[0], plane_d_[i]);
+        distance = XMVectorMultiplyAdd(plane_b_[i], c.r[1], distance);
+        distance = XMVectorMultiplyAdd(plane_c_[i], c.r[2], distance);
+
+        XMVECTOR radius = XMVectorMultiply(abs_a_[i], e.r[0]);
+        radius = XMVectorMultiplyAdd(abs_b_[i], e.r[1], radius);
+        radius = XMVectorMultiplyAdd(abs_c_[i], e.r[2], radius);
+
+        outside = XMVectorOrInt(outside, XMVectorLess(XMVectorAdd(distance, radius), XMVectorZero()));
+    }
+
+    uint32_t lanes[4];
+    XMStoreInt4(lanes, outside);
+
+    unsigned inside = 0;
+    for (unsigned i = 0; i < kBatchSize; i++)
+    {
+        if (!lanes[i]) inside |= 1u << i;
+    }
+    return inside;
+}
@@ -0,0 +1,216 @@
+#include "graphics/MeshOptimizer.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+
+using namespace std;
+
+namespace
+{
+	// Size of LRU cache modelled by the optimizer.
+	constexpr int kCacheSize = 32;
+
+	float VertexScore(int cache_position, uint32_t live_triangles)
+	{
+		// Vertices not used by any remaining triangle never make a triangle attractive.
+		if (live_triangles == 0) return -1.0f;
+
+		float score = 0.0f;
+		if (cache_position >= 0)
+		{
+			// The vertices of the last triangle get a fixed score, so that
+			// the next triangle is not chosen just because it shares an edge.
+			if (cache_position < 3) score = 0.75f;
+			else
+			{
+				const float scaler = 1.0f / (kCacheSize - 3);
+				score = powf(1.0f - (cache_position - 3) * scaler, 1.5f);
+			}
+		}
+
+		// Prefer vertices with few remaining triangles, to finish them off and get rid of them.
+		score += 2.0f * powf(static_cast<float>(live_triangles), -0.5f);
+		return score;
+	}
+}
+
+vector<uint32_t> MeshOptimizer::WeldVertices(const void* vertices, size_t vertex_count, size_t stride, uint32_t* indices)
+{
+	const char* const bytes = static_cast<const char*>(vertices);
+
+	// Keyed by the bytes of the vertex, which stay where they are.
+	unordered_map<string_view, uint32_t> welded(vertex_count);
+	vector<uint32_t> firsts;
+	firsts.reserve(vertex_count);
+
+	for (size_t i = 0; i < vertex_count; i++)
+	{
+		auto result = welded.emplace(string_view(bytes + i * stride, stride), static_cast<uint32_t>(firsts.size()));
+		if (result.second) firsts.push_back(static_cast<uint32_t>(i));
+
+		indices[i] = result.first->second;
+	}
+
+	return firsts;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* indices, size_t index_count, size_t vertex_count)
+{
+	const size_t triangle_count = index_count / 3;
+	if (triangle_count == 0) return;
+
+	// Triangles which use each vertex; adjacency[offset[v], offset[v] + live[v]) are not emitted yet.
+	vector<uint32_t> offset(vertex_count + 1, 0);
+	for (size_t i = 0; i < triangle_count * 3; i++) offset[indices[i] + 1]++;
+	for (size_t v = 0; v < vertex_count; v++) offset[v + 1] += offset[v];
+
+	vector<uint32_t> live(vertex_count);
+	for (size_t v = 0; v < vertex_count; v++) live[v] = offset[v + 1] - offset[v];
+
+	vector<uint32_t> adjacency(triangle_count * 3);
+	{
+		vector<uint32_t> cursor(offset.begin(), offset.end() - 1);
+		for (size_t t = 0; t < triangle_count; t++)
+		{
+			for (size_t k = 0; k < 3; k++) adjacency[cursor[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+		}
+	}
+
+	vector<int> cache_position(vertex_count, -1);
+	vector<float> vertex_score(vertex_count);
+	for (size_t v = 0; v < vertex_count; v++) vertex_score[v] = VertexScore(-1, live[v]);
+
+	vector<float> triangle_score(triangle_count);
+	for (size_t t = 0; t < triangle_count; t++)
+	{
+		const uint32_t* tri = indices + t * 3;
+		triangle_score[t] = vertex_score[tri[0]] + vertex_score[tri[1]] + vertex_score[tri[2]];
+	}
+
+	vector<bool> emitted(triangle_count, false);
+	vector<uint32_t> output;
+	output.reserve(triangle_count * 3);
+
+	vector<uint32_t> cache, next_cache;
+	cache.reserve(kCacheSize + 3);
+	next_cache.reserve(kCacheSize + 3);
+
+	size_t scan_cursor = 0;
+	int64_t best_triangle = -1;
+
+	while (output.size() < triangle_count * 3)
+	{
+		// Nothing in the cache is usable; restart from the next triangle in the original order.
+		if (best_triangle < 0)
+		{
+			while (emitted[scan_cursor]) scan_cursor++;
+			best_triangle = static_cast<int64_t>(scan_cursor);
+		}
+
+		const uint32_t* tri = indices + best_triangle * 3;
+		output.insert(output.end(), tri, tri + 3);
+		emitted[best_triangle] = true;
+
+		// Remove the triangle from the live adjacency of its vertices.
+		for (size_t k = 0; k < 3; k++)
+		{
+			const uint32_t v = tri[k];
+			uint32_t* begin = adjacency.data() + offset[v];
+			uint32_t* end = begin + live[v];
+			uint32_t* found = find(begin, end, static_cast<uint32_t>(best_triangle));
+			if (found != end)
+			{
+				*found = *(end - 1);
+				live[v]--;
+			}
+		}
+
+		// Move the vertices of the triangle to the front of the LRU cache.
+		next_cache.assign(tri, tri + 3);
+		for (uint32_t v : cache)
+		{
+			if (v != tri[0] && v != tri[1] && v != tri[2]) next_cache.push_back(v);
+		}
+
+		// Update scores of every vertex touched, including those just pushed out of the cache.
+		for (size_t i = 0; i < next_cache.size(); i++)
+		{
+			const uint32_t v = next_cache[i];
+			cache_position[v] = (i < kCacheSize) ? static_cast<int>(i) : -1;
+			vertex_score[v] = VertexScore(cache_position[v], live[v]);
+		}
+
+		// Rescore the remaining triangles around them, and pick the best one in the cache.
+		best_triangle = -1;
+		float best_score = -1.0f;
+		for (uint32_t v : next_cache)
+		{
+			for (uint32_t i = offset[v]; i < offset[v] + live[v]; i++)
+			{
+				const uint32_t t = adjacency[i];
+				const uint32_t* candidate = indices + t * 3;
+				triangle_score[t] = vertex_score[candidate[0]] + vertex_score[candidate[1]] + vertex_score[candidate[2]];
+
+				if (cache_position[v] >= 0 && triangle_score[t] > best_score)
+				{
+					best_score = triangle_score[t];
+					best_triangle = t;
+				}
+			}
+		}
+
+		if (next_cache.size() > kCacheSize) next_cache.resize(kCacheSize);
+		swap(cache, next_cache);
+	}
+
+	copy(output.begin(), output.end(), indices);
+}
+
+vector<uint32_t> MeshOptimizer::OptimizeVertexFetch(uint32_t* indices, size_t index_count, size_t vertex_count)
+{
+	constexpr uint32_t kUnused = ~0u;
+
+	vector<uint32_t> remap(vertex_count, kUnused);
+	uint32_t next_vertex = 0;
+
+	for (size_t i = 0; i < index_count; i++)
+	{
+		uint32_t& new_index = remap[indices[i]];
+		if (new_index == kUnused) new_index = next_vertex++;
+		indices[i] = new_index;
+	}
+
+	// Unreferenced vertices go to the end, keeping their relative order.
+	for (auto& new_index : remap)
+	{
+		if (new_index == kUnused) new_index = next_vertex++;
+	}
+
+	return remap;
+}
+
+float MeshOptimizer::CalculateACMR(const uint32_t* indices, size_t index_count, size_t vertex_count,
+	size_t cache_size)
+{
+	const size_t triangle_count = index_count / 3;
+	if (triangle_count == 0) return 0.0f;
+
+	// A vertex is in the FIFO cache when it was pushed within the last cache_size misses.
+	vector<size_t> pushed_at(vertex_count, 0);
+	size_t misses = 0;
+
+	for (size_t i = 0; i < triangle_count * 3; i++)
+	{
+		const uint32_t v = indices[i];
+		if (pushed_at[v] == 0 || misses - pushed_at[v] >= cache_size)
+		{
+			misses++;
+			pushed_at[v] = misses;
+		}
+	}
+
+	return static_cast<float>(misses) / triangle_count;
+}
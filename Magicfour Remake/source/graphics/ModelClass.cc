@@ -1,12 +1,24 @@
 #include "graphics/ModelClass.hh"
 
 #include "graphics/TextureClass.hh"
+#include "graphics/MeshOptimizer.hh"
+#include "graphics/TangentGenerator.hh"
 #include "core/GameException.hh"
+#include "util/FileSystem.hh"
+#include "util/Hash.hh"
 
 #include "core/global.hh"
 
-#include <sstream>
 #include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
 
 #define WIDE2(x) L##x
 #define WIDE(x) WIDE2(x)
@@ -14,60 +26,92 @@
 
 using namespace std;
 
-
-ModelClass::ModelClass(ID3D11Device* device,
-	const std::string& modelFilename,
-	const std::string& diffuse_filename,
-	const std::string& normal_filename,
-	const std::string& emissive_filename)
-	: ModelClass(device,
-		modelFilename.c_str(),
-		diffuse_filename.empty() ? nullptr : std::wstring(diffuse_filename.begin(), diffuse_filename.end()).c_str(),
-		normal_filename.empty() ? nullptr : std::wstring(normal_filename.begin(), normal_filename.end()).c_str(),
-		emissive_filename.empty() ? nullptr : std::wstring(emissive_filename.begin(), emissive_filename.end()).c_str()) {};
-
-ModelClass::ModelClass(ID3D11Device* device,
-	const char* modelFilename,
-	const wchar_t* diffuse_filename,
-	const wchar_t* normal_filename,
-	const wchar_t* emissive_filename)
+namespace
 {
-	// Load in the model_ data.
-	LoadModel(modelFilename);
+	// Models are created on the streaming workers too.
+	atomic<uint32_t> next_sort_id(0);
 
-	// Calculate the tangent and binormal vectors for the model.
-	CalculateModelVectors();
+	// Models of several resources may have one source, e.g. PlaneObject.obj, and load on
+	// several workers at once. Loads of a source take its lock, so it is cooked once,
+	// and the loads waiting for it read the cooked file.
+	mutex cook_locks_mutex;
+	unordered_map<string, shared_ptr<mutex> > cook_locks;
 
-	// Initialize the vertex and index buffers.
-	InitializeBuffers(device);
+	shared_ptr<mutex> GetCookLock(const string& source_filename)
+	{
+		lock_guard<mutex> lock(cook_locks_mutex);
+		auto& cook_lock = cook_locks[source_filename];
+		if (!cook_lock) cook_lock = make_shared<mutex>();
+		return cook_lock;
+	}
+}
 
-	// Load the texture for this model_.
-	LoadTextures(device, diffuse_filename, normal_filename, emissive_filename);
+ModelClass::ModelClass(RenderDevice* device,
+	const std::string& model_filename,
+	const std::shared_ptr<class TextureClass>& diffuse_texture,
+	const std::shared_ptr<class TextureClass>& normal_texture,
+	const std::shared_ptr<class TextureClass>& emissive_texture)
+	: sort_id_(next_sort_id++),
+	  diffuse_texture_(diffuse_texture),
+	  normal_texture_(normal_texture),
+	  emissive_texture_(emissive_texture)
+{
+	// Load the model_ data and initialize the vertex and index buffers.
+	LoadGeometry(model_filename.c_str());
+	CreateBuffers(device);
 }
 
 
-ModelClass::ModelClass(ID3D11Device* device,
-	const std::string& model_filename,
+ModelClass::ModelClass(const std::string& model_filename,
 	const std::shared_ptr<class TextureClass>& diffuse_texture,
 	const std::shared_ptr<class TextureClass>& normal_texture,
 	const std::shared_ptr<class TextureClass>& emissive_texture)
-	: diffuse_texture_(diffuse_texture),
+	: sort_id_(next_sort_id++),
+	  diffuse_texture_(diffuse_texture),
 	  normal_texture_(normal_texture),
 	  emissive_texture_(emissive_texture)
 {
-	// Load in the model_ data.
-	LoadModel(model_filename.c_str());
+	// Only load the model_ data, the buffers are created by CreateBuffers.
+	LoadGeometry(model_filename.c_str());
+}
 
-	// Calculate the tangent and binormal vectors for the model.
-	CalculateModelVectors();
+ModelClass::ModelClass(const std::shared_ptr<const ModelClass>& geometry,
+	const std::shared_ptr<class TextureClass>& diffuse_texture,
+	const std::shared_ptr<class TextureClass>& normal_texture,
+	const std::shared_ptr<class TextureClass>& emissive_texture)
+	: vertex_buffer_(geometry->vertex_buffer_),
+	  index_buffer_(geometry->index_buffer_),
+	  vertexCount_(geometry->vertexCount_),
+	  indexCount_(geometry->indexCount_),
+	  index_format_(geometry->index_format_),
+	  mesh_stats_(geometry->mesh_stats_),
+	  source_hash_(geometry->source_hash_),
+	  sort_id_(geometry->sort_id_),
+	  geometry_source_(geometry),
+	  diffuse_texture_(diffuse_texture),
+	  normal_texture_(normal_texture),
+	  emissive_texture_(emissive_texture),
+	  material_list_(geometry->material_list_),
+	  bounding_volume_(geometry->bounding_volume_)
+{
+	if (!vertex_buffer_) throw GAME_EXCEPTION(L"Model buffers to share are not created yet.");
+}
 
-	// Initialize the vertex and index buffers.
-	InitializeBuffers(device);
+ModelClass::ModelClass(const std::shared_ptr<const ModelClass>& geometry, const DirectX::BoundingBox& bounds)
+	: ModelClass(geometry, geometry->diffuse_texture_, geometry->normal_texture_, geometry->emissive_texture_)
+{
+	bounding_volume_ = bounds;
 }
 
 
 ModelClass::~ModelClass()
 {
+	// Shared buffers belong to the model they are shared from.
+	if (device_ && !geometry_source_)
+	{
+		device_->ReleaseBuffer(vertex_buffer_);
+		device_->ReleaseBuffer(index_buffer_);
+	}
 }
 
 void ModelClass::Shutdown()
@@ -77,429 +121,474 @@ void ModelClass::Shutdown()
 }
 
 
-void ModelClass::Render(ID3D11DeviceContext* deviceContext)
+void ModelClass::Render(RenderDevice* device)
 {
 	// Put the vertex and index buffers on the graphics pipeline to prepare them for drawing.
-	RenderBuffers(deviceContext);
+	RenderBuffers(device);
 
 	return;
 }
 
 
+void ModelClass::SetTextures(const std::shared_ptr<class TextureClass>& diffuse_texture,
+	const std::shared_ptr<class TextureClass>& normal_texture,
+	const std::shared_ptr<class TextureClass>& emissive_texture)
+{
+	diffuse_texture_ = diffuse_texture;
+	normal_texture_ = normal_texture;
+	emissive_texture_ = emissive_texture;
+}
+
 int ModelClass::GetIndexCount()
 {
 	return indexCount_;
 }
 
-ID3D11ShaderResourceView* ModelClass::GetDiffuseTexture()
+TextureView* ModelClass::GetDiffuseTexture()
 {
 	if (diffuse_texture_) return diffuse_texture_->GetTexture();
 	else return nullptr;
 }
 
 
-ID3D11ShaderResourceView* ModelClass::GetNormalTexture()
+TextureView* ModelClass::GetNormalTexture()
 {
 	if (normal_texture_) return normal_texture_->GetTexture();
 	else return nullptr;
 }
 
-ID3D11ShaderResourceView* ModelClass::GetEmissiveTexture()
+TextureView* ModelClass::GetEmissiveTexture()
 {
 	if (emissive_texture_) return emissive_texture_->GetTexture();
 	return nullptr;
 }
 
-void ModelClass::InitializeBuffers(ID3D11Device* device)
+void ModelClass::LoadGeometry(const char* model_filename)
 {
-	VertexType* vertices;
-	unsigned long* indices;
-	D3D11_BUFFER_DESC vertexBufferDesc, indexBufferDesc;
-	D3D11_SUBRESOURCE_DATA vertexData, indexData;
-	HRESULT result;
+	const string cooked_filename = string(model_filename) + ".cooked";
+	const shared_ptr<mutex> cook_lock = GetCookLock(FileSystem::NormalizePath(model_filename));
+	lock_guard<mutex> lock(*cook_lock);
 
-	// Create the vertex array.
-	vertices = new VertexType[vertexCount_];
+	const uint64_t source_hash = HashModelSource(model_filename);
+	source_hash_ = source_hash;
 
-	// Create the index array.
-	indices = new unsigned long[indexCount_];
-
-	// Load the vertex array and index array with data.
-	for (int i = 0; i < vertexCount_; i++)
-	{
-		vertices[i].position = XMFLOAT3(model_[i].x, model_[i].y, model_[i].z);
-		vertices[i].texture = XMFLOAT2(model_[i].tu, model_[i].tv);
-		vertices[i].normal = XMFLOAT3(model_[i].nx, model_[i].ny, model_[i].nz);
-		vertices[i].tangent = XMFLOAT3(model_[i].tx, model_[i].ty, model_[i].tz);
-		vertices[i].binormal = XMFLOAT3(model_[i].bx, model_[i].by, model_[i].bz);
+	// Skip parsing and tangent calculation if the source has not changed since it was cooked.
+	if (LoadCookedModel(cooked_filename.c_str(), source_hash)) return;
 
-		indices[i] = i;
-	}
+	// Load in the model_ data.
+	LoadModel(model_filename);
 
-	// Set up the description of the static vertex buffer.
-	vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	vertexBufferDesc.ByteWidth = sizeof(VertexType) * vertexCount_;
-	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vertexBufferDesc.CPUAccessFlags = 0;
-	vertexBufferDesc.MiscFlags = 0;
-	vertexBufferDesc.StructureByteStride = 0;
-
-	// Give the subresource structure a pointer to the vertex data.
-	vertexData.pSysMem = vertices;
-	vertexData.SysMemPitch = 0;
-	vertexData.SysMemSlicePitch = 0;
-
-	// Now create the vertex buffer.
-	result = device->CreateBuffer(&vertexBufferDesc, &vertexData, vertexBuffer_.GetAddressOf());
-	if (FAILED(result)) throw GAME_EXCEPTION(L"Failed to create vertex buffer.");
+	// Calculate the tangent and binormal vectors for the model.
+	CalculateModelVectors();
 
-	// Set up the description of the static index buffer.
-	indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	indexBufferDesc.ByteWidth = sizeof(unsigned long) * indexCount_;
-	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	indexBufferDesc.CPUAccessFlags = 0;
-	indexBufferDesc.MiscFlags = 0;
-	indexBufferDesc.StructureByteStride = 0;
+	// Weld and reorder the mesh.
+	vector<uint32_t> indices;
+	BuildVertexStream(vertex_stream_, indices);
 
-	// Give the subresource structure a pointer to the index data.
-	indexData.pSysMem = indices;
-	indexData.SysMemPitch = 0;
-	indexData.SysMemSlicePitch = 0;
+	// Everything needed later is in the vertex stream now.
+	ReleaseModel();
 
-	// Create the index buffer.
-	result = device->CreateBuffer(&indexBufferDesc, &indexData, indexBuffer_.GetAddressOf());
-	if (FAILED(result)) throw GAME_EXCEPTION(L"Failed to create index buffer.");
+	// Use 16-bit indices whenever every vertex is addressable with them.
+	if (vertexCount_ <= 0xFFFF)
+	{
+		index_format_ = IndexFormat::kUInt16;
+		index_stream_.resize(sizeof(uint16_t) * indices.size());
 
-	// Release the arrays now that the vertex and index buffers have been created and loaded.
-	delete[] vertices;
-	vertices = 0;
+		uint16_t* short_indices = reinterpret_cast<uint16_t*>(index_stream_.data());
+		for (size_t i = 0; i < indices.size(); i++) short_indices[i] = static_cast<uint16_t>(indices[i]);
+	}
+	else
+	{
+		index_format_ = IndexFormat::kUInt32;
+		index_stream_.resize(sizeof(uint32_t) * indices.size());
+		memcpy(index_stream_.data(), indices.data(), index_stream_.size());
+	}
 
-	delete[] indices;
-	indices = 0;
+	staged_vertices_ = vertex_stream_.data();
+	staged_indices_ = index_stream_.data();
 
+	SaveCookedModel(cooked_filename.c_str(), source_hash, vertex_stream_, staged_indices_);
 }
 
-void ModelClass::RenderBuffers(ID3D11DeviceContext* deviceContext)
+void ModelClass::CreateBuffers(RenderDevice* device)
 {
-	unsigned int stride;
-	unsigned int offset;
+	if (!staged_vertices_) throw GAME_EXCEPTION(L"Model buffers are already created.");
 
+	InitializeBuffers(device, staged_vertices_, staged_indices_);
 
-	// Set vertex buffer stride and offset.
-	stride = sizeof(VertexType);
-	offset = 0;
+	// The streams only exist to be uploaded, so release them now.
+	vertex_stream_ = vector<VertexType>();
+	index_stream_ = vector<char>();
+	cooked_file_ = FileView();
 
-	// Set the vertex buffer to active in the input assembler so it can be rendered.
-	deviceContext->IASetVertexBuffers(0, 1, vertexBuffer_.GetAddressOf(), &stride, &offset);
-
-	// Set the index buffer to active in the input assembler so it can be rendered.
-	deviceContext->IASetIndexBuffer(indexBuffer_.Get(), DXGI_FORMAT_R32_UINT, 0);
-
-	// Set the type of primitive that should be rendered from this vertex buffer, in this case triangles.
-	deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-	return;
+	staged_vertices_ = nullptr;
+	staged_indices_ = nullptr;
 }
 
+MemoryUsage ModelClass::GetMemoryUsage() const
+{
+	MemoryUsage usage;
+	usage.cpu_bytes = sizeof(*this)
+		+ model_.capacity() * sizeof(ModelType)
+		+ vertex_stream_.capacity() * sizeof(VertexType)
+		+ index_stream_.capacity()
+		+ cooked_file_.GetSize()
+		+ material_list_.capacity() * sizeof(material_list_[0]);
+
+	// Shared buffers are counted for the model they belong to.
+	if (vertex_buffer_ && !geometry_source_) usage.gpu_bytes = GetGeometrySize();
+
+	return usage;
+}
 
-void ModelClass::LoadTextures(ID3D11Device* device,
-	const wchar_t* diffuse_filename, const wchar_t* normal_filename, const wchar_t* emissive_filename)
+size_t ModelClass::GetGeometrySize() const
 {
-	// Create and initialize the diffuse texture object.
-	diffuse_texture_ = make_unique<TextureClass>(device, diffuse_filename);
+	const size_t index_size = (index_format_ == IndexFormat::kUInt16) ? sizeof(uint16_t) : sizeof(uint32_t);
+	return sizeof(VertexType) * vertexCount_ + index_size * indexCount_;
+}
 
-	if (normal_filename)
+void ModelClass::BuildVertexStream(vector<VertexType>& vertices, vector<uint32_t>& indices)
+{
+	// Weld triangle corners whose whole vertex data are bitwise identical.
+	vector<VertexType> corners(model_.size());
+	for (size_t i = 0; i < model_.size(); i++)
 	{
-		// Create and initialize the diffuse texture object.
-		normal_texture_ = make_unique<TextureClass>(device, normal_filename);
+		VertexType& vertex = corners[i];
+		vertex.position = XMFLOAT3(model_[i].x, model_[i].y, model_[i].z);
+		vertex.texture = XMFLOAT2(model_[i].tu, model_[i].tv);
+		vertex.normal = XMFLOAT3(model_[i].nx, model_[i].ny, model_[i].nz);
+		vertex.tangent = XMFLOAT3(model_[i].tx, model_[i].ty, model_[i].tz);
+		vertex.binormal = XMFLOAT3(model_[i].bx, model_[i].by, model_[i].bz);
 	}
-	else normal_texture_ = nullptr;
 
+	indices.resize(corners.size());
+	const vector<uint32_t> firsts = MeshOptimizer::WeldVertices(corners.data(), corners.size(), sizeof(VertexType), indices.data());
+
+	vertices.resize(firsts.size());
+	for (size_t v = 0; v < firsts.size(); v++) vertices[v] = corners[firsts[v]];
+	corners = vector<VertexType>();
+
+	mesh_stats_.source_vertex_count = static_cast<uint32_t>(model_.size());
+	mesh_stats_.vertex_count = static_cast<uint32_t>(vertices.size());
+	mesh_stats_.index_count = static_cast<uint32_t>(indices.size());
+	mesh_stats_.acmr_before = MeshOptimizer::CalculateACMR(indices.data(), indices.size(), vertices.size());
 
-	if (emissive_filename)
+	// Reorder triangles within each material range, as ranges are drawn by index offsets.
+	for (size_t i = 0; i < material_list_.size(); i++)
 	{
-		emissive_texture_ = make_unique<TextureClass>(device, emissive_filename);
+		const size_t start = min<size_t>(material_list_[i].second, indices.size());
+		const size_t end = (i + 1 < material_list_.size()) ? min<size_t>(material_list_[i + 1].second, indices.size()) : indices.size();
+		if (start < end) MeshOptimizer::OptimizeVertexCache(indices.data() + start, end - start, vertices.size());
 	}
-	else emissive_texture_ = make_unique<TextureClass>(device, L"data/texture/black.png");
-}
 
+	// Then lay the vertices out in the order they are used.
+	vector<uint32_t> remap = MeshOptimizer::OptimizeVertexFetch(indices.data(), indices.size(), vertices.size());
+	vector<VertexType> ordered(vertices.size());
+	for (size_t v = 0; v < vertices.size(); v++) ordered[remap[v]] = vertices[v];
+	vertices.swap(ordered);
 
+	mesh_stats_.acmr_after = MeshOptimizer::CalculateACMR(indices.data(), indices.size(), vertices.size());
 
-#include <vector>
-#include <map>
+	vertexCount_ = static_cast<int>(vertices.size());
+	indexCount_ = static_cast<int>(indices.size());
+}
 
-using namespace std;
+void ModelClass::InitializeBuffers(RenderDevice* device, const VertexType* vertices, const void* indices)
+{
+	device_ = device;
 
-void ModelClass::LoadModel(const char* filename)
+	// Set up the description of the static vertex buffer.
+	BufferDesc vertex_buffer_desc;
+	vertex_buffer_desc.type = BufferType::kVertex;
+	vertex_buffer_desc.size = sizeof(VertexType) * vertexCount_;
+	vertex_buffer_ = device->CreateBuffer(vertex_buffer_desc, vertices);
+
+	// Set up the description of the static index buffer.
+	BufferDesc index_buffer_desc;
+	index_buffer_desc.type = BufferType::kIndex;
+	index_buffer_desc.size = (index_format_ == IndexFormat::kUInt16 ? sizeof(uint16_t) : sizeof(uint32_t)) * indexCount_;
+	index_buffer_ = device->CreateBuffer(index_buffer_desc, indices);
+}
+
+void ModelClass::RenderBuffers(RenderDevice* device)
 {
-	struct Vertex { float x, y, z; };
-	vector<Vertex> v_list, vt_list, vn_list;
-	map<string, MaterialType> meterial;
-
-	auto read_mtl_file = [&](const char* filename) {
-		string mtl_name = "";
-		MaterialType curr_mtl = {
-			XMFLOAT3(1.0f, 1.0f, 1.0f),
-			XMFLOAT3(1.0f, 1.0f, 1.0f),
-			XMFLOAT3(1.0f, 1.0f, 1.0f)
-		};
-
-		ifstream fin(filename);
-		if (fin.fail()) return; //throw filenotfound_error(filename, WFILE, __LINE__);
-
-		string buffer;
-		while (getline(fin, buffer))
-		{
-			istringstream iss(buffer);
-			getline(iss, buffer, ' ');
-
-			if (buffer == "#") continue; // case: comments
-			else if (buffer == "newmtl")
-			{
-				if (mtl_name.size() > 0)
-				{
-					meterial[mtl_name] = curr_mtl;
-					curr_mtl.ambient = curr_mtl.diffuse = curr_mtl.specular = XMFLOAT3(1.0f, 1.0f, 1.0f);
-				}
-				iss >> mtl_name;
-			}
-			else if (buffer == "Ka")
-			{
-				float r, g, b; iss >> r >> g >> b;
-				curr_mtl.ambient = XMFLOAT3(r, g, b);
-			}
-			else if (buffer == "Kd")
-			{
-				float r, g, b; iss >> r >> g >> b;
-				curr_mtl.diffuse = XMFLOAT3(r, g, b);
-			}
-			else if (buffer == "Ks")
-			{
-				float r, g, b; iss >> r >> g >> b;
-				curr_mtl.specular = XMFLOAT3(r, g, b);
-			}
-		}
+	// Set the vertex buffer to active in the input assembler so it can be rendered.
+	device->SetVertexBuffer(vertex_buffer_, sizeof(VertexType));
 
-		if (mtl_name.size() > 0)
-		{
-			meterial[mtl_name] = curr_mtl;
-		}
-	};
+	// Set the index buffer to active in the input assembler so it can be rendered.
+	device->SetIndexBuffer(index_buffer_, index_format_);
+}
 
 
-	// The bounding volume will be a box by default.
-	// To calculate the bounding box, we need to find the min and max coordinates.
-	DirectX::XMFLOAT3 min = { FLT_MAX, FLT_MAX, FLT_MAX };
-	DirectX::XMFLOAT3 max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
 
-	ifstream fin(filename);
-	if (fin.fail()) throw filenotfound_error(filename, WFILE, __LINE__);
+namespace
+{
+	// The directory part of path, including the last slash.
+	inline string GetDirectory(const char* path)
+	{
+		string_view path_view(path);
+		const size_t last = path_view.find_last_of("/\\");
+		return (last == string_view::npos) ? string() : string(path_view.substr(0, last + 1));
+	}
 
-	string buffer;
-	while (getline(fin, buffer))
+	inline DirectX::XMFLOAT3 ToFloat3(const ObjParser::Color& color)
 	{
-		replace(buffer.begin(), buffer.end(), '\r', ' ');
-		istringstream iss(buffer);
-		getline(iss, buffer, ' ');
+		return DirectX::XMFLOAT3(color.r, color.g, color.b);
+	}
+}
 
-		if (buffer == "#") continue; // case: comments
-		else if (buffer == "v")
-		{
-			float x, y, z;
-			iss >> x >> y >> z;
-			v_list.push_back({ x, y, z });
+void ModelClass::LoadModel(const char* filename)
+{
+	FileView file = FileSystem::Open(filename);
 
-			// Update the min and max coordinates.
-			min.x = min(min.x, x); min.y = min(min.y, y); min.z = min(min.z, z);
-			max.x = max(max.x, x); max.y = max(max.y, y); max.z = max(max.z, z);
-		}
-		else if (buffer == "vt")
-		{
-			float x, y;
-			iss >> x >> y;
-			vt_list.push_back({ x, 1 - y });
-		}
-		else if (buffer == "vn")
+	// Material libraries are optional, so a missing one leaves the default material.
+	const string directory = GetDirectory(filename);
+	auto load_materials = [&directory](string_view library_name, ObjParser::MaterialMap& materials)
+	{
+		FileView mtl_file;
+		try
 		{
-			float x, y, z;
-			iss >> x >> y >> z;
-			vn_list.push_back({ x, y, z });
+			mtl_file = FileSystem::Open(directory + string(library_name));
 		}
-		else if (buffer == "f")
+		catch (const GameException&)
 		{
-			vector<ModelType> face_v;
-			while (getline(iss, buffer, ' '))
-			{
-				if (buffer.size() == 0) continue;
-				face_v.push_back({ 0 });
-				istringstream point_iss(buffer);
-
-				getline(point_iss, buffer, '/');
-				int num = stoi(buffer) - 1;
-
-				face_v.back().x = v_list[num].x;
-				face_v.back().y = v_list[num].y;
-				face_v.back().z = v_list[num].z;
-
-				if (getline(point_iss, buffer, '/') && !buffer.empty())
-				{
-					int num = stoi(buffer) - 1;
-					face_v.back().tu = vt_list[num].x;
-					face_v.back().tv = vt_list[num].y;
-				}
-
-				if (getline(point_iss, buffer, '/') && !buffer.empty())
-				{
-					int num = stoi(buffer) - 1;
-					face_v.back().nx = vn_list[num].x;
-					face_v.back().ny = vn_list[num].y;
-					face_v.back().nz = vn_list[num].z;
-				}
-				else
-				{
-					if (face_v.size() >= 3)
-					{
-						// If normal vector is not defined, calculate it from first three points.
-						VectorType v1 = { face_v[1].x - face_v[0].x , face_v[1].y - face_v[0].y, face_v[1].z - face_v[0].z };
-						VectorType v2 = { face_v[2].x - face_v[0].x , face_v[2].y - face_v[0].y, face_v[2].z - face_v[0].z };
-						VectorType normal = {v1.y * v2.z - v1.z * v2.y, v1.z * v2.x - v1.x * v2.z, v1.x * v2.y - v1.y * v2.x };
-
-						const float length = sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
-						if (length <= 0.001f) normal = { 0, 1, 0 };
-						else normal.x /= length, normal.y /= length, normal.z /= length;
-
-						// And insert it.
-						for (auto& fv : face_v) fv.nx = normal.x, fv.ny = normal.y, fv.nz = normal.z;
-					}
-					else
-					{
-						for (auto& fv : face_v) fv.nx = 0, fv.ny = 1, fv.nz = 0;
-					}
-
-				}
-			}
-
-			for (size_t i = 0; i < face_v.size() - 2; i++)
-			{
-				model_.push_back(face_v[0]);
-				model_.push_back(face_v[i + 1]);
-				model_.push_back(face_v[i + 2]);
-			}
+			return;
 		}
-		else if (buffer == "mtllib")
-		{
-			string path = string(filename);
-			const int last = path.find_last_of('/');
-			path = path.substr(0, path.find_last_of('/') + 1);
-			iss >> buffer;
 
-			read_mtl_file((path + buffer).c_str());
-		}
-		else if (buffer == "usemtl")
-		{
-			iss >> buffer;
-			if (meterial.find(buffer) == meterial.end()) continue;
-			material_list_.emplace_back(meterial[buffer], (int)model_.size());
-		}
-	}
+		ObjParser::ParseMaterials(mtl_file.GetView(), materials);
+	};
+
+	ObjParser::Mesh mesh;
+	if (!ObjParser::ParseModel(file.GetView(), load_materials, mesh)) throw fileformat_error(filename, WFILE, __LINE__);
 
-	if (material_list_.empty()) material_list_.emplace_back(MaterialType{
-			XMFLOAT3(1.0f, 1.0f, 1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f) }, 0);
+	model_.swap(mesh.corners);
+	for (const auto& range : mesh.material_ranges)
+	{
+		const MaterialType material = { ToFloat3(range.first.ambient), ToFloat3(range.first.diffuse), ToFloat3(range.first.specular) };
+		material_list_.emplace_back(material, range.second);
+	}
 
 	indexCount_ = vertexCount_ = model_.size();
 
 	// Set the bounding volume to a box by default.
+	const float* min = mesh.min;
+	const float* max = mesh.max;
 	bounding_volume_ = DirectX::BoundingBox(
-		{ (min.x + max.x) / 2, (min.y + max.y) / 2, (min.z + max.z) / 2 },
-		{ (max.x - min.x) / 2, (max.y - min.y) / 2, (max.z - min.z) / 2 }
+		{ (min[0] + max[0]) / 2, (min[1] + max[1]) / 2, (min[2] + max[2]) / 2 },
+		{ (max[0] - min[0]) / 2, (max[1] - min[1]) / 2, (max[2] - min[2]) / 2 }
 	);
 }
 
-void ModelClass::CalculateModelVectors()
+namespace
+{
+	// Layout of a cooked mesh file:
+	// header, material ranges, vertex stream, index stream.
+	struct CookedModelHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t source_hash;
+
+		uint32_t vertex_count;
+		uint32_t index_count;
+		uint32_t index_size;
+		uint32_t material_count;
+
+		// 0 for a bounding box (center, extents), 1 for a bounding sphere (center, radius).
+		uint32_t bounding_type;
+		float bounding[6];
+
+		// Kept to report the mesh statistics without rebuilding.
+		uint32_t source_vertex_count;
+		float acmr_before, acmr_after;
+		uint32_t degenerate_triangle_count;
+	};
+
+	constexpr char kCookedModelMagic[4] = { 'M', '4', 'M', 'D' };
+
+	// Bump this when the layout of the cooked file or the vertex type is changed.
+	constexpr uint32_t kCookedModelVersion = 4;
+}
+
+uint64_t ModelClass::HashModelSource(const char* model_filename)
 {
+	FileView file = FileSystem::Open(model_filename);
+	uint64_t hash = HashBytes(file.GetView());
 
-	VectorType tangent, binormal;
-	for (int i = 0; i < vertexCount_; i += 3)
+	// Materials are part of the cooked mesh, so the material libraries are hashed too.
+	for (string_view library_name : ObjParser::FindMaterialLibraries(file.GetView()))
 	{
-		TempVertexType vertex[3] =
-		{
-			{model_[i + 0].x, model_[i + 0].y, model_[i + 0].z, model_[i + 0].tu, model_[i + 0].tv},
-			{model_[i + 1].x, model_[i + 1].y, model_[i + 1].z, model_[i + 1].tu, model_[i + 1].tv},
-			{model_[i + 2].x, model_[i + 2].y, model_[i + 2].z, model_[i + 2].tu, model_[i + 2].tv}
-		};
+		const string mtl_filename = GetDirectory(model_filename) + string(library_name);
+		hash = HashBytes(mtl_filename, hash);
 
-		CalculateTangentBinormal(vertex[0], vertex[1], vertex[2], tangent, binormal);
-		for (int j = i; j < i + 3; j++)
+		try
 		{
-			model_[j].tx = tangent.x;
-			model_[j].ty = tangent.y;
-			model_[j].tz = tangent.z;
-
-			model_[j].bx = binormal.x;
-			model_[j].by = binormal.y;
-			model_[j].bz = binormal.z;
+			FileView mtl_file = FileSystem::Open(mtl_filename);
+			hash = HashBytes(mtl_file.GetView(), hash);
 		}
+		catch (const GameException&) {}
 	}
+
+	return hash;
 }
 
-void ModelClass::CalculateTangentBinormal(TempVertexType vertex1, TempVertexType vertex2, TempVertexType vertex3, VectorType& tangent, VectorType& binormal)
+bool ModelClass::LoadCookedModel(const char* cooked_filename, uint64_t source_hash)
 {
-	float vector1[3], vector2[3];
-	float tuVector[2], tvVector[2];
-	float den;
-	float length;
+	FileView file;
+	try
+	{
+		file = FileSystem::Open(cooked_filename);
+	}
+	catch (const GameException&)
+	{
+		return false;
+	}
+
+	// Check whether the cooked file is valid and up to date.
+	if (file.GetSize() < sizeof(CookedModelHeader)) return false;
+
+	CookedModelHeader header;
+	memcpy(&header, file.GetData(), sizeof(header));
 
+	if (memcmp(header.magic, kCookedModelMagic, sizeof(header.magic)) != 0 ||
+		header.version != kCookedModelVersion ||
+		header.source_hash != source_hash ||
+		header.material_count == 0 ||
+		(header.index_size != sizeof(uint16_t) && header.index_size != sizeof(uint32_t))) return false;
 
-	// Calculate the two vectors for this face.
-	vector1[0] = vertex2.x - vertex1.x;
-	vector1[1] = vertex2.y - vertex1.y;
-	vector1[2] = vertex2.z - vertex1.z;
+	const size_t materials_size = sizeof(MaterialType) * header.material_count;
+	const size_t material_starts_size = sizeof(int32_t) * header.material_count;
+	const size_t vertices_size = sizeof(VertexType) * header.vertex_count;
+	const size_t indices_size = size_t(header.index_size) * header.index_count;
+	if (file.GetSize() != sizeof(header) + materials_size + material_starts_size + vertices_size + indices_size) return false;
 
-	vector2[0] = vertex3.x - vertex1.x;
-	vector2[1] = vertex3.y - vertex1.y;
-	vector2[2] = vertex3.z - vertex1.z;
+	const char* data = file.GetData() + sizeof(header);
+
+	material_list_.resize(header.material_count);
+	for (auto& material : material_list_)
+	{
+		int32_t start;
+		memcpy(&material.first, data, sizeof(MaterialType)); data += sizeof(MaterialType);
+		memcpy(&start, data, sizeof(int32_t)); data += sizeof(int32_t);
+		material.second = start;
+	}
+
+	if (header.bounding_type == 0)
+	{
+		bounding_volume_ = DirectX::BoundingBox(
+			{ header.bounding[0], header.bounding[1], header.bounding[2] },
+			{ header.bounding[3], header.bounding[4], header.bounding[5] });
+	}
+	else
+	{
+		bounding_volume_ = DirectX::BoundingSphere(
+			{ header.bounding[0], header.bounding[1], header.bounding[2] },
+			header.bounding[3]);
+	}
 
-	// Calculate the tu and tv texture space vectors.
-	tuVector[0] = vertex2.tu - vertex1.tu;
-	tvVector[0] = vertex2.tv - vertex1.tv;
+	vertexCount_ = header.vertex_count;
+	indexCount_ = header.index_count;
+	index_format_ = (header.index_size == sizeof(uint16_t)) ? IndexFormat::kUInt16 : IndexFormat::kUInt32;
 
-	tuVector[1] = vertex3.tu - vertex1.tu;
-	tvVector[1] = vertex3.tv - vertex1.tv;
+	mesh_stats_.source_vertex_count = header.source_vertex_count;
+	mesh_stats_.vertex_count = header.vertex_count;
+	mesh_stats_.index_count = header.index_count;
+	mesh_stats_.acmr_before = header.acmr_before;
+	mesh_stats_.acmr_after = header.acmr_after;
+	mesh_stats_.degenerate_triangle_count = header.degenerate_triangle_count;
 
-	// Calculate the denominator of the tangent/binormal equation.
-	den = 1.0f / (tuVector[0] * tvVector[1] - tuVector[1] * tvVector[0]);
+	// The vertex and index streams are uploaded straight from the mapped file or archive.
+	staged_vertices_ = reinterpret_cast<const VertexType*>(data);
+	staged_indices_ = data + vertices_size;
+	cooked_file_ = move(file);
 
-	// Calculate the cross products and multiply by the coefficient to get the tangent and binormal.
-	tangent.x = (tvVector[1] * vector1[0] - tvVector[0] * vector2[0]) * den;
-	tangent.y = (tvVector[1] * vector1[1] - tvVector[0] * vector2[1]) * den;
-	tangent.z = (tvVector[1] * vector1[2] - tvVector[0] * vector2[2]) * den;
+	return true;
+}
 
-	binormal.x = (tuVector[0] * vector2[0] - tuVector[1] * vector1[0]) * den;
-	binormal.y = (tuVector[0] * vector2[1] - tuVector[1] * vector1[1]) * den;
-	binormal.z = (tuVector[0] * vector2[2] - tuVector[1] * vector1[2]) * den;
+void ModelClass::SaveCookedModel(const char* cooked_filename, uint64_t source_hash,
+	const vector<VertexType>& vertices, const void* indices) const
+{
+	CookedModelHeader header = {};
+	memcpy(header.magic, kCookedModelMagic, sizeof(header.magic));
+	header.version = kCookedModelVersion;
+	header.source_hash = source_hash;
+	header.vertex_count = static_cast<uint32_t>(vertices.size());
+	header.index_count = static_cast<uint32_t>(indexCount_);
+	header.index_size = (index_format_ == IndexFormat::kUInt16) ? sizeof(uint16_t) : sizeof(uint32_t);
+	header.material_count = static_cast<uint32_t>(material_list_.size());
+	header.source_vertex_count = mesh_stats_.source_vertex_count;
+	header.acmr_before = mesh_stats_.acmr_before;
+	header.acmr_after = mesh_stats_.acmr_after;
+	header.degenerate_triangle_count = mesh_stats_.degenerate_triangle_count;
+
+	if (holds_alternative<DirectX::BoundingBox>(bounding_volume_))
+	{
+		const auto& box = get<DirectX::BoundingBox>(bounding_volume_);
+		header.bounding_type = 0;
+		header.bounding[0] = box.Center.x, header.bounding[1] = box.Center.y, header.bounding[2] = box.Center.z;
+		header.bounding[3] = box.Extents.x, header.bounding[4] = box.Extents.y, header.bounding[5] = box.Extents.z;
+	}
+	else
+	{
+		const auto& sphere = get<DirectX::BoundingSphere>(bounding_volume_);
+		header.bounding_type = 1;
+		header.bounding[0] = sphere.Center.x, header.bounding[1] = sphere.Center.y, header.bounding[2] = sphere.Center.z;
+		header.bounding[3] = sphere.Radius;
+	}
 
-	// Calculate the length of this normal.
-	length = sqrt((tangent.x * tangent.x) + (tangent.y * tangent.y) + (tangent.z * tangent.z));
+	// Cooking is only a cache, so failing to write it is not an error.
+	// It is written aside and renamed over the cooked file, so a crash or a reader never sees it half written.
+	const string temp_filename = string(cooked_filename) + ".tmp";
+	{
+		ofstream fout(temp_filename, ios::binary | ios::trunc);
+		if (fout.fail()) return;
 
-	// Normalize the normal and then store it
-	tangent.x = tangent.x / length;
-	tangent.y = tangent.y / length;
-	tangent.z = tangent.z / length;
+		fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		for (const auto& material : material_list_)
+		{
+			const int32_t start = material.second;
+			fout.write(reinterpret_cast<const char*>(&material.first), sizeof(MaterialType));
+			fout.write(reinterpret_cast<const char*>(&start), sizeof(int32_t));
+		}
+		fout.write(reinterpret_cast<const char*>(vertices.data()), sizeof(VertexType) * vertices.size());
+		fout.write(static_cast<const char*>(indices), size_t(header.index_size) * header.index_count);
 
-	// Calculate the length of this normal.
-	length = sqrt((binormal.x * binormal.x) + (binormal.y * binormal.y) + (binormal.z * binormal.z));
+		fout.close();
+		if (fout.fail())
+		{
+			std::remove(temp_filename.c_str());
+			return;
+		}
+	}
 
-	// Normalize the normal and then store it
-	binormal.x = binormal.x / length;
-	binormal.y = binormal.y / length;
-	binormal.z = binormal.z / length;
+	// Replacing fails while the old cooked file is mapped; it is then cooked again on the next run.
+	error_code error;
+	filesystem::rename(temp_filename, cooked_filename, error);
+	if (error) std::remove(temp_filename.c_str());
+}
 
-	return;
+void ModelClass::CalculateModelVectors()
+{
+	if (model_.empty()) return;
+
+	TangentGenerator::Corners corners;
+	corners.count = model_.size();
+	corners.stride = sizeof(ModelType);
+	corners.position = &model_[0].x;
+	corners.texture = &model_[0].tu;
+	corners.normal = &model_[0].nx;
+	corners.tangent = &model_[0].tx;
+	corners.binormal = &model_[0].bx;
+
+	const auto stats = TangentGenerator::Generate(corners);
+	mesh_stats_.degenerate_triangle_count = static_cast<uint32_t>(stats.degenerate_triangle_count);
 }
 
 
 
 void ModelClass::ReleaseModel()
 {
-	return;
+	// Swap with an empty vector, as clear would keep the capacity.
+	vector<ModelType>().swap(model_);
+	material_list_.shrink_to_fit();
 }
\ No newline at end of file
@@ -0,0 +1,227 @@
+#include "graphics/NullRenderDevice.hh"
+
+#include "core/GameException.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+namespace
+{
+	const char* kCallNames[] =
+	{
+		"CreateBuffer", "ReleaseBuffer", "CreateShader", "CreateSampler", "UpdateBuffer", "WriteBuffer",
+		"SetShader", "SetVertexBuffer", "SetIndexBuffer", "SetConstantBuffer", "SetTexture", "SetSampler",
+		"DrawIndexed", "DrawIndexedInstanced", "BeginFrame",
+	};
+}
+
+NullRenderDevice::NullRenderDevice(bool copies_constant_ranges)
+{
+	SetCopiesConstantRanges(copies_constant_ranges);
+}
+
+size_t NullRenderDevice::CountCalls(CallType type) const
+{
+	return count_if(calls_.begin(), calls_.end(), [type](const Call& call) { return call.type == type; });
+}
+
+const vector<uint8_t>& NullRenderDevice::GetBufferData(BufferHandle buffer) const
+{
+	if (!buffer || buffer.id > buffers_.size()) throw GAME_EXCEPTION(L"Unknown buffer handle.");
+	return buffers_[buffer.id - 1].data;
+}
+
+string NullRenderDevice::DumpCalls() const
+{
+	string dump;
+	char line[224];
+	for (const auto& call : calls_)
+	{
+		snprintf(line, sizeof(line), "%s handle=%u slot=%u value=%llu range=%llu,%llu indices=%u,%u,%d instances=%u,%u\n",
+			kCallNames[static_cast<int>(call.type)], call.handle, call.slot, static_cast<unsigned long long>(call.value),
+			static_cast<unsigned long long>(call.offset), static_cast<unsigned long long>(call.size),
+			call.index_count, call.start_index, call.base_vertex, call.instance_count, call.start_instance);
+		dump += line;
+	}
+
+	return dump;
+}
+
+NullRenderDevice::Buffer& NullRenderDevice::GetBuffer(BufferHandle buffer)
+{
+	if (!buffer || buffer.id > buffers_.size() || !buffers_[buffer.id - 1].live)
+		throw GAME_EXCEPTION(L"Unknown buffer handle.");
+
+	return buffers_[buffer.id - 1];
+}
+
+BufferHandle NullRenderDevice::CreateBufferImpl(const BufferDesc& desc, const void* initial_data)
+{
+	Buffer buffer;
+	buffer.desc = desc;
+	buffer.data.resize(desc.size);
+	if (initial_data) memcpy(buffer.data.data(), initial_data, desc.size);
+	buffer.live = true;
+
+	buffers_.push_back(move(buffer));
+	live_buffer_count_++;
+
+	BufferHandle handle;
+	handle.id = static_cast<uint32_t>(buffers_.size());
+
+	Call call{ CallType::kCreateBuffer };
+	call.handle = handle.id;
+	call.value = desc.size;
+	calls_.push_back(call);
+
+	return handle;
+}
+
+void NullRenderDevice::ReleaseBufferImpl(BufferHandle buffer)
+{
+	Buffer& released = GetBuffer(buffer);
+	released.live = false;
+	released.data = vector<uint8_t>();
+	live_buffer_count_--;
+
+	Call call{ CallType::kReleaseBuffer };
+	call.handle = buffer.id;
+	calls_.push_back(call);
+}
+
+ShaderHandle NullRenderDevice::CreateShaderImpl(const ShaderDesc& desc)
+{
+	ShaderHandle handle;
+	handle.id = ++shader_count_;
+
+	Call call{ CallType::kCreateShader };
+	call.handle = handle.id;
+	call.value = desc.layout_count;
+	calls_.push_back(call);
+
+	return handle;
+}
+
+SamplerHandle NullRenderDevice::CreateSamplerImpl(AddressMode mode)
+{
+	SamplerHandle handle;
+	handle.id = ++sampler_count_;
+
+	Call call{ CallType::kCreateSampler };
+	call.handle = handle.id;
+	call.value = static_cast<uint64_t>(mode);
+	calls_.push_back(call);
+
+	return handle;
+}
+
+void NullRenderDevice::UpdateBufferImpl(BufferHandle buffer, const void* data, size_t size)
+{
+	Buffer& updated = GetBuffer(buffer);
+	if (!updated.desc.dynamic || size > updated.desc.size) throw GAME_EXCEPTION(L"Invalid buffer update.");
+
+	memcpy(updated.data.data(), data, size);
+
+	Call call{ CallType::kUpdateBuffer };
+	call.handle = buffer.id;
+	call.value = size;
+	calls_.push_back(call);
+}
+
+void NullRenderDevice::WriteBufferImpl(BufferHandle buffer, size_t offset, const void* data, size_t size)
+{
+	Buffer& written = GetBuffer(buffer);
+	if (!written.desc.dynamic || offset + size > written.desc.size) throw GAME_EXCEPTION(L"Invalid buffer write.");
+
+	memcpy(written.data.data() + offset, data, size);
+
+	Call call{ CallType::kWriteBuffer };
+	call.handle = buffer.id;
+	call.value = size;
+	call.offset = offset;
+	calls_.push_back(call);
+}
+
+void NullRenderDevice::SetShaderImpl(ShaderHandle shader)
+{
+	Call call{ CallType::kSetShader };
+	call.handle = shader.id;
+	calls_.push_back(call);
+}
+
+void NullRenderDevice::SetVertexBufferImpl(BufferHandle buffer, uint32_t stride, uint32_t slot)
+{
+	Call call{ CallType::kSetVertexBuffer };
+	call.handle = buffer.id;
+	call.slot = slot;
+	call.value = stride;
+	calls_.push_back(call);
+}
+
+void NullRenderDevice::SetIndexBufferImpl(BufferHandle buffer, IndexFormat format)
+{
+	Call call{ CallType::kSetIndexBuffer };
+	call.handle = buffer.id;
+	call.value = static_cast<uint64_t>(format);
+	calls_.push_back(call);
+}
+
+void NullRenderDevice::SetConstantBufferImpl(ShaderStage stage, uint32_t slot, BufferHandle buffer,
+	size_t offset, size_t size)
+{
+	if (size && (offset % kConstantAlignment || size % kConstantAlignment || offset + size > GetBuffer(buffer).desc.size))
+		throw GAME_EXCEPTION(L"Invalid constant buffer range.");
+
+	Call call{ CallType::kSetConstantBuffer };
+	call.handle = buffer.id;
+	call.slot = slot;
+	call.value = static_cast<uint64_t>(stage);
+	call.offset = offset;
+	call.size = size;
+	calls_.push_back(call);
+}
+
+void NullRenderDevice::SetTextureImpl(uint32_t slot, TextureView* texture)
+{
+	Call call{ CallType::kSetTexture };
+	call.slot = slot;
+	call.value = reinterpret_cast<uintptr_t>(texture);
+	calls_.push_back(call);
+}
+
+void NullRenderDevice::SetSamplerImpl(uint32_t slot, SamplerHandle sampler)
+{
+	Call call{ CallType::kSetSampler };
+	call.handle = sampler.id;
+	call.slot = slot;
+	calls_.push_back(call);
+}
+
+void NullRenderDevice::DrawIndexedImpl(uint32_t index_count, uint32_t start_index, int32_t base_vertex)
+{
+	Call call{ CallType::kDrawIndexed };
+	call.index_count = index_count;
+	call.start_index = start_index;
+	call.base_vertex = base_vertex;
+	calls_.push_back(call);
+}
+
+void NullRenderDevice::DrawIndexedInstancedImpl(uint32_t index_count, uint32_t instance_count,
+	uint32_t start_index, int32_t base_vertex, uint32_t start_instance)
+{
+	Call call{ CallType::kDrawIndexedInstanced };
+	call.index_count = index_count;
+	call.start_index = start_index;
+	call.base_vertex = base_vertex;
+	call.instance_count = instance_count;
+	call.start_instance = start_instance;
+	calls_.push_back(call);
+}
+
+void NullRenderDevice::BeginFrameImpl()
+{
+	calls_.push_back(Call{ CallType::kBeginFrame });
+}
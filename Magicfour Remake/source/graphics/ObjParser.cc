@@ -0,0 +1,305 @@
+#include "graphics/ObjParser.hh"
+
+#include <algorithm>
+#include <cfloat>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+const ObjParser::Material ObjParser::kDefaultMaterial = {
+	{ 1.0f, 1.0f, 1.0f },
+	{ 1.0f, 1.0f, 1.0f },
+	{ 1.0f, 1.0f, 1.0f }
+};
+
+namespace
+{
+	// Tokenizer helpers for parsing OBJ/MTL text in place.
+	inline bool IsBlank(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	inline const char* SkipBlank(const char* it, const char* end)
+	{
+		while (it < end && IsBlank(*it)) it++;
+		return it;
+	}
+
+	inline const char* FindLineEnd(const char* it, const char* end)
+	{
+		const char* line_end = static_cast<const char*>(memchr(it, '\n', end - it));
+		return line_end ? line_end : end;
+	}
+
+	// Returns next blank-separated token in [it, end) and advances it.
+	inline string_view NextToken(const char*& it, const char* end)
+	{
+		it = SkipBlank(it, end);
+		const char* token_begin = it;
+		while (it < end && !IsBlank(*it)) it++;
+		return string_view(token_begin, it - token_begin);
+	}
+
+	inline float ParseFloat(const char*& it, const char* end)
+	{
+		it = SkipBlank(it, end);
+		if (it < end && *it == '+') it++;
+
+		float value = 0.0f;
+		auto result = from_chars(it, end, value);
+		if (result.ec != errc()) return 0.0f;
+
+		it = result.ptr;
+		return value;
+	}
+
+	// Parse an OBJ index, which is 1-based or negative (relative to the end of list).
+	// Returns -1 if there is no index.
+	inline int ParseIndex(const char*& it, const char* end, size_t list_size)
+	{
+		int value = 0;
+		auto result = from_chars(it, end, value);
+		if (result.ec != errc()) return -1;
+
+		it = result.ptr;
+		if (value < 0) return static_cast<int>(list_size) + value;
+		return value - 1;
+	}
+}
+
+void ObjParser::ParseMaterials(string_view text, MaterialMap& materials)
+{
+	const char* it = text.data();
+	const char* const end = it + text.size();
+
+	string mtl_name = "";
+	Material curr_mtl = kDefaultMaterial;
+
+	auto parse_color = [](const char*& it, const char* end) {
+		Color color;
+		color.r = ParseFloat(it, end);
+		color.g = ParseFloat(it, end);
+		color.b = ParseFloat(it, end);
+		return color;
+	};
+
+	while (it < end)
+	{
+		const char* line_end = FindLineEnd(it, end);
+		string_view keyword = NextToken(it, line_end);
+
+		if (keyword == "newmtl")
+		{
+			if (mtl_name.size() > 0)
+			{
+				materials[mtl_name] = curr_mtl;
+				curr_mtl = kDefaultMaterial;
+			}
+			mtl_name = string(NextToken(it, line_end));
+		}
+		else if (keyword == "Ka") curr_mtl.ambient = parse_color(it, line_end);
+		else if (keyword == "Kd") curr_mtl.diffuse = parse_color(it, line_end);
+		else if (keyword == "Ks") curr_mtl.specular = parse_color(it, line_end);
+
+		it = line_end + 1;
+	}
+
+	if (mtl_name.size() > 0)
+	{
+		materials[mtl_name] = curr_mtl;
+	}
+}
+
+vector<string_view> ObjParser::FindMaterialLibraries(string_view text)
+{
+	vector<string_view> libraries;
+
+	const char* it = text.data();
+	const char* const end = it + text.size();
+	while (it < end)
+	{
+		const char* line_end = FindLineEnd(it, end);
+		if (NextToken(it, line_end) == "mtllib") libraries.push_back(NextToken(it, line_end));
+		it = line_end + 1;
+	}
+
+	return libraries;
+}
+
+bool ObjParser::ParseModel(string_view text, const MaterialLoader& load_materials, Mesh& mesh)
+{
+	struct Vertex { float x, y, z; };
+	vector<Vertex> v_list, vt_list, vn_list;
+	MaterialMap materials;
+
+	const char* const begin = text.data();
+	const char* const end = begin + text.size();
+
+	// Counting pass, to reserve all arrays before parsing.
+	size_t v_count = 0, vt_count = 0, vn_count = 0, corner_count = 0;
+	for (const char* it = begin; it < end; )
+	{
+		const char* line_end = FindLineEnd(it, end);
+		it = SkipBlank(it, line_end);
+
+		if (line_end - it >= 2)
+		{
+			if (it[0] == 'v' && IsBlank(it[1])) v_count++;
+			else if (it[0] == 'v' && it[1] == 't') vt_count++;
+			else if (it[0] == 'v' && it[1] == 'n') vn_count++;
+			else if (it[0] == 'f' && IsBlank(it[1]))
+			{
+				// A face of n vertices is triangulated into n - 2 triangles.
+				size_t face_vertices = 0;
+				for (it++; NextToken(it, line_end).size() > 0; ) face_vertices++;
+				if (face_vertices >= 3) corner_count += (face_vertices - 2) * 3;
+			}
+		}
+		it = line_end + 1;
+	}
+
+	v_list.reserve(v_count);
+	vt_list.reserve(vt_count);
+	vn_list.reserve(vn_count);
+	mesh.corners.clear();
+	mesh.corners.reserve(corner_count);
+	mesh.material_ranges.clear();
+
+	// The bounding volume will be a box by default.
+	// To calculate the bounding box, we need to find the min and max coordinates.
+	float* const min = mesh.min;
+	float* const max = mesh.max;
+	min[0] = min[1] = min[2] = FLT_MAX;
+	max[0] = max[1] = max[2] = -FLT_MAX;
+
+	vector<Corner> face_v;
+	for (const char* it = begin; it < end; )
+	{
+		const char* line_end = FindLineEnd(it, end);
+		string_view keyword = NextToken(it, line_end);
+
+		if (keyword.empty() || keyword[0] == '#') {} // case: empty lines and comments
+		else if (keyword == "v")
+		{
+			float x = ParseFloat(it, line_end);
+			float y = ParseFloat(it, line_end);
+			float z = ParseFloat(it, line_end);
+			v_list.push_back({ x, y, z });
+
+			// Update the min and max coordinates.
+			min[0] = (std::min)(min[0], x); min[1] = (std::min)(min[1], y); min[2] = (std::min)(min[2], z);
+			max[0] = (std::max)(max[0], x); max[1] = (std::max)(max[1], y); max[2] = (std::max)(max[2], z);
+		}
+		else if (keyword == "vt")
+		{
+			float x = ParseFloat(it, line_end);
+			float y = ParseFloat(it, line_end);
+			vt_list.push_back({ x, 1 - y, 0.0f });
+		}
+		else if (keyword == "vn")
+		{
+			float x = ParseFloat(it, line_end);
+			float y = ParseFloat(it, line_end);
+			float z = ParseFloat(it, line_end);
+			vn_list.push_back({ x, y, z });
+		}
+		else if (keyword == "f")
+		{
+			face_v.clear();
+			bool has_all_normals = true;
+
+			for (string_view token = NextToken(it, line_end); !token.empty(); token = NextToken(it, line_end))
+			{
+				const char* token_it = token.data();
+				const char* const token_end = token_it + token.size();
+
+				Corner point = {};
+
+				const int v_index = ParseIndex(token_it, token_end, v_list.size());
+				if (v_index < 0 || v_index >= (int)v_list.size()) return false;
+
+				point.x = v_list[v_index].x;
+				point.y = v_list[v_index].y;
+				point.z = v_list[v_index].z;
+
+				int vt_index = -1, vn_index = -1;
+				if (token_it < token_end && *token_it == '/')
+				{
+					token_it++;
+					vt_index = ParseIndex(token_it, token_end, vt_list.size());
+
+					if (token_it < token_end && *token_it == '/')
+					{
+						token_it++;
+						vn_index = ParseIndex(token_it, token_end, vn_list.size());
+					}
+				}
+
+				if (0 <= vt_index && vt_index < (int)vt_list.size())
+				{
+					point.tu = vt_list[vt_index].x;
+					point.tv = vt_list[vt_index].y;
+				}
+
+				if (0 <= vn_index && vn_index < (int)vn_list.size())
+				{
+					point.nx = vn_list[vn_index].x;
+					point.ny = vn_list[vn_index].y;
+					point.nz = vn_list[vn_index].z;
+				}
+				else has_all_normals = false;
+
+				face_v.push_back(point);
+			}
+
+			if (face_v.size() < 3)
+			{
+				it = line_end + 1;
+				continue;
+			}
+
+			if (!has_all_normals)
+			{
+				// If normal vector is not defined, calculate it from first three points.
+				const float v1[3] = { face_v[1].x - face_v[0].x, face_v[1].y - face_v[0].y, face_v[1].z - face_v[0].z };
+				const float v2[3] = { face_v[2].x - face_v[0].x, face_v[2].y - face_v[0].y, face_v[2].z - face_v[0].z };
+				float normal[3] = { v1[1] * v2[2] - v1[2] * v2[1], v1[2] * v2[0] - v1[0] * v2[2], v1[0] * v2[1] - v1[1] * v2[0] };
+
+				const float length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+				if (length <= 0.001f) normal[0] = 0, normal[1] = 1, normal[2] = 0;
+				else normal[0] /= length, normal[1] /= length, normal[2] /= length;
+
+				// And insert it.
+				for (auto& fv : face_v) fv.nx = normal[0], fv.ny = normal[1], fv.nz = normal[2];
+			}
+
+			for (size_t i = 0; i < face_v.size() - 2; i++)
+			{
+				mesh.corners.push_back(face_v[0]);
+				mesh.corners.push_back(face_v[i + 1]);
+				mesh.corners.push_back(face_v[i + 2]);
+			}
+		}
+		else if (keyword == "mtllib")
+		{
+			load_materials(NextToken(it, line_end), materials);
+		}
+		else if (keyword == "usemtl")
+		{
+			auto material = materials.find(string(NextToken(it, line_end)));
+			if (material != materials.end())
+			{
+				mesh.material_ranges.emplace_back(material->second, (int)mesh.corners.size());
+			}
+		}
+
+		it = line_end + 1;
+	}
+
+	if (mesh.material_ranges.empty()) mesh.material_ranges.emplace_back(kDefaultMaterial, 0);
+
+	return true;
+}
@@ -0,0 +1,139 @@
+#include "graphics/RenderDevice.hh"
+
+template<typename T>
+bool RenderDevice::Bind(Cached<T>* slots, uint32_t slot, const T& bound, size_t& counter)
+{
+	if (slot < kCachedSlots && !slots[slot].Set(bound))
+	{
+		stats_.redundant_binds++;
+		return false;
+	}
+
+	counter++;
+	return true;
+}
+
+namespace
+{
+	template<typename Binding>
+	void Forget(Binding& binding, BufferHandle buffer)
+	{
+		if (binding.value.buffer == buffer) binding.known = false;
+	}
+}
+
+void RenderDevice::ForgetBuffer(BufferHandle buffer)
+{
+	Forget(bound_.index_buffer, buffer);
+	for (auto& binding : bound_.vertex_buffers) Forget(binding, buffer);
+	ForgetConstantBuffer(buffer);
+}
+
+void RenderDevice::ForgetConstantBuffer(BufferHandle buffer)
+{
+	for (auto& stage : bound_.constant_buffers)
+		for (auto& binding : stage) Forget(binding, buffer);
+}
+
+BufferHandle RenderDevice::CreateBuffer(const BufferDesc& desc, const void* initial_data)
+{
+	if (initial_data) stats_.bytes_uploaded += desc.size;
+	return CreateBufferImpl(desc, initial_data);
+}
+
+void RenderDevice::ReleaseBuffer(BufferHandle buffer)
+{
+	if (!buffer) return;
+
+	ForgetBuffer(buffer);
+	ReleaseBufferImpl(buffer);
+}
+
+ShaderHandle RenderDevice::CreateShader(const ShaderDesc& desc)
+{
+	return CreateShaderImpl(desc);
+}
+
+SamplerHandle RenderDevice::CreateSampler(AddressMode mode)
+{
+	return CreateSamplerImpl(mode);
+}
+
+void RenderDevice::UpdateBuffer(BufferHandle buffer, const void* data, size_t size)
+{
+	stats_.buffer_updates++;
+	stats_.bytes_uploaded += size;
+	if (copies_constant_ranges_) ForgetConstantBuffer(buffer);
+	UpdateBufferImpl(buffer, data, size);
+}
+
+void RenderDevice::WriteBuffer(BufferHandle buffer, size_t offset, const void* data, size_t size)
+{
+	stats_.buffer_updates++;
+	stats_.bytes_uploaded += size;
+	if (copies_constant_ranges_) ForgetConstantBuffer(buffer);
+	WriteBufferImpl(buffer, offset, data, size);
+}
+
+void RenderDevice::SetShader(ShaderHandle shader)
+{
+	if (Bind(&bound_.shader, 0, shader, stats_.shader_binds)) SetShaderImpl(shader);
+}
+
+void RenderDevice::SetVertexBuffer(BufferHandle buffer, uint32_t stride, uint32_t slot)
+{
+	if (Bind(bound_.vertex_buffers, slot, BufferBinding{ buffer, 0, stride }, stats_.buffer_binds))
+		SetVertexBufferImpl(buffer, stride, slot);
+}
+
+void RenderDevice::SetIndexBuffer(BufferHandle buffer, IndexFormat format)
+{
+	const BufferBinding binding{ buffer, 0, static_cast<size_t>(format) };
+	if (Bind(&bound_.index_buffer, 0, binding, stats_.buffer_binds)) SetIndexBufferImpl(buffer, format);
+}
+
+void RenderDevice::SetConstantBuffer(ShaderStage stage, uint32_t slot, BufferHandle buffer)
+{
+	SetConstantBufferRange(stage, slot, buffer, 0, 0);
+}
+
+void RenderDevice::SetConstantBufferRange(ShaderStage stage, uint32_t slot, BufferHandle buffer, size_t offset, size_t size)
+{
+	Cached<BufferBinding>* slots = bound_.constant_buffers[static_cast<int>(stage)];
+	if (Bind(slots, slot, BufferBinding{ buffer, offset, size }, stats_.constant_buffer_binds))
+		SetConstantBufferImpl(stage, slot, buffer, offset, size);
+}
+
+void RenderDevice::SetTexture(uint32_t slot, TextureView* texture)
+{
+	if (Bind(bound_.textures, slot, texture, stats_.texture_binds)) SetTextureImpl(slot, texture);
+}
+
+void RenderDevice::SetSampler(uint32_t slot, SamplerHandle sampler)
+{
+	if (Bind(bound_.samplers, slot, sampler, stats_.sampler_binds)) SetSamplerImpl(slot, sampler);
+}
+
+void RenderDevice::DrawIndexed(uint32_t index_count, uint32_t start_index, int32_t base_vertex)
+{
+	stats_.draws++;
+	stats_.instances++;
+	stats_.indices += index_count;
+	DrawIndexedImpl(index_count, start_index, base_vertex);
+}
+
+void RenderDevice::DrawIndexedInstanced(uint32_t index_count, uint32_t instance_count,
+	uint32_t start_index, int32_t base_vertex, uint32_t start_instance)
+{
+	stats_.draws++;
+	stats_.instances += instance_count;
+	stats_.indices += size_t(index_count) * instance_count;
+	DrawIndexedInstancedImpl(index_count, instance_count, start_index, base_vertex, start_instance);
+}
+
+void RenderDevice::BeginFrame()
+{
+	stats_ = RenderStats();
+	bound_ = BoundState();
+	BeginFrameImpl();
+}
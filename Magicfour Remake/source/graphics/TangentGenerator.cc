@@ -0,0 +1,208 @@
+#include "graphics/TangentGenerator.hh"
+
+#include "util/Hash.hh"
+#include "util/ThreadPool.hh"
+
+#include <DirectXMath.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+using namespace DirectX;
+
+namespace
+{
+	constexpr size_t kTrianglesPerChunk = 2048;
+	constexpr size_t kFramesPerChunk = 4096;
+
+	// Below this, edges or texture coordinates are considered collapsed.
+	constexpr float kEpsilon = 1e-12f;
+
+	template <typename T>
+	inline T* GetAttribute(T* base, size_t index, size_t stride)
+	{
+		using Byte = conditional_t<is_const_v<T>, const char, char>;
+		return reinterpret_cast<T*>(reinterpret_cast<Byte*>(base) + index * stride);
+	}
+
+	inline XMVECTOR LoadFloat3(const float* attribute)
+	{
+		return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(attribute));
+	}
+
+	inline XMVECTOR LoadFloat2(const float* attribute)
+	{
+		return XMLoadFloat2(reinterpret_cast<const XMFLOAT2*>(attribute));
+	}
+
+	// Any unit vector perpendicular to a unit vector.
+	inline XMVECTOR GetPerpendicular(FXMVECTOR unit)
+	{
+		const XMVECTOR axis = (fabsf(XMVectorGetX(unit)) < 0.9f) ? g_XMIdentityR0 : g_XMIdentityR1;
+		return XMVector3Normalize(XMVector3Cross(unit, axis));
+	}
+
+	// What identifies a frame. Corners with the same key get the same tangent and binormal.
+	struct FrameKey
+	{
+		float position[3];
+		float texture[2];
+		float normal[3];
+		int32_t handedness;
+	};
+}
+
+TangentGenerator::Stats TangentGenerator::Generate(const Corners& corners)
+{
+	const size_t triangle_count = corners.count / 3;
+
+	// Face tangent and binormal of each corner, weighted by its angle.
+	vector<XMFLOAT3> corner_tangents(corners.count), corner_binormals(corners.count);
+	vector<uint8_t> degenerate(triangle_count);
+
+	ThreadPool::GetInstance().ParallelFor(triangle_count, kTrianglesPerChunk, [&](size_t begin, size_t end) {
+		for (size_t triangle = begin; triangle < end; triangle++)
+		{
+			const size_t first = triangle * 3;
+
+			XMVECTOR position[3], texture[3];
+			for (size_t k = 0; k < 3; k++)
+			{
+				position[k] = LoadFloat3(GetAttribute(corners.position, first + k, corners.stride));
+				texture[k] = LoadFloat2(GetAttribute(corners.texture, first + k, corners.stride));
+			}
+
+			const XMVECTOR edge1 = XMVectorSubtract(position[1], position[0]);
+			const XMVECTOR edge2 = XMVectorSubtract(position[2], position[0]);
+			const XMFLOAT2 uv1 = { XMVectorGetX(texture[1]) - XMVectorGetX(texture[0]), XMVectorGetY(texture[1]) - XMVectorGetY(texture[0]) };
+			const XMFLOAT2 uv2 = { XMVectorGetX(texture[2]) - XMVectorGetX(texture[0]), XMVectorGetY(texture[2]) - XMVectorGetY(texture[0]) };
+
+			const float uv_area = uv1.x * uv2.y - uv2.x * uv1.y;
+			const float area = XMVectorGetX(XMVector3LengthSq(XMVector3Cross(edge1, edge2)));
+
+			if (fabsf(uv_area) <= kEpsilon || area <= kEpsilon)
+			{
+				degenerate[triangle] = 1;
+				for (size_t k = 0; k < 3; k++)
+				{
+					corner_tangents[first + k] = XMFLOAT3(0.0f, 0.0f, 0.0f);
+					corner_binormals[first + k] = XMFLOAT3(0.0f, 0.0f, 0.0f);
+				}
+				continue;
+			}
+
+			// Solve edge = du * tangent + dv * binormal for both edges.
+			const float inv_uv_area = 1.0f / uv_area;
+			const XMVECTOR tangent = XMVector3Normalize(XMVectorScale(
+				XMVectorSubtract(XMVectorScale(edge1, uv2.y), XMVectorScale(edge2, uv1.y)), inv_uv_area));
+			const XMVECTOR binormal = XMVector3Normalize(XMVectorScale(
+				XMVectorSubtract(XMVectorScale(edge2, uv1.x), XMVectorScale(edge1, uv2.x)), inv_uv_area));
+
+			for (size_t k = 0; k < 3; k++)
+			{
+				const XMVECTOR to_next = XMVectorSubtract(position[(k + 1) % 3], position[k]);
+				const XMVECTOR to_prev = XMVectorSubtract(position[(k + 2) % 3], position[k]);
+				const XMVECTOR angle = XMVector3AngleBetweenVectors(to_next, to_prev);
+
+				XMStoreFloat3(&corner_tangents[first + k], XMVectorMultiply(tangent, angle));
+				XMStoreFloat3(&corner_binormals[first + k], XMVectorMultiply(binormal, angle));
+			}
+		}
+	});
+
+	// Group corners into frames. Mirrored texture coordinates give a separate frame,
+	// as their binormal points the other way.
+	auto hasher = [](const FrameKey& key) { return static_cast<size_t>(HashBytes(&key, sizeof(key))); };
+	auto equal = [](const FrameKey& a, const FrameKey& b) { return memcmp(&a, &b, sizeof(a)) == 0; };
+	unordered_map<FrameKey, uint32_t, decltype(hasher), decltype(equal)> frame_of_key(corners.count, hasher, equal);
+
+	vector<uint32_t> corner_frames(corners.count);
+	vector<XMFLOAT3> frame_tangents, frame_binormals, frame_normals;
+	vector<int32_t> frame_handedness;
+
+	for (size_t i = 0; i < corners.count; i++)
+	{
+		const float* normal = GetAttribute(corners.normal, i, corners.stride);
+
+		FrameKey key;
+		memcpy(key.position, GetAttribute(corners.position, i, corners.stride), sizeof(key.position));
+		memcpy(key.texture, GetAttribute(corners.texture, i, corners.stride), sizeof(key.texture));
+		memcpy(key.normal, normal, sizeof(key.normal));
+
+		const XMVECTOR tangent = XMLoadFloat3(&corner_tangents[i]);
+		const XMVECTOR binormal = XMLoadFloat3(&corner_binormals[i]);
+		const float handedness = XMVectorGetX(XMVector3Dot(XMVector3Cross(LoadFloat3(normal), tangent), binormal));
+		key.handedness = (handedness < 0.0f) ? -1 : 1;
+
+		auto result = frame_of_key.emplace(key, static_cast<uint32_t>(frame_tangents.size()));
+		if (result.second)
+		{
+			frame_tangents.push_back(corner_tangents[i]);
+			frame_binormals.push_back(corner_binormals[i]);
+			frame_normals.push_back(XMFLOAT3(key.normal));
+			frame_handedness.push_back(key.handedness);
+		}
+		else
+		{
+			const uint32_t frame = result.first->second;
+			XMStoreFloat3(&frame_tangents[frame], XMVectorAdd(XMLoadFloat3(&frame_tangents[frame]), tangent));
+			XMStoreFloat3(&frame_binormals[frame], XMVectorAdd(XMLoadFloat3(&frame_binormals[frame]), binormal));
+		}
+
+		corner_frames[i] = result.first->second;
+	}
+
+	// Gram-Schmidt against the normal; the binormal is rebuilt from the normal and tangent.
+	const size_t frame_count = frame_tangents.size();
+	ThreadPool::GetInstance().ParallelFor(frame_count, kFramesPerChunk, [&](size_t begin, size_t end) {
+		for (size_t frame = begin; frame < end; frame++)
+		{
+			XMVECTOR normal = XMLoadFloat3(&frame_normals[frame]);
+			XMVECTOR tangent = XMLoadFloat3(&frame_tangents[frame]);
+			XMVECTOR binormal = XMLoadFloat3(&frame_binormals[frame]);
+
+			if (XMVectorGetX(XMVector3LengthSq(normal)) <= kEpsilon)
+			{
+				// Without a normal, the summed vectors are all there is.
+				if (XMVectorGetX(XMVector3LengthSq(tangent)) <= kEpsilon) tangent = g_XMIdentityR0;
+				if (XMVectorGetX(XMVector3LengthSq(binormal)) <= kEpsilon) binormal = g_XMIdentityR1;
+
+				XMStoreFloat3(&frame_tangents[frame], XMVector3Normalize(tangent));
+				XMStoreFloat3(&frame_binormals[frame], XMVector3Normalize(binormal));
+				continue;
+			}
+
+			normal = XMVector3Normalize(normal);
+			tangent = XMVectorSubtract(tangent, XMVectorMultiply(normal, XMVector3Dot(normal, tangent)));
+
+			// Only degenerate triangles around this vertex, or a tangent along the normal.
+			if (XMVectorGetX(XMVector3LengthSq(tangent)) <= kEpsilon) tangent = GetPerpendicular(normal);
+			else tangent = XMVector3Normalize(tangent);
+
+			binormal = XMVectorScale(XMVector3Cross(normal, tangent), static_cast<float>(frame_handedness[frame]));
+
+			XMStoreFloat3(&frame_tangents[frame], tangent);
+			XMStoreFloat3(&frame_binormals[frame], binormal);
+		}
+	});
+
+	ThreadPool::GetInstance().ParallelFor(corners.count, kTrianglesPerChunk * 3, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			memcpy(GetAttribute(corners.tangent, i, corners.stride), &frame_tangents[corner_frames[i]], sizeof(XMFLOAT3));
+			memcpy(GetAttribute(corners.binormal, i, corners.stride), &frame_binormals[corner_frames[i]], sizeof(XMFLOAT3));
+		}
+	});
+
+	Stats stats = {};
+	stats.triangle_count = triangle_count;
+	stats.frame_count = frame_count;
+	for (uint8_t is_degenerate : degenerate) stats.degenerate_triangle_count += is_degenerate;
+
+	return stats;
+}
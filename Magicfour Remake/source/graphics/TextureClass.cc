@@ -3,6 +3,9 @@
 #include <string>
 
 #include "core/GameException.hh"
+#include "graphics/TextureCooker.hh"
+#include "util/FileSystem.hh"
+#include "util/Hash.hh"
 #include "../third-party/DirectXTex.h"
 
 using namespace DirectX;
@@ -14,35 +17,78 @@ IMAGE_FILE_EXTENSION getExtension(const std::wstring filename)
 	if (extension == L".jpg" || extension == L".jpeg") return FILE_EXTENSION_JPEG;
 	if (extension == L".png") return FILE_EXTENSION_PNG;
 	if (extension == L".tga") return FILE_EXTENSION_TGA;
+	if (extension == L".dds") return FILE_EXTENSION_DDS;
 
 	return FILE_EXTENSION_UNKNOWN;
 }
 
 
-TextureClass::TextureClass(ID3D11Device* device, const wchar_t* filename)
+std::shared_ptr<ScratchImage> TextureClass::LoadImageFile(const std::wstring& filename, bool prefer_cooked)
 {
 	HRESULT hResult;
-	ScratchImage image;
+	auto image = std::make_shared<ScratchImage>();
+
+	// Cooked file has the whole mip chain already compressed, so nothing is decoded.
+	if (prefer_cooked && getExtension(filename) != FILE_EXTENSION_DDS && TextureCooker::IsCookedUpToDate(filename))
+	{
+		return LoadImageFile(TextureCooker::GetCookedFilename(filename), false);
+	}
+
+	// Paths are ASCII, as in the resource XML file.
+	FileView file = FileSystem::Open(std::string(filename.begin(), filename.end()));
 
 	switch (getExtension(filename))
 	{
 	case FILE_EXTENSION_JPEG:
 	case FILE_EXTENSION_PNG:
-		hResult = LoadFromWICFile(filename, WIC_FLAGS_NONE, nullptr, image);
-		if (FAILED(hResult)) throw GAME_EXCEPTION(L"Failed to Read " + std::wstring(filename));
+		hResult = LoadFromWICMemory(file.GetData(), file.GetSize(), WIC_FLAGS_NONE, nullptr, *image);
+		if (FAILED(hResult)) throw GAME_EXCEPTION(L"Failed to Read " + filename);
 		break;
 
 	case FILE_EXTENSION_TGA:
-		hResult = LoadFromTGAFile(filename, TGA_FLAGS_NONE, nullptr, image);
-		if (FAILED(hResult)) throw GAME_EXCEPTION(L"Failed to Read " + std::wstring(filename));
+		hResult = LoadFromTGAMemory(file.GetData(), file.GetSize(), TGA_FLAGS_NONE, nullptr, *image);
+		if (FAILED(hResult)) throw GAME_EXCEPTION(L"Failed to Read " + filename);
+		break;
+
+	case FILE_EXTENSION_DDS:
+		hResult = LoadFromDDSMemory(file.GetData(), file.GetSize(), DDS_FLAGS_NONE, nullptr, *image);
+		if (FAILED(hResult)) throw GAME_EXCEPTION(L"Failed to Read " + filename);
 		break;
 	}
 
+	return image;
+}
+
+uint64_t TextureClass::HashImage(const ScratchImage& image)
+{
+	const TexMetadata& metadata = image.GetMetadata();
+	const uint64_t description[] = {
+		metadata.width, metadata.height, metadata.depth, metadata.arraySize, metadata.mipLevels,
+		metadata.miscFlags, metadata.miscFlags2,
+		static_cast<uint64_t>(metadata.format), static_cast<uint64_t>(metadata.dimension)
+	};
+
+	return HashBytes(image.GetPixels(), image.GetPixelsSize(), HashBytes(description, sizeof(description)));
+}
+
+TextureClass::TextureClass(ID3D11Device* device, const wchar_t* filename)
+	: TextureClass(device, *LoadImageFile(filename), filename)
+{
+
+}
+
+TextureClass::TextureClass(ID3D11Device* device, const ScratchImage& image, const std::wstring& filename)
+{
+	HRESULT hResult;
+
 	width_ = image.GetMetadata().width;
 	height_ = image.GetMetadata().height;
 
+	// Every mip and array slice is uploaded as laid out in the image.
+	gpu_bytes_ = image.GetPixelsSize();
+
 	hResult = CreateShaderResourceView(device, image.GetImages(), image.GetImageCount(), image.GetMetadata(), textureView_.GetAddressOf());
-	if (FAILED(hResult)) throw GAME_EXCEPTION(L"Failed to create Shader Resource View of " + std::wstring(filename));
+	if (FAILED(hResult)) throw GAME_EXCEPTION(L"Failed to create Shader Resource View of " + filename);
 }
 
 TextureClass::TextureClass(ID3D11Device* device, const std::string& filename)
@@ -55,9 +101,9 @@ TextureClass::~TextureClass()
 {
 }
 
-ID3D11ShaderResourceView* TextureClass::GetTexture()
+TextureView* TextureClass::GetTexture()
 {
-	return textureView_.Get();
+	return reinterpret_cast<TextureView*>(textureView_.Get());
 }
 
 int TextureClass::GetWidth()
@@ -0,0 +1,171 @@
+#include "graphics/TextureCooker.hh"
+
+#include "graphics/TextureClass.hh"
+#include "core/GameException.hh"
+#include "util/FileSystem.hh"
+#include "util/ResourceManifest.hh"
+#include "util/ThreadPool.hh"
+#include "../third-party/DirectXTex.h"
+
+#include <cmath>
+#include <filesystem>
+#include <future>
+#include <unordered_set>
+
+using namespace std;
+using namespace DirectX;
+
+wstring TextureCooker::GetCookedFilename(const wstring& source_filename)
+{
+	return source_filename + L".dds";
+}
+
+bool TextureCooker::IsCookedUpToDate(const wstring& source_filename)
+{
+	// Only up-to-date cooked files are packed into the archive.
+	const wstring cooked_filename = GetCookedFilename(source_filename);
+	if (FileSystem::IsInArchive(string(cooked_filename.begin(), cooked_filename.end()))) return true;
+
+	error_code error;
+	const auto cooked_time = filesystem::last_write_time(cooked_filename, error);
+	if (error) return false;
+
+	// Without the source, the cooked file is all we have.
+	const auto source_time = filesystem::last_write_time(source_filename, error);
+	if (error) return true;
+
+	return cooked_time >= source_time;
+}
+
+DXGI_FORMAT TextureCooker::ChooseFormat(const ScratchImage& image, TextureUsage usage, bool high_quality)
+{
+	if (usage == TextureUsage::kNormal) return DXGI_FORMAT_BC5_UNORM;
+	if (high_quality) return DXGI_FORMAT_BC7_UNORM;
+	if (!image.IsAlphaAllOpaque()) return DXGI_FORMAT_BC3_UNORM;
+	return DXGI_FORMAT_BC1_UNORM;
+}
+
+float TextureCooker::GetErrorThreshold(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC3_UNORM:
+		return 28.0f;
+
+	case DXGI_FORMAT_BC5_UNORM:
+		return 32.0f;
+
+	case DXGI_FORMAT_BC7_UNORM:
+		return 34.0f;
+
+	default: // Uncompressed
+		return 0.0f;
+	}
+}
+
+TextureCooker::CookResult TextureCooker::Cook(const wstring& source_filename, TextureUsage usage, bool high_quality)
+{
+	HRESULT hResult;
+
+	auto source = TextureClass::LoadImageFile(source_filename, false);
+
+	// Encoders and the error metric work on 8-bit RGBA.
+	ScratchImage rgba;
+	if (source->GetMetadata().format != DXGI_FORMAT_R8G8B8A8_UNORM)
+	{
+		hResult = Convert(source->GetImages(), source->GetImageCount(), source->GetMetadata(),
+			DXGI_FORMAT_R8G8B8A8_UNORM, TEX_FILTER_DEFAULT, TEX_THRESHOLD_DEFAULT, rgba);
+		if (FAILED(hResult)) throw GAME_EXCEPTION(L"Failed to convert " + source_filename);
+	}
+	else rgba = move(*source);
+	source.reset();
+
+	CookResult result = {};
+	result.source_filename = source_filename;
+	result.width = rgba.GetMetadata().width;
+	result.height = rgba.GetMetadata().height;
+	result.format = ChooseFormat(rgba, usage, high_quality);
+
+	// Block-compressed textures need the top level to be a multiple of 4.
+	if (result.width % 4 != 0 || result.height % 4 != 0) result.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+
+	ScratchImage mip_chain;
+	hResult = GenerateMipMaps(rgba.GetImages(), rgba.GetImageCount(), rgba.GetMetadata(),
+		TEX_FILTER_DEFAULT, 0, mip_chain);
+	if (FAILED(hResult)) throw GAME_EXCEPTION(L"Failed to generate mipmaps of " + source_filename);
+
+	result.mip_levels = mip_chain.GetMetadata().mipLevels;
+
+	ScratchImage compressed;
+	const ScratchImage* cooked = &mip_chain;
+	if (result.format != DXGI_FORMAT_R8G8B8A8_UNORM)
+	{
+		hResult = Compress(mip_chain.GetImages(), mip_chain.GetImageCount(), mip_chain.GetMetadata(),
+			result.format, TEX_COMPRESS_PARALLEL, TEX_THRESHOLD_DEFAULT, compressed);
+		if (FAILED(hResult)) throw GAME_EXCEPTION(L"Failed to compress " + source_filename);
+
+		cooked = &compressed;
+
+		// Decode the top level again and measure the error against the source.
+		ScratchImage decoded;
+		hResult = Decompress(*compressed.GetImage(0, 0, 0), DXGI_FORMAT_R8G8B8A8_UNORM, decoded);
+		if (FAILED(hResult)) throw GAME_EXCEPTION(L"Failed to decompress " + source_filename);
+
+		CMSE_FLAGS flags = CMSE_DEFAULT;
+		if (result.format == DXGI_FORMAT_BC5_UNORM) flags = static_cast<CMSE_FLAGS>(CMSE_IGNORE_BLUE | CMSE_IGNORE_ALPHA);
+		else if (result.format == DXGI_FORMAT_BC1_UNORM) flags = CMSE_IGNORE_ALPHA;
+
+		float mse = 0.0f;
+		hResult = ComputeMSE(*rgba.GetImage(0, 0, 0), *decoded.GetImage(0, 0, 0), mse, nullptr, flags);
+		if (FAILED(hResult)) throw GAME_EXCEPTION(L"Failed to measure error of " + source_filename);
+
+		result.psnr = (mse > 0.0f) ? 10.0f * log10f(1.0f / mse) : 99.0f;
+	}
+	else result.psnr = 99.0f;
+
+	result.accepted = result.psnr >= GetErrorThreshold(result.format);
+	if (!result.accepted) return result;
+
+	hResult = SaveToDDSFile(cooked->GetImages(), cooked->GetImageCount(), cooked->GetMetadata(),
+		DDS_FLAGS_NONE, GetCookedFilename(source_filename).c_str());
+	if (FAILED(hResult)) throw GAME_EXCEPTION(L"Failed to write " + GetCookedFilename(source_filename));
+
+	return result;
+}
+
+vector<TextureCooker::CookResult> TextureCooker::CookFromManifest(const ResourceManifest& manifest, bool high_quality)
+{
+	const auto& texture_nodes = manifest.GetNodes("Texture");
+
+	// Cook each source once; if any model uses it as a normal map, it is cooked as one.
+	vector<pair<wstring, TextureUsage> > sources;
+	unordered_set<string> normal_maps;
+	for (const auto& node : texture_nodes)
+	{
+		if (node.get_attr("type") == "normal") normal_maps.insert(node.get_required_attr("src"));
+	}
+
+	unordered_set<string> visited;
+	for (const auto& node : texture_nodes)
+	{
+		const string src = node.get_required_attr("src");
+		if (!visited.insert(src).second) continue;
+
+		const TextureUsage usage = normal_maps.count(src) ? TextureUsage::kNormal : TextureUsage::kColor;
+		sources.emplace_back(wstring(src.begin(), src.end()), usage);
+	}
+
+	vector<future<CookResult> > cooking;
+	for (const auto& source : sources)
+	{
+		cooking.push_back(ThreadPool::GetInstance().Submit([source, high_quality]() {
+			return Cook(source.first, source.second, high_quality);
+		}));
+	}
+
+	vector<CookResult> results;
+	for (auto& result : cooking) results.push_back(result.get());
+
+	return results;
+}
@@ -0,0 +1,94 @@
+#include "graphics/WorldMatrix.hh"
+
+using namespace DirectX;
+
+namespace
+{
+	// Off-diagonal lanes of the 3x3 rows.
+	const XMVECTORU32 kOffDiagonal[3] = {
+		{ { { 0, 0xFFFFFFFF, 0xFFFFFFFF, 0 } } },
+		{ { { 0xFFFFFFFF, 0, 0xFFFFFFFF, 0 } } },
+		{ { { 0xFFFFFFFF, 0xFFFFFFFF, 0, 0 } } },
+	};
+}
+
+WorldMatrix::Kind WorldMatrix::Classify(FXMMATRIX world)
+{
+	// The last column must be (0, 0, 0, 1) for the translation to sit in the last row alone.
+	if (XMVectorGetW(world.r[0]) != 0.0f || XMVectorGetW(world.r[1]) != 0.0f ||
+		XMVectorGetW(world.r[2]) != 0.0f || XMVectorGetW(world.r[3]) != 1.0f)
+		return Kind::kGeneral;
+
+	// Any off-diagonal bit but the sign makes it more than a scale.
+	XMVECTOR off_diagonal = XMVectorAndInt(world.r[0], kOffDiagonal[0]);
+	off_diagonal = XMVectorOrInt(off_diagonal, XMVectorAndInt(world.r[1], kOffDiagonal[1]));
+	off_diagonal = XMVectorOrInt(off_diagonal, XMVectorAndInt(world.r[2], kOffDiagonal[2]));
+
+	return XMVector4EqualInt(XMVectorAbs(off_diagonal), XMVectorZero()) ? Kind::kScaleTranslate : Kind::kAffine;
+}
+
+XMMATRIX WorldMatrix::Concatenate(FXMMATRIX world, Kind kind, CXMMATRIX vp)
+{
+	XMMATRIX result;
+	switch (kind)
+	{
+	case Kind::kScaleTranslate:
+		result.r[0] = XMVectorMultiply(XMVectorSplatX(world.r[0]), vp.r[0]);
+		result.r[1] = XMVectorMultiply(XMVectorSplatY(world.r[1]), vp.r[1]);
+		result.r[2] = XMVectorMultiply(XMVectorSplatZ(world.r[2]), vp.r[2]);
+		break;
+
+	case Kind::kAffine:
+		result.r[0] = XMVector3TransformNormal(world.r[0], vp);
+		result.r[1] = XMVector3TransformNormal(world.r[1], vp);
+		result.r[2] = XMVector3TransformNormal(world.r[2], vp);
+		break;
+
+	default:
+		return XMMatrixMultiply(world, vp);
+	}
+
+	result.r[3] = XMVector3Transform(world.r[3], vp);
+	return result;
+}
+
+XMMATRIX WorldMatrix::NormalMatrix(FXMMATRIX world, Kind kind)
+{
+	XMMATRIX result;
+	switch (kind)
+	{
+	case Kind::kScaleTranslate:
+	{
+		// The inverse of a scale is the reciprocal scale, which is its own transpose.
+		const XMVECTOR scale = XMVectorAdd(XMVectorAdd(world.r[0], world.r[1]), world.r[2]);
+		const XMVECTOR inverse_scale = XMVectorReciprocal(scale);
+		result.r[0] = XMVectorSelect(g_XMZero, inverse_scale, g_XMSelect1000);
+		result.r[1] = XMVectorSelect(g_XMZero, inverse_scale, g_XMSelect0100);
+		result.r[2] = XMVectorSelect(g_XMZero, inverse_scale, g_XMSelect0010);
+		break;
+	}
+
+	case Kind::kAffine:
+	{
+		// The inverse transpose of a 3x3 is its cofactor matrix over its determinant.
+		const XMVECTOR cofactor0 = XMVector3Cross(world.r[1], world.r[2]);
+		const XMVECTOR cofactor1 = XMVector3Cross(world.r[2], world.r[0]);
+		const XMVECTOR cofactor2 = XMVector3Cross(world.r[0], world.r[1]);
+		const XMVECTOR inverse_determinant = XMVectorReciprocal(XMVector3Dot(world.r[0], cofactor0));
+		result.r[0] = XMVectorMultiply(cofactor0, inverse_determinant);
+		result.r[1] = XMVectorMultiply(cofactor1, inverse_determinant);
+		result.r[2] = XMVectorMultiply(cofactor2, inverse_determinant);
+		break;
+	}
+
+	default:
+		result = XMMatrixTranspose(XMMatrixInverse(nullptr, world));
+		result.r[0] = XMVectorSelect(g_XMZero, result.r[0], g_XMSelect1110);
+		result.r[1] = XMVectorSelect(g_XMZero, result.r[1], g_XMSelect1110);
+		result.r[2] = XMVectorSelect(g_XMZero, result.r[2], g_XMSelect1110);
+		break;
+	}
+
+	result.r[3] = g_XMIdentityR3;
+	return result;
+}
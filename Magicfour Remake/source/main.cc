@@ -9,13 +9,91 @@
 
 #include "core/SystemClass.hh"
 #include "core/GameException.hh"
+#include "graphics/TextureCooker.hh"
+#include "util/AssetArchive.hh"
+#include "util/FileSystem.hh"
+#include "util/ResourceManifest.hh"
 
 #include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+// Compiled to a binary manifest by --compile-manifest, which is loaded instead when up to date.
+static const char* kResourceManifest = "data/resources.xml";
+
+// Cook the textures of resources.xml and write a report, without opening the game window.
+// Returns nonzero if any texture failed the error threshold.
+static int CookTextures(bool high_quality)
+{
+	CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	ResourceManifest manifest(kResourceManifest);
+	auto results = TextureCooker::CookFromManifest(manifest, high_quality);
+
+	std::ofstream report("texture_cook.log");
+	int rejected = 0;
+	for (const auto& result : results)
+	{
+		char line[256];
+		snprintf(line, sizeof(line), "%ls: %zux%zu, %zu mips, format %d, PSNR %.2f dB%s\n",
+			result.source_filename.c_str(), result.width, result.height, result.mip_levels,
+			static_cast<int>(result.format), result.psnr, result.accepted ? "" : " (rejected)");
+		report << line;
+
+		if (!result.accepted) rejected++;
+	}
+
+	CoUninitialize();
+	return rejected ? 1 : 0;
+}
+
+// Loaded from the archive when it exists, from loose files otherwise.
+static const char* kAssetArchive = "data.pak";
+
+// Pack every file the game reads into the asset archive, without opening the game window.
+// The manifest is compiled here; cook textures first, so the cooked files are packed as well.
+static int PackAssets()
+{
+	ResourceManifest::Compile(kResourceManifest);
+	auto file_paths = AssetArchive::CollectResourceFiles(kResourceManifest);
+
+	// Files loaded by path in code rather than through resources.xml.
+	file_paths.push_back("data/texture/black.png");
+	for (const char* directory : { "data/motion", "data/field" })
+	{
+		for (const auto& entry : std::filesystem::directory_iterator(directory))
+		{
+			if (entry.is_regular_file()) file_paths.push_back(entry.path().generic_string());
+		}
+	}
+
+	AssetArchive::Build(kAssetArchive, file_paths);
+	return 0;
+}
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pScmdline, int iCmdshow)
 {
 	try
 	{
+		if (strstr(pScmdline, "--cook-textures"))
+		{
+			return CookTextures(strstr(pScmdline, "--high-quality") != nullptr);
+		}
+
+		if (strstr(pScmdline, "--compile-manifest"))
+		{
+			ResourceManifest::Compile(kResourceManifest);
+			return 0;
+		}
+
+		if (strstr(pScmdline, "--pack-assets"))
+		{
+			return PackAssets();
+		}
+
+		if (GetFileAttributesA(kAssetArchive) != INVALID_FILE_ATTRIBUTES) FileSystem::Mount(kAssetArchive);
+
 		// Create the system object.
 		unique_ptr<SystemClass> System = make_unique<SystemClass>();
 
@@ -1,10 +1,10 @@
 #include "map/FieldClass.hh"
 
 #include <DirectXMath.h>
-#include <fstream>
 #include <corecrt_math_defines.h>
 
 #include "core/GameException.hh"
+#include "util/FileSystem.hh"
 #include "shader/ShaderManager.hh"
 #include "shader/NormalMapShaderClass.hh"
 #include "shader/LightShaderClass.hh"
@@ -13,11 +13,14 @@
 using namespace std;
 using namespace DirectX;
 
+constexpr ResourceId kBackgroundModel("background");
+constexpr ResourceId kCubeModel("cube");
+constexpr ResourceId kGemModel("gem");
+constexpr ResourceId kGrassModel("grass");
+
 FieldClass::FieldClass(const char* filename)
 {
-	ifstream fin(filename);
-
-	if(fin.fail()) throw filenotfound_error(filename, WFILE, __LINE__);
+	FileStream fin(FileSystem::Open(filename));
 
 	while (!fin.eof())
 	{
@@ -25,19 +28,14 @@ FieldClass::FieldClass(const char* filename)
 		fin >> left >> bottom >> right >> top;
 		grounds_.emplace_back(rect_t{ left, bottom, right, top });
 	}
-}
 
-void FieldClass::Draw(time_t curr_time, time_t time_delta, class ShaderManager* shader_manager,
-	ResourceMap<class ModelClass>& models, ResourceMap<class TextureClass>& textures) const
-{
-	// Draw Background
-	const static XMMATRIX kBackgroundMarix = XMMatrixScaling(192.0f, 153.6f, 1) * XMMatrixTranslation(0, 0, 100.0f);
-	shader_manager->light_shader_->PushRenderQueue(models.get("background"), kBackgroundMarix);
+	// Grass strips are turned upright, just in front of the ground.
+	const XMMATRIX grass_orientation = XMMatrixRotationY(3 * M_PI_2) * XMMatrixRotationZ(3 * M_PI_2) *
+		XMMatrixTranslation(0.0f, 0.0f, -0.0001f);
 
-	// Draw grounds
-	for (const auto& ground : GetGrounds())
+	for (const auto& ground : grounds_)
 	{
-		// for grass
+		// Long grounds are split into sections, so the textures keep their scale.
 		rect_t grass_range = ground.GetRange();
 		const int grass_drawing_steps = grass_range.get_w() / 100000 + 1;
 		for (long long i = 0; i < grass_drawing_steps; i++)
@@ -48,41 +46,62 @@ void FieldClass::Draw(time_t curr_time, time_t time_delta, class ShaderManager*
 			const long long next_x = grass_range.x1 + grass_range.get_w() * (i + 1) / grass_drawing_steps;
 			grass_section_range.x1 = curr_x, grass_section_range.x2 = next_x;
 
-			const XMMATRIX&& grass_matrix = XMMatrixRotationY(3 * M_PI_2) * XMMatrixRotationZ(3 * M_PI_2) *
-				XMMatrixTranslation(0.0f, 0.0f, -0.0001f) *
-				grass_section_range.toMatrix();
-
-			shader_manager->fire_shader_->PushRenderQueue(
-				models.get("grass"),
-				grass_matrix,
-				{ -0.3f, -0.1f, -0.3f },
-				{ 1.0f, 2.0f, 3.0f },
-				{ 0.1f, 0.2f },
-				{ 0.1f, 0.3f },
-				{ 0.1f, 0.1f },
-				0.4f, 0.0f);
+			grass_matrices_.push_back(grass_orientation * grass_section_range.toMatrix());
 		}
 
 		rect_t ground_range = ground.GetRange();
 		const int ground_drawing_steps = grass_range.get_w() / 420000 + 1;
 		for (long long i = 0; i < ground_drawing_steps; i++)
 		{
-			// for ground
 			rect_t ground_display_range = ground_range;
 
 			const long long curr_x = ground_range.x1 + ground_range.get_w() * i / ground_drawing_steps;
 			const long long next_x = ground_range.x1 + ground_range.get_w() * (i + 1) / ground_drawing_steps;
 			ground_display_range.x1 = curr_x, ground_display_range.x2 = next_x;
 
-			shader_manager->light_shader_->PushRenderQueue(models.get("cube"),
-				ground_display_range.toMatrix());
+			ground_matrices_.push_back(ground_display_range.toMatrix());
 		}
 	}
+}
 
-	shader_manager->normalMap_shader_->PushRenderQueue(models.get("gem"),
-		XMMatrixScaling(3, 3, 3) * XMMatrixTranslation(1750000 * kScope, (kGroundY - 50000) * kScope, +0.5f));
+void FieldClass::Draw(time_t curr_time, time_t time_delta, class ShaderManager* shader_manager,
+	ResourceMap<class ModelClass>& models, ResourceMap<class TextureClass>& textures) const
+{
+	// Draw Background
+	const static XMMATRIX kBackgroundMarix = XMMatrixScaling(192.0f, 153.6f, 1) * XMMatrixTranslation(0, 0, 100.0f);
+	shader_manager->light_shader_->PushRenderQueue(models.get(kBackgroundModel), kBackgroundMarix);
 
-	shader_manager->normalMap_shader_->PushRenderQueue(models.get("gem"),
-		XMMatrixScaling(4, 4, 4) * XMMatrixTranslation(1950000 * kScope, (kGroundY - 50000) * kScope, 0.0f));
+	// Draw grounds
+	const shared_ptr<ModelClass>& cube_model = models.get(kCubeModel);
+	if (ground_source_ != cube_model.get())
+	{
+		ground_batch_ = shader_manager->light_shader_->CreateStaticBatch(cube_model, ground_matrices_);
+		ground_source_ = cube_model.get();
+	}
+	shader_manager->light_shader_->PushRenderQueue(*ground_batch_);
 
+	// Draw grass
+	const shared_ptr<ModelClass>& grass_model = models.get(kGrassModel);
+	if (grass_source_ != grass_model.get())
+	{
+		grass_batch_ = shader_manager->fire_shader_->CreateStaticBatch(grass_model, grass_matrices_);
+		grass_source_ = grass_model.get();
+	}
+	shader_manager->fire_shader_->PushRenderQueue(*grass_batch_,
+		{ -0.3f, -0.1f, -0.3f },
+		{ 1.0f, 2.0f, 3.0f },
+		{ 0.1f, 0.2f },
+		{ 0.1f, 0.3f },
+		{ 0.1f, 0.1f },
+		0.4f, 0.0f);
+
+	// Draw decorations
+	const static XMMATRIX kGemMatrices[] = {
+		XMMatrixScaling(3, 3, 3) * XMMatrixTranslation(1750000 * kScope, (kGroundY - 50000) * kScope, +0.5f),
+		XMMatrixScaling(4, 4, 4) * XMMatrixTranslation(1950000 * kScope, (kGroundY - 50000) * kScope, 0.0f),
+	};
+	for (const XMMATRIX& gem_matrix : kGemMatrices)
+	{
+		shader_manager->normalMap_shader_->PushRenderQueue(models.get(kGemModel), gem_matrix);
+	}
 }
\ No newline at end of file
@@ -1,14 +1,16 @@
 #include "shader/FireShaderClass.hh"
 
 #include "core/GameException.hh"
-#include "core/D3DClass.hh"
 #include "graphics/ModelClass.hh"
-#include "graphics/FrustumCuller.hh"
 
-FireShaderClass::FireShaderClass(ID3D11Device* device, ID3D11DeviceContext* device_context, HWND hwnd)
+#include <cstring>
+#include <iterator>
+
+FireShaderClass::FireShaderClass(RenderDevice* device, ConstantRing* constants)
+	: ShaderClass(device, constants), instances_(device)
 {
 	// Initialize the vertex and pixel shaders.
-	InitializeShader(device, device_context, hwnd, L"shader/fire.vs", L"shader/fire.ps");
+	InitializeShader(L"shader/fire.vs", L"shader/fire.ps");
 }
 
 FireShaderClass::~FireShaderClass()
@@ -16,217 +18,180 @@ FireShaderClass::~FireShaderClass()
 
 }
 
-void FireShaderClass::PushRenderQueue(std::shared_ptr<ModelClass> model,
+void FireShaderClass::PushRenderQueue(const std::shared_ptr<ModelClass>& model,
 	XMMATRIX world_matrix,
 	XMFLOAT3 scroll_speeds, XMFLOAT3 scales,
 	XMFLOAT2 distortion1, XMFLOAT2 distortion2, XMFLOAT2 distortion3,
 	float distortion_scale, float distortion_bias)
 {
-	RenderCommand render_command;
-	render_command.model = model;
-	render_command.world_matrix = world_matrix;
-	render_command.fire_texture = model->GetDiffuseTexture();
-	render_command.noise_texture = model->GetNormalTexture();
-	render_command.alpha_texture = model->GetEmissiveTexture();
-	render_command.scroll_speeds = scroll_speeds;
-	render_command.scales = scales;
-	render_command.distortion1 = distortion1;
-	render_command.distortion2 = distortion2;
-	render_command.distortion3 = distortion3;
-	render_command.distortion_scale = distortion_scale;
-	render_command.distortion_bias = distortion_bias;
-
-	render_queue_[model].push_back(render_command);
+	PushCommand(model.get(), world_matrix,
+		model->GetDiffuseTexture(), model->GetNormalTexture(), model->GetEmissiveTexture(),
+		{ scroll_speeds, scales, distortion1, distortion2, distortion3, distortion_scale, distortion_bias });
 }
 
 
-void FireShaderClass::PushRenderQueue(std::shared_ptr<ModelClass> model,
+void FireShaderClass::PushRenderQueue(const std::shared_ptr<ModelClass>& model,
 	XMMATRIX world_matrix,
-	ID3D11ShaderResourceView* fire_texture,
-	ID3D11ShaderResourceView* noise_texture,
-	ID3D11ShaderResourceView* alpha_texture,
+	TextureView* fire_texture,
+	TextureView* noise_texture,
+	TextureView* alpha_texture,
 	XMFLOAT3 scroll_speeds, XMFLOAT3 scales,
 	XMFLOAT2 distortion1, XMFLOAT2 distortion2, XMFLOAT2 distortion3,
 	float distortion_scale, float distortion_bias)
 {
-	RenderCommand render_command;
+	PushCommand(model.get(), world_matrix, fire_texture, noise_texture, alpha_texture,
+		{ scroll_speeds, scales, distortion1, distortion2, distortion3, distortion_scale, distortion_bias });
+}
+
+std::unique_ptr<FireShaderClass::StaticBatch> FireShaderClass::CreateStaticBatch(
+	const std::shared_ptr<ModelClass>& model, const std::vector<XMMATRIX>& world_matrices)
+{
+	std::vector<InstanceType> instances(world_matrices.size());
+	for (size_t i = 0; i < world_matrices.size(); i++) instances[i].world = world_matrices[i];
+
+	// The batch is culled as a whole, by the box around its instances.
+	const DirectX::BoundingBox bounds = FrustumCuller::GetWorldBounds(model->GetBoundingVolume(), world_matrices);
+	return std::make_unique<StaticBatch>(device_, std::make_shared<ModelClass>(model, bounds), instances);
+}
+
+void FireShaderClass::PushRenderQueue(const StaticBatch& batch,
+	XMFLOAT3 scroll_speeds, XMFLOAT3 scales,
+	XMFLOAT2 distortion1, XMFLOAT2 distortion2, XMFLOAT2 distortion3,
+	float distortion_scale, float distortion_bias)
+{
+	if (batch.GetCount() == 0) return;
+
+	// Instances are in world space already.
+	ModelClass* model = batch.GetModel().get();
+	RenderCommand& render_command = PushCommand(model, DirectX::XMMatrixIdentity(),
+		model->GetDiffuseTexture(), model->GetNormalTexture(), model->GetEmissiveTexture(),
+		{ scroll_speeds, scales, distortion1, distortion2, distortion3, distortion_scale, distortion_bias });
+	render_command.batch = &batch;
+}
+
+FireShaderClass::RenderCommand& FireShaderClass::PushCommand(ModelClass* model, const XMMATRIX& world_matrix,
+	TextureView* fire_texture, TextureView* noise_texture, TextureView* alpha_texture,
+	const Effect& effect)
+{
+	RenderCommand& render_command = render_queue_.Push();
 	render_command.model = model;
 	render_command.world_matrix = world_matrix;
 	render_command.fire_texture = fire_texture;
 	render_command.noise_texture = noise_texture;
 	render_command.alpha_texture = alpha_texture;
-	render_command.scroll_speeds = scroll_speeds;
-	render_command.scales = scales;
-	render_command.distortion1 = distortion1;
-	render_command.distortion2 = distortion2;
-	render_command.distortion3 = distortion3;
-	render_command.distortion_scale = distortion_scale;
-	render_command.distortion_bias = distortion_bias;
-
-	render_queue_[model].push_back(render_command);
+	render_command.effect = effect;
+	render_command.batch = nullptr;
+	render_command.key = RenderKey::Make(RenderPass::kTransparent, ShaderId::kFire,
+		RenderKey::HashMaterial(fire_texture), model->GetSortId());
+	return render_command;
 }
 
-void FireShaderClass::ProcessRenderQueue(ID3D11DeviceContext* device_context,
-	XMMATRIX vp_matrix, float frame_time)
+void FireShaderClass::ProcessRenderQueue(const XMMATRIX& vp_matrix)
 {
-	FrustumCuller fruster_culler(vp_matrix);
-	for (auto& [model, params] : render_queue_)
+	// Every effect blends, so the visible ones are drawn back to front.
+	const std::vector<SortEntry>& order = render_queue_.Sort(vp_matrix, cull_stats_, sort_stats_);
+
+	// Instances in draw order, so a batch draws a range of them.
+	// Static batches draw their own, so their slots here go unused.
+	instances_.Clear();
+	for (const SortEntry& entry : order)
 	{
-		// Check if the model is in the view frustum
-		if (!fruster_culler.IsInFrustum(model->GetBoundingVolume())) continue;
+		instances_.Push().world = render_queue_[entry.index].world_matrix;
+	}
 
-		// Batch processing for draw calls with same model
-		model->Render(device_context);
-		for (const auto& param : params)
+	// A batch for each run of neighbours with the same model, textures and effect.
+	// Instances are drawn in order, so a batch keeps them back to front.
+	batches_.clear();
+	render_queue_.ForEachBatch(order,
+		[](const RenderCommand& a, const RenderCommand& b)
 		{
-			MatrixBufferType matrix_data;
-			matrix_data.mvp = param.world_matrix * vp_matrix;
-
-			NoiseBufferType noise_data;
-			noise_data.frame_time = frame_time;
-			noise_data.scroll_speeds = param.scroll_speeds;
-			noise_data.scales = param.scales;
-			noise_data.padding = 0.0f;
-
-			DistortionBuffer distortion_data;
-			distortion_data.distortion1 = param.distortion1;
-			distortion_data.distortion2 = param.distortion2;
-			distortion_data.distortion3 = param.distortion3;
-			distortion_data.distortion_scale = param.distortion_scale;
-			distortion_data.distortion_bias = param.distortion_bias;
-
-			// Set the shader parameters that it will use for rendering.
-			SetShaderParameters(device_context, matrix_data, noise_data, distortion_data,
-				param.fire_texture, param.noise_texture, param.alpha_texture);
-
-			// Now render the prepared buffers with the shader.
-			RenderShader(device_context, model->GetIndexCount());
-		}
+			return !a.batch && !b.batch && a.model->GetSortId() == b.model->GetSortId() &&
+				a.fire_texture == b.fire_texture && a.noise_texture == b.noise_texture &&
+				a.alpha_texture == b.alpha_texture && memcmp(&a.effect, &b.effect, sizeof(Effect)) == 0;
+		},
+		[this, &order](uint32_t first, uint32_t count)
+		{
+			const Effect& effect = render_queue_[order[first].index].effect;
+
+			DrawBufferType draw_buffer;
+			draw_buffer.scroll_speeds = effect.scroll_speeds;
+			draw_buffer.padding1 = 0.0f;
+			draw_buffer.scales = effect.scales;
+			draw_buffer.padding2 = 0.0f;
+			draw_buffer.distortion1 = effect.distortion1;
+			draw_buffer.distortion2 = effect.distortion2;
+			draw_buffer.distortion3 = effect.distortion3;
+			draw_buffer.distortion_scale = effect.distortion_scale;
+			draw_buffer.distortion_bias = effect.distortion_bias;
+			batches_.push_back({ first, count, constants_->Push(draw_buffer) });
+		});
+
+	if (!order.empty())
+	{
+		device_->SetShader(shader_);
+		device_->SetSampler(0, sample_state_wrap_);
+		device_->SetSampler(1, sample_state_clamp_);
+		instances_.Upload(1);
+		constants_->Upload();
 	}
 
-	render_queue_.clear();
-}
-
-void FireShaderClass::InitializeShader(ID3D11Device* device,
-	ID3D11DeviceContext* device_context, HWND hwnd,
-	const WCHAR* vs_filename, const WCHAR* ps_filename)
-{
-	constexpr int kNumOfElements = 2;
-	D3D11_INPUT_ELEMENT_DESC polygon_layout[kNumOfElements];
-
-	// Create the vertex input layout description.
-	// This setup needs to match the VertexType stucture in the ModelClass and in the shader.
-	for (int i = 0; i < kNumOfElements; i++)
+	const ModelClass* bound_model = nullptr;
+	bool static_bound = false;
+	for (const Batch& batch : batches_)
 	{
-		polygon_layout[i].SemanticIndex = 0;
-		polygon_layout[i].InputSlot = 0;
-		polygon_layout[i].InstanceDataStepRate = 0;
-		polygon_layout[i].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-		polygon_layout[i].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
-	}
-	polygon_layout[0].AlignedByteOffset = 0;
+		const RenderCommand& param = render_queue_[order[batch.first].index];
 
-	polygon_layout[0].SemanticName = "POSITION";
-	polygon_layout[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+		// Models sharing buffers have the same sort id.
+		if (!bound_model || bound_model->GetSortId() != param.model->GetSortId())
+		{
+			param.model->Render(device_);
+			bound_model = param.model;
+		}
 
-	polygon_layout[1].SemanticName = "TEXCOORD";
-	polygon_layout[1].Format = DXGI_FORMAT_R32G32_FLOAT;
+		constants_->Bind(ShaderStage::kVertex, 0, batch.draw);
+		constants_->Bind(ShaderStage::kPixel, 0, batch.draw);
 
-	ShaderClass::CreateShaderObject(device, device_context, hwnd,
-		vs_filename, ps_filename, polygon_layout, kNumOfElements);
+		// Set shader texture resource in the pixel shader.
+		device_->SetTexture(0, param.fire_texture);
+		device_->SetTexture(1, param.noise_texture);
+		device_->SetTexture(2, param.alpha_texture);
 
-	// Create the texture sampler state.
-	sample_state_clamp_ = ShaderClass::CreateSamplerState(device, D3D11_TEXTURE_ADDRESS_CLAMP);
-	sample_state_wrap_ = ShaderClass::CreateSamplerState(device, D3D11_TEXTURE_ADDRESS_WRAP);
-
-	matrix_buffer_ = CreateBasicConstantBuffer<MatrixBufferType>(device);
-	if (!matrix_buffer_) throw GAME_EXCEPTION(L"Failed to create matrix buffer");
+		if (param.batch)
+		{
+			param.batch->Bind(1);
+			device_->DrawIndexedInstanced(param.model->GetIndexCount(), param.batch->GetCount());
+			static_bound = true;
+			continue;
+		}
 
-	noise_buffer_ = CreateBasicConstantBuffer<NoiseBufferType>(device);
-	if (!noise_buffer_) throw GAME_EXCEPTION(L"Failed to create noise buffer");
+		if (static_bound)
+		{
+			instances_.Bind(1);
+			static_bound = false;
+		}
+		device_->DrawIndexedInstanced(param.model->GetIndexCount(), batch.count, 0, 0, batch.first);
+	}
 
-	distortion_buffer_ = CreateBasicConstantBuffer<DistortionBuffer>(device);
-	if (!distortion_buffer_) throw GAME_EXCEPTION(L"Failed to create noise buffer");
+	render_queue_.Clear();
 }
 
-void FireShaderClass::SetShaderParameters(ID3D11DeviceContext* device_context,
-	const MatrixBufferType& matrix_buffer_data,
-	const NoiseBufferType& noise_buffer_data, const DistortionBuffer& distortion_buffer_data,
-	ID3D11ShaderResourceView* fire_texture, ID3D11ShaderResourceView* noise_texture,
-	ID3D11ShaderResourceView* alpha_texture)
+void FireShaderClass::InitializeShader(const wchar_t* vs_filename, const wchar_t* ps_filename)
 {
-	HRESULT result;
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-	unsigned int bufferNumber = 0;
-	
-
-	// Lock the constant buffer so it can be written to.
-	result = device_context->Map(matrix_buffer_.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	if (FAILED(result)) throw GAME_EXCEPTION(L"Failed to lock matrix buffer to set shader parameter.");
-
-	// Get a pointer to the data in the constant buffer.
-	MatrixBufferType* dataPtr = (MatrixBufferType*)mappedResource.pData;
-
-	// Copy cbuffer data with transposing matrix.
-	*dataPtr = matrix_buffer_data;
-	dataPtr->mvp = XMMatrixTranspose(matrix_buffer_data.mvp);
-
-	device_context->Unmap(matrix_buffer_.Get(), 0);
-
-	// Now set the constant buffer in the vertex shader with the updated bufferNumber values.
-	device_context->VSSetConstantBuffers(bufferNumber++, 1, matrix_buffer_.GetAddressOf());
-
-
-	// Lock the constant buffer so it can be written to.
-	result = device_context->Map(noise_buffer_.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	if (FAILED(result)) throw GAME_EXCEPTION(L"Failed to lock noise buffer to set shader parameter.");
-
-	// Get a pointer to the data in the constant buffer.
-	NoiseBufferType* dataPtr2 = (NoiseBufferType*)mappedResource.pData;
-	*dataPtr2 = noise_buffer_data;
-
-	device_context->Unmap(noise_buffer_.Get(), 0);
-
-	// Now set the constant buffer in the vertex shader with the updated bufferNumber values.
-	device_context->VSSetConstantBuffers(bufferNumber++, 1, noise_buffer_.GetAddressOf());
-	
-
-	bufferNumber = 0; // initialize for pixel shader buffer
-
-	// Set shader texture resource in the pixel shader.
-	device_context->PSSetShaderResources(0, 1, &fire_texture);
-	device_context->PSSetShaderResources(1, 1, &noise_texture);
-	device_context->PSSetShaderResources(2, 1, &alpha_texture);
-
-	result = device_context->Map(distortion_buffer_.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	if (FAILED(result)) throw GAME_EXCEPTION(L"Failed to lock noise buffer to set shader parameter.");
-
-	// Get a pointer to the data in the constant buffer.
-	DistortionBuffer* dataPtr3 = (DistortionBuffer*)mappedResource.pData;
-	*dataPtr3 = distortion_buffer_data;
+	// This setup needs to match the VertexType stucture in the ModelClass, InstanceType and the shader.
+	const VertexElement layout[] =
+	{
+		{ "POSITION", 0, VertexFormat::kFloat3 },
+		{ "TEXCOORD", 0, VertexFormat::kFloat2 },
 
-	device_context->Unmap(distortion_buffer_.Get(), 0);
+		{ "WORLD", 0, VertexFormat::kFloat4, 1, true },
+		{ "WORLD", 1, VertexFormat::kFloat4, 1, true },
+		{ "WORLD", 2, VertexFormat::kFloat4, 1, true },
+		{ "WORLD", 3, VertexFormat::kFloat4, 1, true },
+	};
 
-	// Now set the constant buffer in the vertex shader with the updated bufferNumber values.
-	device_context->PSSetConstantBuffers(bufferNumber++, 1, distortion_buffer_.GetAddressOf());
+	ShaderClass::CreateShaderObject(vs_filename, ps_filename, layout, std::size(layout));
 
+	// Create the texture sampler state.
+	sample_state_clamp_ = device_->CreateSampler(AddressMode::kClamp);
+	sample_state_wrap_ = device_->CreateSampler(AddressMode::kWrap);
 }
-
-void FireShaderClass::RenderShader(ID3D11DeviceContext* device_context, int indexCount)
-{
-	// Set the vertex input layout.
-	device_context->IASetInputLayout(input_layout_.Get());
-
-	// Set the vertex and pixel shaders that will be used to render this triangle.
-	device_context->VSSetShader(vertex_shader_.Get(), NULL, 0);
-	device_context->PSSetShader(pixel_shader_.Get(), NULL, 0);
-
-	// Set the sampler state in the pixel shader.
-	device_context->PSSetSamplers(0, 1, sample_state_wrap_.GetAddressOf());
-	device_context->PSSetSamplers(1, 1, sample_state_clamp_.GetAddressOf());
-
-	// Render the triangle.
-	device_context->DrawIndexed(indexCount, 0, 0);
-
-	return;
-}
\ No newline at end of file
@@ -1,17 +1,17 @@
 #include "shader/LightShaderClass.hh"
 
 #include <algorithm>
-#include <fstream>
+#include <iterator>
 
 #include "core/GameException.hh"
-#include "core/D3DClass.hh"
 #include "graphics/ModelClass.hh"
-#include "graphics/FrustumCuller.hh"
+#include "graphics/WorldMatrix.hh"
 
-LightShaderClass::LightShaderClass(ID3D11Device* device, ID3D11DeviceContext* device_context, HWND hwnd)
+LightShaderClass::LightShaderClass(RenderDevice* device, ConstantRing* constants)
+	: ShaderClass(device, constants), instances_(device)
 {
 	// Initialize the vertex and pixel shaders.
-	InitializeShader(device, device_context, hwnd, L"shader/light.vs", L"shader/light.ps");
+	InitializeShader(L"shader/light.vs", L"shader/light.ps");
 }
 
 LightShaderClass::~LightShaderClass()
@@ -19,161 +19,138 @@ LightShaderClass::~LightShaderClass()
 
 }
 
-void LightShaderClass::PushRenderQueue(std::shared_ptr<ModelClass> model, XMMATRIX world_matrix)
+void LightShaderClass::PushRenderQueue(const std::shared_ptr<ModelClass>& model, XMMATRIX world_matrix)
 {
-	RenderCommand render_command;
-	render_command.model = model;
-	render_command.world_matrix = world_matrix;
-	render_command.texture = model->GetDiffuseTexture();
-
-	render_queue_[model].push_back(render_command);
+	PushRenderQueue(model, world_matrix, model->GetDiffuseTexture());
 }
 
-void LightShaderClass::PushRenderQueue(std::shared_ptr<ModelClass> model, XMMATRIX world_matrix,
-	ID3D11ShaderResourceView* texture)
+void LightShaderClass::PushRenderQueue(const std::shared_ptr<ModelClass>& model, XMMATRIX world_matrix,
+	TextureView* texture)
 {
-	RenderCommand render_command;
-	render_command.model = model;
+	RenderCommand& render_command = render_queue_.Push();
+	render_command.model = model.get();
 	render_command.world_matrix = world_matrix;
 	render_command.texture = texture;
-
-	render_queue_[model].push_back(render_command);
+	render_command.batch = nullptr;
+	render_command.key = RenderKey::Make(RenderPass::kOpaque, ShaderId::kLight,
+		RenderKey::HashMaterial(texture), model->GetSortId());
 }
 
-void LightShaderClass::ProcessRenderQueue(ID3D11DeviceContext* device_context,
-	const XMMATRIX& vp_matrix, XMFLOAT3 light_direction, XMFLOAT4 diffuse_color)
+std::unique_ptr<LightShaderClass::StaticBatch> LightShaderClass::CreateStaticBatch(
+	const std::shared_ptr<ModelClass>& model, const std::vector<XMMATRIX>& world_matrices)
 {
-	FrustumCuller fruster_culler(vp_matrix);
-	for (auto& [model, params] : render_queue_)
+	std::vector<InstanceType> instances(world_matrices.size());
+	for (size_t i = 0; i < world_matrices.size(); i++)
 	{
-		// Batch processing for draw calls with same model
-		model->Render(device_context);
-		for (const auto& param : params)
-		{
-			// Check if the model is in the view frustum
-			if (!fruster_culler.IsInFrustum(model->GetBoundingVolume())) continue;
-
-			// Set the shader parameters that it will use for rendering.
-			SetShaderParameters(device_context, param.world_matrix, vp_matrix, param.texture, light_direction, diffuse_color);
-
-			// Now render the prepared buffers with the shader.
-			RenderShader(device_context, model->GetIndexCount());
-		}
+		instances[i].world = world_matrices[i];
+		instances[i].world_tr_inv = WorldMatrix::NormalMatrix(world_matrices[i], WorldMatrix::Classify(world_matrices[i]));
 	}
 
-	render_queue_.clear();
+	// The batch is culled as a whole, by the box around its instances.
+	const DirectX::BoundingBox bounds = FrustumCuller::GetWorldBounds(model->GetBoundingVolume(), world_matrices);
+	return std::make_unique<StaticBatch>(device_, std::make_shared<ModelClass>(model, bounds), instances);
 }
 
-void LightShaderClass::InitializeShader(ID3D11Device* device,
-	ID3D11DeviceContext* device_context, HWND hwnd,
-	const WCHAR* vs_filename, const WCHAR* ps_filename)
+void LightShaderClass::PushRenderQueue(const StaticBatch& batch)
 {
-	constexpr int kNumOfElements = 3;
-	D3D11_INPUT_ELEMENT_DESC polygon_layout[kNumOfElements];
-
-	// Create the vertex input layout description.
-	// This setup needs to match the VertexType stucture in the ModelClass and in the shader.
-	for (int i = 0; i < kNumOfElements; i++)
-	{
-		polygon_layout[i].SemanticIndex = 0;
-		polygon_layout[i].InputSlot = 0;
-		polygon_layout[i].InstanceDataStepRate = 0;
-		polygon_layout[i].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-		polygon_layout[i].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
-	}
-	polygon_layout[0].AlignedByteOffset = 0;
-
-	polygon_layout[0].SemanticName = "POSITION";
-	polygon_layout[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-
-	polygon_layout[1].SemanticName = "TEXCOORD";
-	polygon_layout[1].Format = DXGI_FORMAT_R32G32_FLOAT;
-
-	polygon_layout[2].SemanticName = "NORMAL";
-	polygon_layout[2].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-
-	ShaderClass::CreateShaderObject(device, device_context, hwnd, vs_filename, ps_filename, polygon_layout, 3);
-
-	// Create the texture sampler state.
-	sample_state_ = ShaderClass::CreateSamplerState(device);
-
-	matrix_buffer_ = CreateBasicConstantBuffer<MatrixBufferType>(device);
-	if (!matrix_buffer_) throw GAME_EXCEPTION(L"Failed to create matrix buffer");
-
-	light_buffer_ = CreateBasicConstantBuffer<LightBufferType>(device);
-	if (!light_buffer_) throw GAME_EXCEPTION(L"Failed to create light buffer");
+	if (batch.GetCount() == 0) return;
+
+	// Instances are in world space already.
+	RenderCommand& render_command = render_queue_.Push();
+	render_command.model = batch.GetModel().get();
+	render_command.world_matrix = DirectX::XMMatrixIdentity();
+	render_command.texture = render_command.model->GetDiffuseTexture();
+	render_command.batch = &batch;
+	render_command.key = RenderKey::Make(RenderPass::kOpaque, ShaderId::kLight,
+		RenderKey::HashMaterial(render_command.texture), render_command.model->GetSortId());
 }
 
-void LightShaderClass::SetShaderParameters(ID3D11DeviceContext* device_context, XMMATRIX world_matrix, XMMATRIX vp_matrix,
-	ID3D11ShaderResourceView* texture, XMFLOAT3 light_direction, XMFLOAT4 diffuse_color)
+void LightShaderClass::ProcessRenderQueue(const XMMATRIX& vp_matrix)
 {
-	HRESULT result;
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-	unsigned int bufferNumber;
-	MatrixBufferType* dataPtr;
-	LightBufferType* dataPtr2;
-
-	// Lock the constant buffer so it can be written to.
-	result = device_context->Map(matrix_buffer_.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	if (FAILED(result)) throw GAME_EXCEPTION(L"Failed to lock matrix buffer to set shader parameter.");
-
-	// Get a pointer to the data in the constant buffer.
-	dataPtr = (MatrixBufferType*)mappedResource.pData;
-
-	// Transpose the matrices to prepare them for the shader.
-	// And Copy them.
-	dataPtr->mvp = XMMatrixTranspose(world_matrix * vp_matrix);
-	dataPtr->world_tr_inv = XMMatrixInverse(nullptr, world_matrix);
+	// Visible commands grouped by texture, then by model.
+	const std::vector<SortEntry>& order = render_queue_.Sort(vp_matrix, cull_stats_, sort_stats_);
 
-	// Unlock the constant buffer.
-	device_context->Unmap(matrix_buffer_.Get(), 0);
-
-	// Set the position of the constant buffer in the vertex shader.
-	bufferNumber = 0;
-
-	// Now set the constant buffer in the vertex shader with the updated values.
-	device_context->VSSetConstantBuffers(bufferNumber, 1, matrix_buffer_.GetAddressOf());
-
-	// Set shader texture resource in the pixel shader.
-	device_context->PSSetShaderResources(0, 1, &texture);
-
-	// Lock the light constant buffer so it can be written to.
-	result = device_context->Map(light_buffer_.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	if (FAILED(result)) throw GAME_EXCEPTION(L"Failed to lock light buffer to set shader parameter.");
-
-	// Get a pointer to the data in the constant buffer.
-	dataPtr2 = (LightBufferType*)mappedResource.pData;
-
-	// Copy the lighting variables into the constant buffer.
-	dataPtr2->diffuse_color = diffuse_color;
-	dataPtr2->light_direction = light_direction;
-	dataPtr2->padding = 0.0f;
+	// Instances in draw order, so a batch draws a range of them.
+	// Static batches draw their own, so their slots here go unused.
+	instances_.Clear();
+	for (const SortEntry& entry : order)
+	{
+		const XMMATRIX& world_matrix = render_queue_[entry.index].world_matrix;
 
-	// Unlock the constant buffer.
-	device_context->Unmap(light_buffer_.Get(), 0);
+		InstanceType& instance = instances_.Push();
+		instance.world = world_matrix;
+		instance.world_tr_inv = WorldMatrix::NormalMatrix(world_matrix, WorldMatrix::Classify(world_matrix));
+	}
 
-	// Set the position of the light constant buffer in the pixel shader.
-	bufferNumber = 0;
+	if (!order.empty())
+	{
+		device_->SetShader(shader_);
+		device_->SetSampler(0, sample_state_);
+		instances_.Upload(1);
+	}
 
-	// Finally set the light constant buffer in the pixel shader with the updated values.
-	device_context->PSSetConstantBuffers(bufferNumber, 1, light_buffer_.GetAddressOf());
+	// One draw for each run of a model with a texture, and for each static batch.
+	const ModelClass* bound_model = nullptr;
+	bool static_bound = false;
+	render_queue_.ForEachBatch(order,
+		[](const RenderCommand& a, const RenderCommand& b)
+		{
+			return !a.batch && !b.batch &&
+				a.model->GetSortId() == b.model->GetSortId() && a.texture == b.texture;
+		},
+		[&](uint32_t first, uint32_t count)
+		{
+			const RenderCommand& param = render_queue_[order[first].index];
+
+			// Models sharing buffers have the same sort id.
+			if (!bound_model || bound_model->GetSortId() != param.model->GetSortId())
+			{
+				param.model->Render(device_);
+				bound_model = param.model;
+			}
+
+			device_->SetTexture(0, param.texture);
+
+			if (param.batch)
+			{
+				param.batch->Bind(1);
+				device_->DrawIndexedInstanced(param.model->GetIndexCount(), param.batch->GetCount());
+				static_bound = true;
+				return;
+			}
+
+			if (static_bound)
+			{
+				instances_.Bind(1);
+				static_bound = false;
+			}
+			device_->DrawIndexedInstanced(param.model->GetIndexCount(), count, 0, 0, first);
+		});
+
+	render_queue_.Clear();
 }
 
-
-void LightShaderClass::RenderShader(ID3D11DeviceContext* device_context, int indexCount)
+void LightShaderClass::InitializeShader(const wchar_t* vs_filename, const wchar_t* ps_filename)
 {
-	// Set the vertex input layout.
-	device_context->IASetInputLayout(input_layout_.Get());
-
-	// Set the vertex and pixel shaders that will be used to render this triangle.
-	device_context->VSSetShader(vertex_shader_.Get(), NULL, 0);
-	device_context->PSSetShader(pixel_shader_.Get(), NULL, 0);
-
-	// Set the sampler state in the pixel shader.
-	device_context->PSSetSamplers(0, 1, sample_state_.GetAddressOf());
-
-	// Render the triangle.
-	device_context->DrawIndexed(indexCount, 0, 0);
+	// This setup needs to match the VertexType stucture in the ModelClass, InstanceType and the shader.
+	const VertexElement layout[] =
+	{
+		{ "POSITION", 0, VertexFormat::kFloat3 },
+		{ "TEXCOORD", 0, VertexFormat::kFloat2 },
+		{ "NORMAL", 0, VertexFormat::kFloat3 },
+
+		{ "WORLD", 0, VertexFormat::kFloat4, 1, true },
+		{ "WORLD", 1, VertexFormat::kFloat4, 1, true },
+		{ "WORLD", 2, VertexFormat::kFloat4, 1, true },
+		{ "WORLD", 3, VertexFormat::kFloat4, 1, true },
+		{ "WORLDTRINV", 0, VertexFormat::kFloat4, 1, true },
+		{ "WORLDTRINV", 1, VertexFormat::kFloat4, 1, true },
+		{ "WORLDTRINV", 2, VertexFormat::kFloat4, 1, true },
+		{ "WORLDTRINV", 3, VertexFormat::kFloat4, 1, true },
+	};
+
+	ShaderClass::CreateShaderObject(vs_filename, ps_filename, layout, std::size(layout));
 
-	return;
-}
\ No newline at end of file
+	// Create the texture sampler state.
+	sample_state_ = device_->CreateSampler(AddressMode::kWrap);
+}
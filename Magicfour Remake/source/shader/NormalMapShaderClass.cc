@@ -1,32 +1,33 @@
 #include "shader/NormalMapShaderClass.hh"
 
 #include <algorithm>
-#include <fstream>
+#include <iterator>
 
 #include "core/GameException.hh"
 #include "graphics/ModelClass.hh"
-#include "graphics/FrustumCuller.hh"
+#include "graphics/WorldMatrix.hh"
 
 
-NormalMapShaderClass::NormalMapShaderClass(ID3D11Device* device, ID3D11DeviceContext* device_context, HWND hwnd)
+NormalMapShaderClass::NormalMapShaderClass(RenderDevice* device, ConstantRing* constants)
+	: ShaderClass(device, constants)
 {
 	// Initialize the vertex and pixel shaders.
-	InitializeShader(device, device_context, hwnd, L"shader/normalmap.vs", L"shader/normalmap.ps");
+	InitializeShader(L"shader/normalmap.vs", L"shader/normalmap.ps");
 
 }
 
-void NormalMapShaderClass::PushRenderQueue(std::shared_ptr<ModelClass> model, XMMATRIX world_matrix)
+void NormalMapShaderClass::PushRenderQueue(const std::shared_ptr<ModelClass>& model, XMMATRIX world_matrix)
 {
-	RenderCommand render_command;
-	render_command.model			  = model;
-	render_command.world_matrix	  = world_matrix;
-	render_command.diffuse_texture  = model->GetDiffuseTexture();
-	render_command.normal_texture   = model->GetNormalTexture();
-	render_command.emissive_texture = model->GetEmissiveTexture();
-
 	auto& material_list = model->GetMaterial();
 	for (size_t i = 0; i < material_list.size(); i++)
 	{
+		RenderCommand& render_command = render_queue_.Push();
+		render_command.model			  = model.get();
+		render_command.world_matrix	  = world_matrix;
+		render_command.diffuse_texture  = model->GetDiffuseTexture();
+		render_command.normal_texture   = model->GetNormalTexture();
+		render_command.emissive_texture = model->GetEmissiveTexture();
+
 		render_command.ambient_weight  = material_list[i].first.ambient;
 		render_command.diffuse_weight  = material_list[i].first.diffuse;
 		render_command.specular_weight = material_list[i].first.specular;
@@ -42,19 +43,20 @@ void NormalMapShaderClass::PushRenderQueue(std::shared_ptr<ModelClass> model, XM
 			render_command.index_start = material_list[i].second;
 		}
 
-		render_queue_[model].push_back(render_command);
+		render_command.key = RenderKey::Make(RenderPass::kOpaque, ShaderId::kNormalMap,
+			RenderKey::HashMaterial(render_command.diffuse_texture, static_cast<uint32_t>(i)), model->GetSortId());
 	}
 }
 
 void NormalMapShaderClass::PushRenderQueue(
-	std::shared_ptr<ModelClass> model, XMMATRIX world_matrix,
-	ID3D11ShaderResourceView* diffuse_texture,
-	ID3D11ShaderResourceView* normal_texture,
-	ID3D11ShaderResourceView* emissive_texture)
+	const std::shared_ptr<ModelClass>& model, XMMATRIX world_matrix,
+	TextureView* diffuse_texture,
+	TextureView* normal_texture,
+	TextureView* emissive_texture)
 {
-	RenderCommand render_command;
+	RenderCommand& render_command = render_queue_.Push();
 
-	render_command.model			  = model;
+	render_command.model			  = model.get();
 	render_command.world_matrix	  = world_matrix;
 	render_command.diffuse_texture  = diffuse_texture;
 	render_command.normal_texture   = normal_texture;
@@ -66,181 +68,80 @@ void NormalMapShaderClass::PushRenderQueue(
 
 	render_command.index_count	  = model->GetIndexCount();
 	render_command.index_start	  = 0;
-
-	render_queue_[model].push_back(render_command);
+	render_command.key = RenderKey::Make(RenderPass::kOpaque, ShaderId::kNormalMap,
+		RenderKey::HashMaterial(diffuse_texture), model->GetSortId());
 }
 
-void NormalMapShaderClass::ProcessRenderQueue(ID3D11DeviceContext* device_context,
-	const XMMATRIX& vp_matrix,
-	XMFLOAT3 light_direction, XMFLOAT4 diffuse_color, XMFLOAT3 camera_pos)
+void NormalMapShaderClass::ProcessRenderQueue(const XMMATRIX& vp_matrix)
 {
-	FrustumCuller fruster_culler(vp_matrix);
+	// Visible commands grouped by material, then by model.
+	const std::vector<SortEntry>& order = render_queue_.Sort(vp_matrix, cull_stats_, sort_stats_);
 
-	for (auto& [model, params] : render_queue_)
+	// Constants of every draw, written in one update.
+	draw_constants_.clear();
+	for (const SortEntry& entry : order)
 	{
-		// Batch processing for draw calls with same model
-		model->Render(device_context);
-		for (const auto& param : params)
-		{
-			// Check if the model is in the view frustum
-			if (!fruster_culler.IsInFrustum(model->GetBoundingVolume())) continue;
-
-			// Set the shader parameters that it will use for rendering.
-			SetShaderParameters(device_context, param.world_matrix, vp_matrix,
-				param.diffuse_texture, param.normal_texture, param.emissive_texture,
-				light_direction, diffuse_color, camera_pos,
-				param.ambient_weight, param.diffuse_weight, param.specular_weight);
-
-			// Now render the prepared buffers with the shader.
-			RenderShader(device_context, param.index_count, param.index_start);
-		}
+		const RenderCommand& param = render_queue_[entry.index];
+
+		// Transpose the matrices to prepare them for the shader.
+		const WorldMatrix::Kind kind = WorldMatrix::Classify(param.world_matrix);
+		DrawBufferType draw_buffer;
+		draw_buffer.mvp = XMMatrixTranspose(WorldMatrix::Concatenate(param.world_matrix, kind, vp_matrix));
+		draw_buffer.world = XMMatrixTranspose(param.world_matrix);
+		draw_buffer.world_tr_inv = XMMatrixTranspose(WorldMatrix::NormalMatrix(param.world_matrix, kind));
+		draw_buffer.ambient_weight = XMFLOAT4(param.ambient_weight.x, param.ambient_weight.y, param.ambient_weight.z, 1.0f);
+		draw_buffer.diffuse_weight = XMFLOAT4(param.diffuse_weight.x, param.diffuse_weight.y, param.diffuse_weight.z, 1.0f);
+		draw_buffer.specular_weight = XMFLOAT4(param.specular_weight.x, param.specular_weight.y, param.specular_weight.z, 1.0f);
+		draw_constants_.push_back(constants_->Push(draw_buffer));
 	}
 
-	render_queue_.clear();
-}
-
-void NormalMapShaderClass::InitializeShader(ID3D11Device* device,
-	ID3D11DeviceContext* device_context, HWND hwnd,
-	const WCHAR* vs_filename, const WCHAR* ps_filename)
-{
-	constexpr int kNumOfElements = 5;
-	D3D11_INPUT_ELEMENT_DESC polygon_layout[kNumOfElements];
-
-	// Create the vertex input layout description.
-	// This setup needs to match the VertexType stucture in the ModelClass and in the shader.
-	for (int i = 0; i < kNumOfElements; i++)
+	if (!order.empty())
 	{
-		polygon_layout[i].SemanticIndex = 0;
-		polygon_layout[i].InputSlot = 0;
-		polygon_layout[i].InstanceDataStepRate = 0;
-		polygon_layout[i].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-		polygon_layout[i].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+		device_->SetShader(shader_);
+		device_->SetSampler(0, sample_state_);
+		constants_->Upload();
 	}
-	polygon_layout[0].AlignedByteOffset = 0;
-
-	polygon_layout[0].SemanticName = "POSITION";
-	polygon_layout[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-
-	polygon_layout[1].SemanticName = "TEXCOORD";
-	polygon_layout[1].Format = DXGI_FORMAT_R32G32_FLOAT;
-
-	polygon_layout[2].SemanticName = "NORMAL";
-	polygon_layout[2].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-
-	polygon_layout[3].SemanticName = "TANGENT";
-	polygon_layout[3].Format = DXGI_FORMAT_R32G32B32_FLOAT;
 
-	polygon_layout[4].SemanticName = "BINORMAL";
-	polygon_layout[4].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-
-	CreateShaderObject(device, device_context, hwnd, vs_filename, ps_filename, polygon_layout, kNumOfElements);
-
-	// Create the texture sampler state.
-	sample_state_ = ShaderClass::CreateSamplerState(device);
-
-	matrix_buffer_ = CreateBasicConstantBuffer<MatrixBufferType>(device);
-	if (!matrix_buffer_) throw GAME_EXCEPTION(L"Failed to create matrix buffer");
+	const ModelClass* bound_model = nullptr;
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		const RenderCommand& param = render_queue_[order[i].index];
 
-	camera_buffer_ = CreateBasicConstantBuffer<CameraBufferType>(device);
-	if (!camera_buffer_) throw GAME_EXCEPTION(L"Failed to create camera buffer");
+		// Models sharing buffers have the same sort id.
+		if (!bound_model || bound_model->GetSortId() != param.model->GetSortId())
+		{
+			param.model->Render(device_);
+			bound_model = param.model;
+		}
 
-	light_buffer_ = CreateBasicConstantBuffer<LightBufferType>(device);
-	if (!light_buffer_) throw GAME_EXCEPTION(L"Failed to create light buffer");
-}
+		constants_->Bind(ShaderStage::kVertex, 0, draw_constants_[i]);
+		constants_->Bind(ShaderStage::kPixel, 0, draw_constants_[i]);
 
+		// Set shader texture resource in the pixel shader.
+		device_->SetTexture(0, param.diffuse_texture);
+		device_->SetTexture(1, param.normal_texture);
+		device_->SetTexture(2, param.emissive_texture);
 
-void NormalMapShaderClass::SetShaderParameters(
-	ID3D11DeviceContext* device_context,
-	XMMATRIX world_matrix, XMMATRIX vp_matrix,
-	ID3D11ShaderResourceView* diffuse_texture,
-	ID3D11ShaderResourceView* normal_texture,
-	ID3D11ShaderResourceView* emissive_texture,
-	XMFLOAT3 light_direction, XMFLOAT4 diffuse_color, XMFLOAT3 camera_pos,
-	XMFLOAT3 ambient_weight, XMFLOAT3 diffuse_weight, XMFLOAT3 specular_weight)
-{
-	HRESULT result;
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-	unsigned int bufferNumber;
-	MatrixBufferType* dataPtr;
-	LightBufferType* dataPtr2;
-	CameraBufferType* dataPtr3;
-
-	// Lock the constant buffer so it can be written to.
-	result = device_context->Map(matrix_buffer_.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	if (FAILED(result)) throw GAME_EXCEPTION(L"Failed to lock matrix buffer to set shader parameter.");
-
-	// Get a pointer to the data in the constant buffer.
-	dataPtr = (MatrixBufferType*)mappedResource.pData;
-	// Transpose the matrices to prepare them for the shader.
-	// And Copy them.
-	dataPtr->mvp = XMMatrixTranspose(world_matrix * vp_matrix);
-	dataPtr->world = XMMatrixTranspose(world_matrix);
-	dataPtr->world_tr_inv = XMMatrixInverse(nullptr, world_matrix);
-	// Unlock the constant buffer.
-	device_context->Unmap(matrix_buffer_.Get(), 0);
-	// Set the position of the constant buffer in the vertex shader.
-	bufferNumber = 0;
-	// Now set the constant buffer in the vertex shader with the updated values.
-	device_context->VSSetConstantBuffers(bufferNumber, 1, matrix_buffer_.GetAddressOf());
-
-	// Lock the light constant buffer so it can be written to.
-	result = device_context->Map(light_buffer_.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	if (FAILED(result)) throw GAME_EXCEPTION(L"Failed to lock constant buffer to set shader parameter.");
-	// Get a pointer to the data in the constant buffer.
-	dataPtr2 = (LightBufferType*)mappedResource.pData;
-	// Copy the lighting variables into the constant buffer.
-	dataPtr2->diffuse_color = diffuse_color;
-	dataPtr2->light_direction = light_direction;
-	dataPtr2->padding = 0.0f;
-	dataPtr2->ambient_weight = XMFLOAT4(ambient_weight.x, ambient_weight.y, ambient_weight.z, 1.0f);
-	dataPtr2->diffuse_weight = XMFLOAT4(diffuse_weight.x, diffuse_weight.y, diffuse_weight.z, 1.0f);
-	dataPtr2->specular_weight = XMFLOAT4(specular_weight.x, specular_weight.y, specular_weight.z, 1.0f);
-	// Unlock the constant buffer.
-	device_context->Unmap(light_buffer_.Get(), 0);
-	// Set the position of the light constant buffer in the pixel shader.
-	bufferNumber = 0;
-	// Finally set the light constant buffer in the pixel shader with the updated values.
-	device_context->PSSetConstantBuffers(bufferNumber, 1, light_buffer_.GetAddressOf());
-
-
-	result = device_context->Map(camera_buffer_.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	if (FAILED(result)) throw GAME_EXCEPTION(L"Failed to camera buffer to set shader parameter.");
-	// Get a pointer to the data in the constant buffer.
-	dataPtr3 = (CameraBufferType*)mappedResource.pData;
-	// Copy the camera position into the constant buffer.
-	dataPtr3->camera_pos = camera_pos;
-	dataPtr3->padding = 0.0f;
-	// Unlock the camera constant buffer.
-	device_context->Unmap(camera_buffer_.Get(), 0);
-	// Set the position of the light constant buffer in the pixel shader.
-	bufferNumber = 1;
-	// Finally set the light constant buffer in the pixel shader with the updated values.
-	device_context->PSSetConstantBuffers(bufferNumber, 1, camera_buffer_.GetAddressOf());
-
-
-	// Set shader texture resource in the pixel shader.
-	device_context->PSSetShaderResources(0, 1, &diffuse_texture);
-	device_context->PSSetShaderResources(1, 1, &normal_texture);
-	device_context->PSSetShaderResources(2, 1, &emissive_texture);
+		device_->DrawIndexed(param.index_count, param.index_start);
+	}
 
+	render_queue_.Clear();
 }
 
-
-void NormalMapShaderClass::RenderShader(
-	ID3D11DeviceContext* device_context, int index_count, int index_start)
+void NormalMapShaderClass::InitializeShader(const wchar_t* vs_filename, const wchar_t* ps_filename)
 {
-	// Set the vertex input layout.
-	device_context->IASetInputLayout(input_layout_.Get());
-
-	// Set the vertex and pixel shaders that will be used to render this triangle.
-	device_context->VSSetShader(vertex_shader_.Get(), NULL, 0);
-	device_context->PSSetShader(pixel_shader_.Get(), NULL, 0);
-
-	// Set the sampler state in the pixel shader.
-	device_context->PSSetSamplers(0, 1, sample_state_.GetAddressOf());
+	// This setup needs to match the VertexType stucture in the ModelClass and in the shader.
+	const VertexElement layout[] =
+	{
+		{ "POSITION", 0, VertexFormat::kFloat3 },
+		{ "TEXCOORD", 0, VertexFormat::kFloat2 },
+		{ "NORMAL", 0, VertexFormat::kFloat3 },
+		{ "TANGENT", 0, VertexFormat::kFloat3 },
+		{ "BINORMAL", 0, VertexFormat::kFloat3 },
+	};
 
-	// Render the triangle.
-	device_context->DrawIndexed(index_count, index_start, 0);
+	CreateShaderObject(vs_filename, ps_filename, layout, std::size(layout));
 
-	return;
-}
\ No newline at end of file
+	// Create the texture sampler state.
+	sample_state_ = device_->CreateSampler(AddressMode::kWrap);
+}
@@ -4,12 +4,93 @@
 #include "shader/StoneShaderClass.hh"
 #include "shader/NormalMapShaderClass.hh"
 #include "shader/FireShaderClass.hh"
+#include "graphics/ConstantRing.hh"
+#include "util/MemoryReport.hh"
 
-ShaderManager::ShaderManager(ID3D11Device* device, ID3D11DeviceContext* device_context, HWND hwnd)
+#include <cstdio>
+
+using namespace DirectX;
+
+namespace
+{
+	// Room for the per-draw constants of a few frames.
+	constexpr size_t kConstantRingSize = 256 * 1024;
+
+	// Matches the FrameBuffer of the shaders.
+	struct FrameBufferType
+	{
+		XMMATRIX vp;
+		XMFLOAT4 diffuse_color;
+		XMFLOAT3 light_direction;
+		float frame_time;
+		XMFLOAT3 camera_pos;
+		float padding;
+	};
+}
+
+ShaderManager::ShaderManager(RenderDevice* device)
+	: device_(device)
 {
+	constants_ = std::make_unique<ConstantRing>(device, kConstantRingSize);
+
+	BufferDesc desc;
+	desc.type = BufferType::kConstant;
+	desc.size = sizeof(FrameBufferType);
+	desc.dynamic = true;
+	frame_buffer_ = device->CreateBuffer(desc);
+
 	// Create and initialize the light shader object.
-	light_shader_		= std::make_unique<LightShaderClass>(device, device_context, hwnd);
-	stone_shader_		= std::make_unique<StoneShaderClass>(device, device_context, hwnd);
-	normalMap_shader_	= std::make_unique<NormalMapShaderClass>(device, device_context, hwnd);
-	fire_shader_		= std::make_unique<FireShaderClass>(device, device_context, hwnd);
-}
\ No newline at end of file
+	light_shader_		= std::make_unique<LightShaderClass>(device, constants_.get());
+	stone_shader_		= std::make_unique<StoneShaderClass>(device, constants_.get());
+	normalMap_shader_	= std::make_unique<NormalMapShaderClass>(device, constants_.get());
+	fire_shader_		= std::make_unique<FireShaderClass>(device, constants_.get());
+}
+
+ShaderManager::~ShaderManager()
+{
+	device_->ReleaseBuffer(frame_buffer_);
+}
+
+void ShaderManager::SetFrameConstants(const XMMATRIX& vp_matrix, XMFLOAT3 light_direction,
+	XMFLOAT4 diffuse_color, XMFLOAT3 camera_pos, float frame_time)
+{
+	// Transpose the matrix to prepare it for the shader.
+	FrameBufferType frame_buffer;
+	frame_buffer.vp = XMMatrixTranspose(vp_matrix);
+	frame_buffer.diffuse_color = diffuse_color;
+	frame_buffer.light_direction = light_direction;
+	frame_buffer.frame_time = frame_time;
+	frame_buffer.camera_pos = camera_pos;
+	frame_buffer.padding = 0.0f;
+	device_->UpdateBuffer(frame_buffer_, &frame_buffer, sizeof(frame_buffer));
+
+	device_->SetConstantBuffer(ShaderStage::kVertex, ShaderClass::kFrameSlot, frame_buffer_);
+	device_->SetConstantBuffer(ShaderStage::kPixel, ShaderClass::kFrameSlot, frame_buffer_);
+}
+
+void ShaderManager::AddToReport(MemoryReport& report) const
+{
+	const std::pair<const char*, const ShaderClass*> queues[] =
+	{
+		{ "light", light_shader_.get() },
+		{ "stone", stone_shader_.get() },
+		{ "normal map", normalMap_shader_.get() },
+		{ "fire", fire_shader_.get() },
+	};
+
+	for (const auto& [name, shader] : queues)
+	{
+		const CullStats& stats = shader->GetCullStats();
+		const SortStats& sort_stats = shader->GetSortStats();
+		char note[160];
+		snprintf(note, sizeof(note), "%s queue: %zu visible, %zu culled, %zu sorted in %.1f us",
+			name, stats.visible, stats.culled, sort_stats.sorted, sort_stats.microseconds);
+		report.AddNote("Render", note);
+	}
+
+	const RenderStats& stats = device_->GetFrameStats();
+	char note[192];
+	snprintf(note, sizeof(note), "device: %zu draws of %zu instances, %zu binds, %zu redundant binds dropped, %zu buffer updates",
+		stats.draws, stats.instances, stats.GetStateChanges(), stats.redundant_binds, stats.buffer_updates);
+	report.AddNote("Render", note);
+}
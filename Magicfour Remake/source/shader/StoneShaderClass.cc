@@ -1,20 +1,23 @@
 #include "shader/StoneShaderClass.hh"
 
 #include "graphics/ModelClass.hh"
+#include "graphics/WorldMatrix.hh"
 #include "core/GameException.hh"
-#include "graphics/FrustumCuller.hh"
 
-StoneShaderClass::StoneShaderClass(ID3D11Device* device, ID3D11DeviceContext* device_context, HWND hwnd)
+#include <iterator>
+
+StoneShaderClass::StoneShaderClass(RenderDevice* device, ConstantRing* constants)
+	: ShaderClass(device, constants), instances_(device)
 {
 	// Initialize the vertex and pixel shaders.
-	InitializeShader(device, device_context, hwnd, L"shader/stone.vs", L"shader/stone.ps");
+	InitializeShader(L"shader/stone.vs", L"shader/stone.ps");
 }
 
-void StoneShaderClass::PushRenderQueue(std::shared_ptr<ModelClass> model, XMMATRIX world_matrix, XMFLOAT4 color)
+void StoneShaderClass::PushRenderQueue(const std::shared_ptr<ModelClass>& model, XMMATRIX world_matrix, XMFLOAT4 color)
 {
-	RenderCommand render_command;
+	RenderCommand& render_command = render_queue_.Push();
 
-	render_command.model = model;
+	render_command.model = model.get();
 	render_command.world_matrix = world_matrix;
 	render_command.diffuse_color = color;
 	
@@ -37,210 +40,92 @@ void StoneShaderClass::PushRenderQueue(std::shared_ptr<ModelClass> model, XMMATR
 		}
 	}
 
-	
-
-	render_queue_[model].push_back(render_command);
+	render_command.key = RenderKey::Make(RenderPass::kOpaque, ShaderId::kStone,
+		RenderKey::HashMaterial(nullptr), model->GetSortId());
 }
 
-void StoneShaderClass::ProcessRenderQueue(ID3D11DeviceContext* device_context,
-	const XMMATRIX& vp_matrix, XMFLOAT3 light_direction, XMFLOAT3 camera_pos)
+void StoneShaderClass::ProcessRenderQueue(const XMMATRIX& vp_matrix)
 {
-	FrustumCuller fruster_culler(vp_matrix);
+	const std::vector<SortEntry>& order = render_queue_.Sort(vp_matrix, cull_stats_, sort_stats_);
 
-	for (auto& [model, params] : render_queue_)
+	// Instances in draw order, so a batch draws a range of them.
+	instances_.Clear();
+	for (const SortEntry& entry : order)
 	{
-		// Batch processing for draw calls with same model
-		model->Render(device_context);
-		for (const auto& param : params)
-		{
-			// Check if the model is in the view frustum
-			if (!fruster_culler.IsInFrustum(model->GetBoundingVolume())) continue;
+		const RenderCommand& param = render_queue_[entry.index];
 
-			SetShaderParameters(device_context, param.world_matrix, vp_matrix,
-				light_direction, param.diffuse_color, camera_pos,
-				param.ambient_weight, param.diffuse_weight, param.specular_weight);
-
-			RenderShader(device_context, param.index_count, param.index_start);
-		}
+		InstanceType& instance = instances_.Push();
+		instance.world = param.world_matrix;
+		instance.world_tr_inv = WorldMatrix::NormalMatrix(param.world_matrix, WorldMatrix::Classify(param.world_matrix));
+		instance.diffuse_color = param.diffuse_color;
 	}
 
-	render_queue_.clear();
-}
-
-void StoneShaderClass::Render(
-	ID3D11DeviceContext* device_context,
-	ModelClass* model, XMMATRIX world_matrix, XMMATRIX vp_matrix,
-	XMFLOAT3 light_direction, XMFLOAT4 diffuse_color, XMFLOAT3 camera_pos)
-{
-	model->Render(device_context);
-	auto& material_list = model->GetMaterial();
-	
-	int curr = 0;
-	// Set the shader parameters that it will use for rendering.
-	for (size_t i = 0; i < material_list.size(); i++)
-	{
-		SetShaderParameters(device_context, world_matrix, vp_matrix,
-			light_direction, diffuse_color, camera_pos,
-			material_list[i].first.ambient,
-			material_list[i].first.diffuse,
-			material_list[i].first.specular);
-
-		// Set the vertex input layout.
-		device_context->IASetInputLayout(input_layout_.Get());
-
-		// Set the vertex and pixel shaders that will be used to render this triangle.
-		device_context->VSSetShader(vertex_shader_.Get(), NULL, 0);
-		device_context->PSSetShader(pixel_shader_.Get(), NULL, 0);
-
-		// Set the sampler state in the pixel shader.
-		device_context->PSSetSamplers(0, 1, sample_state_.GetAddressOf());
-
-		// Render the triangle.
-		if(i == material_list.size() - 1)
-			device_context->DrawIndexed(model->GetIndexCount() - material_list[i].second, material_list[i].second, 0);
-		else device_context->DrawIndexed(material_list[i+1].second - material_list[i].second, material_list[i].second, 0);
-	}
-}
+	// A batch for each run of a model's material. The colors are per instance.
+	batches_.clear();
+	render_queue_.ForEachBatch(order,
+		[](const RenderCommand& a, const RenderCommand& b)
+		{
+			return a.model->GetSortId() == b.model->GetSortId() && a.index_start == b.index_start;
+		},
+		[this, &order](uint32_t first, uint32_t count)
+		{
+			const RenderCommand& param = render_queue_[order[first].index];
 
-void StoneShaderClass::InitializeShader(ID3D11Device* device,
-	ID3D11DeviceContext* device_context, HWND hwnd,
-	const WCHAR* vs_filename, const WCHAR* ps_filename)
-{
-	constexpr int kNumOfElements = 3;
-	D3D11_INPUT_ELEMENT_DESC polygon_layout[kNumOfElements];
+			MaterialBufferType material;
+			material.ambient_weight = XMFLOAT4(param.ambient_weight.x, param.ambient_weight.y, param.ambient_weight.z, 1.0f);
+			material.diffuse_weight = XMFLOAT4(param.diffuse_weight.x, param.diffuse_weight.y, param.diffuse_weight.z, 1.0f);
+			material.specular_weight = XMFLOAT4(param.specular_weight.x, param.specular_weight.y, param.specular_weight.z, 1.0f);
+			batches_.push_back({ first, count, constants_->Push(material) });
+		});
 
-	// Create the vertex input layout description.
-	// This setup needs to match the VertexType stucture in the ModelClass and in the shader.
-	for (int i = 0; i < kNumOfElements; i++)
+	if (!order.empty())
 	{
-		polygon_layout[i].SemanticIndex = 0;
-		polygon_layout[i].InputSlot = 0;
-		polygon_layout[i].InstanceDataStepRate = 0;
-		polygon_layout[i].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-		polygon_layout[i].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+		device_->SetShader(shader_);
+		device_->SetSampler(0, sample_state_);
+		instances_.Upload(1);
+		constants_->Upload();
 	}
-	polygon_layout[0].AlignedByteOffset = 0;
-
-	polygon_layout[0].SemanticName = "POSITION";
-	polygon_layout[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-
-	polygon_layout[1].SemanticName = "TEXCOORD";
-	polygon_layout[1].Format = DXGI_FORMAT_R32G32_FLOAT;
-
-	polygon_layout[2].SemanticName = "NORMAL";
-	polygon_layout[2].Format = DXGI_FORMAT_R32G32B32_FLOAT;
 
-	CreateShaderObject(device, device_context, hwnd, vs_filename, ps_filename, polygon_layout, kNumOfElements);
-
-	sample_state_ = ShaderClass::CreateSamplerState(device);
+	const ModelClass* bound_model = nullptr;
+	for (const Batch& batch : batches_)
+	{
+		const RenderCommand& param = render_queue_[order[batch.first].index];
 
-	matrix_buffer_ = CreateBasicConstantBuffer<MatrixBufferType>(device);
-	if (!matrix_buffer_) throw GAME_EXCEPTION(L"Failed to create matrix buffer");
+		// Models sharing buffers have the same sort id.
+		if (!bound_model || bound_model->GetSortId() != param.model->GetSortId())
+		{
+			param.model->Render(device_);
+			bound_model = param.model;
+		}
 
-	camera_buffer_ = CreateBasicConstantBuffer<CameraBufferType>(device);
-	if (!camera_buffer_) throw GAME_EXCEPTION(L"Failed to create camera buffer");
+		constants_->Bind(ShaderStage::kPixel, 0, batch.material);
+		device_->DrawIndexedInstanced(param.index_count, batch.count, param.index_start, 0, batch.first);
+	}
 
-	light_buffer_ = CreateBasicConstantBuffer<LightBufferType>(device);
-	if (!light_buffer_) throw GAME_EXCEPTION(L"Failed to create light buffer");
+	render_queue_.Clear();
 }
 
-
-void StoneShaderClass::SetShaderParameters(ID3D11DeviceContext* device_context,
-	XMMATRIX world_matrix, XMMATRIX vp_matrix, 
-	XMFLOAT3 light_direction, XMFLOAT4 diffuse_color, XMFLOAT3 camera_pos,
-	XMFLOAT3 ambient_weight, XMFLOAT3 diffuse_weight, XMFLOAT3 specular_weight)
+void StoneShaderClass::InitializeShader(const wchar_t* vs_filename, const wchar_t* ps_filename)
 {
-	HRESULT result;
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-	unsigned int bufferNumber;
-	MatrixBufferType* dataPtr;
-	LightBufferType* dataPtr2;
-	CameraBufferType* dataPtr3;
-
-	// Lock the constant buffer so it can be written to.
-	result = device_context->Map(matrix_buffer_.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	if (FAILED(result)) throw GAME_EXCEPTION(L"Failed to lock matrix buffer to set shader parameter.");
-
-	// Get a pointer to the data in the constant buffer.
-	dataPtr = (MatrixBufferType*)mappedResource.pData;
-
-	// Copy the matrices into the constant buffer.
-	// Transpose the matrices to prepare them for the shader.
-	dataPtr->mvp = XMMatrixTranspose(world_matrix * vp_matrix);
-	dataPtr->world = XMMatrixTranspose(world_matrix);
-	dataPtr->world_tr_inv = XMMatrixInverse(nullptr, world_matrix);
-
-	// Unlock the constant buffer.
-	device_context->Unmap(matrix_buffer_.Get(), 0);
-
-	// Set the position of the constant buffer in the vertex shader.
-	bufferNumber = 0;
-
-	// Now set the constant buffer in the vertex shader with the updated values.
-	device_context->VSSetConstantBuffers(bufferNumber, 1, matrix_buffer_.GetAddressOf());
-
-	// Lock the light constant buffer so it can be written to.
-	result = device_context->Map(light_buffer_.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	if (FAILED(result)) throw GAME_EXCEPTION(L"Failed to lock light buffer to set shader parameter.");
-
-
-	// Get a pointer to the data in the constant buffer.
-	dataPtr2 = (LightBufferType*)mappedResource.pData;
-
-	// Copy the lighting variables into the constant buffer.
-	dataPtr2->diffuse_color = diffuse_color;
-	dataPtr2->light_direction = light_direction;
-	dataPtr2->padding = 0.0f;
-
-	dataPtr2->ambient_weight = XMFLOAT4(ambient_weight.x, ambient_weight.y, ambient_weight.z, 1.0f);
-	dataPtr2->diffuse_weight = XMFLOAT4(diffuse_weight.x, diffuse_weight.y, diffuse_weight.z, 1.0f);
-	dataPtr2->specular_weight = XMFLOAT4(specular_weight.x, specular_weight.y, specular_weight.z, 1.0f);
-
-	// Unlock the constant buffer.
-	device_context->Unmap(light_buffer_.Get(), 0);
-
-	// Set the position of the light constant buffer in the pixel shader.
-	bufferNumber = 0;
-
-	// Finally set the light constant buffer in the pixel shader with the updated values.
-	device_context->PSSetConstantBuffers(bufferNumber, 1, light_buffer_.GetAddressOf());
-
-	result = device_context->Map(camera_buffer_.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-	if (FAILED(result)) throw GAME_EXCEPTION(L"Failed to camera matrix buffer to set shader parameter.");
-
-
-	// Get a pointer to the data in the constant buffer.
-	dataPtr3 = (CameraBufferType*)mappedResource.pData;
-
-	// Copy the camera position into the constant buffer.
-	dataPtr3->camera_pos = camera_pos;
-	dataPtr3->padding = 0.0f;
-
-	// Unlock the camera constant buffer.
-	device_context->Unmap(camera_buffer_.Get(), 0);
-
-	// Set the position of the light constant buffer in the pixel shader.
-	bufferNumber = 1;
-
-	// Finally set the light constant buffer in the pixel shader with the updated values.
-	device_context->PSSetConstantBuffers(bufferNumber, 1, camera_buffer_.GetAddressOf());
+	// This setup needs to match the VertexType stucture in the ModelClass, InstanceType and the shader.
+	const VertexElement layout[] =
+	{
+		{ "POSITION", 0, VertexFormat::kFloat3 },
+		{ "TEXCOORD", 0, VertexFormat::kFloat2 },
+		{ "NORMAL", 0, VertexFormat::kFloat3 },
+
+		{ "WORLD", 0, VertexFormat::kFloat4, 1, true },
+		{ "WORLD", 1, VertexFormat::kFloat4, 1, true },
+		{ "WORLD", 2, VertexFormat::kFloat4, 1, true },
+		{ "WORLD", 3, VertexFormat::kFloat4, 1, true },
+		{ "WORLDTRINV", 0, VertexFormat::kFloat4, 1, true },
+		{ "WORLDTRINV", 1, VertexFormat::kFloat4, 1, true },
+		{ "WORLDTRINV", 2, VertexFormat::kFloat4, 1, true },
+		{ "WORLDTRINV", 3, VertexFormat::kFloat4, 1, true },
+		{ "COLOR", 0, VertexFormat::kFloat4, 1, true },
+	};
+
+	CreateShaderObject(vs_filename, ps_filename, layout, std::size(layout));
+
+	sample_state_ = device_->CreateSampler(AddressMode::kWrap);
 }
-
-
-void StoneShaderClass::RenderShader(ID3D11DeviceContext* device_context, int index_count, int index_start)
-{
-	// Set the vertex input layout.
-	device_context->IASetInputLayout(input_layout_.Get());
-
-	// Set the vertex and pixel shaders that will be used to render this triangle.
-	device_context->VSSetShader(vertex_shader_.Get(), NULL, 0);
-	device_context->PSSetShader(pixel_shader_.Get(), NULL, 0);
-
-	// Set the sampler state in the pixel shader.
-	device_context->PSSetSamplers(0, 1, sample_state_.GetAddressOf());
-
-	// Render the triangle.
-	device_context->DrawIndexed(index_count, index_start, 0);
-
-	return;
-}
\ No newline at end of file
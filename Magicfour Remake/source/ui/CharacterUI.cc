@@ -9,6 +9,10 @@
 
 using namespace DirectX;
 
+constexpr ResourceId kScoreTextFormat("score_text_format");
+constexpr ResourceId kSkillGaugeGrayBitmap("skill_gauge_gray");
+constexpr ResourceId kSkillGaugeRainbowBitmap("skill_gauge_rainbow");
+
 void CharacterUI::DrawUI(class D2DClass* direct2D, UserInterfaceClass* ui,
 	IGameObject* obj, time_t curr_time)
 {
@@ -46,7 +50,7 @@ void CharacterUI::DrawScoreAndCombo(D2DClass* direct2D, const UIContext& context
 {
 	// Draw Score
 	direct2D->SetBrushColor(D2D1::ColorF(D2D1::ColorF::Black));
-	direct2D->RenderText(context.fonts_.get("score_text_format").get(), std::to_wstring(character->GetScore()).c_str(),
+	direct2D->RenderText(context.fonts_.get(kScoreTextFormat).get(), std::to_wstring(character->GetScore()).c_str(),
 		0, 30.0f, (float)(context.screen_width_ - 30), 200.0f);
 
 	// Draw Combo
@@ -92,19 +96,21 @@ void CharacterUI::DrawSkillGauge(D2DClass* direct2D, const UIContext& context,
 	const float left = char_screen_x - 40;
 	const float top = char_screen_y - 196;
 
-	const float right = left + context.bitmaps_.get("skill_gauge_gray")->GetWidth();
-	const float bottom = top + context.bitmaps_.get("skill_gauge_gray")->GetHeight();
+	const auto& gauge = context.bitmaps_.get(kSkillGaugeGrayBitmap);
+
+	const float right = left + gauge->GetWidth();
+	const float bottom = top + gauge->GetHeight();
 
 	if (skill_charge_ratio > 0.0f)
 	{
-		const float height = context.bitmaps_.get("skill_gauge_gray")->GetHeight() * skill_charge_ratio;
+		const float height = gauge->GetHeight() * skill_charge_ratio;
 
 		auto dest = D2D1::RectF(left, bottom - height, right, bottom);
 		auto source = D2D1::RectF(0,
-			context.bitmaps_.get("skill_gauge_gray")->GetHeight() - height,
-			right, context.bitmaps_.get("skill_gauge_gray")->GetHeight());
+			gauge->GetHeight() - height,
+			right, gauge->GetHeight());
 
-		direct2D->RenderBitmap(context.bitmaps_.get("skill_gauge_gray").get(), dest, source);
+		direct2D->RenderBitmap(gauge.get(), dest, source);
 	}
 	else
 	{
@@ -123,19 +129,21 @@ void CharacterUI::DrawInvincibleGauge(D2DClass* direct2D, const UIContext& conte
 	const float left = char_screen_x + 40;
 	const float top = char_screen_y - 196;
 
-	const float right = left + context.bitmaps_.get("skill_gauge_rainbow")->GetWidth();
-	const float bottom = top + context.bitmaps_.get("skill_gauge_rainbow")->GetHeight();
+	const auto& gauge = context.bitmaps_.get(kSkillGaugeRainbowBitmap);
+
+	const float right = left + gauge->GetWidth();
+	const float bottom = top + gauge->GetHeight();
 
 	if (invincible_ratio > 0.0f)
 	{
-		const float height = context.bitmaps_.get("skill_gauge_rainbow")->GetHeight() * invincible_ratio;
+		const float height = gauge->GetHeight() * invincible_ratio;
 
 		auto dest = D2D1::RectF(left, bottom - height, right, bottom);
 		auto source = D2D1::RectF(0,
-			context.bitmaps_.get("skill_gauge_rainbow")->GetHeight() - height,
-			right, context.bitmaps_.get("skill_gauge_rainbow")->GetHeight());
+			gauge->GetHeight() - height,
+			right, gauge->GetHeight());
 
-		direct2D->RenderBitmap(context.bitmaps_.get("skill_gauge_rainbow").get(), dest, source);
+		direct2D->RenderBitmap(gauge.get(), dest, source);
 	}
 	else
 	{
@@ -9,6 +9,8 @@
 
 using namespace DirectX;
 
+constexpr ResourceId kMonsterHpGaugeBitmap("monster_hp_gauge");
+
 void MonsterUI::DrawUI(D2DClass* direct2D, UserInterfaceClass* ui,
 	class IGameObject* obj, time_t curr_time)
 {
@@ -32,7 +34,7 @@ void MonsterUI::DrawUI(D2DClass* direct2D, UserInterfaceClass* ui,
 void MonsterUI::DrawMonsterHp(class D2DClass* direct2D, UserInterfaceClass* ui,
 	int center_x, int top, float hp_ratio, float hp_white_ratio)
 {
-	const auto hp_gauge_bitmap = ui->GetContext().bitmaps_.get("monster_hp_gauge");
+	const auto hp_gauge_bitmap = ui->GetContext().bitmaps_.get(kMonsterHpGaugeBitmap);
 
 	const float left = center_x - hp_gauge_bitmap->GetWidth() / 2;
 	const float right = left + hp_gauge_bitmap->GetWidth();
@@ -5,6 +5,11 @@
 #include "ui/UserInterfaceClass.hh"
 #include "core/D2DClass.hh"
 
+constexpr ResourceId kFpsTextFormat("fps_text_format");
+constexpr ResourceId kGameoverTextFormat("gameover_text_format");
+constexpr ResourceId kPauseDescriptionFormat("pause_description_format");
+constexpr ResourceId kPauseTextFormat("pause_text_format");
+
 void SystemUI::DrawUI(class D2DClass* direct2D,
 	UserInterfaceClass* ui, time_t actual_curr_time)
 {
@@ -22,7 +27,7 @@ void SystemUI::DrawUI(class D2DClass* direct2D,
 
 void SystemUI::DrawFps(D2DClass* direct2D, const UIContext& context)
 {
-	const auto font = context.fonts_.get("fps_text_format").get();
+	const auto font = context.fonts_.get(kFpsTextFormat).get();
 	const std::wstring text = L"fps: " + std::to_wstring(context.system_context_.prev_frame_cnt);
 
 	direct2D->SetBrushColor(D2D1::ColorF(D2D1::ColorF::Black));
@@ -35,9 +40,9 @@ void SystemUI::DrawFps(D2DClass* direct2D, const UIContext& context)
 void SystemUI::DrawPauseMark(D2DClass* direct2D, const UIContext& context)
 {
 	direct2D->SetBrushColor(D2D1::ColorF(D2D1::ColorF::DarkRed));
-	direct2D->RenderText(context.fonts_.get("pause_text_format").get(), L"<< Paused >>",
+	direct2D->RenderText(context.fonts_.get(kPauseTextFormat).get(), L"<< Paused >>",
 		0, 30.0f, context.f_screen_width_, 70.0f);
-	direct2D->RenderText(context.fonts_.get("pause_description_format").get(), L"To resume, press R key.",
+	direct2D->RenderText(context.fonts_.get(kPauseDescriptionFormat).get(), L"To resume, press R key.",
 		0, 70.0f, context.f_screen_width_, 100.0f);
 }
 
@@ -49,6 +54,6 @@ void SystemUI::DrawGameoverScreen(D2DClass* direct2D, const UIContext& context,
 
 	const float text_alpha = SATURATE(0.0f, (gameover_elapsed_time - 2500) / 1500.f, 1.0f);
 	direct2D->SetBrushColor(D2D1::ColorF(D2D1::ColorF::White, text_alpha));
-	direct2D->RenderText(context.fonts_.get("gameover_text_format").get(), L"GAME OVER",
+	direct2D->RenderText(context.fonts_.get(kGameoverTextFormat).get(), L"GAME OVER",
 		0, 0, context.f_screen_width_, context.f_screen_height_);
 }
\ No newline at end of file
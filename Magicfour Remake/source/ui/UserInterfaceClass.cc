@@ -19,8 +19,8 @@
 using namespace std;
 using namespace DirectX;
 
-UserInterfaceClass::UserInterfaceClass(class D2DClass* direct2D,
-	ID3D11Device* device, int screen_width, int screen_height)
+UserInterfaceClass::UserInterfaceClass(class D2DClass* direct2D, ID3D11Device* device,
+	const ResourceManifest& manifest, int screen_width, int screen_height)
 	: context(screen_width, screen_height)
 {
 	const std::unordered_map<std::string, DWRITE_TEXT_ALIGNMENT> kTextAlignmentMap = {
@@ -36,7 +36,7 @@ UserInterfaceClass::UserInterfaceClass(class D2DClass* direct2D,
 		{"center", DWRITE_PARAGRAPH_ALIGNMENT_CENTER}
 	};
 
-	auto font_loader = [&kTextAlignmentMap, &kParagraphAlignmentMap, direct2D](xml_node_wrapper node)
+	auto font_loader = [&kTextAlignmentMap, &kParagraphAlignmentMap, direct2D](resource_node node)
 		-> std::shared_ptr<FontClass>
 		{
 			// find text alignment key
@@ -52,13 +52,21 @@ UserInterfaceClass::UserInterfaceClass(class D2DClass* direct2D,
 			);
 			
 		};
-	context.fonts_.loadFromXML("data/resources.xml", "Font", font_loader);
+	context.fonts_.loadFromManifest(manifest, "Font", font_loader);
 
-	auto bitmap_loader = [direct2D](xml_node_wrapper node) -> std::shared_ptr<BitmapClass>
+	// Images are decoded on the worker pool, and turned into D2D bitmaps here.
+	auto bitmap_loader = [direct2D](resource_node node)
 	{
-		return make_shared<BitmapClass>(direct2D, node.get_required_attr("src"));
+		std::string src = node.get_required_attr("src");
+		return BitmapClass::DecodeImageFile(direct2D->GetWicFactory(), std::wstring(src.begin(), src.end()).c_str());
 	};
-	context.bitmaps_.loadFromXML("data/resources.xml", "Bitmap", bitmap_loader);
+
+	auto bitmap_creator = [direct2D](resource_node node, Microsoft::WRL::ComPtr<IWICBitmap>& image)
+		-> std::shared_ptr<BitmapClass>
+	{
+		return make_shared<BitmapClass>(direct2D, image.Get());
+	};
+	context.bitmaps_.loadFromManifest(manifest, "Bitmap", bitmap_loader, bitmap_creator);
 
 }
 
@@ -66,6 +74,13 @@ UserInterfaceClass::~UserInterfaceClass()
 {
 }
 
+void UserInterfaceClass::AddToReport(MemoryReport& report) const
+{
+	context.bitmaps_.addToReport(report, "Bitmaps", [](const BitmapClass& bitmap) {
+		return bitmap.GetMemoryUsage();
+	});
+}
+
 void UserInterfaceClass::CalculateScreenPos(const XMMATRIX& mvp_matrix,
 	const XMMATRIX& ortho_inv, float& x, float& y) const 
 {
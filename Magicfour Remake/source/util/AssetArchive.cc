@@ -0,0 +1,207 @@
+#include "util/AssetArchive.hh"
+
+#include "core/GameException.hh"
+#include "util/FileSystem.hh"
+#include "util/Hash.hh"
+#include "util/ResourceManifest.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <unordered_set>
+
+using namespace std;
+
+namespace
+{
+	constexpr char kArchiveMagic[4] = { 'M', '4', 'P', 'K' };
+
+	// Bump this when the layout of the archive is changed.
+	constexpr uint32_t kArchiveVersion = 1;
+
+	// Cooked files written next to a source, see TextureCooker, ModelClass and ResourceManifest.
+	constexpr const char* kCookedSuffixes[] = { ".dds", ".cooked" };
+
+	bool IsNotOlder(const string& filename, const string& than_filename)
+	{
+		error_code error;
+		const auto time = filesystem::last_write_time(filename, error);
+		if (error) return false;
+
+		const auto than_time = filesystem::last_write_time(than_filename, error);
+		return error || time >= than_time;
+	}
+
+	void AddMaterialLibraries(const string& model_filename, vector<string>& file_paths)
+	{
+		ifstream fin(model_filename);
+		if (!fin) return;
+
+		const size_t slash = model_filename.find_last_of("/\\");
+		const string directory = (slash == string::npos) ? "" : model_filename.substr(0, slash + 1);
+
+		string line;
+		while (getline(fin, line))
+		{
+			if (line.compare(0, 7, "mtllib ") != 0) continue;
+
+			size_t end = line.find_last_not_of(" \t\r");
+			file_paths.push_back(directory + line.substr(7, end - 6));
+		}
+	}
+}
+
+AssetArchive::AssetArchive(const char* archive_filename)
+	: file_(archive_filename), entries_(nullptr), path_table_(nullptr), entry_count_(0)
+{
+	if (file_.GetSize() < sizeof(Header)) throw fileformat_error(archive_filename, WFILE, __LINE__);
+
+	const Header& header = *reinterpret_cast<const Header*>(file_.GetData());
+	if (memcmp(header.magic, kArchiveMagic, sizeof(header.magic)) != 0 ||
+		header.version != kArchiveVersion ||
+		header.file_size != file_.GetSize() ||
+		sizeof(Header) + header.entry_count * sizeof(Entry) + header.path_table_size > file_.GetSize())
+	{
+		throw fileformat_error(archive_filename, WFILE, __LINE__);
+	}
+
+	entries_ = reinterpret_cast<const Entry*>(file_.GetData() + sizeof(Header));
+	path_table_ = file_.GetData() + sizeof(Header) + header.entry_count * sizeof(Entry);
+	entry_count_ = header.entry_count;
+}
+
+bool AssetArchive::Find(string_view path, string_view& content) const
+{
+	const uint64_t path_hash = HashBytes(path);
+
+	// Entries are sorted by hash, and by path among equal hashes.
+	const Entry* end = entries_ + entry_count_;
+	const Entry* entry = lower_bound(entries_, end, path_hash, [](const Entry& entry, uint64_t hash) {
+		return entry.path_hash < hash;
+	});
+
+	for (; entry != end && entry->path_hash == path_hash; entry++)
+	{
+		if (string_view(path_table_ + entry->path_offset, entry->path_length) != path) continue;
+
+		content = string_view(file_.GetData() + entry->offset, static_cast<size_t>(entry->size));
+		return true;
+	}
+
+	return false;
+}
+
+string_view AssetArchive::GetPath(size_t index) const
+{
+	return string_view(path_table_ + entries_[index].path_offset, entries_[index].path_length);
+}
+
+void AssetArchive::Build(const char* archive_filename, const vector<string>& file_paths)
+{
+	vector<string> paths;
+	unordered_set<string> visited;
+	for (const auto& file_path : file_paths)
+	{
+		string path = FileSystem::NormalizePath(file_path);
+		if (visited.insert(path).second) paths.push_back(move(path));
+	}
+
+	vector<Entry> entries(paths.size());
+	string path_table;
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		entries[i].path_hash = HashBytes(paths[i]);
+		entries[i].path_offset = static_cast<uint32_t>(path_table.size());
+		entries[i].path_length = static_cast<uint32_t>(paths[i].size());
+		path_table += paths[i];
+	}
+
+	// Sort indices rather than entries, as payloads are written in the order of the paths.
+	vector<size_t> order(paths.size());
+	for (size_t i = 0; i < order.size(); i++) order[i] = i;
+	sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		if (entries[a].path_hash != entries[b].path_hash) return entries[a].path_hash < entries[b].path_hash;
+		return paths[a] < paths[b];
+	});
+
+	auto align = [](uint64_t offset) {
+		return (offset + kPayloadAlignment - 1) & ~(kPayloadAlignment - 1);
+	};
+
+	// Payloads keep the order given, so files loaded together are paged in together.
+	uint64_t offset = align(sizeof(Header) + entries.size() * sizeof(Entry) + path_table.size());
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		error_code error;
+		entries[i].size = filesystem::file_size(paths[i], error);
+		if (error) throw filenotfound_error(paths[i].c_str(), WFILE, __LINE__);
+
+		entries[i].offset = offset;
+		offset = align(offset + entries[i].size);
+	}
+
+	Header header = {};
+	memcpy(header.magic, kArchiveMagic, sizeof(header.magic));
+	header.version = kArchiveVersion;
+	header.entry_count = static_cast<uint32_t>(entries.size());
+	header.path_table_size = static_cast<uint32_t>(path_table.size());
+	header.file_size = offset;
+
+	ofstream fout(archive_filename, ios::binary | ios::trunc);
+	if (!fout) throw GAME_EXCEPTION(L"Failed to create asset archive.");
+
+	fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	for (size_t index : order) fout.write(reinterpret_cast<const char*>(&entries[index]), sizeof(Entry));
+	fout.write(path_table.data(), path_table.size());
+
+	const char padding[kPayloadAlignment] = {};
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		const uint64_t position = static_cast<uint64_t>(fout.tellp());
+		fout.write(padding, static_cast<streamsize>(entries[i].offset - position));
+
+		MappedFile file(paths[i].c_str());
+		fout.write(file.GetData(), static_cast<streamsize>(file.GetSize()));
+	}
+
+	const uint64_t position = static_cast<uint64_t>(fout.tellp());
+	fout.write(padding, static_cast<streamsize>(header.file_size - position));
+
+	if (!fout) throw GAME_EXCEPTION(L"Failed to write asset archive.");
+}
+
+vector<string> AssetArchive::CollectResourceFiles(const char* xml_file_path)
+{
+	vector<string> file_paths;
+	file_paths.push_back(xml_file_path);
+
+	ResourceManifest manifest(xml_file_path);
+	for (const char* type : { "Model", "Texture", "Sound", "Bitmap" })
+	{
+		for (const auto& node : manifest.GetNodes(type))
+		{
+			for (const char* attr_name : { "src", "model_path" })
+			{
+				const string path = node.get_attr(attr_name);
+				if (path.empty()) continue;
+
+				file_paths.push_back(path);
+				if (strcmp(attr_name, "model_path") == 0) AddMaterialLibraries(path, file_paths);
+			}
+		}
+	}
+
+	// Stale cooked files would be ignored by the loaders, so they are not packed.
+	const size_t source_count = file_paths.size();
+	for (size_t i = 0; i < source_count; i++)
+	{
+		for (const char* suffix : kCookedSuffixes)
+		{
+			const string cooked_filename = file_paths[i] + suffix;
+			if (IsNotOlder(cooked_filename, file_paths[i])) file_paths.push_back(cooked_filename);
+		}
+	}
+
+	return file_paths;
+}
@@ -0,0 +1,58 @@
+#include "util/FileSystem.hh"
+
+#include "core/GameException.hh"
+
+#include <windows.h>
+
+using namespace std;
+
+unique_ptr<AssetArchive> FileSystem::archive_;
+
+void FileSystem::Mount(const char* archive_filename)
+{
+	archive_ = make_unique<AssetArchive>(archive_filename);
+}
+
+void FileSystem::Unmount()
+{
+	archive_.reset();
+}
+
+FileView FileSystem::Open(const string& path)
+{
+	if (archive_)
+	{
+		string_view content;
+		if (archive_->Find(NormalizePath(path), content)) return FileView(content);
+	}
+
+	// Files not packed, such as ones written by the game, are read from disk.
+	return FileView(make_unique<MappedFile>(path.c_str()));
+}
+
+bool FileSystem::Exists(const string& path)
+{
+	if (IsInArchive(path)) return true;
+
+	const DWORD attributes = GetFileAttributesA(path.c_str());
+	return attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+bool FileSystem::IsInArchive(const string& path)
+{
+	string_view content;
+	return archive_ && archive_->Find(NormalizePath(path), content);
+}
+
+string FileSystem::NormalizePath(string_view path)
+{
+	string normalized(path);
+	for (char& c : normalized)
+	{
+		if (c == '\\') c = '/';
+	}
+
+	while (normalized.compare(0, 2, "./") == 0) normalized.erase(0, 2);
+
+	return normalized;
+}
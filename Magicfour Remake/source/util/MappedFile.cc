@@ -0,0 +1,45 @@
+#include "util/MappedFile.hh"
+
+#include "core/GameException.hh"
+
+MappedFile::MappedFile(const char* filename)
+	: file_(INVALID_HANDLE_VALUE), mapping_(NULL), data_(nullptr), size_(0)
+{
+	file_ = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file_ == INVALID_HANDLE_VALUE) throw filenotfound_error(filename, WFILE, __LINE__);
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file_, &file_size))
+	{
+		CloseHandle(file_);
+		throw GAME_EXCEPTION(L"Failed to get size of mapped file.");
+	}
+
+	size_ = static_cast<size_t>(file_size.QuadPart);
+
+	// A file of zero length can not be mapped.
+	if (size_ == 0) return;
+
+	mapping_ = CreateFileMappingA(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping_ == NULL)
+	{
+		CloseHandle(file_);
+		throw GAME_EXCEPTION(L"Failed to create file mapping.");
+	}
+
+	data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+	if (data_ == nullptr)
+	{
+		CloseHandle(mapping_);
+		CloseHandle(file_);
+		throw GAME_EXCEPTION(L"Failed to map view of file.");
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (data_) UnmapViewOfFile(data_);
+	if (mapping_) CloseHandle(mapping_);
+	if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+}
@@ -0,0 +1,88 @@
+#include "util/MemoryReport.hh"
+
+#include "core/GameException.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+using namespace std;
+
+namespace
+{
+	constexpr double kKilobyte = 1024.0;
+	constexpr int kLabelWidth = 48;
+
+	void WriteLine(ostream& out, const char* label, const MemoryUsage& usage, int indent)
+	{
+		char line[512];
+		snprintf(line, sizeof(line), "%*s%-*s CPU %10.1f KB  GPU %10.1f KB\n", indent, "", kLabelWidth - indent, label,
+			usage.cpu_bytes / kKilobyte, usage.gpu_bytes / kKilobyte);
+		out << line;
+	}
+}
+
+void MemoryReport::Add(const string& group_name, const string& asset_name, const MemoryUsage& usage)
+{
+	entries_.push_back({ group_name, asset_name, usage });
+}
+
+void MemoryReport::AddNote(const string& group_name, const string& note)
+{
+	notes_.emplace_back(group_name, note);
+}
+
+MemoryUsage MemoryReport::GetTotal() const
+{
+	MemoryUsage total;
+	for (const auto& entry : entries_) total += entry.usage;
+	return total;
+}
+
+void MemoryReport::Write(ostream& out) const
+{
+	vector<string> group_names;
+	auto add_group = [&group_names](const string& group_name) {
+		if (find(group_names.begin(), group_names.end(), group_name) == group_names.end())
+		{
+			group_names.push_back(group_name);
+		}
+	};
+	for (const auto& entry : entries_) add_group(entry.group_name);
+	for (const auto& note : notes_) add_group(note.first);
+
+	for (const auto& group_name : group_names)
+	{
+		vector<const Entry*> group;
+		MemoryUsage group_total;
+		for (const auto& entry : entries_)
+		{
+			if (entry.group_name != group_name) continue;
+			group.push_back(&entry);
+			group_total += entry.usage;
+		}
+
+		stable_sort(group.begin(), group.end(), [](const Entry* a, const Entry* b) {
+			return a->usage.cpu_bytes + a->usage.gpu_bytes > b->usage.cpu_bytes + b->usage.gpu_bytes;
+		});
+
+		const string label = group_name + " (" + to_string(group.size()) + " assets)";
+		WriteLine(out, label.c_str(), group_total, 0);
+		for (const auto& note : notes_)
+		{
+			if (note.first == group_name) out << "  " << note.second << '\n';
+		}
+		for (const Entry* entry : group) WriteLine(out, entry->asset_name.c_str(), entry->usage, 2);
+		out << '\n';
+	}
+
+	WriteLine(out, "Total", GetTotal(), 0);
+}
+
+void MemoryReport::Write(const char* filename) const
+{
+	ofstream fout(filename, ios::trunc);
+	if (!fout) throw GAME_EXCEPTION(L"Failed to create memory report.");
+
+	Write(fout);
+}
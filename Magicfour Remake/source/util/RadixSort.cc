@@ -0,0 +1,54 @@
+#include "util/RadixSort.hh"
+
+#include <cstddef>
+
+using namespace std;
+
+namespace
+{
+	constexpr int kRadixBits = 8;
+	constexpr size_t kBucketCount = size_t(1) << kRadixBits;
+	constexpr int kPassCount = 64 / kRadixBits;
+}
+
+void RadixSort(vector<SortEntry>& entries, vector<SortEntry>& scratch)
+{
+	const size_t count = entries.size();
+	if (count < 2) return;
+
+	// Histograms of every pass at once, in one read of the keys.
+	uint32_t histograms[kPassCount][kBucketCount] = {};
+	for (const SortEntry& entry : entries)
+	{
+		for (int pass = 0; pass < kPassCount; pass++)
+			histograms[pass][(entry.key >> (pass * kRadixBits)) & (kBucketCount - 1)]++;
+	}
+
+	scratch.resize(count);
+	vector<SortEntry>* source = &entries;
+	vector<SortEntry>* target = &scratch;
+
+	for (int pass = 0; pass < kPassCount; pass++)
+	{
+		uint32_t* histogram = histograms[pass];
+		const int shift = pass * kRadixBits;
+
+		// Every key has the same byte here; the order stays as it is.
+		if (histogram[((*source)[0].key >> shift) & (kBucketCount - 1)] == count) continue;
+
+		uint32_t offset = 0;
+		for (size_t bucket = 0; bucket < kBucketCount; bucket++)
+		{
+			const uint32_t bucket_size = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucket_size;
+		}
+
+		for (const SortEntry& entry : *source)
+			(*target)[histogram[(entry.key >> shift) & (kBucketCount - 1)]++] = entry;
+
+		swap(source, target);
+	}
+
+	if (source != &entries) entries.swap(scratch);
+}
@@ -0,0 +1,259 @@
+#include "util/ResourceManifest.hh"
+
+#include "core/GameException.hh"
+#include "util/FileSystem.hh"
+#include "../third-party/rapidxml-1.13/rapidxml.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+using namespace std;
+
+namespace
+{
+	struct CompiledManifestHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t node_count;
+		uint32_t attribute_count;
+		uint32_t strings_size;
+	};
+
+	constexpr char kCompiledManifestMagic[4] = { 'M', '4', 'R', 'M' };
+
+	// Bump this when the layout of the compiled file is changed.
+	constexpr uint32_t kCompiledManifestVersion = 1;
+}
+
+const char* resource_node::type() const
+{
+	return manifest->GetString(manifest->nodes_[index].type);
+}
+
+const char* resource_node::find_attr(const char* attr_name) const
+{
+	const auto& node = manifest->nodes_[index];
+	for (uint32_t i = node.first_attribute; i < node.first_attribute + node.attribute_count; i++)
+	{
+		const auto& attribute = manifest->attributes_[i];
+		if (strcmp(manifest->GetString(attribute.name), attr_name) == 0) return manifest->GetString(attribute.value);
+	}
+	return nullptr;
+}
+
+string resource_node::get_required_attr(const char* attr_name) const
+{
+	const char* value = find_attr(attr_name);
+	if (!value) throw GAME_EXCEPTION(L"Missing required attribute: " + wstring(attr_name, attr_name + strlen(attr_name)));
+	return string(value);
+}
+
+string resource_node::get_attr(const char* attr_name, const char* default_value) const
+{
+	const char* value = find_attr(attr_name);
+	return string(value ? value : default_value);
+}
+
+resource_node resource_node::first_node(const char* type_name) const
+{
+	uint32_t child = manifest->nodes_[index].first_child;
+	while (child != kNone && strcmp(manifest->GetString(manifest->nodes_[child].type), type_name) != 0)
+	{
+		child = manifest->nodes_[child].next_sibling;
+	}
+	return resource_node(manifest, child);
+}
+
+resource_node resource_node::next_sibling(const char* type_name) const
+{
+	uint32_t sibling = manifest->nodes_[index].next_sibling;
+	while (sibling != kNone && strcmp(manifest->GetString(manifest->nodes_[sibling].type), type_name) != 0)
+	{
+		sibling = manifest->nodes_[sibling].next_sibling;
+	}
+	return resource_node(manifest, sibling);
+}
+
+ResourceManifest::ResourceManifest(const char* xml_file_path)
+{
+	if (!IsCompiledUpToDate(xml_file_path) || !LoadCompiled(GetCompiledFilename(xml_file_path)))
+	{
+		ParseXML(xml_file_path);
+	}
+
+	BuildIndex();
+}
+
+const vector<resource_node>& ResourceManifest::GetNodes(const char* type_name) const
+{
+	static const vector<resource_node> kNoNodes;
+
+	auto nodes = nodes_by_type_.find(type_name);
+	return (nodes != nodes_by_type_.end()) ? nodes->second : kNoNodes;
+}
+
+resource_node ResourceManifest::Find(const char* type_name, const string& name) const
+{
+	auto nodes = nodes_by_name_.find(type_name);
+	if (nodes == nodes_by_name_.end()) return resource_node();
+
+	auto node = nodes->second.find(name);
+	return (node != nodes->second.end()) ? node->second : resource_node();
+}
+
+string ResourceManifest::GetCompiledFilename(const string& xml_file_path)
+{
+	return xml_file_path + ".cooked";
+}
+
+bool ResourceManifest::IsCompiledUpToDate(const string& xml_file_path)
+{
+	// Only up-to-date compiled files are packed into the archive.
+	const string compiled_filename = GetCompiledFilename(xml_file_path);
+	if (FileSystem::IsInArchive(compiled_filename)) return true;
+
+	error_code error;
+	const auto compiled_time = filesystem::last_write_time(compiled_filename, error);
+	if (error) return false;
+
+	// Without the XML file, the compiled file is all we have.
+	const auto xml_time = filesystem::last_write_time(xml_file_path, error);
+	if (error) return true;
+
+	return compiled_time >= xml_time;
+}
+
+void ResourceManifest::Compile(const char* xml_file_path)
+{
+	ResourceManifest manifest;
+	manifest.ParseXML(xml_file_path);
+	manifest.SaveCompiled(GetCompiledFilename(xml_file_path));
+}
+
+void ResourceManifest::ParseXML(const char* xml_file_path)
+{
+	FileView file = FileSystem::Open(xml_file_path);
+
+	// rapidxml parses in place, so it needs a writable copy.
+	string xml_content(file.GetData(), file.GetSize());
+
+	rapidxml::xml_document<> doc;
+	try
+	{
+		doc.parse<0>(&xml_content[0]);
+	}
+	catch (const rapidxml::parse_error& e)
+	{
+		throw GAME_EXCEPTION(L"Failed to parse resource map XML file.");
+	}
+
+	auto root = doc.first_node("Resources");
+	if (!root) throw GAME_EXCEPTION(L"Invalid resource map XML format: Missing <Resources> root element.");
+
+	unordered_map<string, uint32_t> string_offsets;
+	auto intern = [this, &string_offsets](const char* str) {
+		auto inserted = string_offsets.emplace(str, static_cast<uint32_t>(strings_.size()));
+		if (inserted.second) strings_.append(str, strlen(str) + 1);
+		return inserted.first->second;
+	};
+
+	// Depth first, so nodes are stored in document order.
+	auto add_node = [this, &intern](rapidxml::xml_node<>* xml_node, auto& add_node) -> uint32_t {
+		const uint32_t index = static_cast<uint32_t>(nodes_.size());
+
+		Node node = {};
+		node.type = intern(xml_node->name());
+		node.first_child = node.next_sibling = resource_node::kNone;
+		node.first_attribute = static_cast<uint32_t>(attributes_.size());
+		for (auto attr = xml_node->first_attribute(); attr; attr = attr->next_attribute())
+		{
+			attributes_.push_back({ intern(attr->name()), intern(attr->value()) });
+			node.attribute_count++;
+		}
+		nodes_.push_back(node);
+
+		uint32_t prev_child = resource_node::kNone;
+		for (auto child = xml_node->first_node(); child; child = child->next_sibling())
+		{
+			const uint32_t child_index = add_node(child, add_node);
+			if (prev_child == resource_node::kNone) nodes_[index].first_child = child_index;
+			else nodes_[prev_child].next_sibling = child_index;
+			prev_child = child_index;
+		}
+
+		return index;
+	};
+
+	add_node(root, add_node);
+}
+
+bool ResourceManifest::LoadCompiled(const string& compiled_filename)
+{
+	FileView file;
+	try
+	{
+		file = FileSystem::Open(compiled_filename);
+	}
+	catch (const GameException&)
+	{
+		return false;
+	}
+
+	if (file.GetSize() < sizeof(CompiledManifestHeader)) return false;
+
+	CompiledManifestHeader header;
+	memcpy(&header, file.GetData(), sizeof(header));
+
+	const size_t nodes_size = sizeof(Node) * header.node_count;
+	const size_t attributes_size = sizeof(Attribute) * header.attribute_count;
+	if (memcmp(header.magic, kCompiledManifestMagic, sizeof(header.magic)) != 0 ||
+		header.version != kCompiledManifestVersion ||
+		header.node_count == 0 ||
+		file.GetSize() != sizeof(header) + nodes_size + attributes_size + header.strings_size) return false;
+
+	const char* data = file.GetData() + sizeof(header);
+
+	nodes_.resize(header.node_count);
+	memcpy(nodes_.data(), data, nodes_size); data += nodes_size;
+
+	attributes_.resize(header.attribute_count);
+	memcpy(attributes_.data(), data, attributes_size); data += attributes_size;
+
+	strings_.assign(data, header.strings_size);
+
+	return true;
+}
+
+void ResourceManifest::SaveCompiled(const string& compiled_filename) const
+{
+	CompiledManifestHeader header = {};
+	memcpy(header.magic, kCompiledManifestMagic, sizeof(header.magic));
+	header.version = kCompiledManifestVersion;
+	header.node_count = static_cast<uint32_t>(nodes_.size());
+	header.attribute_count = static_cast<uint32_t>(attributes_.size());
+	header.strings_size = static_cast<uint32_t>(strings_.size());
+
+	ofstream fout(compiled_filename, ios::binary | ios::trunc);
+	if (!fout) throw GAME_EXCEPTION(L"Failed to create compiled resource manifest.");
+
+	fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	fout.write(reinterpret_cast<const char*>(nodes_.data()), sizeof(Node) * nodes_.size());
+	fout.write(reinterpret_cast<const char*>(attributes_.data()), sizeof(Attribute) * attributes_.size());
+	fout.write(strings_.data(), strings_.size());
+
+	if (!fout) throw GAME_EXCEPTION(L"Failed to write compiled resource manifest.");
+}
+
+void ResourceManifest::BuildIndex()
+{
+	// The root itself is not a resource.
+	for (uint32_t i = 1; i < nodes_.size(); i++)
+	{
+		resource_node node(this, i);
+		nodes_by_type_[node.type()].push_back(node);
+
+		if (const char* name = node.find_attr("name")) nodes_by_name_[node.type()].emplace(name, node);
+	}
+}
@@ -0,0 +1,70 @@
+#include "util/ThreadPool.hh"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <objbase.h>
+#endif
+
+using namespace std;
+
+ThreadPool::ThreadPool(size_t thread_count)
+	: stopping_(false)
+{
+	if (thread_count == 0)
+	{
+		const unsigned int cores = thread::hardware_concurrency();
+		thread_count = (cores > 1) ? cores - 1 : 1;
+	}
+
+	workers_.reserve(thread_count);
+	for (size_t i = 0; i < thread_count; i++)
+	{
+		workers_.emplace_back(&ThreadPool::WorkerMain, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard<mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	condition_.notify_all();
+
+	for (auto& worker : workers_) worker.join();
+}
+
+ThreadPool& ThreadPool::GetInstance()
+{
+	static ThreadPool instance;
+	return instance;
+}
+
+void ThreadPool::WorkerMain()
+{
+	// Decoders run on the workers may use COM, e.g. WIC.
+#ifdef _WIN32
+	const HRESULT com_result = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+
+	while (true)
+	{
+		function<void()> task;
+		{
+			unique_lock<mutex> lock(mutex_);
+			condition_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+
+			// Remaining tasks are still run, as someone may wait for their futures.
+			if (tasks_.empty()) break;
+
+			task = move(tasks_.front());
+			tasks_.pop();
+		}
+
+		task();
+	}
+
+#ifdef _WIN32
+	if (SUCCEEDED(com_result)) CoUninitialize();
+#endif
+}
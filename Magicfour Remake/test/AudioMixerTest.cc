@@ -0,0 +1,259 @@
+#include "audio/AudioBackend.hh"
+#include "audio/AudioClip.hh"
+#include "audio/AudioMixer.hh"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	// Mono clip at the mixer rate, so it is mixed without resampling, of one constant sample.
+	shared_ptr<AudioClip> MakeClip(int16_t value, size_t frame_count)
+	{
+		return make_shared<AudioClip>(AudioMixer::kSampleRate, 1, vector<int16_t>(frame_count, value));
+	}
+
+	AudioMixer::SoundSettings MakeSettings(int priority, uint32_t max_instances, float coalesce_ms)
+	{
+		AudioMixer::SoundSettings settings;
+		settings.priority = priority;
+		settings.max_instances = max_instances;
+		settings.coalesce_ms = coalesce_ms;
+		return settings;
+	}
+
+	string ReadFile(const filesystem::path& path)
+	{
+		ifstream fin(path, ios::binary);
+		return string(istreambuf_iterator<char>(fin), istreambuf_iterator<char>());
+	}
+
+	// Bytes of a 16-bit PCM WAVE file.
+	string MakeWave(uint32_t sample_rate, uint16_t channel_count, const vector<int16_t>& samples)
+	{
+		auto append = [](string& bytes, auto value) { bytes.append(reinterpret_cast<const char*>(&value), sizeof(value)); };
+		const uint32_t data_size = static_cast<uint32_t>(samples.size() * sizeof(int16_t));
+
+		string bytes = "RIFF";
+		append(bytes, uint32_t(36 + data_size));
+		bytes += "WAVEfmt ";
+		append(bytes, uint32_t(16));
+		append(bytes, uint16_t(1));
+		append(bytes, channel_count);
+		append(bytes, sample_rate);
+		append(bytes, uint32_t(sample_rate * channel_count * sizeof(int16_t)));
+		append(bytes, uint16_t(channel_count * sizeof(int16_t)));
+		append(bytes, uint16_t(16));
+		bytes += "data";
+		append(bytes, data_size);
+		bytes.append(reinterpret_cast<const char*>(samples.data()), data_size);
+		return bytes;
+	}
+
+	// Mixer output of the clip played alone, as interleaved stereo.
+	vector<int16_t> RenderClip(shared_ptr<const AudioClip> clip, bool loop, size_t frame_count)
+	{
+		const filesystem::path filename = filesystem::temp_directory_path() / "magicfour_render_test.wav";
+		{
+			AudioMixer mixer(make_unique<WaveFileAudioBackend>(filename.string().c_str(), AudioMixer::kSampleRate), 4, false);
+			mixer.Play(1, move(clip), loop);
+
+			// Uneven renders, so chunks of the stream are drained across renders.
+			for (size_t rendered = 0, step = 300; rendered < frame_count; rendered += step, step += 700)
+			{
+				mixer.Render((std::min)(step, frame_count - rendered));
+			}
+			EXPECT_EQ(mixer.GetStats().stream_underruns, 0u);
+		}
+
+		const string bytes = ReadFile(filename);
+		remove(filename.string().c_str());
+
+		const auto output = AudioClip::LoadWave(bytes, filename.string());
+		return vector<int16_t>(output->GetSamples(), output->GetSamples() + output->GetFrameCount() * 2);
+	}
+}
+
+TEST(AudioMixerTest, NullBackendCountsRenderedFrames)
+{
+	auto backend = make_unique<NullAudioBackend>();
+	NullAudioBackend* null_backend = backend.get();
+	AudioMixer mixer(move(backend), 4, false);
+
+	const AudioMixer::VoiceHandle voice = mixer.Play(1, MakeClip(1000, 3000));
+	ASSERT_NE(voice, AudioMixer::kNoVoice);
+
+	// Nothing is asked for on Update; Render writes whatever it is given.
+	mixer.Update();
+	EXPECT_EQ(null_backend->GetWrittenFrames(), 0u);
+
+	mixer.Render(2500);
+	EXPECT_EQ(null_backend->GetWrittenFrames(), 2500u);
+	EXPECT_TRUE(mixer.IsPlaying(voice));
+
+	mixer.Render(1000);
+	EXPECT_EQ(mixer.GetRenderedFrames(), 3500u);
+	EXPECT_FALSE(mixer.IsPlaying(voice));
+	EXPECT_EQ(mixer.GetActiveVoiceCount(), 0u);
+}
+
+TEST(AudioMixerTest, StealsLowerPriorityAndRejectsBelowAll)
+{
+	AudioMixer mixer(make_unique<NullAudioBackend>(), 2, false);
+	mixer.SetSoundSettings(1, MakeSettings(0, 4, 0.0f));
+	mixer.SetSoundSettings(2, MakeSettings(0, 4, 0.0f));
+	mixer.SetSoundSettings(3, MakeSettings(1, 4, 0.0f));
+	mixer.SetSoundSettings(4, MakeSettings(-1, 4, 0.0f));
+
+	const auto clip = MakeClip(1000, 44100);
+	const AudioMixer::VoiceHandle first = mixer.Play(1, clip);
+	mixer.Render(10);
+	const AudioMixer::VoiceHandle second = mixer.Play(2, clip);
+	mixer.Render(10);
+
+	// The pool is full, so the oldest voice of the lowest priority goes.
+	const AudioMixer::VoiceHandle important = mixer.Play(3, clip);
+	ASSERT_NE(important, AudioMixer::kNoVoice);
+	EXPECT_FALSE(mixer.IsPlaying(first));
+	EXPECT_TRUE(mixer.IsPlaying(second));
+	EXPECT_TRUE(mixer.IsPlaying(important));
+
+	// Every voice is above this one.
+	EXPECT_EQ(mixer.Play(4, clip), AudioMixer::kNoVoice);
+
+	const AudioMixer::Stats& stats = mixer.GetStats();
+	EXPECT_EQ(stats.plays, 4u);
+	EXPECT_EQ(stats.stolen, 1u);
+	EXPECT_EQ(stats.rejected, 1u);
+	EXPECT_EQ(stats.peak_voices, 2u);
+}
+
+TEST(AudioMixerTest, MaxInstancesRestartsTheOldest)
+{
+	AudioMixer mixer(make_unique<NullAudioBackend>(), 8, false);
+	mixer.SetSoundSettings(1, MakeSettings(0, 2, 0.0f));
+
+	const auto clip = MakeClip(1000, 44100);
+	vector<AudioMixer::VoiceHandle> voices;
+	for (int i = 0; i < 3; i++)
+	{
+		voices.push_back(mixer.Play(1, clip));
+		mixer.Render(10);
+	}
+
+	EXPECT_FALSE(mixer.IsPlaying(voices[0]));
+	EXPECT_TRUE(mixer.IsPlaying(voices[1]));
+	EXPECT_TRUE(mixer.IsPlaying(voices[2]));
+	EXPECT_EQ(mixer.GetActiveVoiceCount(), 2u);
+	EXPECT_EQ(mixer.GetStats().instance_limited, 1u);
+	EXPECT_EQ(mixer.GetStats().stolen, 0u);
+}
+
+TEST(AudioMixerTest, CoalescesTriggersWithinWindow)
+{
+	AudioMixer mixer(make_unique<NullAudioBackend>(), 8, false);
+	mixer.SetSoundSettings(1, MakeSettings(0, 4, 10.0f));  // 441 frames
+
+	const auto clip = MakeClip(1000, 44100);
+	const AudioMixer::VoiceHandle first = mixer.Play(1, clip);
+	mixer.Render(400);
+	EXPECT_EQ(mixer.Play(1, clip), first);
+
+	mixer.Render(100);
+	const AudioMixer::VoiceHandle second = mixer.Play(1, clip);
+	EXPECT_NE(second, first);
+
+	// A looping trigger is never merged.
+	EXPECT_NE(mixer.Play(1, clip, true), second);
+
+	EXPECT_EQ(mixer.GetStats().coalesced, 1u);
+	EXPECT_EQ(mixer.GetActiveVoiceCount(), 3u);
+}
+
+TEST(AudioMixerTest, WaveFileHoldsTheMix)
+{
+	const filesystem::path filename = filesystem::temp_directory_path() / "magicfour_mixer_test.wav";
+	{
+		AudioMixer mixer(make_unique<WaveFileAudioBackend>(filename.string().c_str(), AudioMixer::kSampleRate), 4, false);
+		mixer.SetSoundSettings(1, MakeSettings(0, 4, 0.0f));
+		mixer.SetSoundSettings(2, MakeSettings(0, 4, 0.0f));
+
+		// 1000 alone for 100 frames, then 1000 + 2000 for 200, then 2000 alone for 100, then silence.
+		mixer.Play(1, MakeClip(1000, 300));
+		mixer.Render(100);
+		mixer.Play(2, MakeClip(2000, 300));
+		mixer.Render(1900);
+	}
+
+	// The file completed by the backend is read back as a clip.
+	const string bytes = ReadFile(filename);
+	remove(filename.string().c_str());
+	const auto clip = AudioClip::LoadWave(bytes, filename.string());
+
+	ASSERT_EQ(clip->GetSampleRate(), AudioMixer::kSampleRate);
+	ASSERT_EQ(clip->GetChannelCount(), 2u);
+	ASSERT_EQ(clip->GetFrameCount(), 2000u);
+
+	const int16_t* samples = clip->GetSamples();
+	for (size_t frame = 0; frame < clip->GetFrameCount(); frame++)
+	{
+		int16_t expected = 0;
+		if (frame < 100) expected = 1000;
+		else if (frame < 300) expected = 3000;
+		else if (frame < 400) expected = 2000;
+
+		ASSERT_EQ(samples[frame * 2], expected) << "frame " << frame;
+		ASSERT_EQ(samples[frame * 2 + 1], expected) << "frame " << frame;
+	}
+}
+
+TEST(AudioMixerTest, StreamedClipMixesLikePcm)
+{
+	// Several chunks of the stream ring, and a partial one at the end.
+	constexpr size_t kClipFrames = 3 * 4096 + 123;
+
+	mt19937 random(7);
+	uniform_int_distribution<int> sample(-20000, 20000);
+	for (uint32_t sample_rate : { AudioMixer::kSampleRate, AudioMixer::kSampleRate / 2 })
+	{
+		for (uint16_t channel_count = 1; channel_count <= 2; channel_count++)
+		{
+			vector<int16_t> samples(kClipFrames * channel_count);
+			for (auto& value : samples) value = static_cast<int16_t>(sample(random));
+			const string bytes = MakeWave(sample_rate, channel_count, samples);
+
+			const auto pcm = AudioClip::LoadWave(bytes, "pcm.wav", AudioClip::Storage::kPcm);
+
+			// Streamed from the bytes in place, kept alive by the owner, and from a copy without one.
+			auto owner = make_shared<string>(bytes);
+			const auto streamed = AudioClip::LoadWave(*owner, "stream.wav", AudioClip::Storage::kStream, owner);
+			owner.reset();
+			const auto copied = AudioClip::LoadWave(bytes, "copy.wav", AudioClip::Storage::kStream);
+			ASSERT_EQ(streamed->GetStorage(), AudioClip::Storage::kStream);
+
+			for (bool loop : { false, true })
+			{
+				// Past the end of the clip, twice over when it is resampled.
+				const size_t frame_count = kClipFrames * 2 * AudioMixer::kSampleRate / sample_rate + 1000;
+				const vector<int16_t> expected = RenderClip(pcm, loop, frame_count);
+
+				EXPECT_EQ(RenderClip(streamed, loop, frame_count), expected)
+					<< sample_rate << " Hz, " << channel_count << " channels, loop " << loop;
+				EXPECT_EQ(RenderClip(copied, loop, frame_count), expected)
+					<< sample_rate << " Hz, " << channel_count << " channels, loop " << loop;
+			}
+		}
+	}
+}
@@ -0,0 +1,84 @@
+#include "audio/AudioRingBuffer.hh"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+TEST(AudioRingBufferTest, SpansStopAtTheWrap)
+{
+	AudioRingBuffer buffer(5, 2);
+	int16_t* write;
+	const int16_t* read;
+
+	ASSERT_EQ(buffer.PeekWrite(&write), 5u);
+	buffer.Commit(3);
+	ASSERT_EQ(buffer.PeekRead(&read), 3u);
+	buffer.Consume(3);
+
+	// Four frames free, but only two before the end of the storage.
+	EXPECT_EQ(buffer.GetWritableFrames(), 5u);
+	int16_t* tail;
+	ASSERT_EQ(buffer.PeekWrite(&tail), 2u);
+	buffer.Commit(2);
+
+	int16_t* head;
+	ASSERT_EQ(buffer.PeekWrite(&head), 3u);
+	EXPECT_EQ(head + 3 * 2, tail);
+	buffer.Commit(2);
+
+	EXPECT_EQ(buffer.GetReadableFrames(), 4u);
+	EXPECT_EQ(buffer.GetWritableFrames(), 1u);
+	ASSERT_EQ(buffer.PeekRead(&read), 2u);
+	EXPECT_EQ(read, tail);
+	buffer.Consume(2);
+	ASSERT_EQ(buffer.PeekRead(&read), 2u);
+	EXPECT_EQ(read, head);
+}
+
+TEST(AudioRingBufferTest, KeepsOrderOverManyWraps)
+{
+	constexpr size_t kCapacity = 7;
+	AudioRingBuffer buffer(kCapacity, 2);
+
+	// Frames numbered in both channels, written and read in sizes that wrap at every offset.
+	int16_t next_written = 0, next_read = 0;
+	for (int round = 0; round < 200; round++)
+	{
+		size_t to_write = 1 + round % 5;
+		while (to_write > 0 && buffer.GetWritableFrames() > 0)
+		{
+			int16_t* frames;
+			const size_t count = (std::min)(buffer.PeekWrite(&frames), to_write);
+			ASSERT_GT(count, 0u);
+			for (size_t i = 0; i < count; i++, next_written++)
+			{
+				frames[i * 2] = next_written;
+				frames[i * 2 + 1] = static_cast<int16_t>(-next_written);
+			}
+			buffer.Commit(count);
+			to_write -= count;
+		}
+		ASSERT_LE(buffer.GetReadableFrames(), kCapacity);
+
+		size_t to_read = 1 + round % 3;
+		while (to_read > 0 && buffer.GetReadableFrames() > 0)
+		{
+			const int16_t* frames;
+			const size_t count = (std::min)(buffer.PeekRead(&frames), to_read);
+			ASSERT_GT(count, 0u);
+			for (size_t i = 0; i < count; i++, next_read++)
+			{
+				ASSERT_EQ(frames[i * 2], next_read);
+				ASSERT_EQ(frames[i * 2 + 1], -next_read);
+			}
+			buffer.Consume(count);
+			to_read -= count;
+		}
+	}
+
+	EXPECT_GT(next_read, int16_t(kCapacity * 20));
+	EXPECT_EQ(size_t(next_written - next_read), buffer.GetReadableFrames());
+}
@@ -0,0 +1,87 @@
+#include "audio/ImaAdpcm.hh"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	// Interleaved tones of another pitch per channel, at 44.1 kHz.
+	vector<int16_t> MakeTones(size_t frame_count, uint32_t channel_count)
+	{
+		vector<int16_t> samples(frame_count * channel_count);
+		for (size_t frame = 0; frame < frame_count; frame++)
+		{
+			for (uint32_t c = 0; c < channel_count; c++)
+			{
+				const double phase = 2.0 * 3.14159265358979 * (440.0 + 110.0 * c) * frame / 44100.0;
+				samples[frame * channel_count + c] = static_cast<int16_t>(12000.0 * sin(phase));
+			}
+		}
+		return samples;
+	}
+}
+
+TEST(ImaAdpcmTest, BlockLayout)
+{
+	EXPECT_EQ(ImaAdpcm::GetFramesPerBlock(256, 1), 505u);
+	EXPECT_EQ(ImaAdpcm::GetFramesPerBlock(512, 2), 505u);
+	EXPECT_EQ(ImaAdpcm::GetFramesPerBlock(4, 1), 0u);
+	EXPECT_EQ(ImaAdpcm::GetFramesPerBlock(510, 2), 0u);
+
+	// The last block is padded.
+	const vector<int16_t> samples = MakeTones(1000, 2);
+	EXPECT_EQ(ImaAdpcm::Encode(samples.data(), 1000, 2).size(), 2 * 512u);
+}
+
+TEST(ImaAdpcmTest, RoundTripErrorIsBounded)
+{
+	constexpr size_t kFrameCount = 10000;
+	// The step size starts at its smallest, so the first frames lag behind a loud signal.
+	constexpr size_t kWarmUpFrames = 64;
+
+	for (uint32_t channel_count = 1; channel_count <= 2; channel_count++)
+	{
+		const vector<int16_t> samples = MakeTones(kFrameCount, channel_count);
+		const vector<uint8_t> blocks = ImaAdpcm::Encode(samples.data(), kFrameCount, channel_count);
+
+		const size_t block_bytes = ImaAdpcm::kBlockBytesPerChannel * channel_count;
+		const size_t frames_per_block = ImaAdpcm::GetFramesPerBlock(block_bytes, channel_count);
+		ASSERT_EQ(blocks.size() % block_bytes, 0u);
+
+		vector<int16_t> decoded(frames_per_block * channel_count);
+		double signal = 0.0, noise = 0.0;
+		int max_error = 0;
+		for (size_t block = 0; block * block_bytes < blocks.size(); block++)
+		{
+			ImaAdpcm::DecodeBlock(blocks.data() + block * block_bytes, block_bytes, channel_count, decoded.data());
+
+			for (size_t f = 0; f < frames_per_block && block * frames_per_block + f < kFrameCount; f++)
+			{
+				const size_t frame = block * frames_per_block + f;
+				for (uint32_t c = 0; c < channel_count; c++)
+				{
+					const int source = samples[frame * channel_count + c];
+					const int error = decoded[f * channel_count + c] - source;
+
+					// The first frame of a block is stored as it is.
+					if (f == 0) { EXPECT_EQ(error, 0) << "block " << block; }
+
+					if (frame < kWarmUpFrames) continue;
+					signal += double(source) * source;
+					noise += double(error) * error;
+					max_error = (std::max)(max_error, abs(error));
+				}
+			}
+		}
+
+		EXPECT_GT(10.0 * log10(signal / noise), 40.0) << channel_count << " channels";
+		EXPECT_LT(max_error, 256) << channel_count << " channels";
+	}
+}
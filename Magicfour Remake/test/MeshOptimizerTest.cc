@@ -0,0 +1,140 @@
+#include "graphics/MeshOptimizer.hh"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	// Triangles of a grid of (size + 1)^2 vertices, shuffled so they have no locality.
+	vector<uint32_t> MakeShuffledGrid(uint32_t size)
+	{
+		vector<array<uint32_t, 3> > triangles;
+		for (uint32_t y = 0; y < size; y++)
+		{
+			for (uint32_t x = 0; x < size; x++)
+			{
+				const uint32_t v = y * (size + 1) + x;
+				triangles.push_back({ v, v + size + 1, v + 1 });
+				triangles.push_back({ v + 1, v + size + 1, v + size + 2 });
+			}
+		}
+
+		shuffle(triangles.begin(), triangles.end(), mt19937(42));
+
+		vector<uint32_t> indices;
+		for (const auto& triangle : triangles) indices.insert(indices.end(), triangle.begin(), triangle.end());
+		return indices;
+	}
+
+	// Triangles rotated to start at their smallest index, which keeps the winding, then sorted.
+	vector<array<uint32_t, 3> > GetTriangleSet(const vector<uint32_t>& indices)
+	{
+		vector<array<uint32_t, 3> > triangles;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			array<uint32_t, 3> triangle = { indices[i], indices[i + 1], indices[i + 2] };
+			rotate(triangle.begin(), min_element(triangle.begin(), triangle.end()), triangle.end());
+			triangles.push_back(triangle);
+		}
+
+		sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+}
+
+TEST(MeshOptimizerTest, VertexCacheKeepsTrianglesAndLowersACMR)
+{
+	constexpr uint32_t kGridSize = 32;
+	constexpr size_t kVertexCount = (kGridSize + 1) * (kGridSize + 1);
+
+	vector<uint32_t> indices = MakeShuffledGrid(kGridSize);
+	const auto triangles_before = GetTriangleSet(indices);
+	const float acmr_before = MeshOptimizer::CalculateACMR(indices.data(), indices.size(), kVertexCount);
+
+	MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), kVertexCount);
+
+	EXPECT_EQ(GetTriangleSet(indices), triangles_before);
+
+	// A shuffled grid misses nearly every vertex; a good order reuses most of them.
+	const float acmr_after = MeshOptimizer::CalculateACMR(indices.data(), indices.size(), kVertexCount);
+	EXPECT_GT(acmr_before, 2.0f);
+	EXPECT_LT(acmr_after, 1.0f);
+}
+
+TEST(MeshOptimizerTest, VertexFetchRenumbersInFirstUseOrder)
+{
+	constexpr uint32_t kGridSize = 8;
+	constexpr size_t kVertexCount = (kGridSize + 1) * (kGridSize + 1) + 2;  // Two never referenced
+
+	const vector<uint32_t> source = MakeShuffledGrid(kGridSize);
+	vector<uint32_t> indices = source;
+	const vector<uint32_t> remap = MeshOptimizer::OptimizeVertexFetch(indices.data(), indices.size(), kVertexCount);
+
+	// The table is a permutation, and the indices were rewritten through it.
+	ASSERT_EQ(remap.size(), kVertexCount);
+	vector<uint32_t> sorted_remap = remap;
+	sort(sorted_remap.begin(), sorted_remap.end());
+	for (uint32_t v = 0; v < kVertexCount; v++) EXPECT_EQ(sorted_remap[v], v);
+
+	for (size_t i = 0; i < indices.size(); i++) EXPECT_EQ(indices[i], remap[source[i]]);
+
+	// Each new index is first used after every smaller one.
+	uint32_t next_vertex = 0;
+	for (uint32_t index : indices)
+	{
+		ASSERT_LE(index, next_vertex);
+		if (index == next_vertex) next_vertex++;
+	}
+
+	// The unreferenced vertices are numbered last, in their order.
+	EXPECT_EQ(remap[kVertexCount - 2], kVertexCount - 2);
+	EXPECT_EQ(remap[kVertexCount - 1], kVertexCount - 1);
+}
+
+TEST(MeshOptimizerTest, WeldThenFetchKeepsVertexData)
+{
+	struct Vertex
+	{
+		float position[3];
+		float texture[2];
+	};
+
+	// A quad as two triangles of separate corners, with a seam in the texture coordinates.
+	const vector<Vertex> corners =
+	{
+		{ { 0, 0, 0 }, { 0, 0 } }, { { 0, 1, 0 }, { 0, 1 } }, { { 1, 0, 0 }, { 1, 0 } },
+		{ { 1, 0, 0 }, { 1, 0 } }, { { 0, 1, 0 }, { 0, 1 } }, { { 1, 1, 0 }, { 1, 1 } },
+		{ { 1, 1, 0 }, { 0, 1 } }, { { 0, 0, 0 }, { 0, 0 } }, { { 1, 0, 0 }, { 1, 0 } },
+	};
+
+	vector<uint32_t> indices(corners.size());
+	const vector<uint32_t> firsts = MeshOptimizer::WeldVertices(corners.data(), corners.size(), sizeof(Vertex), indices.data());
+
+	// Identical corners share a vertex; the seam keeps its own.
+	ASSERT_EQ(firsts.size(), 5u);
+	EXPECT_EQ(indices[3], indices[2]);
+	EXPECT_EQ(indices[4], indices[1]);
+	EXPECT_EQ(indices[7], indices[0]);
+	EXPECT_NE(indices[6], indices[5]);
+
+	vector<Vertex> vertices;
+	for (uint32_t first : firsts) vertices.push_back(corners[first]);
+
+	const vector<uint32_t> remap = MeshOptimizer::OptimizeVertexFetch(indices.data(), indices.size(), vertices.size());
+	vector<Vertex> ordered(vertices.size());
+	for (size_t v = 0; v < vertices.size(); v++) ordered[remap[v]] = vertices[v];
+
+	// Every corner still reads its own data through both renumberings.
+	for (size_t i = 0; i < corners.size(); i++)
+	{
+		EXPECT_EQ(memcmp(&ordered[indices[i]], &corners[i], sizeof(Vertex)), 0) << "corner " << i;
+	}
+}
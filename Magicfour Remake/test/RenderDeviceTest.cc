@@ -0,0 +1,211 @@
+#include "graphics/ConstantRing.hh"
+#include "graphics/InstanceBuffer.hh"
+#include "graphics/NullRenderDevice.hh"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	using CallType = NullRenderDevice::CallType;
+
+	struct Constants
+	{
+		float values[16];
+	};
+
+	Constants MakeConstants(float value)
+	{
+		Constants constants;
+		for (float& v : constants.values) v = value;
+		return constants;
+	}
+
+	// The recorded calls, one short line each, for the calls a frame of draws makes.
+	vector<string> Describe(const NullRenderDevice& device)
+	{
+		vector<string> lines;
+		for (const auto& call : device.GetCalls())
+		{
+			const string handle = to_string(call.handle);
+			switch (call.type)
+			{
+			case CallType::kCreateBuffer: lines.push_back("create " + handle + " " + to_string(call.value)); break;
+			case CallType::kReleaseBuffer: lines.push_back("release " + handle); break;
+			case CallType::kUpdateBuffer: lines.push_back("update " + handle + " " + to_string(call.value)); break;
+			case CallType::kWriteBuffer:
+				lines.push_back("write " + handle + " " + to_string(call.offset) + "+" + to_string(call.value));
+				break;
+			case CallType::kSetShader: lines.push_back("shader " + handle); break;
+			case CallType::kSetVertexBuffer: lines.push_back("vb" + to_string(call.slot) + " " + handle); break;
+			case CallType::kSetConstantBuffer:
+				lines.push_back(string(call.value == uint64_t(ShaderStage::kVertex) ? "vs" : "ps") + to_string(call.slot)
+					+ " " + handle + " " + to_string(call.offset) + "+" + to_string(call.size));
+				break;
+			case CallType::kDrawIndexed: lines.push_back("draw " + to_string(call.index_count)); break;
+			case CallType::kBeginFrame: lines.push_back("begin"); break;
+			default: lines.push_back("other"); break;
+			}
+		}
+		return lines;
+	}
+}
+
+TEST(RenderDeviceTest, ConstantRingFrame)
+{
+	NullRenderDevice device;
+	ConstantRing ring(&device, 1024);
+
+	BufferDesc desc;
+	desc.type = BufferType::kVertex;
+	desc.size = 64;
+	const BufferHandle vertices = device.CreateBuffer(desc, MakeConstants(0.0f).values);
+
+	device.BeginFrame();
+	device.ClearCalls();
+
+	// The constants of a batch of three draws go up in one update.
+	ConstantRange ranges[3];
+	for (int i = 0; i < 3; i++) ranges[i] = ring.Push(MakeConstants(float(i + 1)));
+	ring.Upload();
+
+	for (int i = 0; i < 3; i++)
+	{
+		// Drawing the same mesh with the same shader, so only the ranges change.
+		device.SetShader(ShaderHandle{ 1 });
+		device.SetVertexBuffer(vertices, 64);
+		ring.Bind(ShaderStage::kVertex, 0, ranges[i]);
+		ring.Bind(ShaderStage::kPixel, 0, ranges[i]);
+		ring.Bind(ShaderStage::kVertex, 0, ranges[i]);
+		device.DrawIndexed(6);
+	}
+
+	// The next batch goes after it, without discarding what the draws above read.
+	const ConstantRange next = ring.Push(MakeConstants(4.0f));
+	ring.Upload();
+	ring.Bind(ShaderStage::kVertex, 0, next);
+	device.DrawIndexed(3);
+
+	const vector<string> expected =
+	{
+		"update 1 768",
+		"shader 1", "vb0 2", "vs0 1 0+256", "ps0 1 0+256", "draw 6",
+		"vs0 1 256+256", "ps0 1 256+256", "draw 6",
+		"vs0 1 512+256", "ps0 1 512+256", "draw 6",
+		"write 1 768+256",
+		"vs0 1 768+256", "draw 3",
+	};
+	EXPECT_EQ(Describe(device), expected);
+
+	// Shader and vertex buffer twice each, and the vertex range again, for each of the three draws.
+	const RenderStats& stats = device.GetFrameStats();
+	EXPECT_EQ(stats.redundant_binds, 2u + 2u + 3u);
+	EXPECT_EQ(stats.shader_binds, 1u);
+	EXPECT_EQ(stats.buffer_binds, 1u);
+	EXPECT_EQ(stats.constant_buffer_binds, 7u);
+	EXPECT_EQ(stats.draws, 4u);
+	EXPECT_EQ(stats.buffer_updates, 2u);
+	EXPECT_EQ(stats.bytes_uploaded, 1024u);
+
+	// What the last draw reads.
+	const vector<uint8_t>& data = device.GetBufferData(BufferHandle{ 1 });
+	EXPECT_EQ(memcmp(data.data() + 768, MakeConstants(4.0f).values, sizeof(Constants)), 0);
+	EXPECT_EQ(memcmp(data.data() + 256, MakeConstants(2.0f).values, sizeof(Constants)), 0);
+
+	device.ReleaseBuffer(vertices);
+}
+
+TEST(RenderDeviceTest, ConstantRingGrowsForALargeBatch)
+{
+	NullRenderDevice device;
+	{
+		ConstantRing ring(&device, 512);
+		device.BeginFrame();
+
+		for (int i = 0; i < 3; i++) ring.Push(MakeConstants(float(i)));
+		ring.Upload();
+	}
+
+	const vector<string> expected = { "create 1 512", "begin", "release 1", "create 2 1024", "update 2 768", "release 2" };
+	EXPECT_EQ(Describe(device), expected);
+	EXPECT_EQ(device.GetLiveBufferCount(), 0u);
+}
+
+TEST(RenderDeviceTest, InstanceBufferGrowsAndIsKept)
+{
+	struct Instance
+	{
+		float world[16];
+	};
+
+	NullRenderDevice device;
+	{
+		InstanceBuffer<Instance> instances(&device);
+
+		// Nothing pushed, nothing created.
+		instances.Upload(1);
+		EXPECT_TRUE(device.GetCalls().empty());
+
+		// Frames of 3, 5, 4 and 7 instances: it grows to the count, or to twice what it was.
+		for (int count : { 3, 5, 4, 7 })
+		{
+			instances.Clear();
+			for (int i = 0; i < count; i++) instances.Push().world[0] = float(count * 10 + i);
+			instances.Upload(1);
+			ASSERT_EQ(instances.GetCount(), uint32_t(count));
+		}
+
+		const vector<string> expected =
+		{
+			"create 1 " + to_string(3 * sizeof(Instance)), "update 1 " + to_string(3 * sizeof(Instance)), "vb1 1",
+			"release 1", "create 2 " + to_string(6 * sizeof(Instance)), "update 2 " + to_string(5 * sizeof(Instance)), "vb1 2",
+			"update 2 " + to_string(4 * sizeof(Instance)),
+			"release 2", "create 3 " + to_string(12 * sizeof(Instance)), "update 3 " + to_string(7 * sizeof(Instance)), "vb1 3",
+		};
+		EXPECT_EQ(Describe(device), expected);
+
+		// The frame of 4 kept the buffer and its binding.
+		EXPECT_EQ(device.GetFrameStats().redundant_binds, 1u);
+		EXPECT_EQ(device.GetLiveBufferCount(), 1u);
+
+		const vector<uint8_t>& data = device.GetBufferData(BufferHandle{ 3 });
+		Instance last;
+		memcpy(&last, data.data() + 6 * sizeof(Instance), sizeof(Instance));
+		EXPECT_EQ(last.world[0], 76.0f);
+	}
+
+	EXPECT_EQ(device.GetLiveBufferCount(), 0u);
+}
+
+TEST(RenderDeviceTest, CopiedRangesAreBoundAgainAfterAnUpdate)
+{
+	for (bool copies : { false, true })
+	{
+		NullRenderDevice device(copies);
+		ConstantRing ring(&device, 512);
+		device.BeginFrame();
+		device.ClearCalls();
+
+		// Two batches that fill the ring, so the second starts over where the first was bound.
+		for (int batch = 0; batch < 2; batch++)
+		{
+			const ConstantRange first = ring.Push(MakeConstants(float(batch * 2 + 1)));
+			ring.Push(MakeConstants(float(batch * 2 + 2)));
+			ring.Upload();
+			ring.Bind(ShaderStage::kVertex, 0, first);
+			device.DrawIndexed(6);
+		}
+
+		// In place, the bound range reads the new constants; a copy of it has to be made again.
+		vector<string> expected = { "update 1 512", "vs0 1 0+256", "draw 6", "update 1 512", "vs0 1 0+256", "draw 6" };
+		if (!copies) expected.erase(expected.begin() + 4);
+		EXPECT_EQ(Describe(device), expected) << "copies " << copies;
+		EXPECT_EQ(device.GetFrameStats().redundant_binds, copies ? 0u : 1u);
+	}
+}
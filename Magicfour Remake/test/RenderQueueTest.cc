@@ -0,0 +1,189 @@
+#include "graphics/ConstantRing.hh"
+#include "graphics/NullRenderDevice.hh"
+#include "graphics/RenderQueue.hh"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace DirectX;
+using namespace std;
+
+namespace
+{
+	// What a queue needs of a model: its bounds, and an id to batch and sort by.
+	struct FakeModel
+	{
+		FrustumCuller::BoundingVolume bounds;
+		uint32_t sort_id;
+
+		inline const FrustumCuller::BoundingVolume& GetBoundingVolume() const { return bounds; }
+	};
+
+	struct Command
+	{
+		const FakeModel* model;
+		XMMATRIX world_matrix;
+		uint64_t key;
+	};
+
+	struct Constants
+	{
+		float depth[4];
+	};
+
+	// Looking down +z from the origin.
+	XMMATRIX MakeViewProjection()
+	{
+		return XMMatrixPerspectiveFovLH(1.2f, 1.0f, 0.1f, 100.0f);
+	}
+
+	void PushCommand(RenderQueue<Command>& queue, const FakeModel& model, float x, float z)
+	{
+		Command& command = queue.Push();
+		command.model = &model;
+		command.world_matrix = XMMatrixTranslation(x, 0.0f, z);
+		command.key = RenderKey::Make(RenderPass::kOpaque, ShaderId::kLight, 0, model.sort_id);
+	}
+
+	vector<string> DescribeDraws(const NullRenderDevice& device)
+	{
+		using CallType = NullRenderDevice::CallType;
+
+		vector<string> lines;
+		for (const auto& call : device.GetCalls())
+		{
+			if (call.type == CallType::kUpdateBuffer) lines.push_back("update " + to_string(call.value));
+			else if (call.type == CallType::kWriteBuffer) lines.push_back("write " + to_string(call.offset) + "+" + to_string(call.value));
+			else if (call.type == CallType::kSetVertexBuffer) lines.push_back("model " + to_string(call.handle));
+			else if (call.type == CallType::kSetConstantBuffer) lines.push_back("constants " + to_string(call.offset));
+			else if (call.type == CallType::kDrawIndexedInstanced)
+				lines.push_back("draw " + to_string(call.instance_count) + " from " + to_string(call.start_instance));
+		}
+		return lines;
+	}
+}
+
+TEST(RenderQueueTest, RecordsASortedFrame)
+{
+	const FakeModel rock{ BoundingBox(XMFLOAT3(0, 0, 0), XMFLOAT3(1, 1, 1)), 1 };
+	const FakeModel tree{ BoundingSphere(XMFLOAT3(0, 0, 0), 1.0f), 2 };
+
+	NullRenderDevice device;
+	ConstantRing ring(&device, 4096);
+	// Vertex buffers by sort id, 3 and 4 after the ring.
+	const uint8_t vertices[64] = {};
+	BufferHandle model_buffers[3];
+	for (BufferHandle& buffer : model_buffers) buffer = device.CreateBuffer({ BufferType::kVertex, sizeof(vertices) }, vertices);
+
+	RenderQueue<Command> queue;
+
+	// Pushed out of order, from parallel chunks too, with one behind the camera.
+	PushCommand(queue, tree, 0.0f, 30.0f);
+	PushCommand(queue, rock, 0.0f, 20.0f);
+	RenderLane::ParallelFor(4, 1, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++) PushCommand(queue, (i % 2) ? tree : rock, 1.0f, 10.0f + i);
+		});
+	PushCommand(queue, rock, 0.0f, -20.0f);
+
+	CullStats cull_stats;
+	SortStats sort_stats;
+	const vector<SortEntry>& order = queue.Sort(MakeViewProjection(), cull_stats, sort_stats);
+	EXPECT_EQ(cull_stats.visible, 6u);
+	EXPECT_EQ(cull_stats.culled, 1u);
+	EXPECT_EQ(sort_stats.sorted, 6u);
+
+	// Grouped by model, and nearest first within a model: the lane pushes are rocks at 10 and 12
+	// and trees at 11 and 13, the first pushes a rock at 20 and a tree at 30.
+	vector<float> depths;
+	for (const SortEntry& entry : order) depths.push_back(XMVectorGetZ(queue[entry.index].world_matrix.r[3]));
+	EXPECT_EQ(depths, vector<float>({ 10, 12, 20, 11, 13, 30 }));
+
+	// A frame as the shaders record it: constants per batch, uploaded at once, then the draws.
+	device.BeginFrame();
+	device.ClearCalls();
+
+	struct Batch { uint32_t first, count; ConstantRange constants; };
+	vector<Batch> batches;
+	queue.ForEachBatch(order,
+		[](const Command& a, const Command& b) { return a.model->sort_id == b.model->sort_id; },
+		[&](uint32_t first, uint32_t count)
+		{
+			Constants constants = { { float(first), float(count), 0, 0 } };
+			batches.push_back({ first, count, ring.Push(constants) });
+		});
+	ring.Upload();
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		// The second pass binds nothing new, as in a shadow or depth pass over the same batches.
+		for (const Batch& batch : batches)
+		{
+			const FakeModel* model = queue[order[batch.first].index].model;
+			device.SetVertexBuffer(model_buffers[model->sort_id], 64);
+			ring.Bind(ShaderStage::kVertex, 0, batch.constants);
+			device.DrawIndexedInstanced(36, batch.count, 0, 0, batch.first);
+		}
+	}
+
+	const vector<string> expected =
+	{
+		"update 512",
+		"model 3", "constants 0", "draw 3 from 0",
+		"model 4", "constants 256", "draw 3 from 3",
+		"model 3", "constants 0", "draw 3 from 0",
+		"model 4", "constants 256", "draw 3 from 3",
+	};
+	EXPECT_EQ(DescribeDraws(device), expected);
+
+	// Every bind of the second pass changes what the first left bound, so none is redundant;
+	// binding the same batch twice in a row is.
+	EXPECT_EQ(device.GetFrameStats().redundant_binds, 0u);
+	ring.Bind(ShaderStage::kVertex, 0, batches.back().constants);
+	device.SetVertexBuffer(model_buffers[2], 64);
+	EXPECT_EQ(device.GetFrameStats().redundant_binds, 2u);
+	EXPECT_EQ(device.GetFrameStats().instances, 12u);
+
+	queue.Clear();
+	for (BufferHandle buffer : model_buffers) device.ReleaseBuffer(buffer);
+}
+
+TEST(RenderQueueTest, ForEachBatchGroupsNeighbours)
+{
+	const FakeModel rock{ BoundingBox(XMFLOAT3(0, 0, 0), XMFLOAT3(1, 1, 1)), 1 };
+	const FakeModel tree{ BoundingBox(XMFLOAT3(0, 0, 0), XMFLOAT3(1, 1, 1)), 2 };
+
+	RenderQueue<Command> queue;
+	const FakeModel* models[] = { &rock, &tree, &rock, &rock, &tree, &tree, &rock };
+	for (const FakeModel* model : models) PushCommand(queue, *model, 0.0f, 10.0f);
+
+	auto same_model = [](const Command& a, const Command& b) { return a.model == b.model; };
+	auto batches_of = [&](const vector<SortEntry>& order)
+	{
+		vector<pair<uint32_t, uint32_t> > batches;
+		queue.ForEachBatch(order, same_model, [&](uint32_t first, uint32_t count) { batches.emplace_back(first, count); });
+		return batches;
+	};
+
+	// Only neighbours in the order are grouped, whatever comes later.
+	vector<SortEntry> order;
+	for (uint32_t i = 0; i < 7; i++) order.push_back({ 0, i });
+	EXPECT_EQ(batches_of(order), (vector<pair<uint32_t, uint32_t> >{ { 0, 1 }, { 1, 1 }, { 2, 2 }, { 4, 2 }, { 6, 1 } }));
+
+	// The positions are in the order given, not in the queue.
+	order = { { 0, 0 }, { 0, 2 }, { 0, 3 }, { 0, 6 }, { 0, 1 }, { 0, 4 }, { 0, 5 } };
+	EXPECT_EQ(batches_of(order), (vector<pair<uint32_t, uint32_t> >{ { 0, 4 }, { 4, 3 } }));
+
+	order = { { 0, 5 } };
+	EXPECT_EQ(batches_of(order), (vector<pair<uint32_t, uint32_t> >{ { 0, 1 } }));
+
+	// Nothing visible, nothing drawn.
+	order.clear();
+	EXPECT_TRUE(batches_of(order).empty());
+
+	queue.Clear();
+}
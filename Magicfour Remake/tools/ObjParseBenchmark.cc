@@ -0,0 +1,297 @@
+// Times ObjParser against the stream based parser it replaced, on every OBJ given.
+// Usage: obj_parse_benchmark [--repeat N] [file or directory]...
+// Directories are searched for .obj files recursively; the default is data/model.
+// Run from the game directory, with release optimizations.
+
+#include "graphics/ObjParser.hh"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	// ModelClass::LoadModel before ObjParser: getline per line, a string stream per line and per corner.
+	// Kept as it was, on the same output, as the reference for timing and results.
+	bool ParseLegacy(const char* filename, ObjParser::Mesh& mesh)
+	{
+		struct Vertex { float x, y, z; };
+		vector<Vertex> v_list, vt_list, vn_list;
+		map<string, ObjParser::Material> meterial;
+
+		auto read_mtl_file = [&](const char* filename) {
+			string mtl_name = "";
+			ObjParser::Material curr_mtl = ObjParser::kDefaultMaterial;
+
+			ifstream fin(filename);
+			if (fin.fail()) return;
+
+			string buffer;
+			while (getline(fin, buffer))
+			{
+				istringstream iss(buffer);
+				getline(iss, buffer, ' ');
+
+				if (buffer == "#") continue; // case: comments
+				else if (buffer == "newmtl")
+				{
+					if (mtl_name.size() > 0)
+					{
+						meterial[mtl_name] = curr_mtl;
+						curr_mtl = ObjParser::kDefaultMaterial;
+					}
+					iss >> mtl_name;
+				}
+				else if (buffer == "Ka") iss >> curr_mtl.ambient.r >> curr_mtl.ambient.g >> curr_mtl.ambient.b;
+				else if (buffer == "Kd") iss >> curr_mtl.diffuse.r >> curr_mtl.diffuse.g >> curr_mtl.diffuse.b;
+				else if (buffer == "Ks") iss >> curr_mtl.specular.r >> curr_mtl.specular.g >> curr_mtl.specular.b;
+			}
+
+			if (mtl_name.size() > 0)
+			{
+				meterial[mtl_name] = curr_mtl;
+			}
+		};
+
+		mesh.corners.clear();
+		mesh.material_ranges.clear();
+		mesh.min[0] = mesh.min[1] = mesh.min[2] = FLT_MAX;
+		mesh.max[0] = mesh.max[1] = mesh.max[2] = -FLT_MAX;
+
+		ifstream fin(filename);
+		if (fin.fail()) return false;
+
+		string buffer;
+		while (getline(fin, buffer))
+		{
+			replace(buffer.begin(), buffer.end(), '\r', ' ');
+			istringstream iss(buffer);
+			getline(iss, buffer, ' ');
+
+			if (buffer == "#") continue; // case: comments
+			else if (buffer == "v")
+			{
+				float x, y, z;
+				iss >> x >> y >> z;
+				v_list.push_back({ x, y, z });
+
+				mesh.min[0] = (std::min)(mesh.min[0], x); mesh.min[1] = (std::min)(mesh.min[1], y); mesh.min[2] = (std::min)(mesh.min[2], z);
+				mesh.max[0] = (std::max)(mesh.max[0], x); mesh.max[1] = (std::max)(mesh.max[1], y); mesh.max[2] = (std::max)(mesh.max[2], z);
+			}
+			else if (buffer == "vt")
+			{
+				float x, y;
+				iss >> x >> y;
+				vt_list.push_back({ x, 1 - y, 0 });
+			}
+			else if (buffer == "vn")
+			{
+				float x, y, z;
+				iss >> x >> y >> z;
+				vn_list.push_back({ x, y, z });
+			}
+			else if (buffer == "f")
+			{
+				vector<ObjParser::Corner> face_v;
+				while (getline(iss, buffer, ' '))
+				{
+					if (buffer.size() == 0) continue;
+					face_v.push_back({});
+					istringstream point_iss(buffer);
+
+					getline(point_iss, buffer, '/');
+					int num = stoi(buffer) - 1;
+					if (num < 0 || num >= (int)v_list.size()) return false;
+
+					face_v.back().x = v_list[num].x;
+					face_v.back().y = v_list[num].y;
+					face_v.back().z = v_list[num].z;
+
+					if (getline(point_iss, buffer, '/') && !buffer.empty())
+					{
+						int num = stoi(buffer) - 1;
+						face_v.back().tu = vt_list[num].x;
+						face_v.back().tv = vt_list[num].y;
+					}
+
+					if (getline(point_iss, buffer, '/') && !buffer.empty())
+					{
+						int num = stoi(buffer) - 1;
+						face_v.back().nx = vn_list[num].x;
+						face_v.back().ny = vn_list[num].y;
+						face_v.back().nz = vn_list[num].z;
+					}
+					else if (face_v.size() >= 3)
+					{
+						// If normal vector is not defined, calculate it from first three points.
+						const float v1[3] = { face_v[1].x - face_v[0].x, face_v[1].y - face_v[0].y, face_v[1].z - face_v[0].z };
+						const float v2[3] = { face_v[2].x - face_v[0].x, face_v[2].y - face_v[0].y, face_v[2].z - face_v[0].z };
+						float normal[3] = { v1[1] * v2[2] - v1[2] * v2[1], v1[2] * v2[0] - v1[0] * v2[2], v1[0] * v2[1] - v1[1] * v2[0] };
+
+						const float length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+						if (length <= 0.001f) normal[0] = 0, normal[1] = 1, normal[2] = 0;
+						else normal[0] /= length, normal[1] /= length, normal[2] /= length;
+
+						for (auto& fv : face_v) fv.nx = normal[0], fv.ny = normal[1], fv.nz = normal[2];
+					}
+					else
+					{
+						for (auto& fv : face_v) fv.nx = 0, fv.ny = 1, fv.nz = 0;
+					}
+				}
+
+				for (size_t i = 0; i + 2 < face_v.size(); i++)
+				{
+					mesh.corners.push_back(face_v[0]);
+					mesh.corners.push_back(face_v[i + 1]);
+					mesh.corners.push_back(face_v[i + 2]);
+				}
+			}
+			else if (buffer == "mtllib")
+			{
+				string path = string(filename);
+				path = path.substr(0, path.find_last_of('/') + 1);
+				iss >> buffer;
+
+				read_mtl_file((path + buffer).c_str());
+			}
+			else if (buffer == "usemtl")
+			{
+				iss >> buffer;
+				if (meterial.find(buffer) == meterial.end()) continue;
+				mesh.material_ranges.emplace_back(meterial[buffer], (int)mesh.corners.size());
+			}
+		}
+
+		if (mesh.material_ranges.empty()) mesh.material_ranges.emplace_back(ObjParser::kDefaultMaterial, 0);
+		return true;
+	}
+
+	// The whole file is read, as FileSystem maps it, so the read is timed along with the parse.
+	bool ParseCurrent(const char* filename, ObjParser::Mesh& mesh)
+	{
+		auto read_file = [](const string& path, string& content)
+		{
+			ifstream fin(path, ios::binary);
+			if (fin.fail()) return false;
+			content.assign(istreambuf_iterator<char>(fin), istreambuf_iterator<char>());
+			return true;
+		};
+
+		string text;
+		if (!read_file(filename, text)) return false;
+
+		const string path(filename);
+		const string directory = path.substr(0, path.find_last_of("/\\") + 1);
+		auto load_materials = [&](string_view library_name, ObjParser::MaterialMap& materials)
+		{
+			string mtl_text;
+			if (read_file(directory + string(library_name), mtl_text)) ObjParser::ParseMaterials(mtl_text, materials);
+		};
+
+		return ObjParser::ParseModel(text, load_materials, mesh);
+	}
+
+	// Largest difference between the corners of both parsers, or infinity if their counts differ.
+	float CompareMeshes(const ObjParser::Mesh& a, const ObjParser::Mesh& b)
+	{
+		if (a.corners.size() != b.corners.size() || a.material_ranges.size() != b.material_ranges.size()) return INFINITY;
+
+		float difference = 0.0f;
+		for (size_t i = 0; i < a.corners.size(); i++)
+		{
+			const float* x = &a.corners[i].x;
+			const float* y = &b.corners[i].x;
+			for (int j = 0; j < 8; j++) difference = (std::max)(difference, fabs(x[j] - y[j]));
+		}
+		return difference;
+	}
+
+	template <typename Parse>
+	double TimeParse(Parse parse, const char* filename, int repeat, ObjParser::Mesh& mesh)
+	{
+		double best = INFINITY;
+		for (int i = 0; i < repeat; i++)
+		{
+			const auto start = chrono::steady_clock::now();
+			if (!parse(filename, mesh)) return -1.0;
+			const chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+			best = (std::min)(best, elapsed.count());
+		}
+		return best;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int repeat = 5;
+	vector<string> paths;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) repeat = (std::max)(1, atoi(argv[++i]));
+		else paths.push_back(argv[i]);
+	}
+	if (paths.empty()) paths.push_back("data/model");
+
+	vector<string> filenames;
+	for (const auto& path : paths)
+	{
+		if (!filesystem::is_directory(path))
+		{
+			filenames.push_back(path);
+			continue;
+		}
+
+		for (const auto& entry : filesystem::recursive_directory_iterator(path))
+		{
+			if (entry.is_regular_file() && entry.path().extension() == ".obj") filenames.push_back(entry.path().generic_string());
+		}
+	}
+	sort(filenames.begin(), filenames.end());
+
+	if (filenames.empty())
+	{
+		fprintf(stderr, "No OBJ files found.\n");
+		return 1;
+	}
+
+	printf("%-48s %10s %10s %12s %12s %8s %10s\n", "file", "bytes", "corners", "legacy ms", "current ms", "speedup", "max diff");
+
+	double legacy_total = 0.0, current_total = 0.0;
+	int failed = 0;
+	for (const auto& filename : filenames)
+	{
+		ObjParser::Mesh legacy_mesh, current_mesh;
+		const double legacy_ms = TimeParse(ParseLegacy, filename.c_str(), repeat, legacy_mesh);
+		const double current_ms = TimeParse(ParseCurrent, filename.c_str(), repeat, current_mesh);
+		if (legacy_ms < 0.0 || current_ms < 0.0)
+		{
+			printf("%-48s failed to parse\n", filename.c_str());
+			failed++;
+			continue;
+		}
+
+		legacy_total += legacy_ms;
+		current_total += current_ms;
+		printf("%-48s %10llu %10zu %12.3f %12.3f %7.1fx %10.2g\n", filename.c_str(),
+			static_cast<unsigned long long>(filesystem::file_size(filename)), current_mesh.corners.size(),
+			legacy_ms, current_ms, legacy_ms / current_ms, CompareMeshes(legacy_mesh, current_mesh));
+	}
+
+	printf("%-48s %10s %10s %12.3f %12.3f %7.1fx\n", "total", "", "", legacy_total, current_total,
+		current_total > 0.0 ? legacy_total / current_total : 0.0);
+
+	return failed ? 1 : 0;
+}